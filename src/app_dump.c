@@ -4,12 +4,15 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <libgen.h>
 #include <getopt.h>
 
 #include "zlmb.h"
 #include "dump.h"
+#include "stack.h"
+#include "ttl.h"
 #include "log.h"
 
 #define ZLMB_SYSLOG_IDENT "zlmb-cli"
@@ -17,6 +20,35 @@
 static int _syslog = 0;
 static int _verbose = 0;
 
+static void
+_clear(zlmb_stack_t *stack)
+{
+    while (zlmb_stack_size(stack)) {
+        zmq_msg_t *zmsg = zlmb_stack_shift(stack);
+        if (zmsg) {
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+    }
+}
+
+/* ttl: expired message (frame of the client stage) */
+static int
+_expired(zlmb_stack_t *stack)
+{
+    zlmb_stack_item_t *item = zlmb_stack_last(stack);
+    zmq_msg_t *zmsg;
+
+    if (!item || zlmb_stack_size(stack) < 2) {
+        return 0;
+    }
+
+    zmsg = zlmb_stack_item_data(item);
+
+    return zlmb_ttl_check(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                          zlmb_ttl_now()) == ZLMB_TTL_EXPIRED;
+}
+
 static void
 _usage(char *arg, char *message)
 {
@@ -44,6 +76,8 @@ main (int argc, char **argv)
     int opt, continued = 0;
     char *endpoint = NULL;
     zlmb_dump_t *dump;
+    zlmb_stack_t *stack;
+    uint64_t messages = 0, expired = 0;
 #ifndef NDEBUG
     int silent = 0;
 #endif
@@ -154,45 +188,100 @@ main (int argc, char **argv)
         _ERR("Read in dump file: %s\n", argv[optind]);
     }
 
+    stack = zlmb_stack_init();
+    if (!stack) {
+        _ERR("Message stack initilize.\n");
+        zlmb_dump_destroy(&dump);
+        if (socket)  {
+            zmq_close(socket);
+            zmq_ctx_destroy(context);
+        }
+        _LOG_CLOSE();
+        return -1;
+    }
+
     _VERBOSE("Read start dump.\n");
 
     while (1) {
         int flags;
-        zmq_msg_t zmsg;
+        zmq_msg_t *zmsg;
 
-        flags = zlmb_dump_read(dump, &zmsg);
-        if (flags == 0) {
+        zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
+        if (!zmsg || zmq_msg_init(zmsg) != 0) {
+            _ERR("Memory allocate in read.\n");
+            free(zmsg);
             break;
-        } else if (flags == -1) {
+        }
+
+        flags = zlmb_dump_read(dump, zmsg);
+        if (flags == -1) {
             _ERR("Read format dump file: %s\n", argv[optind]);
+            zmq_msg_close(zmsg);
+            free(zmsg);
             break;
         }
 
-        if (zmq_msg_size(&zmsg) == 0) {
-            zmq_msg_close(&zmsg);
+        /* end of file */
+        if (zmq_msg_size(zmsg) == 0) {
+            zmq_msg_close(zmsg);
+            free(zmsg);
             break;
         }
 
-#ifndef NDEBUG
-        if (!silent) {
-            zlmb_dump_printmsg(stderr, &zmsg);
+        if (zlmb_stack_push(stack, zmsg) != 0) {
+            _ERR("Message stack push.\n");
+            zmq_msg_close(zmsg);
+            free(zmsg);
+            break;
         }
-#endif
 
-        if (socket)  {
-            _DEBUG("ZeroMQ send.\n");
-            if (zmq_sendmsg(socket, &zmsg, flags) == -1) {
-                _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
-            }
+        if (flags != 0) {
+            continue;
+        }
+
+        /* message: all frames are read */
+        if (_expired(stack)) {
+            _DEBUG("Drop expired message.\n");
+            expired++;
+            _clear(stack);
+            continue;
         }
 
-        zmq_msg_close(&zmsg);
+        messages++;
 
-        if (!continued && flags == 0) {
+        while (zlmb_stack_size(stack)) {
+            zmsg = zlmb_stack_shift(stack);
+            if (!zmsg) {
+                continue;
+            }
+#ifndef NDEBUG
+            if (!silent) {
+                zlmb_dump_printmsg(stderr, zmsg);
+            }
+#endif
+            if (socket)  {
+                _DEBUG("ZeroMQ send.\n");
+                if (zmq_sendmsg(socket, zmsg,
+                                zlmb_stack_size(stack) ? ZMQ_SNDMORE : 0)
+                    == -1) {
+                    _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
+                }
+            }
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+
+        if (!continued) {
             break;
         }
     }
 
+    _clear(stack);
+    zlmb_stack_destroy(&stack);
+
+    _VERBOSE("Messages: %llu (expired: %llu)\n",
+             (unsigned long long)messages, (unsigned long long)expired);
+
     _VERBOSE("Read end dump.\n");
 
     zlmb_dump_close(dump);
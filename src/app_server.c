@@ -8,11 +8,13 @@
 #include <libgen.h>
 #include <signal.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <getopt.h>
 #include <syslog.h>
+#include <fnmatch.h>
 
 #include <yaml.h>
 
@@ -22,6 +24,17 @@
 #include "dump.h"
 #include "log.h"
 #include "utils.h"
+#include "ratelimit.h"
+#include "stack.h"
+#include "dedup.h"
+#include "sequence.h"
+#include "replay.h"
+#include "journal.h"
+#include "codec.h"
+#include "syslogd.h"
+#include "sink.h"
+#include "memory.h"
+#include "ttl.h"
 
 #ifdef USE_SNAPPY
 #    include <snappy-c.h>
@@ -37,6 +50,9 @@
 #define ZLMB_SENDMSG_UNCOMPRESS 4
 
 #define ZLMB_CLIENT_BACKEND_INPROC_SOCKET  "inproc://zlmb.client.backend"
+#define ZLMB_CLIENT_SYSLOG_INPROC_SOCKET   "inproc://zlmb.client.syslog"
+#define ZLMB_CLIENT_PRIORITY_INPROC_SOCKET "inproc://zlmb.client.priority"
+#define ZLMB_CLIENT_PRIORITY_KEY_SIZE      256
 #define ZLMB_CLIENT_PUBLISH_MONITOR_SOCKET "inproc://zlmb.publish.monitor"
 #define ZLMB_SUBSCRIBE_MONITOR_SOCKET      "inproc://zlmb.subscribe.monitor"
 
@@ -48,12 +64,21 @@
 #define _PUB_SUB(_l, ...) _##_l(ZLMB_OPTION_MODE_PUBLISH_SUBSCRIBE": "__VA_ARGS__)
 #define _CLI_SUB(_l, ...) _##_l(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE": "__VA_ARGS__)
 #define _ALONE(_l, ...) _##_l(ZLMB_OPTION_MODE_STAND_ALONE": "__VA_ARGS__)
+#define _PIPELINE(_l, ...) _##_l(ZLMB_OPTION_MODE_PIPELINE": "__VA_ARGS__)
 
 static int _interrupted = 0;
+static int _wakeup[2] = { -1, -1 };
 static int _syslog = 0;
 static int _verbose = 0;
+static int _stats_interval = 0;
+static zlmb_memory_t *_memory = NULL;
+static zlmb_ttl_t *_ttl = NULL;
 static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t _mutex_monitor = PTHREAD_MUTEX_INITIALIZER;
+static void *_pipeline_context = NULL;
+static int _pipeline_ready = 0;
+static pthread_mutex_t _pipeline_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _pipeline_cond = PTHREAD_COND_INITIALIZER;
 
 typedef struct {
     pthread_t thread;
@@ -61,6 +86,8 @@ typedef struct {
     char *endpoint;
     int event;
     char *mode;
+    int wakeup;
+    int fd[2];
 } zlmb_socket_monitor_t;
 
 typedef struct {
@@ -84,12 +111,145 @@ typedef struct {
     char *dumpfile;
     int dumptype;
     char *mode;
+    int codec;
+    char *priority;
+    int weight;
+    char *priority_endpoints;
+    void *priority_socket;
+    uint64_t priority_messages;
 } zlmb_client_backend_t;
 
+typedef struct {
+    pthread_t thread;
+    void *context;
+    zlmb_syslogd_t *syslogd;
+    char *endpoints;
+    int key;
+    char *mode;
+} zlmb_client_syslog_t;
+
+typedef struct {
+    zlmb_ratelimit_t *ratelimit;
+    zlmb_sequence_t *sequence;
+    zlmb_replay_t *replay;
+    char *replayendpoint;
+    void *replay_socket;
+    zlmb_journal_t *journal;
+    char *journalendpoint;
+    void *journal_socket;
+    char *priority_frontendpoint;
+    char *priority_backendpoint;
+    void *priority_frontend;
+    void *priority_backend;
+    uint64_t priority_messages;
+} zlmb_publish_stage_t;
+
+#define ZLMB_SUBSCRIBE_REPLAY_MAX 16
+#define ZLMB_SUBSCRIBE_SOCKET_MAX (ZLMB_SUBSCRIBE_REPLAY_MAX + 3)
+#define ZLMB_SUBSCRIBE_JOURNAL_TIMEOUT 10
+
+typedef struct {
+    zlmb_dedup_t *dedup;
+    zlmb_sequence_tracker_t *sequence;
+    char *replayendpoints;
+    int replay_catchup;
+    int replay_count;
+    char *key;
+    size_t key_len;
+    void *replay[ZLMB_SUBSCRIBE_REPLAY_MAX];
+    uint64_t replay_requests;
+    char *journalendpoint;
+    char *journal_offsetfile;
+    void *journal;
+    int journal_partition;
+    int journal_partitions;
+    int journal_pending;
+    int journal_dirty;
+    uint64_t journal_next;
+    uint64_t journal_round;
+    uint64_t journal_received;
+    uint64_t journal_removed;
+    uint64_t journal_offset[ZLMB_JOURNAL_PARTITIONS_MAX];
+    zlmb_codec_t *codec;
+    zlmb_sink_t *sink;
+    int ttl;
+    uint64_t ttl_expired;
+    uint64_t ttl_expired_bytes;
+    char *priority_endpoints;
+    void *priority;
+    uint64_t priority_messages;
+} zlmb_subscribe_stage_t;
+
+static int
+_wakeup_init(int *fd)
+{
+    if (pipe(fd) == -1) {
+        fd[0] = fd[1] = -1;
+        return -1;
+    }
+
+    fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fd[1], F_SETFL, fcntl(fd[1], F_GETFL) | O_NONBLOCK);
+
+    return 0;
+}
+
 static void
-_signal_handler(int sig)
+_wakeup_destroy(int *fd)
+{
+    if (fd[0] != -1) {
+        close(fd[0]);
+    }
+    if (fd[1] != -1) {
+        close(fd[1]);
+    }
+    fd[0] = fd[1] = -1;
+}
+
+static void
+_wakeup_drain(int *fd)
+{
+    char buf[64];
+
+    while (read(fd[0], buf, sizeof(buf)) > 0) {
+        ;
+    }
+}
+
+static int
+_wakeup_pollitem(int *fd, zmq_pollitem_t *pollitem)
 {
+    if (fd[0] == -1) {
+        return 0;
+    }
+
+    pollitem->socket = NULL;
+    pollitem->fd = fd[0];
+    pollitem->events = ZMQ_POLLIN;
+    pollitem->revents = 0;
+
+    return 1;
+}
+
+static void
+_interrupt(void)
+{
+    char c = 0;
+
     _interrupted = 1;
+
+    /* wakeup: never drained, every poll loop returns (signal safe) */
+    if (_wakeup[1] != -1) {
+        if (write(_wakeup[1], &c, 1) == -1) {
+            return;
+        }
+    }
+}
+
+static void
+_signal_handler(int sig)
+{
+    _interrupt();
 }
 
 static void
@@ -104,6 +264,115 @@ _signals(void)
     sigaction(SIGTERM, &sa, NULL);
 }
 
+static void *
+_context_new(void)
+{
+    /* pipeline: stages share the context (inproc endpoints) */
+    if (_pipeline_context) {
+        return _pipeline_context;
+    }
+
+    return zmq_ctx_new();
+}
+
+static void
+_context_destroy(void *context)
+{
+    if (context != _pipeline_context) {
+        zmq_ctx_destroy(context);
+    }
+}
+
+static int
+_bind_endpoints(void *socket, char *endpoints, char *name, char *mode)
+{
+    char *endpoint, *token;
+
+    /* endpoints: fair-queued by the socket (tcp://, ipc://, ...) */
+    endpoint = strdup(endpoints);
+    if (!endpoint) {
+        _MODE(ERR, "Memory allocate endpoints.\n", mode);
+        return -1;
+    }
+
+    token = endpoint;
+
+    while (1) {
+        char *end;
+
+        end = strtok(token, ",");
+        if (end == NULL) {
+            break;
+        }
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        if (zmq_bind(socket, end) == -1) {
+            _MODE(ERR, "ZeroMQ %s bind: %s: %s\n",
+                  mode, name, end, zmq_strerror(errno));
+            free(endpoint);
+            return -1;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ %s bind: %s\n", mode, name, end);
+
+        token = NULL;
+    }
+
+    free(endpoint);
+
+    return 0;
+}
+
+static void
+_unbind_endpoints(void *socket, char *endpoints, char *name, char *mode)
+{
+    char *endpoint, *token;
+
+    endpoint = strdup(endpoints);
+    if (!endpoint) {
+        return;
+    }
+
+    token = endpoint;
+
+    while (1) {
+        char *end;
+
+        end = strtok(token, ",");
+        if (end == NULL) {
+            break;
+        }
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ %s unbind: %s\n", mode, name, end);
+        zmq_unbind(socket, end);
+
+        token = NULL;
+    }
+
+    free(endpoint);
+}
+
+static void
+_pipeline_started(void)
+{
+    if (!_pipeline_context) {
+        return;
+    }
+
+    /* pipeline: sockets are bound, start the next stage */
+    pthread_mutex_lock(&_pipeline_mutex);
+    _pipeline_ready++;
+    pthread_cond_signal(&_pipeline_cond);
+    pthread_mutex_unlock(&_pipeline_mutex);
+}
+
 static void
 _socket_monitor_destroy(zlmb_socket_monitor_t **self)
 {
@@ -112,6 +381,7 @@ _socket_monitor_destroy(zlmb_socket_monitor_t **self)
             free((*self)->endpoint);
             (*self)->endpoint = NULL;
         }
+        _wakeup_destroy((*self)->fd);
         free(*self);
         *self = NULL;
     }
@@ -138,6 +408,13 @@ _socket_monitor_init(void *context, void *socket, char *endpoint, char *mode)
     self->event = 0;
     self->mode = mode;
 
+    /* wakeup: poll loop of the owner */
+    if (_wakeup_init(self->fd) == -1) {
+        _MODE(ERR, "Monitor wakeup pipe.\n", mode);
+        _socket_monitor_destroy(&self);
+        return NULL;
+    }
+
     //if (zmq_socket_monitor(socket, self->endpoint, ZMQ_EVENT_ALL) == -1) {
     if (zmq_socket_monitor(socket, self->endpoint,
                            ZMQ_EVENT_CONNECTED | ZMQ_EVENT_DISCONNECTED
@@ -150,6 +427,42 @@ _socket_monitor_init(void *context, void *socket, char *endpoint, char *mode)
     return self;
 }
 
+static void
+_socket_monitor_wakeup(zlmb_socket_monitor_t *self)
+{
+    char c = 0;
+
+    /* mutex locked: one byte until the owner drains */
+    if (!self->wakeup) {
+        if (write(self->fd[1], &c, 1) == 1) {
+            self->wakeup = 1;
+        }
+    }
+}
+
+static void
+_socket_monitor_drain(zlmb_socket_monitor_t *self)
+{
+    if (!self->wakeup) {
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    _wakeup_drain(self->fd);
+    self->wakeup = 0;
+    pthread_mutex_unlock(&_mutex);
+}
+
+static int
+_socket_monitor_pollitem(zlmb_socket_monitor_t *self, zmq_pollitem_t *pollitem)
+{
+    if (!self) {
+        return 0;
+    }
+
+    return _wakeup_pollitem(self->fd, pollitem);
+}
+
 static void *
 _socket_monitor_event(void *arg)
 {
@@ -159,7 +472,7 @@ _socket_monitor_event(void *arg)
 
     if (!self) {
         _MODE(ERR, "Function arguments: %s\n", self->mode, __FUNCTION__);
-        _interrupted = 1;
+        _interrupt();
         pthread_mutex_unlock(&_mutex_monitor);
         return NULL;
     }
@@ -168,7 +481,7 @@ _socket_monitor_event(void *arg)
     if (!socket) {
         _MODE(ERR, "ZeroMQ monitor socket: %s\n",
               self->mode, zmq_strerror(errno));
-        _interrupted = 1;
+        _interrupt();
         pthread_mutex_unlock(&_mutex_monitor);
         return NULL;
     }
@@ -179,7 +492,7 @@ _socket_monitor_event(void *arg)
         _MODE(ERR, "ZeroMQ monitor connect: %s\n",
               self->mode, zmq_strerror(errno));
         zmq_close(socket);
-        _interrupted = 1;
+        _interrupt();
         pthread_mutex_unlock(&_mutex_monitor);
         return NULL;
     }
@@ -209,6 +522,7 @@ _socket_monitor_event(void *arg)
                           self->mode, self->endpoint);
                     pthread_mutex_lock(&_mutex);
                     self->event |= ZMQ_EVENT_CONNECTED;
+                    _socket_monitor_wakeup(self);
                     pthread_mutex_unlock(&_mutex);
                     break;
                 case ZMQ_EVENT_ACCEPTED:
@@ -216,6 +530,7 @@ _socket_monitor_event(void *arg)
                           self->mode, self->endpoint);
                     pthread_mutex_lock(&_mutex);
                     self->event |= ZMQ_EVENT_ACCEPTED;
+                    _socket_monitor_wakeup(self);
                     pthread_mutex_unlock(&_mutex);
                     break;
                 case ZMQ_EVENT_DISCONNECTED:
@@ -223,6 +538,7 @@ _socket_monitor_event(void *arg)
                           self->mode, self->endpoint);
                     pthread_mutex_lock(&_mutex);
                     self->event |= ZMQ_EVENT_DISCONNECTED;
+                    _socket_monitor_wakeup(self);
                     pthread_mutex_unlock(&_mutex);
                     break;
                 /*
@@ -245,6 +561,46 @@ _socket_monitor_event(void *arg)
     return NULL;
 }
 
+#ifdef USE_SNAPPY
+static int
+_msg_compress(zmq_msg_t *zmsg, char *mode)
+{
+    _MODE(DEBUG, "Compress message.\n", mode);
+
+    if (zlmb_codec_message(zmsg, ZLMB_CODEC_COMPRESS) != 0) {
+        _MODE(ERR, "Compress Snappy.\n", mode);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* memory: buffer of zlmb_memory_alloc passed to ZeroMQ (no copy) and
+ * counted until written, freed on error */
+static int
+_send(void *socket, void *data, size_t size, int flags)
+{
+    zmq_msg_t zmsg;
+    int err;
+
+    if (zlmb_memory_data(_memory, &zmsg, data, size) != 0) {
+        err = errno;
+        zlmb_memory_free(data);
+        errno = err;
+        return -1;
+    }
+
+    if (zmq_sendmsg(socket, &zmsg, flags) == -1) {
+        err = errno;
+        zmq_msg_close(&zmsg);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
 static int
 _sendmsg(int type, void *socket, zmq_msg_t *zmsg, int flags,
          zlmb_dump_t *dump, char *mode)
@@ -253,25 +609,31 @@ _sendmsg(int type, void *socket, zmq_msg_t *zmsg, int flags,
     char *in = NULL, *out = NULL;
 
 #ifdef USE_SNAPPY
+    /* ttl frame: read before uncompress */
+    if ((type == ZLMB_SENDMSG_COMPRESS || type == ZLMB_SENDMSG_UNCOMPRESS) &&
+        zlmb_ttl_parse(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                       NULL, NULL) == 0) {
+        type = ZLMB_SENDMSG;
+    }
+
     if (type == ZLMB_SENDMSG_COMPRESS) {
         _MODE(DEBUG, "Compress message.\n", mode);
         in_len = zmq_msg_size(zmsg);
         out_len = snappy_max_compressed_length(in_len);
         in = zmq_msg_data(zmsg);
-        out = (char *)malloc(out_len);
+        out = (char *)zlmb_memory_alloc(out_len);
         if (out) {
             if (snappy_compress(in, in_len, out, &out_len) == SNAPPY_OK) {
-                if (zmq_send(socket, out, out_len, flags) != -1) {
-                    free(out);
+                /* out: owned by the message */
+                if (_send(socket, out, out_len, flags) != -1) {
                     return 0;
-                } else {
-                    _MODE(ERR, "ZeroMQ compress send: %s\n",
-                          mode, zmq_strerror(errno));
                 }
+                _MODE(ERR, "ZeroMQ compress send: %s\n",
+                      mode, zmq_strerror(errno));
             } else {
                 _MODE(ERR, "Compress Snappy.\n", mode);
+                zlmb_memory_free(out);
             }
-            free(out);
         } else {
             _MODE(ERR, "Memory allocate in compress.\n", mode);
         }
@@ -281,20 +643,19 @@ _sendmsg(int type, void *socket, zmq_msg_t *zmsg, int flags,
         in = zmq_msg_data(zmsg);
         in_len = zmq_msg_size(zmsg);
         if (snappy_uncompressed_length(in, in_len, &out_len) == SNAPPY_OK) {
-            out = (char *)malloc(out_len);
+            out = (char *)zlmb_memory_alloc(out_len);
             if (out) {
                 if (snappy_uncompress(in, in_len, out, &out_len) == SNAPPY_OK) {
-                    if (zmq_send(socket, out, out_len, flags) != -1) {
-                        free(out);
+                    /* out: owned by the message */
+                    if (_send(socket, out, out_len, flags) != -1) {
                         return 0;
-                    } else {
-                        _MODE(ERR, "ZeroMQ uncompress send: %s\n",
-                              mode, zmq_strerror(errno));
                     }
+                    _MODE(ERR, "ZeroMQ uncompress send: %s\n",
+                          mode, zmq_strerror(errno));
                 } else {
                     _MODE(ERR, "Uncompress Snappy.\n", mode);
+                    zlmb_memory_free(out);
                 }
-                free(out);
             } else {
                 _MODE(ERR, "Memory allocate in compress.\n", mode);
             }
@@ -306,6 +667,9 @@ _sendmsg(int type, void *socket, zmq_msg_t *zmsg, int flags,
 #endif
 
     if (type == ZLMB_SENDMSG) {
+        if (_memory && zlmb_memory_message(_memory, zmsg) == -1) {
+            _MODE(ERR, "Memory allocate in send message.\n", mode);
+        }
         if (zmq_sendmsg(socket, zmsg, flags) != -1) {
             return 0;
         } else {
@@ -328,355 +692,2915 @@ _sendmsg(int type, void *socket, zmq_msg_t *zmsg, int flags,
     return -1;
 }
 
-static void
-_client_publish_destroy(zlmb_client_publish_t **self)
+static int
+_stats_expired(uint64_t *next)
 {
-    if (*self) {
-        if ((*self)->sockets) {
-            int i;
-            for (i = 0; i < (*self)->count; i++) {
-                if ((*self)->sockets[i]) {
-                    if ((*self)->sockets[i]->monitor) {
-                        _socket_monitor_destroy(&(*self)->sockets[i]->monitor);
-                    }
-                    if ((*self)->sockets[i]->socket) {
-                        zmq_close((*self)->sockets[i]->socket);
-                        (*self)->sockets[i]->socket = NULL;
-                    }
-                    if ((*self)->sockets[i]->endpoint) {
-                        free((*self)->sockets[i]->endpoint);
-                        (*self)->sockets[i]->endpoint = NULL;
-                    }
-                    free((*self)->sockets[i]);
-                    (*self)->sockets[i] = NULL;
-                }
-            }
-            free((*self)->sockets);
-        }
-        free(*self);
-        *self = NULL;
+    uint64_t now;
+
+    if (_stats_interval <= 0) {
+        return 0;
     }
-}
 
-static zlmb_client_publish_t *
-_client_publish_init(void *context, void *socket, char *endpoints, char *mode)
-{
-    int i, n = 0;
-    char *token = NULL, *endpoint = endpoints;
-    size_t size;
-    zlmb_client_publish_t *self;
+    now = zlmb_utils_clock();
 
-    if (!endpoint || strlen(endpoint) == 0) {
-        return NULL;
+    if (*next == 0) {
+        *next = now + (uint64_t)_stats_interval * 1000000;
+        return 0;
+    } else if (now < *next) {
+        return 0;
     }
 
-    while (1) {
-        n++;
-        token = strchr(endpoint, ',');
-        if (token == NULL) {
-            break;
-        }
+    *next = now + (uint64_t)_stats_interval * 1000000;
 
-        endpoint = (++token);
-    }
+    return 1;
+}
 
-    if (n == 0) {
-        return NULL;
-    }
+static long
+_stats_timeout(uint64_t next, long timeout)
+{
+    uint64_t now;
+    long remain;
 
-    self = (zlmb_client_publish_t *)malloc(sizeof(zlmb_client_publish_t));
-    if (!self) {
-        return NULL;
+    if (_stats_interval <= 0 || next == 0) {
+        return timeout;
     }
 
-    self->count = n;
-    size = sizeof(zlmb_client_inproc_socket_t *) * self->count;
+    now = zlmb_utils_clock();
+    if (now >= next) {
+        return 0;
+    }
 
-    self->sockets = (zlmb_client_inproc_socket_t **)malloc(size);
-    if (!self->sockets) {
-        _client_publish_destroy(&self);
-        return NULL;
+    remain = (long)((next - now) / 1000) + 1;
+    if (timeout < 0 || remain < timeout) {
+        return remain;
     }
-    memset(self->sockets, 0, size);
 
-    endpoint = strdup(endpoints);
-    token = endpoint;
+    return timeout;
+}
 
-    for (i = 0; i < self->count; i++) {
-        char *end, *mon;
-        size_t size;
+static void
+_recvmsg_drop(void *socket, int more)
+{
+    size_t moresz = sizeof(more);
 
-        end = strtok(token, ",");
-        if (end == NULL) {
-            _client_publish_destroy(&self);
-            return NULL;
-        }
+    while (more) {
+        zmq_msg_t zmsg;
 
-        while (*end == ' ') {
-            end++;
+        if (zmq_msg_init(&zmsg) != 0) {
+            break;
         }
 
-        if (zlmb_utils_asprintf(&mon, "%s.%d.%d",
-                                ZLMB_CLIENT_PUBLISH_MONITOR_SOCKET,
-                                getpid(), i) == -1) {
-            _client_publish_destroy(&self);
-            return NULL;
+        if (zmq_recvmsg(socket, &zmsg, 0) == -1) {
+            zmq_msg_close(&zmsg);
+            break;
         }
 
-        size = sizeof(zlmb_client_inproc_socket_t);
-
-        self->sockets[i] = (zlmb_client_inproc_socket_t *)malloc(size);
-        if (!self->sockets[i]) {
-            _client_publish_destroy(&self);
-            return NULL;
+        if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            more = 0;
         }
 
-        memset(self->sockets[i], 0, size);
-
-        self->sockets[i]->endpoint = strdup(end);
+        zmq_msg_close(&zmsg);
+    }
+}
 
-        self->sockets[i]->socket = zmq_socket(context, ZMQ_PUSH);
-        if (self->sockets[i]->socket == NULL) {
-            _client_publish_destroy(&self);
-            return NULL;
-        }
+static int
+_ratelimit_message(zlmb_ratelimit_t *ratelimit, void *socket,
+                   zmq_msg_t *zmsg, int more, char *mode)
+{
+    int limit;
 
-        _MODE(VERBOSE, "ZeroMQ client:publish socket: PUSH\n", mode);
+    if (!ratelimit) {
+        return 0;
+    }
 
-        self->sockets[i]->monitor =
-            _socket_monitor_init(context, self->sockets[i]->socket, mon, mode);
-        if (self->sockets[i]->monitor == NULL) {
-            _client_publish_destroy(&self);
-            return NULL;
-        }
+    /* key: first frame of multi-part message (single part: global key) */
+    if (more) {
+        limit = zlmb_ratelimit_check(ratelimit, zmq_msg_data(zmsg),
+                                     zmq_msg_size(zmsg));
+    } else {
+        limit = zlmb_ratelimit_check(ratelimit, "", 0);
+    }
 
-        token = NULL;
-        free(mon);
+    if (limit == ZLMB_RATELIMIT_PASS) {
+        return 0;
     }
 
-    free(endpoint);
+    if (limit == ZLMB_RATELIMIT_SAMPLE) {
+        _MODE(DEBUG, "Sampling out message.\n", mode);
+    } else {
+        _MODE(DEBUG, "Rate limit drop message.\n", mode);
+    }
 
-    self->mode = mode;
+    _recvmsg_drop(socket, more);
 
-    return self;
+    return -1;
 }
 
 static void
-_client_publish_connect(zlmb_client_publish_t *self, void *socket, int *connect)
+_ratelimit_report(zlmb_ratelimit_t *ratelimit, char *mode)
 {
-    int i;
+    size_t pos = 0;
+    zlmb_ratelimit_bucket_t *bucket;
 
-    if (!self || !socket) {
+    if (!ratelimit) {
         return;
     }
 
-    for (i = 0; i < self->count; i++) {
-        if (self->sockets[i]->monitor->event & ZMQ_EVENT_CONNECTED) {
-            pthread_mutex_lock(&_mutex);
-            if (zmq_connect(socket, self->sockets[i]->endpoint) != -1) {
-                _MODE(VERBOSE, "ZeroMQ backend:publish connect(#%d): %s\n",
-                      self->mode, i+1, self->sockets[i]->endpoint);
-                (*connect)++;
-                self->sockets[i]->monitor->event = 0;
-            }
-            pthread_mutex_unlock(&_mutex);
-        }
-        if (self->sockets[i]->monitor->event & ZMQ_EVENT_DISCONNECTED) {
-            pthread_mutex_lock(&_mutex);
-            if (zmq_disconnect(socket, self->sockets[i]->endpoint) != -1) {
-                _MODE(VERBOSE, "ZeroMQ backend:publish disconnect(#%d): %s\n",
-                      self->mode, i+1, self->sockets[i]->endpoint);
-                (*connect)--;
-                self->sockets[i]->monitor->event = 0;
-            }
-            pthread_mutex_unlock(&_mutex);
+    /* key: uncompressed when the bucket was created */
+    while ((bucket = zlmb_ratelimit_next(ratelimit, &pos)) != NULL) {
+        if (bucket->dropped == 0 && bucket->sampled == 0) {
+            continue;
         }
+        _MODE(INFO, "Rate limit key(%.*s): "
+              "passed=%llu dropped=%llu sampled=%llu\n",
+              mode, (int)bucket->key_len, bucket->key,
+              (unsigned long long)bucket->passed,
+              (unsigned long long)bucket->dropped,
+              (unsigned long long)bucket->sampled);
     }
 }
 
-
 static void
-_client_publish_monitor_stop(zlmb_client_publish_t *self)
+_stack_clear(zlmb_stack_t *stack)
 {
-    int i;
-
-    if (!self) {
-        return;
-    }
-
-    for (i = 0; i < self->count; i++) {
-        if (self->sockets[i]->monitor->thread) {
-            _MODE(VERBOSE, "Thread end backend:publish(#%d).\n",
-                  self->mode, i+1);
-            pthread_kill(self->sockets[i]->monitor->thread, SIGINT);
-            pthread_join(self->sockets[i]->monitor->thread, NULL);
-            self->sockets[i]->monitor->thread = 0;
+    while (zlmb_stack_size(stack)) {
+        zmq_msg_t *zmsg = zlmb_stack_shift(stack);
+        if (zmsg) {
+            zmq_msg_close(zmsg);
+            free(zmsg);
         }
     }
 }
 
 static int
-_client_publish_monitor_start(zlmb_client_publish_t *self)
+_recvmsg_stack(void *socket, zlmb_stack_t *stack, char *mode)
 {
-    int i;
+    int more = 1;
+    size_t moresz = sizeof(more);
 
-    if (!self) {
+    while (more && !_interrupted) {
+        zmq_msg_t *zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
+        if (!zmsg) {
+            _MODE(ERR, "Memory allocate message.\n", mode);
+            break;
+        }
+
+        if (zmq_msg_init(zmsg) != 0) {
+            free(zmsg);
+            break;
+        }
+
+        if (zmq_recvmsg(socket, zmsg, 0) == -1) {
+            _MODE(ERR, "ZeroMQ frontend receive: %s\n",
+                  mode, zmq_strerror(errno));
+            zmq_msg_close(zmsg);
+            free(zmsg);
+            break;
+        }
+
+        if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            _MODE(ERR, "ZeroMQ frontend receive socket option: %s\n",
+                  mode, zmq_strerror(errno));
+            more = 0;
+        }
+#ifndef NDEBUG
+        zlmb_dump_printmsg(stderr, zmsg);
+#endif
+        if (zlmb_stack_push(stack, zmsg) != 0) {
+            _MODE(ERR, "Message stack push.\n", mode);
+            zmq_msg_close(zmsg);
+            free(zmsg);
+            break;
+        }
+    }
+
+    if (more) {
+        _recvmsg_drop(socket, more);
         return -1;
     }
 
-    for (i = 0; i < self->count; i++) {
-        pthread_mutex_lock(&_mutex_monitor);
-        _MODE(VERBOSE, "Thread start backend:publish monitor(#%d).\n",
-              self->mode, i+1);
-        if (pthread_create(&(self->sockets[i]->monitor->thread), NULL,
-                           _socket_monitor_event,
-                           (void *)self->sockets[i]->monitor) == -1) {
-            _MODE(ERR, "Thread create backend:publish monitor.\n", self->mode);
-            return -1;
+    return (int)zlmb_stack_size(stack);
+}
+
+static void
+_sendmsg_stack(int type, void *socket, zlmb_stack_t *stack, int dropkey,
+               zlmb_dump_t *dump, char *mode)
+{
+    int flags, frames = 0;
+
+    while (zlmb_stack_size(stack)) {
+        zmq_msg_t *zmsg = zlmb_stack_shift(stack);
+        if (!zmsg) {
+            continue;
         }
 
-        pthread_mutex_lock(&_mutex_monitor);
-        pthread_mutex_unlock(&_mutex_monitor);
+        if (zlmb_stack_size(stack)) {
+            flags = ZMQ_SNDMORE;
+        } else {
+            flags = 0;
+        }
 
-        if (_interrupted) {
-            _MODE(ERR, "Thread started backend:publish monitor: %s\n",
-                  self->mode, self->sockets[i]->endpoint);
-            return -1;
+        if (!dropkey || ++frames != 1) {
+            _MODE(DEBUG, "ZeroMQ backend send message.\n", mode);
+            _sendmsg(type, socket, zmsg, flags, dump, mode);
         }
 
-        if (zmq_connect(self->sockets[i]->socket,
-                        self->sockets[i]->endpoint) == -1) {
-            _MODE(ERR, "ZeroMQ backend:publish monitor connect: %s: %s\n",
-                  self->mode, self->sockets[i]->endpoint, zmq_strerror(errno));
+        zmq_msg_close(zmsg);
+        free(zmsg);
+    }
+}
+
+static void
+_codec_sendmsg(zlmb_codec_t *codec, zlmb_stack_t *stack, void *socket,
+               int connect, int dropkey, zlmb_dump_t *dump, char *mode)
+{
+    if (connect > 0) {
+        _sendmsg_stack(ZLMB_SENDMSG, socket, stack, dropkey, dump, mode);
+    } else {
+        /* dump: same frames as received */
+        zlmb_stack_item_t *item = zlmb_stack_first(stack);
+        while (item) {
+            zlmb_codec_message(zlmb_stack_item_data(item),
+                               (codec->type == ZLMB_CODEC_COMPRESS) ?
+                               ZLMB_CODEC_UNCOMPRESS : ZLMB_CODEC_COMPRESS);
+            item = zlmb_stack_item_next(item);
+        }
+        _sendmsg_stack(ZLMB_SENDMSG_DUMP, socket, stack, dropkey, dump, mode);
+    }
+
+    _stack_clear(stack);
+    zlmb_stack_destroy(&stack);
+}
+
+static int
+_codec_push(zlmb_codec_t *codec, zlmb_stack_t *stack, void *socket,
+            int connect, int dropkey, zlmb_dump_t *dump, char *mode)
+{
+    while (zlmb_codec_push(codec, stack) != 0) {
+        /* full: wait for the oldest message */
+        zlmb_stack_t *done = zlmb_codec_pop(codec, 1);
+        if (!done) {
             return -1;
         }
-        _MODE(VERBOSE, "ZeroMQ backend:publish monitor connect(#%d): %s\n",
-              self->mode, i+1, self->sockets[i]->endpoint);
+        _codec_sendmsg(codec, done, socket, connect, dropkey, dump, mode);
     }
 
     return 0;
 }
 
 static void
-_client_publish_gc(zlmb_client_publish_t *self, void *inproc,
-                   void *publish, int connect, zlmb_dump_t *dump)
+_codec_send(zlmb_codec_t *codec, void *socket, int connect, int dropkey,
+            zlmb_dump_t *dump, int wait, char *mode)
 {
-    zmq_pollitem_t pollitems[] = { { inproc, 0, ZMQ_POLLIN, 0 } };
+    zlmb_stack_t *stack;
 
-    if (!self || !inproc || !publish){
-        _MODE(ERR, "Function arguments: %s\n", self->mode, __FUNCTION__);
-        return;
+    /* in order of push */
+    while ((stack = zlmb_codec_pop(codec, wait)) != NULL) {
+        _codec_sendmsg(codec, stack, socket, connect, dropkey, dump, mode);
     }
+}
 
-    _client_publish_connect(self, publish, &connect);
-
-    while (1) {
-        if (zmq_poll(pollitems, 1, ZLMB_POLL_TIMEOUT) == -1) {
-            break;
-        }
+static void
+_codec_report(zlmb_codec_t *codec, char *mode)
+{
+    double utilization[ZLMB_CODEC_THREADS_MAX];
+    int i;
 
-        if (pollitems[0].revents & ZMQ_POLLIN) {
-            _MODE(DEBUG, "ZeroMQ backend:inproc receive in poll event(GC).\n",
-                  self->mode);
+    if (!codec) {
+        return;
+    }
 
-            int more, send, flags;
-            size_t moresz = sizeof(more);
+    zlmb_codec_utilization(codec, utilization);
 
-            if (connect > 0) {
-                send = ZLMB_SENDMSG;
-            } else {
-                send = ZLMB_SENDMSG_DUMP;
-            }
+    for (i = 0; i < codec->threads; i++) {
+        _MODE(INFO, "Codec: thread=%d jobs=%llu frames=%llu errors=%llu "
+              "utilization=%.1f%%\n", mode, i,
+              (unsigned long long)codec->thread[i].jobs,
+              (unsigned long long)codec->thread[i].frames,
+              (unsigned long long)codec->thread[i].errors,
+              utilization[i]);
+    }
 
-            while (!_interrupted) {
-                zmq_msg_t zmsg;
+    _MODE(INFO, "Codec: pending=%ld full=%llu\n", mode,
+          (long)zlmb_codec_pending(codec), (unsigned long long)codec->full);
+}
 
-                _MODE(DEBUG, "ZeroMQ backend:inproc receive message(GC).\n",
-                      self->mode);
+static void
+_memory_report(char *mode)
+{
+    if (!_memory) {
+        return;
+    }
 
-                if (zmq_msg_init(&zmsg) != 0) {
-                    break;
-                }
+    _MODE(INFO, "Memory: used=%llu peak=%llu limit=%llu messages=%llu "
+          "diverted=%llu crossed=%llu\n", mode,
+          (unsigned long long)_memory->used,
+          (unsigned long long)_memory->peak,
+          (unsigned long long)_memory->limit,
+          (unsigned long long)_memory->tracked,
+          (unsigned long long)_memory->diverted,
+          (unsigned long long)_memory->crossed);
+}
 
-                if (zmq_recvmsg(inproc, &zmsg, 0) == -1) {
-                    _MODE(ERR, "ZeroMQ backend:inproc receive(GC): %s\n",
-                          self->mode, zmq_strerror(errno));
-                    zmq_msg_close(&zmsg);
-                    break;
-                }
+static void
+_ttl_report(char *mode)
+{
+    if (!_ttl) {
+        return;
+    }
 
-                if (zmq_getsockopt(inproc, ZMQ_RCVMORE,
-                                   &more, &moresz) == -1) {
-                    _MODE(ERR,
-                          "ZeroMQ backend:inproc receive socket option(GC):"
-                          " %s\n", self->mode, zmq_strerror(errno));
-                    //zmq_msg_close(&zmsg);
-                    //break;
-                    more = 0;
-                }
+    _MODE(INFO, "TTL: stamped=%llu expired=%llu (bytes=%llu)\n", mode,
+          (unsigned long long)_ttl->stamped,
+          (unsigned long long)_ttl->expired,
+          (unsigned long long)_ttl->expired_bytes);
+}
 
-                if (more) {
-                    flags = ZMQ_SNDMORE;
-                } else {
-                    flags = 0;
-                }
-#ifndef NDEBUG
-                zlmb_dump_printmsg(stderr, &zmsg);
-#endif
-                _MODE(DEBUG, "ZeroMQ backend:publish send message.\n",
-                      self->mode);
+/* ttl: stamp at ingress, drop expired (replayed from a dump file) */
+static int
+_ttl_stack(zlmb_stack_t *stack, char *mode)
+{
+    zlmb_stack_item_t *item;
+    zmq_msg_t *zmsg;
+    uint64_t now;
+    uint32_t ttl;
 
-                _sendmsg(send, publish, &zmsg, flags, dump, self->mode);
+    item = zlmb_stack_last(stack);
+    if (!_ttl || !item) {
+        return 0;
+    }
 
-                zmq_msg_close(&zmsg);
+    now = zlmb_ttl_now();
 
-                if (flags == 0) {
-                    break;
-                }
-            }
-        } else {
+    zmsg = zlmb_stack_item_data(item);
+    switch (zlmb_ttl_check(zmq_msg_data(zmsg), zmq_msg_size(zmsg), now)) {
+        case ZLMB_TTL_EXPIRED:
+            _MODE(DEBUG, "Drop expired message.\n", mode);
+            _ttl->expired++;
+            _ttl->expired_bytes += zlmb_memory_stack(stack);
+            return -1;
+        case ZLMB_TTL_LIVE:
+            return 0;
+        default:
             break;
-        }
+    }
 
-        _client_publish_connect(self, publish, &connect);
+    /* key: first frame of a multi-part message */
+    if (zlmb_stack_size(stack) > 1) {
+        zmsg = zlmb_stack_item_data(zlmb_stack_first(stack));
+        ttl = zlmb_ttl_lookup(_ttl, zmq_msg_data(zmsg), zmq_msg_size(zmsg));
+    } else {
+        ttl = zlmb_ttl_lookup(_ttl, NULL, 0);
     }
-}
 
-static void *
-_client_backend(void *arg)
-{
-    int connect = 0;
-    zlmb_client_backend_t *self = (zlmb_client_backend_t *)arg;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
-                                   { NULL, 0, ZMQ_POLLIN, 0 } };
-    zlmb_dump_t *dump = NULL;
-    void *socket_inproc, *socket_publish;
-    zlmb_client_publish_t *publish;
+    if (ttl == 0) {
+        return 0;
+    }
 
-    if (!self || !self->context) {
-        _MODE(ERR, "Function arguments: %s\n", self->mode, __FUNCTION__);
-        _interrupted = 1;
-        pthread_mutex_unlock(&_mutex);
-        return NULL;
+    zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
+    if (!zmsg) {
+        _MODE(ERR, "Memory allocate in ttl frame.\n", mode);
+        return 0;
     }
 
-    /* backend:inproc */
-    socket_inproc = zmq_socket(self->context, ZMQ_PULL);
-    if (!socket_inproc) {
-        _MODE(ERR, "ZeroMQ backend:inproc socket: %s\n",
-              self->mode, zmq_strerror(errno));
-        _interrupted = 1;
-        pthread_mutex_unlock(&_mutex);
-        return NULL;
+    if (zmq_msg_init_size(zmsg, ZLMB_TTL_FRAME_SIZE) != 0) {
+        free(zmsg);
+        return 0;
     }
 
-    _MODE(VERBOSE, "ZeroMQ backend:inproc socket: PULL\n", self->mode);
+    zlmb_ttl_frame(zmq_msg_data(zmsg), now, ttl);
 
-    if (zmq_connect(socket_inproc, ZLMB_CLIENT_BACKEND_INPROC_SOCKET) == -1) {
-        _MODE(ERR, "ZeroMQ backend:inproc connect: %s\n",
-              self->mode, zmq_strerror(errno));
+    if (zlmb_stack_push(stack, zmsg) != 0) {
+        zmq_msg_close(zmsg);
+        free(zmsg);
+        return 0;
+    }
+
+    _ttl->stamped++;
+
+    return 0;
+}
+
+static int
+_socket_readable(void *socket)
+{
+    int events = 0;
+    size_t size = sizeof(events);
+
+    if (zmq_getsockopt(socket, ZMQ_EVENTS, &events, &size) == -1) {
+        return 0;
+    }
+
+    return (events & ZMQ_POLLIN) ? 1 : 0;
+}
+
+static void
+_publish_stage_destroy(zlmb_publish_stage_t **self)
+{
+    if (*self) {
+        if ((*self)->ratelimit) {
+            zlmb_ratelimit_destroy(&(*self)->ratelimit);
+        }
+        if ((*self)->sequence) {
+            zlmb_sequence_destroy(&(*self)->sequence);
+        }
+        if ((*self)->replay) {
+            zlmb_replay_destroy(&(*self)->replay);
+        }
+        if ((*self)->journal) {
+            zlmb_journal_destroy(&(*self)->journal);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+/* stage: NULL if not configured, -1 if a configured part failed */
+static int
+_publish_stage_init(zlmb_option_t *option, zlmb_publish_stage_t **stage)
+{
+    zlmb_publish_stage_t *self;
+
+    *stage = NULL;
+
+    if (!option) {
+        return 0;
+    }
+
+    self = (zlmb_publish_stage_t *)malloc(sizeof(zlmb_publish_stage_t));
+    if (!self) {
+        _ERR("Publish stage initilized.\n");
+        return -1;
+    }
+
+    memset(self, 0, sizeof(zlmb_publish_stage_t));
+
+    self->ratelimit = zlmb_ratelimit_init(option->publish_ratelimit,
+                                          option->publish_ratelimit_burst,
+                                          option->publish_sampling,
+                                          option->publish_sampling_random,
+                                          option->publish_ratelimit_buckets);
+    if (!self->ratelimit &&
+        (option->publish_ratelimit > 0 || option->publish_sampling > 1)) {
+        _ERR("Rate limit initilized.\n");
+        _publish_stage_destroy(&self);
+        return -1;
+    }
+
+    /* replay: requires sequence number */
+    if (option->publish_replayendpoint &&
+        strlen(option->publish_replayendpoint) > 0) {
+        self->replay = zlmb_replay_init(option->publish_replay_size,
+                                        option->publish_replay_budget);
+        if (!self->replay) {
+            _ERR("Replay initilized.\n");
+            _publish_stage_destroy(&self);
+            return -1;
+        }
+        self->replayendpoint = option->publish_replayendpoint;
+    }
+
+    if (option->publish_sequence || self->replay) {
+        self->sequence = zlmb_sequence_init();
+        if (!self->sequence) {
+            _ERR("Sequence initilized.\n");
+            _publish_stage_destroy(&self);
+            return -1;
+        }
+    }
+
+    if (option->publish_journal && strlen(option->publish_journal) > 0) {
+        self->journal = zlmb_journal_init(
+            option->publish_journal,
+            option->publish_journal_partitions,
+            (uint64_t)option->publish_journal_segment_size << 20,
+            (uint64_t)option->publish_journal_retention_size << 20,
+            option->publish_journal_retention_time,
+            option->publish_journal_sync);
+        if (!self->journal) {
+            _ERR("Journal initilized: %s\n", option->publish_journal);
+            _publish_stage_destroy(&self);
+            return -1;
+        }
+        if (option->publish_journalendpoint &&
+                   strlen(option->publish_journalendpoint) > 0) {
+            self->journalendpoint = option->publish_journalendpoint;
+        }
+    }
+
+    /* priority: lane without rate limit, sequence, replay and journal */
+    if (option->publish_priority_frontendpoint &&
+        strlen(option->publish_priority_frontendpoint) > 0) {
+        self->priority_frontendpoint = option->publish_priority_frontendpoint;
+        if (option->publish_priority_backendpoint &&
+            strlen(option->publish_priority_backendpoint) > 0) {
+            self->priority_backendpoint = option->publish_priority_backendpoint;
+        }
+    }
+
+    if (!self->ratelimit && !self->sequence && !self->journal &&
+        !self->priority_frontendpoint) {
+        free(self);
+        return 0;
+    }
+
+    *stage = self;
+
+    return 0;
+}
+
+static void *
+_publish_stage_bind(void *context, char *endpoint, char *name, char *mode)
+{
+    void *socket;
+    int linger = 0;
+
+    socket = zmq_socket(context, ZMQ_ROUTER);
+    if (!socket) {
+        _MODE(ERR, "ZeroMQ %s socket: %s\n", mode, name, zmq_strerror(errno));
+        return NULL;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ %s socket: ROUTER\n", mode, name);
+
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+    if (zmq_bind(socket, endpoint) == -1) {
+        _MODE(ERR, "ZeroMQ %s bind: %s\n", mode, name, zmq_strerror(errno));
+        zmq_close(socket);
+        return NULL;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ %s bind: %s\n", mode, name, endpoint);
+
+    return socket;
+}
+
+static void
+_publish_stage_close(zlmb_publish_stage_t *self)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->replay_socket) {
+        zmq_close(self->replay_socket);
+        self->replay_socket = NULL;
+    }
+
+    if (self->journal_socket) {
+        zmq_close(self->journal_socket);
+        self->journal_socket = NULL;
+    }
+
+    if (self->priority_frontend) {
+        zmq_close(self->priority_frontend);
+        self->priority_frontend = NULL;
+    }
+
+    if (self->priority_backend) {
+        zmq_close(self->priority_backend);
+        self->priority_backend = NULL;
+    }
+}
+
+static void *
+_publish_stage_priority_bind(void *context, int type, char *endpoint,
+                             char *name, char *mode)
+{
+    void *socket;
+
+    socket = zmq_socket(context, type);
+    if (!socket) {
+        _MODE(ERR, "ZeroMQ %s socket: %s\n", mode, name, zmq_strerror(errno));
+        return NULL;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ %s socket: %s\n", mode, name,
+          type == ZMQ_PULL ? "PULL" : "PUB");
+
+    if (zmq_bind(socket, endpoint) == -1) {
+        _MODE(ERR, "ZeroMQ %s bind: %s\n", mode, name, zmq_strerror(errno));
+        zmq_close(socket);
+        return NULL;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ %s bind: %s\n", mode, name, endpoint);
+
+    return socket;
+}
+
+static int
+_publish_stage_open(zlmb_publish_stage_t *self, void *context,
+                    zmq_pollitem_t *pollitems, char *mode)
+{
+    int n = 0;
+
+    if (!self) {
+        return 0;
+    }
+
+    if (self->replay && self->replayendpoint) {
+        self->replay_socket = _publish_stage_bind(context,
+                                                  self->replayendpoint,
+                                                  "replay", mode);
+        if (!self->replay_socket) {
+            return -1;
+        }
+        pollitems[n].socket = self->replay_socket;
+        pollitems[n].fd = 0;
+        pollitems[n].events = ZMQ_POLLIN;
+        pollitems[n].revents = 0;
+        n++;
+    }
+
+    if (self->journal && self->journalendpoint) {
+        self->journal_socket = _publish_stage_bind(context,
+                                                   self->journalendpoint,
+                                                   "journal", mode);
+        if (!self->journal_socket) {
+            _publish_stage_close(self);
+            return -1;
+        }
+        pollitems[n].socket = self->journal_socket;
+        pollitems[n].fd = 0;
+        pollitems[n].events = ZMQ_POLLIN;
+        pollitems[n].revents = 0;
+        n++;
+    }
+
+    /* priority: last pollitem, drained before the frontend message */
+    if (self->priority_frontendpoint) {
+        self->priority_frontend = _publish_stage_priority_bind(
+            context, ZMQ_PULL, self->priority_frontendpoint,
+            "priority frontend", mode);
+        if (!self->priority_frontend) {
+            _publish_stage_close(self);
+            return -1;
+        }
+        if (self->priority_backendpoint) {
+            self->priority_backend = _publish_stage_priority_bind(
+                context, ZMQ_PUB, self->priority_backendpoint,
+                "priority backend", mode);
+            if (!self->priority_backend) {
+                _publish_stage_close(self);
+                return -1;
+            }
+        }
+        pollitems[n].socket = self->priority_frontend;
+        pollitems[n].fd = 0;
+        pollitems[n].events = ZMQ_POLLIN;
+        pollitems[n].revents = 0;
+        n++;
+    }
+
+    return n;
+}
+
+static void
+_publish_stage_info(zlmb_publish_stage_t *self, char *mode)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->ratelimit) {
+        _MODE(INFO, "Rate limit: %.2f/sec (burst:%.0f, buckets:%ld)\n", mode,
+              self->ratelimit->rate, self->ratelimit->burst,
+              self->ratelimit->size);
+        _MODE(INFO, "Sampling: %d (%s)\n", mode, self->ratelimit->sampling,
+              self->ratelimit->random ? "random" : "deterministic");
+    }
+
+    if (self->sequence) {
+        _MODE(INFO, "Sequence: enable (publisher:%016llx)\n", mode,
+              (unsigned long long)self->sequence->id);
+    }
+
+    if (self->replay) {
+        _MODE(INFO, "Replay endpoint: %s (size:%ld, budget:%d/sec)\n", mode,
+              self->replayendpoint, self->replay->size, self->replay->budget);
+    }
+
+    if (self->journal) {
+        _MODE(INFO, "Journal: %s (partitions:%d, segment:%llu, "
+              "retention:%llu/%llusec, sync:%dms)\n", mode,
+              self->journal->dir, self->journal->partitions,
+              (unsigned long long)self->journal->segment_size,
+              (unsigned long long)self->journal->retention_size,
+              (unsigned long long)self->journal->retention_time,
+              self->journal->sync);
+        if (self->journalendpoint) {
+            _MODE(INFO, "Journal endpoint: %s\n", mode,
+                  self->journalendpoint);
+        }
+    }
+
+    if (self->priority_frontendpoint) {
+        _MODE(INFO, "Priority endpoint: %s -> %s\n", mode,
+              self->priority_frontendpoint,
+              self->priority_backendpoint ?
+              self->priority_backendpoint : "backend");
+    }
+}
+
+static void
+_publish_stage_begin(zlmb_publish_stage_t *self, zmq_msg_t *zmsg, int more)
+{
+    if (!self) {
+        return;
+    }
+
+    zlmb_replay_begin(self->replay);
+
+    /* journal: partition by the first frame (key) */
+    if (self->journal) {
+        if (more) {
+            zlmb_journal_begin(self->journal, zmq_msg_data(zmsg),
+                               zmq_msg_size(zmsg));
+        } else {
+            zlmb_journal_begin(self->journal, NULL, 0);
+        }
+    }
+}
+
+static void
+_publish_stage_frame(zlmb_publish_stage_t *self, zmq_msg_t *zmsg,
+                     const void *data, size_t len, int type)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->replay) {
+        if (zmsg) {
+            zlmb_replay_add(self->replay, zmsg, type);
+        } else {
+            zlmb_replay_add_data(self->replay, data, len, type);
+        }
+    }
+
+    if (self->journal) {
+        if (zmsg) {
+            zlmb_journal_frame(self->journal, zmq_msg_data(zmsg),
+                               zmq_msg_size(zmsg));
+        } else {
+            zlmb_journal_frame(self->journal, data, len);
+        }
+    }
+}
+
+static int
+_publish_stage_end(zlmb_publish_stage_t *self, void *socket, char *mode)
+{
+    unsigned char buf[ZLMB_SEQUENCE_FRAME_SIZE];
+    uint64_t seq;
+    size_t len = 0;
+    int ret = 0;
+
+    if (!self) {
+        return 0;
+    }
+
+    if (self->sequence) {
+        len = zlmb_sequence_frame(self->sequence, buf, &seq);
+
+        if (self->replay) {
+            zlmb_replay_add_data(self->replay, buf, len, ZLMB_SENDMSG);
+            zlmb_replay_commit(self->replay, seq);
+        }
+
+        if (self->journal) {
+            zlmb_journal_frame(self->journal, buf, len);
+        }
+    }
+
+    /* journal: append before the last frame is sent */
+    if (self->journal && zlmb_journal_commit(self->journal, NULL) != 0) {
+        _MODE(ERR, "Journal append: %s\n", mode, strerror(errno));
+    }
+
+    if (self->sequence) {
+        _MODE(DEBUG, "ZeroMQ backend send message(sequence).\n", mode);
+
+        if (zmq_send(socket, buf, len, 0) == -1) {
+            _MODE(ERR, "ZeroMQ backend send: %s\n", mode, zmq_strerror(errno));
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+static int
+_publish_stage_request(void *socket, zmq_msg_t *identity, zmq_msg_t *request,
+                       zmq_msg_t *key, char *name, char *mode)
+{
+    int more = 0;
+    size_t moresz = sizeof(more);
+
+    /* request: [identity][request]([key]) */
+    if (zmq_msg_init(identity) != 0) {
+        return -1;
+    }
+
+    if (zmq_recvmsg(socket, identity, 0) == -1) {
+        _MODE(ERR, "ZeroMQ %s receive: %s\n", mode, name, zmq_strerror(errno));
+        zmq_msg_close(identity);
+        return -1;
+    }
+
+    if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1 || !more) {
+        zmq_msg_close(identity);
+        return -1;
+    }
+
+    if (zmq_msg_init(request) != 0) {
+        _recvmsg_drop(socket, more);
+        zmq_msg_close(identity);
+        return -1;
+    }
+
+    if (zmq_recvmsg(socket, request, 0) == -1) {
+        _MODE(ERR, "ZeroMQ %s receive: %s\n", mode, name, zmq_strerror(errno));
+        zmq_msg_close(request);
+        zmq_msg_close(identity);
+        return -1;
+    }
+
+    if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+        more = 0;
+    }
+
+    if (key) {
+        zmq_msg_init(key);
+        if (more) {
+            if (zmq_recvmsg(socket, key, 0) == -1 ||
+                zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+                more = 0;
+            }
+        }
+    }
+
+    _recvmsg_drop(socket, more);
+
+    return 0;
+}
+
+static void
+_publish_stage_replay(zlmb_publish_stage_t *self, char *mode)
+{
+    zmq_msg_t identity, request, key;
+    uint64_t id, from, to, seq, count;
+    zlmb_replay_t *replay = self->replay;
+    void *socket = self->replay_socket;
+
+    /* request: [identity][publisher id, from, to]([subscribe key]) */
+    if (_publish_stage_request(socket, &identity, &request, &key,
+                               "replay", mode) != 0) {
+        return;
+    }
+
+    if (zlmb_sequence_parse_request(zmq_msg_data(&request),
+                                    zmq_msg_size(&request),
+                                    &id, &from, &to) != 0) {
+        _MODE(NOTICE, "Invalid replay request.\n", mode);
+        zmq_msg_close(&key);
+        zmq_msg_close(&request);
+        zmq_msg_close(&identity);
+        return;
+    }
+
+    zmq_msg_close(&request);
+
+    /* other publisher */
+    if (id != self->sequence->id) {
+        _MODE(DEBUG, "Ignore replay request: publisher=%016llx\n", mode,
+              (unsigned long long)id);
+        zmq_msg_close(&key);
+        zmq_msg_close(&identity);
+        return;
+    }
+
+    replay->requests++;
+
+    _MODE(VERBOSE, "Replay request: %llu-%llu\n", mode,
+          (unsigned long long)from, (unsigned long long)to);
+
+    if (from == 0) {
+        from = 1;
+    }
+
+    if (from < replay->first) {
+        if (to < replay->first) {
+            replay->unavailable += to - from + 1;
+            zmq_msg_close(&key);
+            zmq_msg_close(&identity);
+            return;
+        }
+        replay->unavailable += replay->first - from;
+        from = replay->first;
+    }
+
+    if (to > replay->last) {
+        to = replay->last;
+    }
+
+    if (from > to) {
+        zmq_msg_close(&key);
+        zmq_msg_close(&identity);
+        return;
+    }
+
+    count = zlmb_replay_budget(replay, to - from + 1);
+    if (count < to - from + 1) {
+        replay->throttled += to - from + 1 - count;
+        _MODE(NOTICE, "Replay budget exceeded: %llu messages\n", mode,
+              (unsigned long long)(to - from + 1 - count));
+        if (count == 0) {
+            zmq_msg_close(&key);
+            zmq_msg_close(&identity);
+            return;
+        }
+        to = from + count - 1;
+    }
+
+    /* reply: [identity][frames ...][sequence] */
+    for (seq = from; seq <= to && !_interrupted; seq++) {
+        zlmb_replay_entry_t *entry = zlmb_replay_get(replay, seq);
+        size_t i;
+
+        if (!entry) {
+            replay->unavailable++;
+            continue;
+        }
+
+        /* subscribe key: other keys are filtered by the SUB socket */
+        if (zmq_msg_size(&key) > 0 &&
+            (entry->count == 0 ||
+             zmq_msg_size(&entry->frames[0].msg) < zmq_msg_size(&key) ||
+             memcmp(zmq_msg_data(&entry->frames[0].msg), zmq_msg_data(&key),
+                    zmq_msg_size(&key)) != 0)) {
+            continue;
+        }
+
+        if (zmq_send(socket, zmq_msg_data(&identity), zmq_msg_size(&identity),
+                     ZMQ_SNDMORE) == -1) {
+            _MODE(ERR, "ZeroMQ replay send: %s\n", mode, zmq_strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < entry->count; i++) {
+            zmq_msg_t zmsg;
+
+            if (zmq_msg_init(&zmsg) != 0) {
+                break;
+            }
+
+            zmq_msg_copy(&zmsg, &entry->frames[i].msg);
+
+            _sendmsg(entry->frames[i].type, socket, &zmsg,
+                     (i + 1 < entry->count) ? ZMQ_SNDMORE : 0, NULL, mode);
+
+            zmq_msg_close(&zmsg);
+        }
+
+        replay->retransmitted++;
+    }
+
+    zmq_msg_close(&key);
+    zmq_msg_close(&identity);
+}
+
+static int
+_publish_stage_record(void *socket, zmq_msg_t *identity, int partition,
+                      zlmb_journal_record_t *record, char *mode)
+{
+    unsigned char buf[ZLMB_JOURNAL_MESSAGE_SIZE];
+    size_t len;
+    uint32_t i;
+
+    /* message: [identity][partition, offset][frames ...] */
+    if (zmq_send(socket, zmq_msg_data(identity), zmq_msg_size(identity),
+                 ZMQ_SNDMORE) == -1) {
+        _MODE(ERR, "ZeroMQ journal send: %s\n", mode, zmq_strerror(errno));
+        return -1;
+    }
+
+    len = zlmb_journal_message(buf, partition, record->offset);
+
+    if (zmq_send(socket, buf, len,
+                 (record->frames > 0) ? ZMQ_SNDMORE : 0) == -1) {
+        _MODE(ERR, "ZeroMQ journal send: %s\n", mode, zmq_strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < record->frames; i++) {
+        zmq_msg_t zmsg;
+        const char *data;
+        size_t size = 0;
+
+        data = zlmb_journal_record_frame(record, &size);
+        if (!data) {
+            data = "";
+            size = 0;
+        }
+
+        /* frame refers to the mapped segment (no copy) */
+        zlmb_journal_map_ref(record->map);
+
+        if (zmq_msg_init_data(&zmsg, (void *)data, size,
+                              zlmb_journal_map_release, record->map) != 0) {
+            zlmb_journal_map_release(NULL, record->map);
+            _MODE(ERR, "ZeroMQ journal message: %s\n", mode,
+                  zmq_strerror(errno));
+            return -1;
+        }
+
+        if (zmq_sendmsg(socket, &zmsg,
+                        (i + 1 < record->frames) ? ZMQ_SNDMORE : 0) == -1) {
+            _MODE(ERR, "ZeroMQ journal send: %s\n", mode,
+                  zmq_strerror(errno));
+            zmq_msg_close(&zmsg);
+            return -1;
+        }
+
+        zmq_msg_close(&zmsg);
+    }
+
+    return 0;
+}
+
+static void
+_publish_stage_fetch(zlmb_publish_stage_t *self, char *mode)
+{
+    zmq_msg_t identity, request;
+    unsigned char buf[ZLMB_JOURNAL_END_SIZE];
+    zlmb_journal_t *journal = self->journal;
+    zlmb_journal_record_t record;
+    uint64_t offset, first = 0;
+    int partition, count, sent = 0;
+    size_t len;
+
+    /* request: [identity][partition, offset, count] */
+    if (_publish_stage_request(self->journal_socket, &identity, &request, NULL,
+                               "journal", mode) != 0) {
+        return;
+    }
+
+    if (zlmb_journal_parse_fetch(zmq_msg_data(&request),
+                                 zmq_msg_size(&request),
+                                 &partition, &offset, &count) != 0) {
+        _MODE(NOTICE, "Invalid journal fetch request.\n", mode);
+        zmq_msg_close(&request);
+        zmq_msg_close(&identity);
+        return;
+    }
+
+    zmq_msg_close(&request);
+
+    if (count <= 0 || count > ZLMB_JOURNAL_FETCH_MAX) {
+        count = ZLMB_JOURNAL_FETCH_MAX;
+    }
+
+    _MODE(DEBUG, "Journal fetch: partition=%d offset=%llu count=%d\n", mode,
+          partition, (unsigned long long)offset, count);
+
+    if (partition >= 0 && partition < journal->partitions) {
+        zlmb_journal_partition_t *part = &journal->partition[partition];
+
+        /* buffered records */
+        zlmb_journal_flush(journal);
+
+        while (sent < count && !_interrupted &&
+               zlmb_journal_read(journal, partition, offset, &record) == 0) {
+            if (record.offset != offset) {
+                _MODE(NOTICE, "Journal gap: partition=%d offset=%llu-%llu\n",
+                      mode, partition, (unsigned long long)offset,
+                      (unsigned long long)record.offset - 1);
+            }
+            if (_publish_stage_record(self->journal_socket, &identity,
+                                      partition, &record, mode) != 0) {
+                break;
+            }
+            offset = record.offset + 1;
+            sent++;
+        }
+
+        first = part->head->base;
+        if (offset < first) {
+            offset = first;
+        }
+    }
+
+    /* end: [identity][partition, next, first, partitions, count] */
+    len = zlmb_journal_end(buf, partition, offset, first,
+                           journal->partitions, sent);
+
+    if (zmq_send(self->journal_socket, zmq_msg_data(&identity),
+                 zmq_msg_size(&identity), ZMQ_SNDMORE) == -1 ||
+        zmq_send(self->journal_socket, buf, len, 0) == -1) {
+        _MODE(ERR, "ZeroMQ journal send: %s\n", mode, zmq_strerror(errno));
+    }
+
+    zmq_msg_close(&identity);
+}
+
+/* priority: forward whole lane (no rate limit, sequence, replay, journal) */
+static void
+_publish_stage_priority(zlmb_publish_stage_t *self, void *backend,
+                        char *key, size_t key_len, char *mode)
+{
+    void *socket;
+
+    if (!self || !self->priority_frontend) {
+        return;
+    }
+
+    socket = self->priority_backend ? self->priority_backend : backend;
+
+    while (!_interrupted && _socket_readable(self->priority_frontend)) {
+        int more = 1;
+        size_t moresz = sizeof(more);
+
+        _MODE(DEBUG, "ZeroMQ priority receive message.\n", mode);
+
+        if (key && zmq_send(socket, key, key_len, ZMQ_SNDMORE) == -1) {
+            _MODE(ERR, "ZeroMQ priority send: %s\n", mode,
+                  zmq_strerror(errno));
+        }
+
+        while (more && !_interrupted) {
+            zmq_msg_t zmsg;
+
+            if (zmq_msg_init(&zmsg) != 0) {
+                break;
+            }
+
+            if (zmq_recvmsg(self->priority_frontend, &zmsg, 0) == -1) {
+                _MODE(ERR, "ZeroMQ priority receive: %s\n", mode,
+                      zmq_strerror(errno));
+                zmq_msg_close(&zmsg);
+                break;
+            }
+
+            if (zmq_getsockopt(self->priority_frontend, ZMQ_RCVMORE,
+                               &more, &moresz) == -1) {
+                more = 0;
+            }
+
+            if (zmq_sendmsg(socket, &zmsg, more ? ZMQ_SNDMORE : 0) == -1) {
+                _MODE(ERR, "ZeroMQ priority send: %s\n", mode,
+                      zmq_strerror(errno));
+            }
+
+            zmq_msg_close(&zmsg);
+        }
+
+        self->priority_messages++;
+    }
+}
+
+static long
+_publish_stage_timeout(zlmb_publish_stage_t *self, long timeout)
+{
+    if (!self || !self->journal) {
+        return timeout;
+    }
+
+    return zlmb_journal_timeout(self->journal, timeout);
+}
+
+static void
+_publish_stage_poll(zlmb_publish_stage_t *self, zmq_pollitem_t *pollitems,
+                    char *mode)
+{
+    int n = 0;
+
+    if (!self) {
+        return;
+    }
+
+    if (self->replay_socket) {
+        if (pollitems[n].revents & ZMQ_POLLIN) {
+            _publish_stage_replay(self, mode);
+        }
+        n++;
+    }
+
+    if (self->journal_socket) {
+        if (pollitems[n].revents & ZMQ_POLLIN) {
+            _publish_stage_fetch(self, mode);
+        }
+        n++;
+    }
+
+    /* journal: sync and retention */
+    if (self->journal && zlmb_journal_expired(self->journal)) {
+        if (zlmb_journal_sync(self->journal) != 0) {
+            _MODE(ERR, "Journal sync: %s\n", mode, strerror(errno));
+        }
+    }
+}
+
+static void
+_publish_stage_report(zlmb_publish_stage_t *self, char *mode)
+{
+    if (!self) {
+        return;
+    }
+
+    _ratelimit_report(self->ratelimit, mode);
+
+    if (self->sequence) {
+        _MODE(INFO, "Sequence: publisher=%016llx next=%llu\n", mode,
+              (unsigned long long)self->sequence->id,
+              (unsigned long long)self->sequence->next);
+    }
+
+    if (self->replay) {
+        _MODE(INFO, "Replay: held=%llu-%llu bytes=%ld requests=%llu "
+              "retransmitted=%llu unavailable=%llu throttled=%llu\n", mode,
+              (unsigned long long)self->replay->first,
+              (unsigned long long)self->replay->last,
+              self->replay->bytes,
+              (unsigned long long)self->replay->requests,
+              (unsigned long long)self->replay->retransmitted,
+              (unsigned long long)self->replay->unavailable,
+              (unsigned long long)self->replay->throttled);
+    }
+
+    if (self->journal) {
+        int i;
+        _MODE(INFO, "Journal: appended=%llu syncs=%llu fetched=%llu "
+              "removed=%llu\n", mode,
+              (unsigned long long)self->journal->appended,
+              (unsigned long long)self->journal->syncs,
+              (unsigned long long)self->journal->fetched,
+              (unsigned long long)self->journal->removed);
+        for (i = 0; i < self->journal->partitions; i++) {
+            zlmb_journal_partition_t *part = &self->journal->partition[i];
+            _MODE(VERBOSE, "Journal: partition=%d offset=%llu-%llu "
+                  "bytes=%llu\n", mode, i,
+                  (unsigned long long)part->head->base,
+                  (unsigned long long)part->next,
+                  (unsigned long long)part->bytes);
+        }
+    }
+
+    if (self->priority_frontend) {
+        _MODE(INFO, "Priority: messages=%llu\n", mode,
+              (unsigned long long)self->priority_messages);
+    }
+}
+
+/* key as subscribed: replay (the publisher skips the other keys), priority */
+static int
+_subscribe_stage_key(zlmb_subscribe_stage_t *self, char *key)
+{
+    size_t key_len;
+
+    if (!key || strlen(key) == 0) {
+        return 0;
+    }
+
+    key_len = strlen(key);
+
+#ifdef USE_SNAPPY
+    self->key_len = snappy_max_compressed_length(key_len);
+    self->key = (char *)malloc(self->key_len);
+    if (self->key &&
+        snappy_compress(key, key_len, self->key,
+                        &self->key_len) != SNAPPY_OK) {
+        free(self->key);
+        self->key = NULL;
+    }
+#else
+    self->key = strdup(key);
+    self->key_len = key_len;
+#endif
+
+    if (!self->key) {
+        self->key_len = 0;
+        _ERR("Subscribe key initilized.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+_subscribe_stage_destroy(zlmb_subscribe_stage_t **self)
+{
+    if (*self) {
+        if ((*self)->dedup) {
+            zlmb_dedup_destroy(&(*self)->dedup);
+        }
+        if ((*self)->sequence) {
+            zlmb_sequence_tracker_destroy(&(*self)->sequence);
+        }
+        if ((*self)->codec) {
+            zlmb_codec_destroy(&(*self)->codec);
+        }
+        if ((*self)->sink) {
+            zlmb_sink_destroy(&(*self)->sink);
+        }
+        if ((*self)->key) {
+            free((*self)->key);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+/* stage: NULL if not configured, -1 if a configured part failed */
+static int
+_subscribe_stage_init(zlmb_option_t *option, zlmb_subscribe_stage_t **stage)
+{
+    zlmb_subscribe_stage_t *self;
+
+    *stage = NULL;
+
+    if (!option ||
+        (!option->subscribe_dedup && !option->subscribe_sequence &&
+         !option->subscribe_replayendpoints &&
+         !option->subscribe_journalendpoint &&
+         !option->subscribe_sink && !option->subscribe_ttl &&
+         !option->subscribe_priority_frontendpoints &&
+         option->subscribe_codec_threads <= 0)) {
+        return 0;
+    }
+
+    self = (zlmb_subscribe_stage_t *)malloc(sizeof(zlmb_subscribe_stage_t));
+    if (!self) {
+        _ERR("Subscribe stage initilized.\n");
+        return -1;
+    }
+
+    memset(self, 0, sizeof(zlmb_subscribe_stage_t));
+
+    if (option->subscribe_dedup) {
+        self->dedup = zlmb_dedup_init(option->subscribe_dedup_memory,
+                                      option->subscribe_dedup_window);
+        if (!self->dedup) {
+            _ERR("Dedup initilized.\n");
+            _subscribe_stage_destroy(&self);
+            return -1;
+        }
+    }
+
+    self->ttl = option->subscribe_ttl;
+
+    /* replay: requires sequence number */
+    if (option->subscribe_sequence || option->subscribe_replayendpoints) {
+        self->sequence = zlmb_sequence_tracker_init();
+        if (!self->sequence) {
+            _ERR("Sequence tracker initilized.\n");
+            _subscribe_stage_destroy(&self);
+            return -1;
+        }
+        if (option->subscribe_replayendpoints &&
+                   strlen(option->subscribe_replayendpoints) > 0) {
+            self->replayendpoints = option->subscribe_replayendpoints;
+            self->replay_catchup = option->subscribe_replay_catchup;
+        }
+    }
+
+    if (option->subscribe_priority_frontendpoints &&
+        strlen(option->subscribe_priority_frontendpoints) > 0) {
+        self->priority_endpoints = option->subscribe_priority_frontendpoints;
+    }
+
+    if (self->replayendpoints || self->priority_endpoints) {
+        if (_subscribe_stage_key(self, option->subscribe_key) == -1) {
+            _subscribe_stage_destroy(&self);
+            return -1;
+        }
+    }
+
+    if (option->subscribe_journalendpoint &&
+        strlen(option->subscribe_journalendpoint) > 0) {
+        self->journalendpoint = option->subscribe_journalendpoint;
+        self->journal_offsetfile = option->subscribe_journal_offsetfile;
+        self->journal_partitions = 1;
+    }
+
+#ifdef USE_SNAPPY
+    if (option->subscribe_codec_threads > 0) {
+        self->codec = zlmb_codec_init(ZLMB_CODEC_UNCOMPRESS,
+                                      option->subscribe_codec_threads, 0);
+        if (!self->codec) {
+            _ERR("Codec initilized.\n");
+            _subscribe_stage_destroy(&self);
+            return -1;
+        }
+        self->codec->memory = _memory;
+    }
+#endif
+
+    /* sink: archive frames as received (or uncompress on copies) */
+    if (option->subscribe_sink && strlen(option->subscribe_sink) > 0) {
+        self->sink = zlmb_sink_init(option->subscribe_sink,
+                                    option->subscribe_sink_rotate_size,
+                                    option->subscribe_sink_rotate_time,
+                                    option->subscribe_sink_compress,
+                                    option->subscribe_sink_sync,
+                                    option->subscribe_sink_uncompress);
+        if (!self->sink) {
+            _ERR("Sink initilized: %s: %s\n",
+                 option->subscribe_sink, strerror(errno));
+            _subscribe_stage_destroy(&self);
+            return -1;
+        }
+    }
+
+    *stage = self;
+
+    return 0;
+}
+
+static void
+_subscribe_stage_offset_load(zlmb_subscribe_stage_t *self, char *mode)
+{
+    FILE *fp;
+    int partition;
+    unsigned long long offset;
+
+    if (!self->journal_offsetfile) {
+        return;
+    }
+
+    fp = fopen(self->journal_offsetfile, "r");
+    if (!fp) {
+        _MODE(VERBOSE, "Journal offset file: %s: %s\n", mode,
+              self->journal_offsetfile, strerror(errno));
+        return;
+    }
+
+    /* offset file: "partition offset" */
+    while (fscanf(fp, "%d %llu", &partition, &offset) == 2) {
+        if (partition >= 0 && partition < ZLMB_JOURNAL_PARTITIONS_MAX) {
+            self->journal_offset[partition] = offset;
+            if (partition >= self->journal_partitions) {
+                self->journal_partitions = partition + 1;
+            }
+            _MODE(VERBOSE, "Journal offset: partition=%d offset=%llu\n",
+                  mode, partition, offset);
+        }
+    }
+
+    fclose(fp);
+}
+
+static int
+_subscribe_stage_offset_save(zlmb_subscribe_stage_t *self, char *mode)
+{
+    FILE *fp;
+    char *tmp = NULL;
+    int i, ret = 0;
+
+    if (!self->journal_dirty || !self->journal_offsetfile) {
+        return 0;
+    }
+
+    if (zlmb_utils_asprintf(&tmp, "%s.tmp", self->journal_offsetfile) == -1) {
+        return -1;
+    }
+
+    fp = fopen(tmp, "w");
+    if (!fp) {
+        _MODE(ERR, "Journal offset file: %s: %s\n", mode,
+              tmp, strerror(errno));
+        free(tmp);
+        return -1;
+    }
+
+    for (i = 0; i < self->journal_partitions; i++) {
+        fprintf(fp, "%d %llu\n",
+                i, (unsigned long long)self->journal_offset[i]);
+    }
+
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+
+    /* offset file: replace at once */
+    if (ret == 0 && rename(tmp, self->journal_offsetfile) == -1) {
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        self->journal_dirty = 0;
+    } else {
+        _MODE(ERR, "Journal offset file: %s: %s\n", mode,
+              self->journal_offsetfile, strerror(errno));
+        unlink(tmp);
+    }
+
+    free(tmp);
+
+    return ret;
+}
+
+static void
+_subscribe_stage_open_replay(zlmb_subscribe_stage_t *self, void *context,
+                             zmq_pollitem_t *pollitems, char *mode)
+{
+    char *endpoint, *token;
+    int linger = 0;
+
+    if (!self->replayendpoints) {
+        return;
+    }
+
+    endpoint = strdup(self->replayendpoints);
+    if (!endpoint) {
+        return;
+    }
+
+    token = endpoint;
+
+    /* replay: one DEALER socket for each publish server */
+    while (self->replay_count < ZLMB_SUBSCRIBE_REPLAY_MAX) {
+        char *end;
+        void *socket;
+
+        end = strtok(token, ",");
+        if (end == NULL) {
+            break;
+        }
+
+        token = NULL;
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        socket = zmq_socket(context, ZMQ_DEALER);
+        if (!socket) {
+            _MODE(ERR, "ZeroMQ replay socket: %s\n", mode,
+                  zmq_strerror(errno));
+            break;
+        }
+
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+        if (zmq_connect(socket, end) == -1) {
+            _MODE(ERR, "ZeroMQ replay connect: %s: %s\n", mode,
+                  end, zmq_strerror(errno));
+            zmq_close(socket);
+            continue;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ replay connect: %s\n", mode, end);
+
+        pollitems[self->replay_count].socket = socket;
+        pollitems[self->replay_count].fd = 0;
+        pollitems[self->replay_count].events = ZMQ_POLLIN;
+        pollitems[self->replay_count].revents = 0;
+
+        self->replay[self->replay_count++] = socket;
+    }
+
+    free(endpoint);
+}
+
+static int
+_subscribe_stage_open_journal(zlmb_subscribe_stage_t *self, void *context,
+                              zmq_pollitem_t *pollitem, char *mode)
+{
+    int linger = 0;
+
+    if (!self->journalendpoint) {
+        return 0;
+    }
+
+    self->journal = zmq_socket(context, ZMQ_DEALER);
+    if (!self->journal) {
+        _MODE(ERR, "ZeroMQ journal socket: %s\n", mode, zmq_strerror(errno));
+        return 0;
+    }
+
+    zmq_setsockopt(self->journal, ZMQ_LINGER, &linger, sizeof(linger));
+
+    if (zmq_connect(self->journal, self->journalendpoint) == -1) {
+        _MODE(ERR, "ZeroMQ journal connect: %s: %s\n", mode,
+              self->journalendpoint, zmq_strerror(errno));
+        zmq_close(self->journal);
+        self->journal = NULL;
+        return 0;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ journal connect: %s\n", mode,
+          self->journalendpoint);
+
+    pollitem->socket = self->journal;
+    pollitem->fd = 0;
+    pollitem->events = ZMQ_POLLIN;
+    pollitem->revents = 0;
+
+    _subscribe_stage_offset_load(self, mode);
+
+    return 1;
+}
+
+static int
+_subscribe_stage_open_priority(zlmb_subscribe_stage_t *self, void *context,
+                               zmq_pollitem_t *pollitem, char *mode)
+{
+    char *endpoint, *token, *end;
+    int connect = 0;
+
+    if (!self->priority_endpoints) {
+        return 0;
+    }
+
+    self->priority = zmq_socket(context, ZMQ_SUB);
+    if (!self->priority) {
+        _MODE(ERR, "ZeroMQ priority socket: %s\n", mode, zmq_strerror(errno));
+        return 0;
+    }
+
+    if (zmq_setsockopt(self->priority, ZMQ_SUBSCRIBE,
+                       self->key ? self->key : "", self->key_len) == -1) {
+        _MODE(ERR, "ZeroMQ priority subscribe key: %s\n", mode,
+              zmq_strerror(errno));
+        zmq_close(self->priority);
+        self->priority = NULL;
+        return 0;
+    }
+
+    endpoint = strdup(self->priority_endpoints);
+    if (!endpoint) {
+        zmq_close(self->priority);
+        self->priority = NULL;
+        return 0;
+    }
+
+    token = endpoint;
+
+    while ((end = strtok(token, ",")) != NULL) {
+        token = NULL;
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        if (zmq_connect(self->priority, end) == -1) {
+            _MODE(ERR, "ZeroMQ priority connect: %s: %s\n", mode,
+                  end, zmq_strerror(errno));
+            continue;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ priority connect: %s\n", mode, end);
+
+        connect++;
+    }
+
+    free(endpoint);
+
+    if (connect == 0) {
+        zmq_close(self->priority);
+        self->priority = NULL;
+        return 0;
+    }
+
+    pollitem->socket = self->priority;
+    pollitem->fd = 0;
+    pollitem->events = ZMQ_POLLIN;
+    pollitem->revents = 0;
+
+    return 1;
+}
+
+static int
+_subscribe_stage_open(zlmb_subscribe_stage_t *self, void *context,
+                      zmq_pollitem_t *pollitems, char *mode)
+{
+    int n;
+
+    if (!self) {
+        return 0;
+    }
+
+    _subscribe_stage_open_replay(self, context, pollitems, mode);
+
+    /* journal: the socket follows the replay sockets */
+    n = self->replay_count +
+        _subscribe_stage_open_journal(self, context,
+                                      &pollitems[self->replay_count], mode);
+
+    /* codec: wakeup when the oldest message is ready */
+    if (self->codec) {
+        pollitems[n].socket = NULL;
+        pollitems[n].fd = zlmb_codec_fd(self->codec);
+        pollitems[n].events = ZMQ_POLLIN;
+        pollitems[n].revents = 0;
+        n++;
+    }
+
+    /* priority: last pollitem, drained before the frontend message */
+    n += _subscribe_stage_open_priority(self, context, &pollitems[n], mode);
+
+    return n;
+}
+
+static void
+_subscribe_stage_close(zlmb_subscribe_stage_t *self, char *mode)
+{
+    int i;
+
+    if (!self) {
+        return;
+    }
+
+    for (i = 0; i < self->replay_count; i++) {
+        zmq_close(self->replay[i]);
+        self->replay[i] = NULL;
+    }
+
+    self->replay_count = 0;
+
+    if (self->journal) {
+        _subscribe_stage_offset_save(self, mode);
+        zmq_close(self->journal);
+        self->journal = NULL;
+    }
+
+    if (self->priority) {
+        zmq_close(self->priority);
+        self->priority = NULL;
+    }
+}
+
+static void
+_subscribe_stage_request(zlmb_subscribe_stage_t *self, uint64_t id,
+                         uint64_t from, uint64_t to, char *mode)
+{
+    unsigned char buf[ZLMB_SEQUENCE_REQUEST_SIZE];
+    size_t len;
+    int i;
+
+    if (self->replay_count == 0) {
+        return;
+    }
+
+    len = zlmb_sequence_request(buf, id, from, to);
+
+    _MODE(VERBOSE, "Replay request: publisher=%016llx %llu-%llu\n", mode,
+          (unsigned long long)id, (unsigned long long)from,
+          (unsigned long long)to);
+
+    /* publisher of other id ignores the request */
+    for (i = 0; i < self->replay_count; i++) {
+        if (zmq_send(self->replay[i], buf, len,
+                     (self->key_len > 0)
+                     ? ZMQ_SNDMORE | ZMQ_DONTWAIT : ZMQ_DONTWAIT) == -1) {
+            _MODE(DEBUG, "ZeroMQ replay send: %s\n", mode,
+                  zmq_strerror(errno));
+            continue;
+        }
+        if (self->key_len > 0 &&
+            zmq_send(self->replay[i], self->key, self->key_len,
+                     ZMQ_DONTWAIT) == -1) {
+            _MODE(DEBUG, "ZeroMQ replay send: %s\n", mode,
+                  zmq_strerror(errno));
+        }
+    }
+
+    self->replay_requests++;
+}
+
+static int
+_subscribe_stage_filter(zlmb_subscribe_stage_t *self, zlmb_stack_t *stack,
+                        char *mode)
+{
+    if (self->sequence) {
+        zlmb_stack_item_t *item = zlmb_stack_last(stack);
+        zmq_msg_t *zmsg = item ? zlmb_stack_item_data(item) : NULL;
+        uint64_t id, seq;
+
+        if (zmsg && zlmb_stack_size(stack) > 1 &&
+            zlmb_sequence_parse(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                &id, &seq) == 0) {
+            zlmb_sequence_publisher_t *publisher = NULL;
+
+            zmsg = zlmb_stack_pop(stack);
+            zmq_msg_close(zmsg);
+            free(zmsg);
+
+            switch (zlmb_sequence_track(self->sequence, id, seq, &publisher)) {
+                case ZLMB_SEQUENCE_NEW:
+                    _MODE(VERBOSE, "Sequence: publisher=%016llx start=%llu\n",
+                          mode, (unsigned long long)id,
+                          (unsigned long long)seq);
+                    if (self->replay_catchup && seq > 1) {
+                        zlmb_sequence_missing(publisher, 1, seq - 1);
+                        _subscribe_stage_request(self, id, 1, seq - 1, mode);
+                    }
+                    break;
+                case ZLMB_SEQUENCE_GAP:
+                    _MODE(NOTICE, "Sequence gap: publisher=%016llx "
+                          "lost=%llu (%llu-%llu)\n", mode,
+                          (unsigned long long)id,
+                          (unsigned long long)(publisher->gap_to
+                                               - publisher->gap_from + 1),
+                          (unsigned long long)publisher->gap_from,
+                          (unsigned long long)publisher->gap_to);
+                    _subscribe_stage_request(self, id, publisher->gap_from,
+                                             publisher->gap_to, mode);
+                    break;
+                case ZLMB_SEQUENCE_RECOVERED:
+                    _MODE(DEBUG, "Recovered sequence: "
+                          "publisher=%016llx sequence=%llu\n", mode,
+                          (unsigned long long)id, (unsigned long long)seq);
+                    break;
+                case ZLMB_SEQUENCE_DUPLICATE:
+                    _MODE(DEBUG, "Drop duplicate sequence: "
+                          "publisher=%016llx sequence=%llu\n", mode,
+                          (unsigned long long)id, (unsigned long long)seq);
+                    return -1;
+                default:
+                    break;
+            }
+        }
+    }
+
+    /* ttl: frame of the client stage (before the sequence frame) */
+    if (self->ttl) {
+        zlmb_stack_item_t *item = zlmb_stack_last(stack);
+        zmq_msg_t *zmsg = item ? zlmb_stack_item_data(item) : NULL;
+        int ttl = ZLMB_TTL_NONE;
+
+        if (zmsg && zlmb_stack_size(stack) > 1) {
+            ttl = zlmb_ttl_check(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                 zlmb_ttl_now());
+        }
+
+        if (ttl != ZLMB_TTL_NONE) {
+            zmsg = zlmb_stack_pop(stack);
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+
+        if (ttl == ZLMB_TTL_EXPIRED) {
+            _MODE(DEBUG, "Drop expired message.\n", mode);
+            self->ttl_expired++;
+            self->ttl_expired_bytes += zlmb_memory_stack(stack);
+            return -1;
+        }
+    }
+
+    if (self->dedup) {
+        uint64_t hash = 0;
+        zlmb_stack_item_t *item = zlmb_stack_first(stack);
+        while (item) {
+            zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+            hash = zlmb_utils_hash(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                   hash ^ zmq_msg_size(zmsg));
+            item = zlmb_stack_item_next(item);
+        }
+        if (zlmb_dedup_check(self->dedup, hash)) {
+            _MODE(DEBUG, "Drop duplicate message.\n", mode);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+_subscribe_stage_send(zlmb_subscribe_stage_t *self, zlmb_stack_t **stack,
+                      void *backend, int send, int dropkey,
+                      zlmb_dump_t *dump, char *mode)
+{
+    /* sink: archived messages are not dumped without workers */
+    if (self && self->sink) {
+        if (zlmb_sink_write(self->sink, *stack) == 0 &&
+            send == ZLMB_SENDMSG_DUMP) {
+            return;
+        }
+    }
+
+    /* codec: uncompress on worker threads (stack is taken) */
+    if (self && self->codec && send == ZLMB_SENDMSG_UNCOMPRESS) {
+        if (_codec_push(self->codec, *stack, backend, 1, dropkey,
+                        dump, mode) == 0) {
+            *stack = NULL;
+            return;
+        }
+    }
+
+    _sendmsg_stack(send, backend, *stack, dropkey, dump, mode);
+}
+
+static void
+_subscribe_stage_message(zlmb_subscribe_stage_t *self,
+                         void *frontend, void *backend, int send, int dropkey,
+                         zlmb_dump_t *dump, char *mode)
+{
+    zlmb_stack_t *stack;
+
+    stack = zlmb_stack_init();
+    if (!stack) {
+        _MODE(ERR, "Message stack initilize.\n", mode);
+        return;
+    }
+
+    if (_recvmsg_stack(frontend, stack, mode) > 0 &&
+        _subscribe_stage_filter(self, stack, mode) == 0) {
+        _subscribe_stage_send(self, &stack, backend, send, dropkey, dump, mode);
+    }
+
+    if (stack) {
+        _stack_clear(stack);
+        zlmb_stack_destroy(&stack);
+    }
+}
+
+static void
+_subscribe_stage_fetch(zlmb_subscribe_stage_t *self, char *mode)
+{
+    unsigned char buf[ZLMB_JOURNAL_FETCH_SIZE];
+    uint64_t now;
+    size_t len;
+
+    now = zlmb_utils_clock();
+    if (now < self->journal_next) {
+        return;
+    }
+
+    if (self->journal_pending) {
+        _MODE(NOTICE, "Journal fetch timeout: partition=%d\n", mode,
+              self->journal_partition);
+    }
+
+    /* fetch: one request at a time (reply fits the high water mark) */
+    len = zlmb_journal_fetch(buf, self->journal_partition,
+                             self->journal_offset[self->journal_partition],
+                             ZLMB_JOURNAL_FETCH_MAX);
+
+    if (zmq_send(self->journal, buf, len, ZMQ_DONTWAIT) == -1) {
+        _MODE(DEBUG, "ZeroMQ journal send: %s\n", mode, zmq_strerror(errno));
+        self->journal_pending = 0;
+        self->journal_next = now + ZLMB_POLL_TIMEOUT * 1000;
+        return;
+    }
+
+    self->journal_pending = 1;
+    self->journal_next = now + (uint64_t)ZLMB_SUBSCRIBE_JOURNAL_TIMEOUT * 1000000;
+}
+
+static void
+_subscribe_stage_fetched(zlmb_subscribe_stage_t *self, int partition,
+                         uint64_t first, int partitions, int count,
+                         char *mode)
+{
+    /* removed by retention */
+    if (self->journal_offset[partition] < first) {
+        _MODE(NOTICE, "Journal removed: partition=%d lost=%llu (%llu-%llu)\n",
+              mode, partition,
+              (unsigned long long)(first - self->journal_offset[partition]),
+              (unsigned long long)self->journal_offset[partition],
+              (unsigned long long)(first - 1));
+        self->journal_removed += first - self->journal_offset[partition];
+        self->journal_offset[partition] = first;
+        self->journal_dirty = 1;
+    }
+
+    if (partitions > 0 && partitions <= ZLMB_JOURNAL_PARTITIONS_MAX) {
+        self->journal_partitions = partitions;
+    }
+
+    self->journal_pending = 0;
+    self->journal_round += count;
+
+    if (count >= ZLMB_JOURNAL_FETCH_MAX) {
+        /* more records: same partition */
+        self->journal_next = 0;
+    } else {
+        /* next partition: wait for a while after idle round */
+        self->journal_partition = (partition + 1) % self->journal_partitions;
+        if (self->journal_partition == 0 && self->journal_round == 0) {
+            self->journal_next = zlmb_utils_clock() + ZLMB_POLL_TIMEOUT * 1000;
+        } else {
+            self->journal_next = 0;
+        }
+        if (self->journal_partition == 0) {
+            self->journal_round = 0;
+        }
+    }
+
+    _subscribe_stage_offset_save(self, mode);
+}
+
+static void
+_subscribe_stage_journal(zlmb_subscribe_stage_t *self, void *backend,
+                         int send, int dropkey, zlmb_dump_t *dump, char *mode)
+{
+    zlmb_stack_t *stack;
+    zmq_msg_t *zmsg;
+    int partition, partitions, count;
+    uint64_t offset, first;
+
+    stack = zlmb_stack_init();
+    if (!stack) {
+        _MODE(ERR, "Message stack initilize.\n", mode);
+        return;
+    }
+
+    if (_recvmsg_stack(self->journal, stack, mode) <= 0) {
+        _stack_clear(stack);
+        zlmb_stack_destroy(&stack);
+        return;
+    }
+
+    zmsg = zlmb_stack_shift(stack);
+    if (!zmsg) {
+        _stack_clear(stack);
+        zlmb_stack_destroy(&stack);
+        return;
+    }
+
+    if (zlmb_journal_parse_message(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                   &partition, &offset) == 0) {
+        /* message: [partition, offset][frames ...] */
+        if (partition >= 0 && partition < ZLMB_JOURNAL_PARTITIONS_MAX &&
+            offset >= self->journal_offset[partition]) {
+            if (zlmb_stack_size(stack) > 0 &&
+                _subscribe_stage_filter(self, stack, mode) == 0) {
+                _subscribe_stage_send(self, &stack, backend, send, dropkey,
+                                      dump, mode);
+            }
+            self->journal_offset[partition] = offset + 1;
+            self->journal_dirty = 1;
+            self->journal_received++;
+        }
+    } else if (zlmb_journal_parse_end(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                      &partition, &offset, &first,
+                                      &partitions, &count) == 0) {
+        /* end: [partition, next, first, partitions, count] */
+        if (self->journal_pending && partition == self->journal_partition) {
+            _subscribe_stage_fetched(self, partition, first, partitions,
+                                     count, mode);
+        }
+    } else {
+        _MODE(NOTICE, "Invalid journal message.\n", mode);
+    }
+
+    zmq_msg_close(zmsg);
+    free(zmsg);
+
+    if (stack) {
+        _stack_clear(stack);
+        zlmb_stack_destroy(&stack);
+    }
+}
+
+static void
+_subscribe_stage_poll(zlmb_subscribe_stage_t *self, zmq_pollitem_t *pollitems,
+                      int connect, void *backend, int dropkey,
+                      zlmb_dump_t *dump, char *mode)
+{
+    int i, send;
+
+    if (!self) {
+        return;
+    }
+
+    if (connect > 0) {
+#ifdef USE_SNAPPY
+        send = ZLMB_SENDMSG_UNCOMPRESS;
+#else
+        send = ZLMB_SENDMSG;
+#endif
+    } else {
+        send = ZLMB_SENDMSG_DUMP;
+    }
+
+    /* replay: retransmitted message (same frames as published) */
+    for (i = 0; i < self->replay_count; i++) {
+        if (pollitems[i].revents & ZMQ_POLLIN) {
+            _MODE(DEBUG, "ZeroMQ replay receive in poll event.\n", mode);
+            _subscribe_stage_message(self, self->replay[i], backend, send,
+                                     dropkey, dump, mode);
+        }
+    }
+
+    /* journal: fetch only while the backend is connected (and in budget) */
+    if (self->journal) {
+        if (pollitems[self->replay_count].revents & ZMQ_POLLIN) {
+            _MODE(DEBUG, "ZeroMQ journal receive in poll event.\n", mode);
+            _subscribe_stage_journal(self, backend, send, dropkey, dump, mode);
+        }
+        if (connect > 0 && !zlmb_memory_over(_memory)) {
+            _subscribe_stage_fetch(self, mode);
+        }
+    }
+
+    /* codec: uncompressed messages in order of receive */
+    if (self->codec) {
+        _codec_send(self->codec, backend, connect, dropkey, dump, 0, mode);
+    }
+
+    if (self->sink) {
+        if (zlmb_sink_flush(self->sink, 0) == -1) {
+            _MODE(ERR, "Sink write: %s\n", mode, strerror(errno));
+        }
+    }
+}
+
+/* priority: whole lane before the next frontend message */
+static void
+_subscribe_stage_priority(zlmb_subscribe_stage_t *self, int connect,
+                          void *backend, int dropkey, zlmb_dump_t *dump,
+                          char *mode)
+{
+    int send;
+
+    if (!self || !self->priority) {
+        return;
+    }
+
+    /* priority: not diverted by memory limit (as the client stage) */
+    if (connect > 0) {
+#ifdef USE_SNAPPY
+        send = ZLMB_SENDMSG_UNCOMPRESS;
+#else
+        send = ZLMB_SENDMSG;
+#endif
+    } else {
+        send = ZLMB_SENDMSG_DUMP;
+    }
+
+    while (!_interrupted && _socket_readable(self->priority)) {
+        _MODE(DEBUG, "ZeroMQ priority receive message.\n", mode);
+        _subscribe_stage_message(self, self->priority, backend, send,
+                                 dropkey, dump, mode);
+        self->priority_messages++;
+    }
+}
+
+static long
+_subscribe_stage_timeout(zlmb_subscribe_stage_t *self, int connect,
+                         long timeout)
+{
+    uint64_t now;
+    long next;
+
+    if (!self) {
+        return timeout;
+    }
+
+    /* sink: pending batch or sync */
+    if (self->sink) {
+        next = zlmb_sink_timeout(self->sink);
+        if (next >= 0 && (timeout < 0 || next < timeout)) {
+            timeout = next;
+        }
+    }
+
+    /* journal: next fetch while the backend is connected */
+    if (!self->journal || connect <= 0) {
+        return timeout;
+    }
+
+    now = zlmb_utils_clock();
+    if (self->journal_next <= now) {
+        return 0;
+    }
+
+    next = (long)((self->journal_next - now + 999) / 1000);
+    if (timeout < 0 || next < timeout) {
+        return next;
+    }
+
+    return timeout;
+}
+
+static void
+_subscribe_stage_flush(zlmb_subscribe_stage_t *self, int connect,
+                       void *backend, int dropkey, zlmb_dump_t *dump,
+                       char *mode)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->sink) {
+        if (zlmb_sink_flush(self->sink, 1) == -1) {
+            _MODE(ERR, "Sink write: %s\n", mode, strerror(errno));
+        }
+    }
+
+    if (!self->codec) {
+        return;
+    }
+
+    _codec_send(self->codec, backend, connect, dropkey, dump, 1, mode);
+}
+
+static void
+_subscribe_stage_report(zlmb_subscribe_stage_t *self, char *mode)
+{
+    if (!self) {
+        return;
+    }
+
+    if (self->dedup) {
+        _MODE(INFO, "Dedup: checked=%llu duplicates=%llu rotations=%llu "
+              "false-positive=%.6f\n", mode,
+              (unsigned long long)self->dedup->checked,
+              (unsigned long long)self->dedup->duplicates,
+              (unsigned long long)self->dedup->rotations,
+              zlmb_dedup_fpp(self->dedup));
+    }
+
+    if (self->sequence) {
+        size_t i;
+        for (i = 0; i < self->sequence->count; i++) {
+            zlmb_sequence_publisher_t *publisher;
+            publisher = &self->sequence->publishers[i];
+            _MODE(INFO, "Sequence: publisher=%016llx received=%llu lost=%llu "
+                  "gaps=%llu recovered=%llu duplicates=%llu next=%llu\n",
+                  mode,
+                  (unsigned long long)publisher->id,
+                  (unsigned long long)publisher->received,
+                  (unsigned long long)publisher->lost,
+                  (unsigned long long)publisher->gaps,
+                  (unsigned long long)publisher->recovered,
+                  (unsigned long long)publisher->duplicates,
+                  (unsigned long long)publisher->next);
+        }
+    }
+
+    if (self->replay_count > 0) {
+        _MODE(INFO, "Replay: requests=%llu\n", mode,
+              (unsigned long long)self->replay_requests);
+    }
+
+    if (self->priority) {
+        _MODE(INFO, "Priority: messages=%llu\n", mode,
+              (unsigned long long)self->priority_messages);
+    }
+
+    if (self->ttl) {
+        _MODE(INFO, "TTL: expired=%llu (bytes=%llu)\n", mode,
+              (unsigned long long)self->ttl_expired,
+              (unsigned long long)self->ttl_expired_bytes);
+    }
+
+    if (self->journal) {
+        int i;
+        _MODE(INFO, "Journal: received=%llu removed=%llu partitions=%d\n",
+              mode, (unsigned long long)self->journal_received,
+              (unsigned long long)self->journal_removed,
+              self->journal_partitions);
+        for (i = 0; i < self->journal_partitions; i++) {
+            _MODE(VERBOSE, "Journal: partition=%d offset=%llu\n", mode, i,
+                  (unsigned long long)self->journal_offset[i]);
+        }
+    }
+
+    if (self->sink) {
+        _MODE(INFO, "Sink: messages=%llu bytes=%llu writes=%llu "
+              "rotations=%llu syncs=%llu errors=%llu files=%ld\n", mode,
+              (unsigned long long)self->sink->messages,
+              (unsigned long long)self->sink->bytes,
+              (unsigned long long)self->sink->writes,
+              (unsigned long long)self->sink->rotations,
+              (unsigned long long)self->sink->syncs,
+              (unsigned long long)self->sink->errors,
+              (long)self->sink->nfiles);
+    }
+
+    _codec_report(self->codec, mode);
+}
+
+static void
+_client_publish_destroy(zlmb_client_publish_t **self)
+{
+    if (*self) {
+        if ((*self)->sockets) {
+            int i;
+            for (i = 0; i < (*self)->count; i++) {
+                if ((*self)->sockets[i]) {
+                    if ((*self)->sockets[i]->monitor) {
+                        _socket_monitor_destroy(&(*self)->sockets[i]->monitor);
+                    }
+                    if ((*self)->sockets[i]->socket) {
+                        zmq_close((*self)->sockets[i]->socket);
+                        (*self)->sockets[i]->socket = NULL;
+                    }
+                    if ((*self)->sockets[i]->endpoint) {
+                        free((*self)->sockets[i]->endpoint);
+                        (*self)->sockets[i]->endpoint = NULL;
+                    }
+                    free((*self)->sockets[i]);
+                    (*self)->sockets[i] = NULL;
+                }
+            }
+            free((*self)->sockets);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+static zlmb_client_publish_t *
+_client_publish_init(void *context, void *socket, char *endpoints, char *mode)
+{
+    int i, n = 0;
+    char *token = NULL, *endpoint = endpoints;
+    size_t size;
+    zlmb_client_publish_t *self;
+
+    if (!endpoint || strlen(endpoint) == 0) {
+        return NULL;
+    }
+
+    while (1) {
+        n++;
+        token = strchr(endpoint, ',');
+        if (token == NULL) {
+            break;
+        }
+
+        endpoint = (++token);
+    }
+
+    if (n == 0) {
+        return NULL;
+    }
+
+    self = (zlmb_client_publish_t *)malloc(sizeof(zlmb_client_publish_t));
+    if (!self) {
+        return NULL;
+    }
+
+    self->count = n;
+    size = sizeof(zlmb_client_inproc_socket_t *) * self->count;
+
+    self->sockets = (zlmb_client_inproc_socket_t **)malloc(size);
+    if (!self->sockets) {
+        _client_publish_destroy(&self);
+        return NULL;
+    }
+    memset(self->sockets, 0, size);
+
+    endpoint = strdup(endpoints);
+    token = endpoint;
+
+    for (i = 0; i < self->count; i++) {
+        char *end, *mon;
+        size_t size;
+
+        end = strtok(token, ",");
+        if (end == NULL) {
+            _client_publish_destroy(&self);
+            return NULL;
+        }
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        if (zlmb_utils_asprintf(&mon, "%s.%d.%d",
+                                ZLMB_CLIENT_PUBLISH_MONITOR_SOCKET,
+                                getpid(), i) == -1) {
+            _client_publish_destroy(&self);
+            return NULL;
+        }
+
+        size = sizeof(zlmb_client_inproc_socket_t);
+
+        self->sockets[i] = (zlmb_client_inproc_socket_t *)malloc(size);
+        if (!self->sockets[i]) {
+            _client_publish_destroy(&self);
+            return NULL;
+        }
+
+        memset(self->sockets[i], 0, size);
+
+        self->sockets[i]->endpoint = strdup(end);
+
+        self->sockets[i]->socket = zmq_socket(context, ZMQ_PUSH);
+        if (self->sockets[i]->socket == NULL) {
+            _client_publish_destroy(&self);
+            return NULL;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ client:publish socket: PUSH\n", mode);
+
+        self->sockets[i]->monitor =
+            _socket_monitor_init(context, self->sockets[i]->socket, mon, mode);
+        if (self->sockets[i]->monitor == NULL) {
+            _client_publish_destroy(&self);
+            return NULL;
+        }
+
+        token = NULL;
+        free(mon);
+    }
+
+    free(endpoint);
+
+    self->mode = mode;
+
+    return self;
+}
+
+static void
+_client_publish_connect(zlmb_client_publish_t *self, void *socket,
+                        void *priority, int *connect)
+{
+    int i;
+
+    if (!self || !socket) {
+        return;
+    }
+
+    for (i = 0; i < self->count; i++) {
+        _socket_monitor_drain(self->sockets[i]->monitor);
+        if (self->sockets[i]->monitor->event & ZMQ_EVENT_CONNECTED) {
+            pthread_mutex_lock(&_mutex);
+            if (zmq_connect(socket, self->sockets[i]->endpoint) != -1) {
+                _MODE(VERBOSE, "ZeroMQ backend:publish connect(#%d): %s\n",
+                      self->mode, i+1, self->sockets[i]->endpoint);
+                /* priority: own connection (not behind the bulk queue) */
+                if (priority &&
+                    zmq_connect(priority, self->sockets[i]->endpoint) == -1) {
+                    _MODE(ERR, "ZeroMQ backend:priority connect(#%d): %s\n",
+                          self->mode, i+1, zmq_strerror(errno));
+                }
+                (*connect)++;
+                self->sockets[i]->monitor->event = 0;
+            }
+            pthread_mutex_unlock(&_mutex);
+        }
+        if (self->sockets[i]->monitor->event & ZMQ_EVENT_DISCONNECTED) {
+            pthread_mutex_lock(&_mutex);
+            if (zmq_disconnect(socket, self->sockets[i]->endpoint) != -1) {
+                _MODE(VERBOSE, "ZeroMQ backend:publish disconnect(#%d): %s\n",
+                      self->mode, i+1, self->sockets[i]->endpoint);
+                if (priority) {
+                    zmq_disconnect(priority, self->sockets[i]->endpoint);
+                }
+                (*connect)--;
+                self->sockets[i]->monitor->event = 0;
+            }
+            pthread_mutex_unlock(&_mutex);
+        }
+    }
+}
+
+
+static void
+_client_publish_monitor_stop(zlmb_client_publish_t *self)
+{
+    int i;
+
+    if (!self) {
+        return;
+    }
+
+    for (i = 0; i < self->count; i++) {
+        if (self->sockets[i]->monitor->thread) {
+            _MODE(VERBOSE, "Thread end backend:publish(#%d).\n",
+                  self->mode, i+1);
+            pthread_kill(self->sockets[i]->monitor->thread, SIGINT);
+            pthread_join(self->sockets[i]->monitor->thread, NULL);
+            self->sockets[i]->monitor->thread = 0;
+        }
+    }
+}
+
+static int
+_client_publish_monitor_start(zlmb_client_publish_t *self)
+{
+    int i;
+
+    if (!self) {
+        return -1;
+    }
+
+    for (i = 0; i < self->count; i++) {
+        pthread_mutex_lock(&_mutex_monitor);
+        _MODE(VERBOSE, "Thread start backend:publish monitor(#%d).\n",
+              self->mode, i+1);
+        if (pthread_create(&(self->sockets[i]->monitor->thread), NULL,
+                           _socket_monitor_event,
+                           (void *)self->sockets[i]->monitor) == -1) {
+            _MODE(ERR, "Thread create backend:publish monitor.\n", self->mode);
+            return -1;
+        }
+
+        pthread_mutex_lock(&_mutex_monitor);
+        pthread_mutex_unlock(&_mutex_monitor);
+
+        if (_interrupted) {
+            _MODE(ERR, "Thread started backend:publish monitor: %s\n",
+                  self->mode, self->sockets[i]->endpoint);
+            return -1;
+        }
+
+        if (zmq_connect(self->sockets[i]->socket,
+                        self->sockets[i]->endpoint) == -1) {
+            _MODE(ERR, "ZeroMQ backend:publish monitor connect: %s: %s\n",
+                  self->mode, self->sockets[i]->endpoint, zmq_strerror(errno));
+            return -1;
+        }
+        _MODE(VERBOSE, "ZeroMQ backend:publish monitor connect(#%d): %s\n",
+              self->mode, i+1, self->sockets[i]->endpoint);
+    }
+
+    return 0;
+}
+
+/* backend: one message from a lane to publish (or dump) */
+static void
+_client_backend_message(void *inproc, void *publish, int send,
+                        zlmb_dump_t *dump, char *mode)
+{
+    int more, flags;
+    size_t moresz = sizeof(more);
+
+    /* ttl: whole message (stamp or drop) */
+    if (_ttl && _ttl->count > 0) {
+        zlmb_stack_t *stack = zlmb_stack_init();
+        if (!stack) {
+            _MODE(ERR, "Message stack initilize.\n", mode);
+            return;
+        }
+        if (_recvmsg_stack(inproc, stack, mode) > 0 &&
+            _ttl_stack(stack, mode) == 0) {
+            _sendmsg_stack(send, publish, stack, 0, dump, mode);
+        }
+        _stack_clear(stack);
+        zlmb_stack_destroy(&stack);
+        return;
+    }
+
+    while (!_interrupted) {
+        zmq_msg_t zmsg;
+
+        _MODE(DEBUG, "ZeroMQ backend:inproc receive message.\n", mode);
+
+        if (zmq_msg_init(&zmsg) != 0) {
+            break;
+        }
+
+        if (zmq_recvmsg(inproc, &zmsg, 0) == -1) {
+            _MODE(ERR, "ZeroMQ backend:inproc receive: %s\n",
+                  mode, zmq_strerror(errno));
+            zmq_msg_close(&zmsg);
+            break;
+        }
+
+        if (zmq_getsockopt(inproc, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            _MODE(ERR, "ZeroMQ backend:inproc receive socket option: %s\n",
+                  mode, zmq_strerror(errno));
+            //zmq_msg_close(&zmsg);
+            //break;
+            more = 0;
+        }
+
+        if (more) {
+            flags = ZMQ_SNDMORE;
+        } else {
+            flags = 0;
+        }
+#ifndef NDEBUG
+        zlmb_dump_printmsg(stderr, &zmsg);
+#endif
+        _MODE(DEBUG, "ZeroMQ backend:publish send message.\n", mode);
+
+        _sendmsg(send, publish, &zmsg, flags, dump, mode);
+
+        zmq_msg_close(&zmsg);
+
+        if (flags == 0) {
+            break;
+        }
+    }
+}
+
+static void
+_client_publish_gc(zlmb_client_publish_t *self, void *inproc,
+                   void *publish, int connect, zlmb_dump_t *dump)
+{
+    zmq_pollitem_t pollitems[] = { { inproc, 0, ZMQ_POLLIN, 0 } };
+
+    if (!self || !inproc || !publish){
+        _MODE(ERR, "Function arguments: %s\n", self->mode, __FUNCTION__);
+        return;
+    }
+
+    _client_publish_connect(self, publish, NULL, &connect);
+
+    while (1) {
+        if (zmq_poll(pollitems, 1, ZLMB_POLL_TIMEOUT) == -1) {
+            break;
+        }
+
+        if (pollitems[0].revents & ZMQ_POLLIN) {
+            _MODE(DEBUG, "ZeroMQ backend:inproc receive in poll event(GC).\n",
+                  self->mode);
+
+            int send;
+
+            if (connect > 0 && !zlmb_memory_divert(_memory)) {
+                send = ZLMB_SENDMSG;
+            } else {
+                send = ZLMB_SENDMSG_DUMP;
+            }
+
+            _client_backend_message(inproc, publish, send, dump, self->mode);
+        } else {
+            break;
+        }
+
+        _client_publish_connect(self, publish, NULL, &connect);
+    }
+}
+
+/* priority: key (first frame) matches a pattern (ex: *.err.*) */
+static int
+_client_priority_match(char *patterns, zmq_msg_t *zmsg)
+{
+    char key[ZLMB_CLIENT_PRIORITY_KEY_SIZE];
+    char pattern[ZLMB_CLIENT_PRIORITY_KEY_SIZE];
+    size_t len;
+
+    len = zmq_msg_size(zmsg);
+    if (len >= sizeof(key)) {
+        len = sizeof(key) - 1;
+    }
+    memcpy(key, zmq_msg_data(zmsg), len);
+    key[len] = '\0';
+
+    while (patterns && *patterns) {
+        char *end = strchr(patterns, ',');
+
+        len = end ? (size_t)(end - patterns) : strlen(patterns);
+        if (len < sizeof(pattern)) {
+            memcpy(pattern, patterns, len);
+            pattern[len] = '\0';
+            if (fnmatch(pattern, key, 0) == 0) {
+                return 1;
+            }
+        }
+
+        if (!end) {
+            break;
+        }
+        patterns = end + 1;
+    }
+
+    return 0;
+}
+
+/* frontend: whole message to the backend lane of its key */
+static void
+_client_frontend_message(void *frontend, zlmb_client_backend_t *backend,
+                         char *mode)
+{
+    int more, flags, frames = 0;
+    size_t moresz = sizeof(more);
+    void *socket = backend->socket;
+
+    while (!_interrupted) {
+        zmq_msg_t zmsg;
+
+        _MODE(DEBUG, "ZeroMQ frontend receive message.\n", mode);
+
+        if (zmq_msg_init(&zmsg) != 0) {
+            break;
+        }
+
+        if (zmq_recvmsg(frontend, &zmsg, 0) == -1) {
+            _MODE(ERR, "ZeroMQ frontend receive: %s\n",
+                  mode, zmq_strerror(errno));
+            zmq_msg_close(&zmsg);
+            break;
+        }
+
+        if (zmq_getsockopt(frontend, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            _MODE(ERR, "ZeroMQ frontend receive socket option: %s\n",
+                  mode, zmq_strerror(errno));
+            more = 0;
+        }
+
+        if (more) {
+            flags = ZMQ_SNDMORE;
+        } else {
+            flags = 0;
+        }
+
+        if (frames++ == 0 && more && backend->priority_socket &&
+            _client_priority_match(backend->priority, &zmsg)) {
+            socket = backend->priority_socket;
+        }
+
+#ifndef NDEBUG
+        zlmb_dump_printmsg(stderr, &zmsg);
+#endif
+        _MODE(DEBUG, "ZeroMQ backend send message.\n", mode);
+
+        if (zmq_sendmsg(socket, &zmsg, flags) == -1) {
+            _MODE(ERR, "ZeroMQ backend send: %s\n", mode, zmq_strerror(errno));
+        }
+
+        zmq_msg_close(&zmsg);
+
+        if (flags == 0) {
+            break;
+        }
+    }
+}
+
+static void
+_client_frontend(void *frontend, zlmb_client_backend_t *backend, char *mode)
+{
+    zmq_pollitem_t pollitems[2] = { { frontend, 0, ZMQ_POLLIN, 0 } };
+    int npollitems = 1;
+
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+
+    while (!_interrupted) {
+        if (zmq_poll(pollitems, npollitems, -1) == -1) {
+            break;
+        }
+
+        if (pollitems[0].revents & ZMQ_POLLIN) {
+            _client_frontend_message(frontend, backend, mode);
+        }
+    }
+}
+
+static int
+_client_backend_priority(zlmb_client_backend_t *self, void **lane,
+                         void **priority)
+{
+    char *endpoint, *token, *end;
+    int connect = 0;
+
+    *lane = NULL;
+    *priority = NULL;
+
+    if (!self->priority_socket) {
+        return 0;
+    }
+
+    /* priority:inproc */
+    *lane = zmq_socket(self->context, ZMQ_PULL);
+    if (!*lane) {
+        _MODE(ERR, "ZeroMQ backend:priority socket: %s\n",
+              self->mode, zmq_strerror(errno));
+        return -1;
+    }
+
+    if (zmq_connect(*lane, ZLMB_CLIENT_PRIORITY_INPROC_SOCKET) == -1) {
+        _MODE(ERR, "ZeroMQ backend:priority connect: %s\n",
+              self->mode, zmq_strerror(errno));
+        zmq_close(*lane);
+        *lane = NULL;
+        return -1;
+    }
+
+    /* priority:publish */
+    *priority = zmq_socket(self->context, ZMQ_PUSH);
+    if (!*priority) {
+        _MODE(ERR, "ZeroMQ backend:priority socket: %s\n",
+              self->mode, zmq_strerror(errno));
+        zmq_close(*lane);
+        *lane = NULL;
+        return -1;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ backend:priority socket: PULL/PUSH (weight: %d)\n",
+          self->mode, self->weight);
+
+    if (!self->priority_endpoints || strlen(self->priority_endpoints) == 0) {
+        return 0;
+    }
+
+    /* priority: own endpoints (ex: publish_priority_frontendpoint) */
+    endpoint = strdup(self->priority_endpoints);
+    if (!endpoint) {
+        zmq_close(*lane);
+        zmq_close(*priority);
+        *lane = NULL;
+        *priority = NULL;
+        return -1;
+    }
+
+    token = endpoint;
+
+    while ((end = strtok(token, ",")) != NULL) {
+        token = NULL;
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        if (zmq_connect(*priority, end) == -1) {
+            _MODE(ERR, "ZeroMQ backend:priority connect: %s: %s\n",
+                  self->mode, end, zmq_strerror(errno));
+            continue;
+        }
+
+        _MODE(VERBOSE, "ZeroMQ backend:priority connect: %s\n",
+              self->mode, end);
+
+        connect++;
+    }
+
+    free(endpoint);
+
+    return connect;
+}
+
+/* frontend side of the priority lane: bound before the backend connects */
+static int
+_client_priority_bind(zlmb_client_backend_t *backend, char *mode)
+{
+    if (!backend->priority || strlen(backend->priority) == 0) {
+        return 0;
+    }
+
+    backend->priority_socket = zmq_socket(backend->context, ZMQ_PUSH);
+    if (!backend->priority_socket) {
+        _MODE(ERR, "ZeroMQ backend:priority socket: %s\n",
+              mode, zmq_strerror(errno));
+        return -1;
+    }
+
+    if (zmq_bind(backend->priority_socket,
+                 ZLMB_CLIENT_PRIORITY_INPROC_SOCKET) == -1) {
+        _MODE(ERR, "ZeroMQ backend:priority bind: %s\n",
+              mode, zmq_strerror(errno));
+        zmq_close(backend->priority_socket);
+        backend->priority_socket = NULL;
+        return -1;
+    }
+
+    _MODE(INFO, "Priority keys: %s (weight: %d)\n",
+          mode, backend->priority, backend->weight);
+    if (backend->priority_endpoints && strlen(backend->priority_endpoints) > 0) {
+        _MODE(INFO, "Priority endpoints: %s\n",
+              mode, backend->priority_endpoints);
+    }
+
+    return 0;
+}
+
+static void
+_client_priority_close(zlmb_client_backend_t *backend)
+{
+    if (backend->priority_socket) {
+        zmq_close(backend->priority_socket);
+        backend->priority_socket = NULL;
+    }
+}
+
+static void *
+_client_backend(void *arg)
+{
+    int connect = 0;
+    zlmb_client_backend_t *self = (zlmb_client_backend_t *)arg;
+    zmq_pollitem_t *pollitems = NULL;
+    int i, npollitems = 2;
+    uint64_t stats = 0;
+    zlmb_dump_t *dump = NULL;
+    void *socket_inproc, *socket_publish, *socket_lane, *socket_priority;
+    zlmb_client_publish_t *publish;
+    zlmb_codec_t *codec = NULL;
+    int lane = -1, priority_connect;
+
+    if (!self || !self->context) {
+        _MODE(ERR, "Function arguments: %s\n", self->mode, __FUNCTION__);
+        _interrupt();
+        pthread_mutex_unlock(&_mutex);
+        return NULL;
+    }
+
+    /* backend:inproc */
+    socket_inproc = zmq_socket(self->context, ZMQ_PULL);
+    if (!socket_inproc) {
+        _MODE(ERR, "ZeroMQ backend:inproc socket: %s\n",
+              self->mode, zmq_strerror(errno));
+        _interrupt();
+        pthread_mutex_unlock(&_mutex);
+        return NULL;
+    }
+
+    _MODE(VERBOSE, "ZeroMQ backend:inproc socket: PULL\n", self->mode);
+
+    if (zmq_connect(socket_inproc, ZLMB_CLIENT_BACKEND_INPROC_SOCKET) == -1) {
+        _MODE(ERR, "ZeroMQ backend:inproc connect: %s\n",
+              self->mode, zmq_strerror(errno));
         zmq_close(socket_inproc);
-        _interrupted = 1;
+        _interrupt();
         pthread_mutex_unlock(&_mutex);
         return NULL;
     }
@@ -690,148 +3614,403 @@ _client_backend(void *arg)
         _MODE(ERR, "ZeroMQ backend:publish socket: %s\n",
               self->mode, zmq_strerror(errno));
         zmq_close(socket_inproc);
-        _interrupted = 1;
+        _interrupt();
         pthread_mutex_unlock(&_mutex);
         return NULL;
     }
 
     _MODE(VERBOSE, "ZeroMQ backend:publish socket: PUSH\n", self->mode);
 
-    publish = _client_publish_init(self->context, socket_publish,
-                                   self->endpoints, self->mode);
-    if (!publish) {
-        _MODE(ERR, "ZeroMQ backend:publish initilized.\n", self->mode);
-        zmq_close(socket_inproc);
-        zmq_close(socket_publish);
-        _interrupted = 1;
-        pthread_mutex_unlock(&_mutex);
+    /* backend:priority (connected with the publish sockets by default) */
+    priority_connect = _client_backend_priority(self, &socket_lane,
+                                                &socket_priority);
+    if (priority_connect == -1) {
+        zmq_close(socket_inproc);
+        zmq_close(socket_publish);
+        _interrupt();
+        pthread_mutex_unlock(&_mutex);
+        return NULL;
+    }
+
+    publish = _client_publish_init(self->context, socket_publish,
+                                   self->endpoints, self->mode);
+    if (!publish) {
+        _MODE(ERR, "ZeroMQ backend:publish initilized.\n", self->mode);
+        if (socket_lane) {
+            zmq_close(socket_lane);
+            zmq_close(socket_priority);
+        }
+        zmq_close(socket_inproc);
+        zmq_close(socket_publish);
+        _interrupt();
+        pthread_mutex_unlock(&_mutex);
+        return NULL;
+    }
+
+    /* backend:publish monitoring */
+    _MODE(VERBOSE, "Monitor start backend:publish.\n", self->mode);
+    if (_client_publish_monitor_start(publish) == -1) {
+        _MODE(ERR, "Monitor backend:publish started.\n", self->mode);
+        _MODE(VERBOSE, "Monitor stop backend:publish.\n", self->mode);
+        _client_publish_monitor_stop(publish);
+        _client_publish_destroy(&publish);
+        if (socket_lane) {
+            zmq_close(socket_lane);
+            zmq_close(socket_priority);
+        }
+        zmq_close(socket_inproc);
+        zmq_close(socket_publish);
+        _interrupt();
+        pthread_mutex_unlock(&_mutex);
+        return NULL;
+    }
+
+    pthread_mutex_unlock(&_mutex);
+
+    /* dump */
+    dump = zlmb_dump_init(self->dumpfile, self->dumptype);
+
+    /* poll: inproc, publish, interrupt, priority, monitors and codec */
+    pollitems = (zmq_pollitem_t *)calloc(5 + publish->count,
+                                         sizeof(zmq_pollitem_t));
+    if (!pollitems) {
+        _MODE(ERR, "Memory allocate poll items.\n", self->mode);
+        _interrupt();
+    } else {
+        pollitems[0].socket = socket_inproc;
+        pollitems[0].events = ZMQ_POLLIN;
+        pollitems[1].socket = socket_publish;
+        pollitems[1].events = ZMQ_POLLIN;
+
+        npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+        if (socket_lane) {
+            lane = npollitems++;
+            pollitems[lane].socket = socket_lane;
+            pollitems[lane].events = ZMQ_POLLIN;
+        }
+        for (i = 0; i < publish->count; i++) {
+            npollitems += _socket_monitor_pollitem(publish->sockets[i]->monitor,
+                                                   &pollitems[npollitems]);
+        }
+    }
+
+    /* codec: compress on worker threads */
+#ifdef USE_SNAPPY
+    if (self->codec > 0 && pollitems) {
+        codec = zlmb_codec_init(ZLMB_CODEC_COMPRESS, self->codec, 0);
+        if (codec) {
+            _MODE(VERBOSE, "Codec threads: %d\n", self->mode, codec->threads);
+            codec->memory = _memory;
+            pollitems[npollitems].fd = zlmb_codec_fd(codec);
+            pollitems[npollitems].events = ZMQ_POLLIN;
+            npollitems++;
+        } else {
+            _MODE(ERR, "Codec initilized.\n", self->mode);
+        }
+    }
+#endif
+
+    /* poll */
+    _MODE(VERBOSE, "ZeroMQ start backend proxy.\n", self->mode);
+
+    _signals();
+
+    _stats_expired(&stats);
+
+    /* connected before the first event */
+    _client_publish_connect(publish, socket_publish,
+                            priority_connect > 0 ? NULL : socket_priority,
+                            &connect);
+
+    while (!_interrupted) {
+        if (zmq_poll(pollitems, npollitems,
+                     _stats_timeout(stats, -1)) == -1) {
+            break;
+        }
+
+        /* priority: strict (weight 0) or weight messages per bulk message */
+        if (lane >= 0 && (pollitems[lane].revents & ZMQ_POLLIN)) {
+            int send, count = 0;
+
+            if (connect > 0 || priority_connect > 0) {
+#ifdef USE_SNAPPY
+                send = ZLMB_SENDMSG_COMPRESS;
+#else
+                send = ZLMB_SENDMSG;
+#endif
+            } else {
+                send = ZLMB_SENDMSG_DUMP;
+            }
+
+            while (!_interrupted &&
+                   (self->weight <= 0 || count < self->weight) &&
+                   _socket_readable(socket_lane)) {
+                _MODE(DEBUG, "ZeroMQ backend:priority receive message.\n",
+                      self->mode);
+                _client_backend_message(socket_lane, socket_priority, send,
+                                        dump, self->mode);
+                self->priority_messages++;
+                count++;
+            }
+        }
+
+        if ((pollitems[0].revents & ZMQ_POLLIN) && codec && connect > 0) {
+            zlmb_stack_t *stack;
+
+            _MODE(DEBUG, "ZeroMQ backend:inproc receive in poll event.\n",
+                  self->mode);
+
+            stack = zlmb_stack_init();
+            if (!stack) {
+                _MODE(ERR, "Message stack initilize.\n", self->mode);
+            } else if (_recvmsg_stack(socket_inproc, stack, self->mode) <= 0 ||
+                       _ttl_stack(stack, self->mode) != 0 ||
+                       _codec_push(codec, stack, socket_publish, connect, 0,
+                                   dump, self->mode) != 0) {
+                _stack_clear(stack);
+                zlmb_stack_destroy(&stack);
+            }
+        } else if (pollitems[0].revents & ZMQ_POLLIN) {
+            int send;
+
+            _MODE(DEBUG, "ZeroMQ backend:inproc receive in poll event.\n",
+                  self->mode);
+
+            if (connect > 0 && !zlmb_memory_divert(_memory)) {
+#ifdef USE_SNAPPY
+                send = ZLMB_SENDMSG_COMPRESS;
+#else
+                send = ZLMB_SENDMSG;
+#endif
+            } else {
+                send = ZLMB_SENDMSG_DUMP;
+            }
+
+            _client_backend_message(socket_inproc, socket_publish, send,
+                                    dump, self->mode);
+        }
+
+        /* codec: compressed messages in order of receive */
+        if (codec) {
+            _codec_send(codec, socket_publish, connect, 0, dump, 0, self->mode);
+        }
+
+        _client_publish_connect(publish, socket_publish,
+                                priority_connect > 0 ? NULL : socket_priority,
+                                &connect);
+
+        if (_stats_expired(&stats)) {
+            _codec_report(codec, self->mode);
+            _memory_report(self->mode);
+            _ttl_report(self->mode);
+            if (socket_lane) {
+                _MODE(INFO, "Priority: messages=%llu\n", self->mode,
+                      (unsigned long long)self->priority_messages);
+            }
+        }
+
+        //_MODE(DEBUG, "sleep(10)", self->mode);
+        //sleep(10);
+    }
+
+    _MODE(VERBOSE, "ZeroMQ end backend proxy.\n", self->mode);
+
+    /* codec: cleanup */
+    if (codec) {
+        _codec_send(codec, socket_publish, connect, 0, dump, 1, self->mode);
+        _codec_report(codec, self->mode);
+        zlmb_codec_destroy(&codec);
+    }
+
+    _memory_report(self->mode);
+    _ttl_report(self->mode);
+
+    /* gc: priority first */
+    if (socket_lane) {
+        _client_publish_gc(publish, socket_lane, socket_priority,
+                           connect, dump);
+        _MODE(INFO, "Priority: messages=%llu\n", self->mode,
+              (unsigned long long)self->priority_messages);
+    }
+    _client_publish_gc(publish, socket_inproc, socket_publish, connect, dump);
+
+    /* publish: monitoring */
+    _MODE(VERBOSE, "Monitor stop backend:publish.\n", self->mode);
+    _client_publish_monitor_stop(publish);
+    _client_publish_destroy(&publish);
+
+    /* socket close */
+    _MODE(VERBOSE, "ZeroMQ backend sockets.\n", self->mode);
+    if (socket_lane) {
+        zmq_close(socket_lane);
+        zmq_close(socket_priority);
+    }
+    zmq_close(socket_inproc);
+    zmq_close(socket_publish);
+
+    /* dump: cleanup */
+    if (dump) {
+        zlmb_dump_destroy(&dump);
+    }
+
+    if (pollitems) {
+        free(pollitems);
+    }
+
+    return NULL;
+}
+
+static int
+_client_syslog_send(void *socket, zlmb_syslogd_message_t *message, int key)
+{
+    /* key frame: facility.severity.app */
+    if (key &&
+        zmq_send(socket, message->key, message->key_len, ZMQ_SNDMORE) == -1) {
+        return -1;
+    }
+
+    return zmq_send(socket, message->data, message->len, 0);
+}
+
+static void *
+_client_syslog(void *arg)
+{
+    zlmb_client_syslog_t *self = (zlmb_client_syslog_t *)arg;
+    zmq_pollitem_t pollitems[1 + ZLMB_SYSLOGD_SOCKET_MAX];
+    int i, npollitems = 0;
+    void *socket;
+
+    socket = zmq_socket(self->context, ZMQ_PUSH);
+    if (!socket) {
+        _MODE(ERR, "ZeroMQ syslog:inproc socket: %s\n",
+              self->mode, zmq_strerror(errno));
+        _interrupt();
         return NULL;
     }
 
-    /* backend:publish monitoring */
-    _MODE(VERBOSE, "Monitor start backend:publish.\n", self->mode);
-    if (_client_publish_monitor_start(publish) == -1) {
-        _MODE(ERR, "Monitor backend:publish started.\n", self->mode);
-        _MODE(VERBOSE, "Monitor stop backend:publish.\n", self->mode);
-        _client_publish_monitor_stop(publish);
-        _client_publish_destroy(&publish);
-        zmq_close(socket_inproc);
-        zmq_close(socket_publish);
-        _interrupted = 1;
-        pthread_mutex_unlock(&_mutex);
+    if (zmq_connect(socket, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET) == -1) {
+        _MODE(ERR, "ZeroMQ syslog:inproc connect: %s\n",
+              self->mode, zmq_strerror(errno));
+        zmq_close(socket);
+        _interrupt();
         return NULL;
     }
 
-    pthread_mutex_unlock(&_mutex);
-
-    /* dump */
-    dump = zlmb_dump_init(self->dumpfile, self->dumptype);
-
-    /* poll */
-    _MODE(VERBOSE, "ZeroMQ start backend proxy.\n", self->mode);
+    _MODE(VERBOSE, "ZeroMQ syslog:inproc connect: %s\n",
+          self->mode, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET);
 
-    pollitems[0].socket = socket_inproc;
-    pollitems[1].socket = socket_publish;
+    for (i = 0; i < self->syslogd->count; i++) {
+        pollitems[i].socket = NULL;
+        pollitems[i].fd = zlmb_syslogd_fd(self->syslogd, i);
+        pollitems[i].events = ZMQ_POLLIN;
+        pollitems[i].revents = 0;
+    }
+    npollitems = self->syslogd->count;
 
-    _signals();
+    /* interrupt */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
 
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 2, ZLMB_POLL_TIMEOUT) == -1) {
+        if (zmq_poll(pollitems, npollitems, -1) == -1) {
             break;
         }
 
-        if (pollitems[0].revents & ZMQ_POLLIN) {
-            int more, flags, send;
-            size_t moresz = sizeof(more);
-
-            _MODE(DEBUG, "ZeroMQ backend:inproc receive in poll event.\n",
-                  self->mode);
+        for (i = 0; i < self->syslogd->count && !_interrupted; i++) {
+            int j, n;
 
-            if (connect > 0) {
-#ifdef USE_SNAPPY
-                send = ZLMB_SENDMSG_COMPRESS;
-#else
-                send = ZLMB_SENDMSG;
-#endif
-            } else {
-                send = ZLMB_SENDMSG_DUMP;
+            if (!(pollitems[i].revents & ZMQ_POLLIN)) {
+                continue;
             }
 
-            while (!_interrupted) {
-                zmq_msg_t zmsg;
-
-                _MODE(DEBUG, "ZeroMQ backend:inproc receive message.\n",
-                      self->mode);
+            /* batch: one recvmmsg per readable socket */
+            n = zlmb_syslogd_recv(self->syslogd, i);
+            if (n == -1) {
+                _MODE(ERR, "Syslog receive: %s\n",
+                      self->mode, strerror(errno));
+                continue;
+            }
 
-                if (zmq_msg_init(&zmsg) != 0) {
-                    break;
-                }
+            _MODE(DEBUG, "Syslog receive messages: %d\n", self->mode, n);
 
-                if (zmq_recvmsg(socket_inproc, &zmsg, 0) == -1) {
-                    _MODE(ERR, "ZeroMQ backend:inproc receive: %s\n",
+            for (j = 0; j < n; j++) {
+                if (_client_syslog_send(socket,
+                                        zlmb_syslogd_message(self->syslogd, j),
+                                        self->key) == -1) {
+                    _MODE(ERR, "ZeroMQ syslog:inproc send: %s\n",
                           self->mode, zmq_strerror(errno));
-                    zmq_msg_close(&zmsg);
                     break;
                 }
+            }
+        }
+    }
 
-                if (zmq_getsockopt(socket_inproc, ZMQ_RCVMORE,
-                                   &more, &moresz) == -1) {
-                    _MODE(ERR,
-                          "ZeroMQ backend:inproc receive socket option: %s\n",
-                          self->mode, zmq_strerror(errno));
-                    //zmq_msg_close(&zmsg);
-                    //break;
-                    more = 0;
-                }
+    zmq_close(socket);
 
-                if (more) {
-                    flags = ZMQ_SNDMORE;
-                } else {
-                    flags = 0;
-                }
-#ifndef NDEBUG
-                zlmb_dump_printmsg(stderr, &zmsg);
-#endif
-                _MODE(DEBUG, "ZeroMQ backend:publish send message.\n",
-                      self->mode);
+    return NULL;
+}
 
-                _sendmsg(send, socket_publish, &zmsg, flags, dump, self->mode);
+static int
+_client_syslog_start(zlmb_client_syslog_t *self, void *context, void *frontend)
+{
+    if (!self || !self->endpoints || strlen(self->endpoints) == 0) {
+        return 0;
+    }
 
-                zmq_msg_close(&zmsg);
+    _MODE(INFO, "Syslog endpoint: %s\n", self->mode, self->endpoints);
+    if (self->key) {
+        _MODE(INFO, "Syslog key: enable\n", self->mode);
+    }
 
-                if (flags == 0) {
-                    break;
-                }
-            }
-        }
+    self->syslogd = zlmb_syslogd_init(self->endpoints, self->key);
+    if (!self->syslogd) {
+        _MODE(ERR, "Syslog endpoint: %s: %s\n",
+              self->mode, self->endpoints, strerror(errno));
+        return -1;
+    }
 
-        _client_publish_connect(publish, socket_publish, &connect);
+    /* frontend: datagrams join the client messages */
+    if (zmq_bind(frontend, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET) == -1) {
+        _MODE(ERR, "ZeroMQ frontend bind: %s: %s\n",
+              self->mode, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET,
+              zmq_strerror(errno));
+        zlmb_syslogd_destroy(&self->syslogd);
+        return -1;
+    }
 
-        //_MODE(DEBUG, "sleep(10)", self->mode);
-        //sleep(10);
+    self->context = context;
+
+    _MODE(VERBOSE, "Thread start syslog.\n", self->mode);
+    if (pthread_create(&(self->thread), NULL,
+                       _client_syslog, (void *)self) != 0) {
+        _MODE(ERR, "Thread create syslog.\n", self->mode);
+        zmq_unbind(frontend, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET);
+        zlmb_syslogd_destroy(&self->syslogd);
+        return -1;
     }
 
-    _MODE(VERBOSE, "ZeroMQ end backend proxy.\n", self->mode);
+    return 0;
+}
 
-    /* gc */
-    _client_publish_gc(publish, socket_inproc, socket_publish, connect, dump);
+static void
+_client_syslog_stop(zlmb_client_syslog_t *self, void *frontend)
+{
+    if (!self || !self->syslogd) {
+        return;
+    }
 
-    /* publish: monitoring */
-    _MODE(VERBOSE, "Monitor stop backend:publish.\n", self->mode);
-    _client_publish_monitor_stop(publish);
-    _client_publish_destroy(&publish);
+    _MODE(VERBOSE, "Thread end syslog.\n", self->mode);
+    pthread_kill(self->thread, SIGINT);
+    pthread_join(self->thread, NULL);
 
-    /* socket close */
-    _MODE(VERBOSE, "ZeroMQ backend sockets.\n", self->mode);
-    zmq_close(socket_inproc);
-    zmq_close(socket_publish);
+    zmq_unbind(frontend, ZLMB_CLIENT_SYSLOG_INPROC_SOCKET);
 
-    /* dump: cleanup */
-    if (dump) {
-        zlmb_dump_destroy(&dump);
-    }
+    _MODE(INFO, "Syslog messages: %llu (batches: %llu, truncated: %llu)\n",
+          self->mode,
+          (unsigned long long)self->syslogd->received,
+          (unsigned long long)self->syslogd->batches,
+          (unsigned long long)self->syslogd->truncated);
 
-    return NULL;
+    zlmb_syslogd_destroy(&self->syslogd);
 }
 
 static void
@@ -841,6 +4020,8 @@ _subscribe_monitor_connect(zlmb_socket_monitor_t *self, int *connect)
         return;
     }
 
+    _socket_monitor_drain(self);
+
     if (self->event & ZMQ_EVENT_ACCEPTED) {
         pthread_mutex_lock(&_mutex);
         (*connect)++;
@@ -858,13 +4039,18 @@ _subscribe_monitor_connect(zlmb_socket_monitor_t *self, int *connect)
 //------------------------------------------------------------------------------
 
 static int
-_server_client(char *frontendpoint, char *backendpoints,
-               char *dumpfile, int dumptype)
+_server_client(char *frontendpoint, char *syslogendpoints, int syslogkey,
+               char *backendpoints, char *dumpfile, int dumptype, int codec,
+               char *priority, int weight, char *priority_endpoints)
 {
     void *context, *frontend;
     zlmb_client_backend_t backend = { 0, NULL, NULL, backendpoints,
                                       dumpfile, dumptype,
-                                      ZLMB_OPTION_MODE_CLIENT };
+                                      ZLMB_OPTION_MODE_CLIENT, codec,
+                                      priority, weight, priority_endpoints,
+                                      NULL, 0 };
+    zlmb_client_syslog_t syslogd = { 0, NULL, NULL, syslogendpoints,
+                                     syslogkey, ZLMB_OPTION_MODE_CLIENT };
 
     if (!frontendpoint || strlen(frontendpoint) == 0) {
         _CLIENT(ERR, "frontendpoint.\n");
@@ -882,7 +4068,7 @@ _server_client(char *frontendpoint, char *backendpoints,
             dumpfile, zlmb_option_dumptype2string(dumptype));
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _CLIENT(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         return -1;
@@ -891,13 +4077,13 @@ _server_client(char *frontendpoint, char *backendpoints,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -906,28 +4092,26 @@ _server_client(char *frontendpoint, char *backendpoints,
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _CLIENT(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     _CLIENT(VERBOSE, "ZeroMQ frontend socket: PULL\n")
 
-    if (zmq_bind(frontend, frontendpoint) == -1) {
-        _CLIENT(ERR, "ZeroMQ frontend bind: %s\n", zmq_strerror(errno));
+    if (_bind_endpoints(frontend, frontendpoint, "frontend",
+                        ZLMB_OPTION_MODE_CLIENT) == -1) {
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
-    _CLIENT(VERBOSE, "ZeroMQ frontend bind: %s\n", frontendpoint);
-
     /* backend */
     backend.context = context;
     backend.socket = zmq_socket(context, ZMQ_PUSH);
     if (!backend.socket) {
         _CLIENT(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -938,13 +4122,21 @@ _server_client(char *frontendpoint, char *backendpoints,
         _CLIENT(ERR, "ZeroMQ backend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
         zmq_close(backend.socket);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     _CLIENT(VERBOSE, "ZeroMQ backend bind: %s\n",
             ZLMB_CLIENT_BACKEND_INPROC_SOCKET);
 
+    /* backend: priority */
+    if (_client_priority_bind(&backend, ZLMB_OPTION_MODE_CLIENT) == -1) {
+        zmq_close(frontend);
+        zmq_close(backend.socket);
+        _context_destroy(context);
+        return -1;
+    }
+
     /* backend: thread */
     pthread_mutex_lock(&_mutex);
     _CLIENT(VERBOSE, "Thread start backend.\n");
@@ -953,23 +4145,39 @@ _server_client(char *frontendpoint, char *backendpoints,
         _CLIENT(ERR, "Thread create backend.\n");
         zmq_close(frontend);
         zmq_close(backend.socket);
-        zmq_ctx_destroy(context);
+        _client_priority_close(&backend);
+        _context_destroy(context);
         return -1;
     }
 
     pthread_mutex_lock(&_mutex);
     pthread_mutex_unlock(&_mutex);
 
-    if (!_interrupted) {
+    /* syslog */
+    if (_client_syslog_start(&syslogd, context, frontend) == -1) {
+        _interrupt();
+    }
+
+    _pipeline_started();
+
+    if (!_interrupted && backend.priority_socket) {
+        _CLIENT(VERBOSE, "ZeroMQ start priority proxy.\n");
+        _signals();
+        _client_frontend(frontend, &backend, ZLMB_OPTION_MODE_CLIENT);
+        _CLIENT(VERBOSE, "ZeroMQ end priority proxy.\n");
+    } else if (!_interrupted) {
         _CLIENT(VERBOSE, "ZeroMQ start proxy.\n");
         _signals();
         zmq_proxy(frontend, backend.socket, NULL);
         _CLIENT(VERBOSE, "ZeroMQ end proxy.\n");
     }
 
+    /* syslog: cleanup */
+    _client_syslog_stop(&syslogd, frontend);
+
     /* frontend: unbind */
-    _CLIENT(VERBOSE, "ZeroMQ frontend unnbind: %s", frontendpoint);
-    zmq_unbind(frontend, frontendpoint);
+    _unbind_endpoints(frontend, frontendpoint, "frontend",
+                      ZLMB_OPTION_MODE_CLIENT);
 
     /* backend: cleanup */
     _CLIENT(VERBOSE, "Thread end backend.\n");
@@ -980,21 +4188,30 @@ _server_client(char *frontendpoint, char *backendpoints,
     _CLIENT(VERBOSE, "ZeroMQ close sockets.\n");
     zmq_close(frontend);
     zmq_close(backend.socket);
+    _client_priority_close(&backend);
 
     /* context: cleanup */
     _CLIENT(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     return 0;
 }
 
 static int
-_server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
+_server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey,
+                zlmb_publish_stage_t *stage)
 {
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 } };
+    int n, npollitems = 1;
+    zlmb_ratelimit_t *ratelimit = stage ? stage->ratelimit : NULL;
     void *context, *frontend, *backend;
     size_t key_len = 0;
     char *compress_key = NULL;
+    uint64_t stats = 0;
 
     if (!frontendpoint || strlen(frontendpoint) == 0) {
         _PUBLISH(ERR, "frontendpoint.\n");
@@ -1017,12 +4234,13 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 
     _PUBLISH(INFO, "Bind front endpoint: %s\n", frontendpoint);
     _PUBLISH(INFO, "Bind back endpoint: %s\n", backendpoint);
-    _PUBLISH(INFO, "Publish key: %s\n", key);
+    _PUBLISH(INFO, "Publish key: %s\n", key ? key : "-");
     if (sendkey) {
         _PUBLISH(INFO, "Send publish key: enable\n");
     } else {
         _PUBLISH(INFO, "Send publish key: disable\n");
     }
+    _publish_stage_info(stage, ZLMB_OPTION_MODE_PUBLISH);
 
 #ifdef USE_SNAPPY
     if (key) {
@@ -1042,7 +4260,7 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 #endif
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _PUBLISH(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         if (compress_key) {
@@ -1054,13 +4272,13 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -1069,7 +4287,7 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _PUBLISH(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1081,7 +4299,7 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
     if (zmq_bind(frontend, frontendpoint) == -1) {
         _PUBLISH(ERR, "ZeroMQ frontend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1095,7 +4313,7 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
     if (!backend) {
         _PUBLISH(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1108,7 +4326,7 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
         _PUBLISH(ERR, "ZeroMQ backend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1117,20 +4335,47 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 
     _PUBLISH(VERBOSE, "ZeroMQ backend bind: %s\n", frontendpoint);
 
+    /* replay, journal, priority */
+    n = _publish_stage_open(stage, context, &pollitems[1], ZLMB_OPTION_MODE_PUBLISH);
+    if (n == -1) {
+        zmq_close(frontend);
+        zmq_close(backend);
+        _context_destroy(context);
+        if (compress_key) {
+            free(compress_key);
+        }
+        return -1;
+    }
+
+    npollitems += n;
+
+    /* interrupt */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+
     /* poll */
     _PUBLISH(VERBOSE, "ZeroMQ start proxy.\n");
 
     pollitems[0].socket = frontend;
 
+    _pipeline_started();
+
     _signals();
 
+    _stats_expired(&stats);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, -1) == -1) {
+        if (zmq_poll(pollitems, npollitems,
+                     _publish_stage_timeout(stage,
+                                            _stats_timeout(stats, -1))) == -1) {
             break;
         }
 
+        /* priority: before the next frontend message */
+        _publish_stage_priority(stage, backend, key, key_len,
+                                ZLMB_OPTION_MODE_PUBLISH);
+
         if (pollitems[0].revents & ZMQ_POLLIN) {
-            int more, flags, first = 1;
+            int more, flags, first = 1, frames = 0;
             size_t moresz = sizeof(more);
 
             _PUBLISH(DEBUG, "ZeroMQ frontend receive in poll event.\n");
@@ -1160,12 +4405,23 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
                     more = 0;
                 }
 
-                if (more) {
+                if (more || (stage && stage->sequence)) {
                     flags = ZMQ_SNDMORE;
                 } else {
                     flags = 0;
                 }
 
+                if (++frames == 1 &&
+                    _ratelimit_message(ratelimit, frontend, &zmsg, more,
+                                       ZLMB_OPTION_MODE_PUBLISH) != 0) {
+                    zmq_msg_close(&zmsg);
+                    break;
+                }
+
+                if (frames == 1) {
+                    _publish_stage_begin(stage, &zmsg, more);
+                }
+
                 if (key && first) {
 #ifndef NDEBG
                     zlmb_dump_print(stderr, key, key_len);
@@ -1177,6 +4433,8 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
                         _PUBLISH(ERR, "ZeroMQ backend send: %s\n",
                                  zmq_strerror(errno));
                     }
+                    _publish_stage_frame(stage, NULL, key, key_len,
+                                         ZLMB_SENDMSG);
                     first = 0;
                 }
 
@@ -1185,6 +4443,8 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 #endif
                 _PUBLISH(DEBUG, "ZeroMQ backend send message.\n");
 
+                _publish_stage_frame(stage, &zmsg, NULL, 0, ZLMB_SENDMSG);
+
                 if (zmq_sendmsg(backend, &zmsg, flags) == -1) {
                     _PUBLISH(ERR, "ZeroMQ backend send: %s\n",
                              zmq_strerror(errno));
@@ -1193,23 +4453,33 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 
                 zmq_msg_close(&zmsg);
 
-                if (flags == 0) {
+                if (!more) {
+                    _publish_stage_end(stage, backend, ZLMB_OPTION_MODE_PUBLISH);
                     break;
                 }
             }
         }
+
+        _publish_stage_poll(stage, &pollitems[1], ZLMB_OPTION_MODE_PUBLISH);
+
+        if (_stats_expired(&stats)) {
+            _publish_stage_report(stage, ZLMB_OPTION_MODE_PUBLISH);
+        }
     }
 
     _PUBLISH(VERBOSE, "ZeroMQ end proxy.\n");
 
+    _publish_stage_report(stage, ZLMB_OPTION_MODE_PUBLISH);
+
     /* sockets: cleanup */
     _PUBLISH(VERBOSE, "ZeroMQ close sockets.\n");
+    _publish_stage_close(stage);
     zmq_close(frontend);
     zmq_close(backend);
 
     /* context: cleanup */
     _PUBLISH(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     if (compress_key) {
         free(compress_key);
@@ -1220,10 +4490,13 @@ _server_publish(char *frontendpoint, char *backendpoint, char *key, int sendkey)
 
 static int
 _server_subscribe(char *frontendpoints, char *backendpoint,
-                  char *key, int dropkey, char *dumpfile, int dumptype)
+                  char *key, int dropkey, char *dumpfile, int dumptype,
+                  zlmb_subscribe_stage_t *stage)
 {
-    int connect = 0;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    int connect = 0, npollitems = 1;
+    uint64_t stats = 0;
+    zmq_pollitem_t pollitems[3 + ZLMB_SUBSCRIBE_SOCKET_MAX] = {
+        { NULL, 0, ZMQ_POLLIN, 0 } };
     zlmb_dump_t *dump = NULL;
     char *endpoint, *token;
     void *context, *frontend, *backend;
@@ -1231,9 +4504,13 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     char *compress_key = NULL;
     size_t key_len = 0;
 
+    /* journal: frontend is optional */
     if (!frontendpoints || strlen(frontendpoints) == 0) {
-        _SUBSCRIBE(ERR, "frontendpoints.\n");
-        return -1;
+        if (!stage || !stage->journalendpoint) {
+            _SUBSCRIBE(ERR, "frontendpoints.\n");
+            return -1;
+        }
+        frontendpoints = "";
     }
 
     if (!backendpoint || strlen(backendpoint) == 0) {
@@ -1257,9 +4534,27 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     }
     _SUBSCRIBE(INFO, "Dump file: %s (%s)\n",
                dumpfile, zlmb_option_dumptype2string(dumptype));
+    if (stage && stage->dedup) {
+        _SUBSCRIBE(INFO, "Dedup: enable (memory:%ld, window:%llu)\n",
+                   stage->dedup->bits / 4,
+                   (unsigned long long)stage->dedup->window / 1000000);
+    }
+    if (stage && stage->replayendpoints) {
+        _SUBSCRIBE(INFO, "Replay endpoints: %s (catchup:%s)\n",
+                   stage->replayendpoints,
+                   stage->replay_catchup ? "enable" : "disable");
+    }
+    if (stage && stage->journalendpoint) {
+        _SUBSCRIBE(INFO, "Journal endpoint: %s (offset:%s)\n",
+                   stage->journalendpoint, stage->journal_offsetfile);
+    }
+    if (stage && stage->priority_endpoints) {
+        _SUBSCRIBE(INFO, "Priority endpoints: %s\n",
+                   stage->priority_endpoints);
+    }
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _SUBSCRIBE(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         return -1;
@@ -1268,13 +4563,13 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -1283,7 +4578,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     frontend = zmq_socket(context, ZMQ_SUB);
     if (!frontend) {
         _SUBSCRIBE(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1309,7 +4604,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     if (zmq_setsockopt(frontend, ZMQ_SUBSCRIBE, key, key_len) == -1) {
         _SUBSCRIBE(ERR, "ZeroMQ frontend subscribe key: %s\n",
                    zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1341,7 +4636,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
                        end, zmq_strerror(errno));
             free(endpoint);
             zmq_close(frontend);
-            zmq_ctx_destroy(context);
+            _context_destroy(context);
             return -1;
         }
 
@@ -1357,7 +4652,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     if (!backend) {
         _SUBSCRIBE(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1368,7 +4663,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
                             ZLMB_SUBSCRIBE_MONITOR_SOCKET, getpid()) == -1) {
         _SUBSCRIBE(ERR, "Allocate monitor string backend point.\n");
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1378,7 +4673,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1391,7 +4686,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1406,7 +4701,7 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1415,25 +4710,44 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
     /* dump */
     dump = zlmb_dump_init(dumpfile, dumptype);
 
+    /* replay, journal, codec, priority */
+    npollitems += _subscribe_stage_open(stage, context, &pollitems[1],
+                                        ZLMB_OPTION_MODE_SUBSCRIBE);
+
+    /* interrupt and backend monitor */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+    npollitems += _socket_monitor_pollitem(monitor, &pollitems[npollitems]);
+
     /* poll */
     _SUBSCRIBE(VERBOSE, "ZeroMQ start proxy.\n");
 
     pollitems[0].socket = frontend;
 
+    _pipeline_started();
+
     _signals();
 
+    _stats_expired(&stats);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, ZLMB_POLL_TIMEOUT) == -1) {
+        if (zmq_poll(pollitems, npollitems,
+                     _subscribe_stage_timeout(stage, connect,
+                                              _stats_timeout(stats,
+                                                             -1))) == -1) {
             break;
         }
 
+        /* priority: before the next frontend message */
+        _subscribe_stage_priority(stage, connect, backend, dropkey, dump,
+                                  ZLMB_OPTION_MODE_SUBSCRIBE);
+
         if (pollitems[0].revents & ZMQ_POLLIN) {
             int more, flags, send, frames = 0;
             size_t moresz = sizeof(more);
 
             _SUBSCRIBE(DEBUG, "ZeroMQ fronend receive in poll event.\n");
 
-            if (connect > 0) {
+            if (connect > 0 && !zlmb_memory_divert(_memory)) {
 #ifdef USE_SNAPPY
                 send = ZLMB_SENDMSG_UNCOMPRESS;
 #else
@@ -1443,7 +4757,13 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
                 send = ZLMB_SENDMSG_DUMP;
             }
 
-            while (!_interrupted) {
+            if (stage) {
+                _subscribe_stage_message(stage, frontend, backend, send,
+                                         dropkey, dump,
+                                         ZLMB_OPTION_MODE_SUBSCRIBE);
+            }
+
+            while (!stage && !_interrupted) {
                 zmq_msg_t zmsg;
 
                 _SUBSCRIBE(DEBUG, "ZeroMQ fronend receive message.\n");
@@ -1493,11 +4813,27 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
             }
         }
 
+        _subscribe_stage_poll(stage, &pollitems[1], connect, backend, dropkey,
+                              dump, ZLMB_OPTION_MODE_SUBSCRIBE);
+
         _subscribe_monitor_connect(monitor, &connect);
+
+        if (_stats_expired(&stats)) {
+            _subscribe_stage_report(stage, ZLMB_OPTION_MODE_SUBSCRIBE);
+            _memory_report(ZLMB_OPTION_MODE_SUBSCRIBE);
+            _ttl_report(ZLMB_OPTION_MODE_SUBSCRIBE);
+        }
     }
 
     _SUBSCRIBE(VERBOSE, "ZeroMQ end proxy.\n");
 
+    _subscribe_stage_flush(stage, connect, backend, dropkey, dump,
+                           ZLMB_OPTION_MODE_SUBSCRIBE);
+
+    _subscribe_stage_report(stage, ZLMB_OPTION_MODE_SUBSCRIBE);
+    _memory_report(ZLMB_OPTION_MODE_SUBSCRIBE);
+    _ttl_report(ZLMB_OPTION_MODE_SUBSCRIBE);
+
     /* gc ? */
     //TODO
 
@@ -1509,12 +4845,13 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
 
     /* sockets: cleanup */
     _SUBSCRIBE(VERBOSE, "ZeroMQ close sockets.\n");
+    _subscribe_stage_close(stage, ZLMB_OPTION_MODE_SUBSCRIBE);
     zmq_close(frontend);
     zmq_close(backend);
 
     /* context: cleanup */
     _SUBSCRIBE(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     /* dump: cleanup */
     if (dump) {
@@ -1525,13 +4862,24 @@ _server_subscribe(char *frontendpoints, char *backendpoint,
 }
 
 int
-_server_client_publish(char *frontendpoint, char *backendpoint,
-                       char *key, int sendkey)
+_server_client_publish(char *frontendpoint, char *syslogendpoints,
+                       int syslogkey, char *backendpoint,
+                       char *key, int sendkey, zlmb_publish_stage_t *stage)
 {
     void *context, *frontend, *backend;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_client_syslog_t syslogd = { 0, NULL, NULL, syslogendpoints,
+                                     syslogkey,
+                                     ZLMB_OPTION_MODE_CLIENT_PUBLISH };
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 } };
+    int n, npollitems = 1;
+    zlmb_ratelimit_t *ratelimit = stage ? stage->ratelimit : NULL;
     size_t key_len = 0;
     char *compress_key = NULL;
+    uint64_t stats = 0;
 
     if (!frontendpoint || strlen(frontendpoint) == 0) {
         _CLI_PUB(ERR, "frontend.\n");
@@ -1554,12 +4902,13 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 
     _CLI_PUB(INFO, "Bind front endpoint: %s\n", frontendpoint);
     _CLI_PUB(INFO, "Bind back endpoint: %s\n", backendpoint);
-    _CLI_PUB(INFO, "Publish key: %s\n", key);
+    _CLI_PUB(INFO, "Publish key: %s\n", key ? key : "-");
     if (sendkey) {
         _CLI_PUB(INFO, "Send publish key: enable\n");
     } else {
         _CLI_PUB(INFO, "Send publish key: disable\n");
     }
+    _publish_stage_info(stage, ZLMB_OPTION_MODE_CLIENT_PUBLISH);
 
 #ifdef USE_SNAPPY
     if (key) {
@@ -1579,7 +4928,7 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 #endif
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _CLI_PUB(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         if (compress_key) {
@@ -1591,13 +4940,13 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -1606,7 +4955,7 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _CLI_PUB(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1615,24 +4964,22 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 
     _CLI_PUB(VERBOSE, "ZeroMQ frontend socket: PULL\n")
 
-    if (zmq_bind(frontend, frontendpoint) == -1) {
-        _CLI_PUB(ERR, "ZeroMQ frontend bind: %s\n", zmq_strerror(errno));
+    if (_bind_endpoints(frontend, frontendpoint, "frontend",
+                        ZLMB_OPTION_MODE_CLIENT_PUBLISH) == -1) {
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
         return -1;
     }
 
-    _CLI_PUB(VERBOSE, "ZeroMQ frontend bind: %s\n", frontendpoint);
-
     /* backend */
     backend = zmq_socket(context, ZMQ_PUB);
     if (!backend) {
         _CLI_PUB(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1645,7 +4992,7 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
         _CLI_PUB(ERR, "ZeroMQ backend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -1654,6 +5001,28 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 
     _CLI_PUB(VERBOSE, "ZeroMQ backend bind: %s\n", backendpoint);
 
+    /* replay, journal, priority */
+    n = _publish_stage_open(stage, context, &pollitems[1], ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+    if (n == -1) {
+        zmq_close(frontend);
+        zmq_close(backend);
+        _context_destroy(context);
+        if (compress_key) {
+            free(compress_key);
+        }
+        return -1;
+    }
+
+    npollitems += n;
+
+    /* interrupt */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+
+    /* syslog */
+    if (_client_syslog_start(&syslogd, context, frontend) == -1) {
+        _interrupt();
+    }
+
     /* poll */
     _CLI_PUB(VERBOSE, "ZeroMQ start proxy.\n");
 
@@ -1661,19 +5030,23 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 
     _signals();
 
+    _stats_expired(&stats);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, -1) == -1) {
+        if (zmq_poll(pollitems, npollitems,
+                     _publish_stage_timeout(stage,
+                                            _stats_timeout(stats, -1))) == -1) {
             break;
         }
 
+        /* priority: before the next frontend message */
+        _publish_stage_priority(stage, backend, key, key_len,
+                                ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+
         if (pollitems[0].revents & ZMQ_POLLIN) {
-            int more, flags, first = 1;
+            int more, flags, first = 1, frames = 0;
             size_t moresz = sizeof(more);
-#ifdef USE_SNAPPY
-            int send = ZLMB_SENDMSG_COMPRESS;
-#else
-            int send = ZLMB_SENDMSG;
-#endif
+
             _CLI_PUB(DEBUG, "ZeroMQ frontend receive in poll event.\n");
             while (!_interrupted) {
                 zmq_msg_t zmsg;
@@ -1700,12 +5073,23 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
                     more = 0;
                 }
 
-                if (more) {
+                if (more || (stage && stage->sequence)) {
                     flags = ZMQ_SNDMORE;
                 } else {
                     flags = 0;
                 }
 
+                if (++frames == 1 &&
+                    _ratelimit_message(ratelimit, frontend, &zmsg, more,
+                                       ZLMB_OPTION_MODE_CLIENT_PUBLISH) != 0) {
+                    zmq_msg_close(&zmsg);
+                    break;
+                }
+
+                if (frames == 1) {
+                    _publish_stage_begin(stage, &zmsg, more);
+                }
+
                 if (key && first) {
 #ifndef NDEBG
                     zlmb_dump_print(stderr, key, key_len);
@@ -1717,6 +5101,8 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
                         _CLI_PUB(ERR, "ZeroMQ frontend send: %s\n",
                                  zmq_strerror(errno));
                     }
+                    _publish_stage_frame(stage, NULL, key, key_len,
+                                         ZLMB_SENDMSG);
                     first = 0;
                 }
 
@@ -1725,28 +5111,48 @@ _server_client_publish(char *frontendpoint, char *backendpoint,
 #endif
                 _CLI_PUB(DEBUG, "ZeroMQ backend send message.\n");
 
-                _sendmsg(send, backend, &zmsg, flags, NULL,
+#ifdef USE_SNAPPY
+                /* compressed once for backend, replay and journal */
+                _msg_compress(&zmsg, ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+#endif
+
+                _publish_stage_frame(stage, &zmsg, NULL, 0, ZLMB_SENDMSG);
+
+                _sendmsg(ZLMB_SENDMSG, backend, &zmsg, flags, NULL,
                          ZLMB_OPTION_MODE_CLIENT_PUBLISH);
 
                 zmq_msg_close(&zmsg);
 
-                if (flags == 0) {
+                if (!more) {
+                    _publish_stage_end(stage, backend, ZLMB_OPTION_MODE_CLIENT_PUBLISH);
                     break;
                 }
             }
         }
+
+        _publish_stage_poll(stage, &pollitems[1], ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+
+        if (_stats_expired(&stats)) {
+            _publish_stage_report(stage, ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+        }
     }
 
     _CLI_PUB(VERBOSE, "ZeroMQ end proxy.\n");
 
+    /* syslog: cleanup */
+    _client_syslog_stop(&syslogd, frontend);
+
+    _publish_stage_report(stage, ZLMB_OPTION_MODE_CLIENT_PUBLISH);
+
     /* sockets: cleanup */
     _CLI_PUB(VERBOSE, "ZeroMQ close sockets.\n");
+    _publish_stage_close(stage);
     zmq_close(frontend);
     zmq_close(backend);
 
     /* context: cleanup */
     _CLI_PUB(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     if (compress_key) {
         free(compress_key);
@@ -1759,8 +5165,10 @@ int
 _server_publish_subscribe(char *frontendpoint, char *backendpoint,
                           char *dumpfile, int dumptype)
 {
-    int connect = 0;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    int connect = 0, npollitems = 1;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 } };
     zlmb_dump_t *dump = NULL;
     void *context, *frontend, *backend;
     char *endpoint;
@@ -1782,7 +5190,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
              dumpfile, zlmb_option_dumptype2string(dumptype));
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _PUB_SUB(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         return -1;
@@ -1791,13 +5199,13 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -1806,7 +5214,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _PUB_SUB(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1815,7 +5223,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
     if (zmq_bind(frontend, frontendpoint) == -1) {
         _PUB_SUB(ERR, "ZeroMQ frontend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1826,7 +5234,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
     if (!backend) {
         _PUB_SUB(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1837,7 +5245,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
         _PUB_SUB(ERR, "ZeroMQ backend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1849,7 +5257,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
         _PUB_SUB(ERR, "Allocate monitor string backend point.\n");
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1859,7 +5267,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1872,7 +5280,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -1884,10 +5292,16 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
 
     pollitems[0].socket = frontend;
 
+    /* interrupt and backend monitor */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+    npollitems += _socket_monitor_pollitem(monitor, &pollitems[npollitems]);
+
     _signals();
 
+    _subscribe_monitor_connect(monitor, &connect);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, ZLMB_POLL_TIMEOUT) == -1) {
+        if (zmq_poll(pollitems, npollitems, -1) == -1) {
             break;
         }
 
@@ -1897,7 +5311,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
 
             _PUB_SUB(DEBUG, "ZeroMQ frontend receive in poll event.\n");
 
-            if (connect > 0) {
+            if (connect > 0 && !zlmb_memory_divert(_memory)) {
 #ifdef USE_SNAPPY
                 send = ZLMB_SENDMSG_UNCOMPRESS;
 #else
@@ -1972,7 +5386,7 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
 
     /* context: cleanup */
     _PUB_SUB(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     /* dump: cleanup */
     if (dump) {
@@ -1984,22 +5398,36 @@ _server_publish_subscribe(char *frontendpoint, char *backendpoint,
 
 static int
 _server_client_subscribe(char *client_frontendpoint,
+                         char *client_syslogendpoints,
+                         int client_syslogkey,
                          char *client_backendpoints,
                          char *client_dumpfile,
                          int client_dumptype,
+                         int client_codec,
+                         char *client_priority,
+                         int client_weight,
+                         char *client_priority_endpoints,
                          char *subscribe_frontendpoints,
                          char *subscribe_backendpoint,
                          char *subscribe_key, int subscribe_dropkey,
                          char *subscribe_dumpfile,
-                         int subscribe_dumptype)
+                         int subscribe_dumptype,
+                         zlmb_subscribe_stage_t *subscribe_stage)
 {
     int subscribe_connect = 0;
+    uint64_t stats = 0;
     zlmb_client_backend_t client_backend =
         { 0, NULL, NULL, client_backendpoints,
           client_dumpfile, client_dumptype,
+          ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE, client_codec,
+          client_priority, client_weight, client_priority_endpoints,
+          NULL, 0 };
+    zlmb_client_syslog_t client_syslogd =
+        { 0, NULL, NULL, client_syslogendpoints, client_syslogkey,
           ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE };
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
-                                   { NULL, 0, ZMQ_POLLIN, 0 } };
+    zmq_pollitem_t pollitems[4 + ZLMB_SUBSCRIBE_SOCKET_MAX] = {
+        { NULL, 0, ZMQ_POLLIN, 0 }, { NULL, 0, ZMQ_POLLIN, 0 } };
+    int npollitems = 2;
     zlmb_dump_t *subscribe_dump = NULL;
     char *endpoint, *token;
     void *context, *client_frontend;
@@ -2018,9 +5446,13 @@ _server_client_subscribe(char *client_frontendpoint,
         return -1;
     }
 
+    /* journal: frontend is optional */
     if (!subscribe_frontendpoints || strlen(subscribe_frontendpoints) == 0) {
-        _CLI_SUB(ERR, "Subscribe frontendpoints.\n");
-        return -1;
+        if (!subscribe_stage || !subscribe_stage->journalendpoint) {
+            _CLI_SUB(ERR, "Subscribe frontendpoints.\n");
+            return -1;
+        }
+        subscribe_frontendpoints = "";
     }
 
     if (!subscribe_backendpoint || strlen(subscribe_backendpoint) == 0) {
@@ -2052,7 +5484,7 @@ _server_client_subscribe(char *client_frontendpoint,
              zlmb_option_dumptype2string(subscribe_dumptype));
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _CLI_SUB(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         return -1;
@@ -2061,13 +5493,13 @@ _server_client_subscribe(char *client_frontendpoint,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -2077,21 +5509,20 @@ _server_client_subscribe(char *client_frontendpoint,
     if (!client_frontend) {
         _CLI_SUB(ERR, "ZeroMQ client frontend socket: %s\n",
                  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     _PUB_SUB(VERBOSE, "ZeroMQ client frontend socket: PULL\n")
 
-    if (zmq_bind(client_frontend, client_frontendpoint) == -1) {
-        _CLI_SUB(ERR, "ZeroMQ client frontend bind: %s\n", zmq_strerror(errno));
+    if (_bind_endpoints(client_frontend, client_frontendpoint,
+                        "client frontend",
+                        ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE) == -1) {
         zmq_close(client_frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
-    _CLI_SUB(VERBOSE, "ZeroMQ client frontend bind: %s\n", client_frontendpoint);
-
     /* client:backend */
     client_backend.context = context;
 
@@ -2099,7 +5530,7 @@ _server_client_subscribe(char *client_frontendpoint,
     if (!client_backend.socket) {
         _CLI_SUB(ERR, "ZeroMQ client backend socket: %s\n", zmq_strerror(errno));
         zmq_close(client_frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2111,13 +5542,22 @@ _server_client_subscribe(char *client_frontendpoint,
         _CLI_SUB(ERR, "ZeroMQ client backend bind: %s\n", zmq_strerror(errno));
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     _CLI_SUB(VERBOSE, "ZeroMQ client backend bind: %s\n",
              ZLMB_CLIENT_BACKEND_INPROC_SOCKET);
 
+    /* client:backend: priority */
+    if (_client_priority_bind(&client_backend,
+                              ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE) == -1) {
+        zmq_close(client_frontend);
+        zmq_close(client_backend.socket);
+        _context_destroy(context);
+        return -1;
+    }
+
     /* client:backend: thread */
     pthread_mutex_lock(&_mutex);
     _CLI_SUB(INFO, "Thread start client backend.\n");
@@ -2126,7 +5566,8 @@ _server_client_subscribe(char *client_frontendpoint,
         _CLI_SUB(ERR, "Thread create client backend.\n");
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
-        zmq_ctx_destroy(context);
+        _client_priority_close(&client_backend);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2135,12 +5576,15 @@ _server_client_subscribe(char *client_frontendpoint,
 
     if (pthread_kill(client_backend.thread, 0) != 0 || _interrupted) {
         _CLI_SUB(ERR, "Thread end client backend.\n");
-        zmq_unbind(client_frontend, client_frontendpoint);
+        _unbind_endpoints(client_frontend, client_frontendpoint,
+                          "client frontend",
+                          ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
         pthread_kill(client_backend.thread, SIGINT);
         pthread_join(client_backend.thread, NULL);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
-        zmq_ctx_destroy(context);
+        _client_priority_close(&client_backend);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2154,7 +5598,8 @@ _server_client_subscribe(char *client_frontendpoint,
         pthread_join(client_backend.thread, NULL);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
-        zmq_ctx_destroy(context);
+        _client_priority_close(&client_backend);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2186,7 +5631,8 @@ _server_client_subscribe(char *client_frontendpoint,
         pthread_join(client_backend.thread, NULL);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
-        zmq_ctx_destroy(context);
+        _client_priority_close(&client_backend);
+        _context_destroy(context);
         if (compress_key) {
             free(compress_key);
         }
@@ -2222,8 +5668,9 @@ _server_client_subscribe(char *client_frontendpoint,
             pthread_join(client_backend.thread, NULL);
             zmq_close(client_frontend);
             zmq_close(client_backend.socket);
+            _client_priority_close(&client_backend);
             zmq_close(subscribe_frontend);
-            zmq_ctx_destroy(context);
+            _context_destroy(context);
             return -1;
         }
 
@@ -2244,8 +5691,9 @@ _server_client_subscribe(char *client_frontendpoint,
         pthread_join(client_backend.thread, NULL);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2260,9 +5708,10 @@ _server_client_subscribe(char *client_frontendpoint,
         pthread_join(client_backend.thread, NULL);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
         zmq_close(subscribe_backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2276,9 +5725,10 @@ _server_client_subscribe(char *client_frontendpoint,
         _socket_monitor_destroy(&subscribe_monitor);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
         zmq_close(subscribe_backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2295,9 +5745,10 @@ _server_client_subscribe(char *client_frontendpoint,
         _socket_monitor_destroy(&subscribe_monitor);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
         zmq_close(subscribe_backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2308,9 +5759,10 @@ _server_client_subscribe(char *client_frontendpoint,
         _socket_monitor_destroy(&subscribe_monitor);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
         zmq_close(subscribe_backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2327,9 +5779,10 @@ _server_client_subscribe(char *client_frontendpoint,
         _socket_monitor_destroy(&subscribe_monitor);
         zmq_close(client_frontend);
         zmq_close(client_backend.socket);
+        _client_priority_close(&client_backend);
         zmq_close(subscribe_frontend);
         zmq_close(subscribe_backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2339,6 +5792,22 @@ _server_client_subscribe(char *client_frontendpoint,
     /* dump */
     subscribe_dump = zlmb_dump_init(subscribe_dumpfile, subscribe_dumptype);
 
+    /* subscribe:replay, journal, codec, priority */
+    npollitems += _subscribe_stage_open(subscribe_stage, context,
+                                        &pollitems[2],
+                                        ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+
+    /* interrupt and subscribe:backend monitor */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+    npollitems += _socket_monitor_pollitem(subscribe_monitor,
+                                           &pollitems[npollitems]);
+
+    /* client:syslog */
+    if (_client_syslog_start(&client_syslogd, context,
+                             client_frontend) == -1) {
+        _interrupt();
+    }
+
     /* poll */
     _CLI_SUB(VERBOSE, "ZeroMQ start proxy.\n");
 
@@ -2347,69 +5816,31 @@ _server_client_subscribe(char *client_frontendpoint,
 
     _signals();
 
+    _stats_expired(&stats);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 2, ZLMB_POLL_TIMEOUT) == -1) {
+        if (zmq_poll(pollitems, npollitems,
+                     _subscribe_stage_timeout(subscribe_stage,
+                                              subscribe_connect,
+                                              _stats_timeout(stats,
+                                                             -1))) == -1) {
             break;
         }
 
         if (pollitems[0].revents & ZMQ_POLLIN) {
             /* client */
-            int more, flags;
-            size_t moresz = sizeof(more);
-
             _CLI_SUB(DEBUG, "ZeroMQ client frontend receive in poll event.\n");
 
-            while (!_interrupted) {
-                zmq_msg_t zmsg;
-
-                _CLI_SUB(DEBUG, "ZeroMQ client frontend receive message.\n");
-
-                if (zmq_msg_init(&zmsg) != 0) {
-                    break;
-                }
-
-                if (zmq_recvmsg(client_frontend, &zmsg, 0) == -1) {
-                    _CLI_SUB(ERR, "ZeroMQ client frontend receive: %s\n",
-                             zmq_strerror(errno));
-                    zmq_msg_close(&zmsg);
-                    break;
-                }
-
-                if (zmq_getsockopt(client_frontend, ZMQ_RCVMORE,
-                                   &more, &moresz) == -1) {
-                    _CLI_SUB(ERR,
-                             "ZeroMQ client frontend receive socket option:"
-                             " %s\n", zmq_strerror(errno));
-                    //zmq_msg_close(&zmsg);
-                    //break;
-                    more = 0;
-                }
-
-                if (more) {
-                    flags = ZMQ_SNDMORE;
-                } else {
-                    flags = 0;
-                }
-
-#ifndef NDEBUG
-                zlmb_dump_printmsg(stderr, &zmsg);
-#endif
-                _CLI_SUB(DEBUG, "ZeroMQ client frontend send message.\n");
-
-                if (zmq_sendmsg(client_backend.socket, &zmsg, flags) == -1) {
-                    _CLI_SUB(ERR, "ZeroMQ client backend send: %s\n",
-                             zmq_strerror(errno));
-                    //break;
-                }
-
-                zmq_msg_close(&zmsg);
-
-                if (flags == 0) {
-                    break;
-                }
-            }
+            _client_frontend_message(client_frontend, &client_backend,
+                                     ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
         }
 
+        /* subscribe:priority before the next frontend message */
+        _subscribe_stage_priority(subscribe_stage, subscribe_connect,
+                                  subscribe_backend, subscribe_dropkey,
+                                  subscribe_dump,
+                                  ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+
         if (pollitems[1].revents & ZMQ_POLLIN) {
             /* subscribe */
             int more, send, flags, frames = 0;
@@ -2418,7 +5849,7 @@ _server_client_subscribe(char *client_frontendpoint,
             _CLI_SUB(DEBUG,
                      "ZeroMQ subscribe frontend receive in poll event.\n");
 
-            if (subscribe_connect > 0) {
+            if (subscribe_connect > 0 && !zlmb_memory_divert(_memory)) {
 #ifdef USE_SNAPPY
                 send = ZLMB_SENDMSG_UNCOMPRESS;
 #else
@@ -2428,7 +5859,14 @@ _server_client_subscribe(char *client_frontendpoint,
                 send = ZLMB_SENDMSG_DUMP;
             }
 
-            while (!_interrupted) {
+            if (subscribe_stage) {
+                _subscribe_stage_message(subscribe_stage, subscribe_frontend,
+                                         subscribe_backend, send,
+                                         subscribe_dropkey, subscribe_dump,
+                                         ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+            }
+
+            while (!subscribe_stage && !_interrupted) {
                 zmq_msg_t zmsg;
 
                 _CLI_SUB(DEBUG, "ZeroMQ subscribe frontend receive message.\n");
@@ -2481,15 +5919,33 @@ _server_client_subscribe(char *client_frontendpoint,
             }
         }
 
+        _subscribe_stage_poll(subscribe_stage, &pollitems[2],
+                              subscribe_connect, subscribe_backend,
+                              subscribe_dropkey, subscribe_dump,
+                              ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+
         _subscribe_monitor_connect(subscribe_monitor, &subscribe_connect);
+
+        if (_stats_expired(&stats)) {
+            _subscribe_stage_report(subscribe_stage,
+                                    ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+        }
     }
 
     _CLI_SUB(VERBOSE, "ZeroMQ end proxy.\n");
 
+    /* client:syslog: cleanup */
+    _client_syslog_stop(&client_syslogd, client_frontend);
+
+    _subscribe_stage_flush(subscribe_stage, subscribe_connect,
+                           subscribe_backend, subscribe_dropkey,
+                           subscribe_dump, ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+
+    _subscribe_stage_report(subscribe_stage, ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
+
     /* client:frontend: unbind */
-    _CLI_SUB(VERBOSE, "ZeroMQ client frontend unbind.\n: %s",
-             client_frontendpoint);
-    zmq_unbind(client_frontend, client_frontendpoint);
+    _unbind_endpoints(client_frontend, client_frontendpoint,
+                      "client frontend", ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
 
     /* client:backend: cleanup */
     _CLI_SUB(VERBOSE, "Thread end client backend.\n");
@@ -2504,14 +5960,16 @@ _server_client_subscribe(char *client_frontendpoint,
 
     /* sockets: cleanup */
     _CLI_SUB(INFO, "ZeroMQ close sockets.\n");
+    _subscribe_stage_close(subscribe_stage, ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
     zmq_close(client_frontend);
     zmq_close(client_backend.socket);
+    _client_priority_close(&client_backend);
     zmq_close(subscribe_frontend);
     zmq_close(subscribe_backend);
 
     /* context: cleanup */
     _CLI_SUB(INFO, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _context_destroy(context);
 
     /* dump: cleanup */
     if (subscribe_dump) {
@@ -2522,11 +5980,15 @@ _server_client_subscribe(char *client_frontendpoint,
 }
 
 int
-_server_stand_alone(char *frontendpoint, char *backendpoint,
-                    char *dumpfile, int dumptype)
+_server_stand_alone(char *frontendpoint, char *syslogendpoints, int syslogkey,
+                    char *backendpoint, char *dumpfile, int dumptype)
 {
-    int connect = 0;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_client_syslog_t syslogd = { 0, NULL, NULL, syslogendpoints,
+                                     syslogkey, ZLMB_OPTION_MODE_STAND_ALONE };
+    int connect = 0, npollitems = 1;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 },
+                                   { NULL, 0, ZMQ_POLLIN, 0 } };
     zlmb_dump_t *dump = NULL;
     char *endpoint;
     void *context, *frontend, *backend;
@@ -2548,7 +6010,7 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
            dumpfile, zlmb_option_dumptype2string(dumptype));
 
     /* context */
-    context = zmq_ctx_new();
+    context = _context_new();
     if (!context) {
         _ALONE(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
         return -1;
@@ -2557,13 +6019,13 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
     /*
     if (zmq_ctx_set(context, ZMQ_IO_THREADS, 1) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     if (zmq_ctx_set(context, ZMQ_MAX_SOCKETS, 1024) == -1) {
         _ERR("%s",  zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
     */
@@ -2572,27 +6034,25 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _ALONE(ERR, "ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     _ALONE(VERBOSE, "ZeroMQ frontend socket: PULL\n")
 
-    if (zmq_bind(frontend, frontendpoint) == -1) {
-        _ALONE(ERR, "ZeroMQ frontend bind: %s\n", zmq_strerror(errno));
+    if (_bind_endpoints(frontend, frontendpoint, "frontend",
+                        ZLMB_OPTION_MODE_STAND_ALONE) == -1) {
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
-    _ALONE(VERBOSE, "ZeroMQ frontend bind: %s\n", frontendpoint);
-
     /* backend */
     backend = zmq_socket(context, ZMQ_PUSH);
     if (!backend) {
         _ALONE(ERR, "ZeroMQ backend socket: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2603,7 +6063,7 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
         _ALONE(ERR, "ZeroMQ backend bind: %s\n", zmq_strerror(errno));
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2615,7 +6075,7 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
         _ALONE(ERR, "Allocate monitor string backend point.\n");
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2625,7 +6085,7 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
@@ -2638,108 +6098,340 @@ _server_stand_alone(char *frontendpoint, char *backendpoint,
         _socket_monitor_destroy(&monitor);
         zmq_close(frontend);
         zmq_close(backend);
-        zmq_ctx_destroy(context);
+        _context_destroy(context);
         return -1;
     }
 
     /* dump */
     dump = zlmb_dump_init(dumpfile, dumptype);
 
+    /* syslog */
+    if (_client_syslog_start(&syslogd, context, frontend) == -1) {
+        _interrupt();
+    }
+
     /* poll */
     _ALONE(VERBOSE, "ZeroMQ start proxy.\n");
 
     pollitems[0].socket = frontend;
 
+    /* interrupt and backend monitor */
+    npollitems += _wakeup_pollitem(_wakeup, &pollitems[npollitems]);
+    npollitems += _socket_monitor_pollitem(monitor, &pollitems[npollitems]);
+
     _signals();
 
+    _subscribe_monitor_connect(monitor, &connect);
+
     while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, ZLMB_POLL_TIMEOUT) == -1) {
+        if (zmq_poll(pollitems, npollitems, -1) == -1) {
+            break;
+        }
+
+        if (pollitems[0].revents & ZMQ_POLLIN) {
+            int more, send, flags;
+            size_t moresz = sizeof(more);
+
+            _ALONE(DEBUG, "ZeroMQ  frontend receive in poll event.\n");
+
+            if (connect > 0 && !zlmb_memory_divert(_memory)) {
+                send = ZLMB_SENDMSG;
+            } else {
+                send = ZLMB_SENDMSG_DUMP;
+            }
+
+            while (!_interrupted) {
+                zmq_msg_t zmsg;
+
+                _ALONE(DEBUG, "ZeroMQ  frontend receive message.\n");
+
+                if (zmq_msg_init(&zmsg) != 0) {
+                    break;
+                }
+
+                if (zmq_recvmsg(frontend, &zmsg, 0) == -1) {
+                    _ALONE(ERR, "ZeroMQ frontend receive: %s\n",
+                           zmq_strerror(errno));
+                    zmq_msg_close(&zmsg);
+                    break;
+                }
+
+                if (zmq_getsockopt(frontend, ZMQ_RCVMORE,
+                                   &more, &moresz) == -1) {
+                    _ALONE(ERR, "ZeroMQ frontend receive socket option: %s\n",
+                           zmq_strerror(errno));
+                    //zmq_msg_close(&zmsg);
+                    //break;
+                    more = 0;
+                }
+
+                if (more) {
+                    flags = ZMQ_SNDMORE;
+                } else {
+                    flags = 0;
+                }
+#ifndef NDEBUG
+                zlmb_dump_printmsg(stderr, &zmsg);
+#endif
+                _ALONE(DEBUG, "ZeroMQ  backend send message.\n");
+
+                _sendmsg(send, backend, &zmsg, flags, dump,
+                         ZLMB_OPTION_MODE_STAND_ALONE);
+
+                zmq_msg_close(&zmsg);
+
+                if (flags == 0) {
+                    break;
+                }
+            }
+        }
+
+        _subscribe_monitor_connect(monitor, &connect);
+    }
+
+    _ALONE(VERBOSE, "ZeroMQ end proxy.\n");
+
+    _memory_report(ZLMB_OPTION_MODE_STAND_ALONE);
+    _ttl_report(ZLMB_OPTION_MODE_STAND_ALONE);
+
+    /* syslog: cleanup */
+    _client_syslog_stop(&syslogd, frontend);
+
+    /* backend monitoring: cleanup */
+    _ALONE(VERBOSE, "Thread end backend monitor.\n");
+    pthread_kill(monitor->thread, SIGINT);
+    pthread_join(monitor->thread, NULL);
+    _socket_monitor_destroy(&monitor);
+
+    /* sockets: cleanup */
+    _ALONE(VERBOSE, "ZeroMQ close sockets.\n");
+    zmq_close(frontend);
+    zmq_close(backend);
+
+    /* context: cleanup */
+    _ALONE(VERBOSE, "ZeroMQ destroy context.\n");
+    _context_destroy(context);
+
+    /* dump: cleanup */
+    if (dump) {
+        zlmb_dump_destroy(&dump);
+    }
+
+    return 0;
+}
+
+#define ZLMB_PIPELINE_STAGE_MAX 3
+
+typedef struct {
+    pthread_t thread;
+    int mode;
+    int done;
+    zlmb_option_t *option;
+    zlmb_publish_stage_t *publish;
+    zlmb_subscribe_stage_t *subscribe;
+} zlmb_pipeline_stage_t;
+
+static int
+_pipeline_parse(char *pipeline)
+{
+    int stages = 0;
+    char *str, *token;
+
+    if (!pipeline) {
+        return -1;
+    }
+
+    str = strdup(pipeline);
+    if (!str) {
+        return -1;
+    }
+
+    token = str;
+
+    while (1) {
+        char *end;
+        int mode;
+
+        end = strtok(token, ",");
+        if (end == NULL) {
+            break;
+        }
+
+        while (*end == ' ') {
+            end++;
+        }
+
+        if (strcmp(end, ZLMB_OPTION_MODE_CLIENT) == 0) {
+            mode = ZLMB_MODE_CLIENT;
+        } else if (strcmp(end, ZLMB_OPTION_MODE_PUBLISH) == 0) {
+            mode = ZLMB_MODE_PUBLISH;
+        } else if (strcmp(end, ZLMB_OPTION_MODE_SUBSCRIBE) == 0) {
+            mode = ZLMB_MODE_SUBSCRIBE;
+        } else {
+            _PIPELINE(ERR, "Invalid stage: %s\n", end);
+            free(str);
+            return -1;
+        }
+
+        /* one stage per tier (stage options are shared) */
+        if (stages & mode) {
+            _PIPELINE(ERR, "Duplicate stage: %s\n", end);
+            free(str);
+            return -1;
+        }
+
+        stages |= mode;
+        token = NULL;
+    }
+
+    free(str);
+
+    if (stages == 0) {
+        return -1;
+    }
+
+    return stages;
+}
+
+static void *
+_pipeline_stage(void *arg)
+{
+    zlmb_pipeline_stage_t *self = (zlmb_pipeline_stage_t *)arg;
+    zlmb_option_t *option = self->option;
+
+    switch (self->mode) {
+        case ZLMB_MODE_CLIENT:
+            _server_client(option->client_frontendpoint,
+                           option->client_syslogendpoints,
+                           option->client_syslog_key,
+                           option->client_backendpoints,
+                           option->client_dumpfile,
+                           option->client_dumptype,
+                           option->client_codec_threads,
+                           option->client_priority_keys,
+                           option->client_priority_weight,
+                           option->client_priority_backendpoints);
+            break;
+        case ZLMB_MODE_PUBLISH:
+            _server_publish(option->publish_frontendpoint,
+                            option->publish_backendpoint,
+                            option->publish_key,
+                            option->publish_sendkey,
+                            self->publish);
+            break;
+        case ZLMB_MODE_SUBSCRIBE:
+            _server_subscribe(option->subscribe_frontendpoints,
+                              option->subscribe_backendpoint,
+                              option->subscribe_key,
+                              option->subscribe_dropkey,
+                              option->subscribe_dumpfile,
+                              option->subscribe_dumptype,
+                              self->subscribe);
             break;
-        }
+        default:
+            break;
+    }
 
-        if (pollitems[0].revents & ZMQ_POLLIN) {
-            int more, send, flags;
-            size_t moresz = sizeof(more);
+    /* stage stopped: stop the pipeline */
+    pthread_mutex_lock(&_pipeline_mutex);
+    self->done = 1;
+    _interrupt();
+    pthread_cond_signal(&_pipeline_cond);
+    pthread_mutex_unlock(&_pipeline_mutex);
 
-            _ALONE(DEBUG, "ZeroMQ  frontend receive in poll event.\n");
+    return NULL;
+}
 
-            if (connect > 0) {
-                send = ZLMB_SENDMSG;
-            } else {
-                send = ZLMB_SENDMSG_DUMP;
-            }
+static int
+_server_pipeline(zlmb_option_t *option, int stages,
+                 zlmb_publish_stage_t *publish_stage,
+                 zlmb_subscribe_stage_t *subscribe_stage)
+{
+    /* bind before connect: publish -> subscribe -> client */
+    int order[ZLMB_PIPELINE_STAGE_MAX] = { ZLMB_MODE_PUBLISH,
+                                           ZLMB_MODE_SUBSCRIBE,
+                                           ZLMB_MODE_CLIENT };
+    zlmb_pipeline_stage_t stage[ZLMB_PIPELINE_STAGE_MAX];
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    int i, count = 0;
 
-            while (!_interrupted) {
-                zmq_msg_t zmsg;
+    _PIPELINE(INFO, "Stages: %s\n", option->pipeline);
 
-                _ALONE(DEBUG, "ZeroMQ  frontend receive message.\n");
+    /* wakeup: stops the stages and this thread (no polling timeout) */
+    if (_wakeup_pollitem(_wakeup, pollitems) == 0) {
+        _PIPELINE(ERR, "Wakeup pipe unavailable.\n");
+        return -1;
+    }
 
-                if (zmq_msg_init(&zmsg) != 0) {
-                    break;
-                }
+    /* context: shared by stages */
+    _pipeline_context = zmq_ctx_new();
+    if (!_pipeline_context) {
+        _PIPELINE(ERR, "ZeroMQ context: %s\n", zmq_strerror(errno));
+        return -1;
+    }
 
-                if (zmq_recvmsg(frontend, &zmsg, 0) == -1) {
-                    _ALONE(ERR, "ZeroMQ frontend receive: %s\n",
-                           zmq_strerror(errno));
-                    zmq_msg_close(&zmsg);
-                    break;
-                }
+    _pipeline_ready = 0;
 
-                if (zmq_getsockopt(frontend, ZMQ_RCVMORE,
-                                   &more, &moresz) == -1) {
-                    _ALONE(ERR, "ZeroMQ frontend receive socket option: %s\n",
-                           zmq_strerror(errno));
-                    //zmq_msg_close(&zmsg);
-                    //break;
-                    more = 0;
-                }
+    /* stages: start one by one */
+    for (i = 0; i < ZLMB_PIPELINE_STAGE_MAX && !_interrupted; i++) {
+        zlmb_pipeline_stage_t *current = &stage[count];
 
-                if (more) {
-                    flags = ZMQ_SNDMORE;
-                } else {
-                    flags = 0;
-                }
-#ifndef NDEBUG
-                zlmb_dump_printmsg(stderr, &zmsg);
-#endif
-                _ALONE(DEBUG, "ZeroMQ  backend send message.\n");
+        if (!(stages & order[i])) {
+            continue;
+        }
 
-                _sendmsg(send, backend, &zmsg, flags, dump,
-                         ZLMB_OPTION_MODE_STAND_ALONE);
+        memset(current, 0, sizeof(zlmb_pipeline_stage_t));
+        current->mode = order[i];
+        current->option = option;
+        current->publish = publish_stage;
+        current->subscribe = subscribe_stage;
+
+        _PIPELINE(VERBOSE, "Thread start stage: %s\n",
+                  order[i] == ZLMB_MODE_CLIENT ? ZLMB_OPTION_MODE_CLIENT :
+                  order[i] == ZLMB_MODE_PUBLISH ? ZLMB_OPTION_MODE_PUBLISH :
+                  ZLMB_OPTION_MODE_SUBSCRIBE);
+
+        if (pthread_create(&current->thread, NULL,
+                           _pipeline_stage, (void *)current) != 0) {
+            _PIPELINE(ERR, "Thread create stage.\n");
+            _interrupt();
+            break;
+        }
 
-                zmq_msg_close(&zmsg);
+        count++;
 
-                if (flags == 0) {
-                    break;
-                }
-            }
+        /* wait: stage sockets are bound */
+        pthread_mutex_lock(&_pipeline_mutex);
+        while (_pipeline_ready < count && !current->done) {
+            pthread_cond_wait(&_pipeline_cond, &_pipeline_mutex);
         }
-
-        _subscribe_monitor_connect(monitor, &connect);
+        pthread_mutex_unlock(&_pipeline_mutex);
     }
 
-    _ALONE(VERBOSE, "ZeroMQ end proxy.\n");
+    _signals();
 
-    /* backend monitoring: cleanup */
-    _ALONE(VERBOSE, "Thread end backend monitor.\n");
-    pthread_kill(monitor->thread, SIGINT);
-    pthread_join(monitor->thread, NULL);
-    _socket_monitor_destroy(&monitor);
+    _PIPELINE(VERBOSE, "Pipeline running.\n");
 
-    /* sockets: cleanup */
-    _ALONE(VERBOSE, "ZeroMQ close sockets.\n");
-    zmq_close(frontend);
-    zmq_close(backend);
+    while (!_interrupted) {
+        if (zmq_poll(pollitems, 1, -1) == -1 && errno != EINTR) {
+            _PIPELINE(ERR, "ZeroMQ poll: %s\n", zmq_strerror(errno));
+            break;
+        }
+    }
 
-    /* context: cleanup */
-    _ALONE(VERBOSE, "ZeroMQ destroy context.\n");
-    zmq_ctx_destroy(context);
+    _PIPELINE(VERBOSE, "Pipeline stop.\n");
 
-    /* dump: cleanup */
-    if (dump) {
-        zlmb_dump_destroy(&dump);
+    /* stages: upstream first */
+    for (i = count - 1; i >= 0; i--) {
+        pthread_kill(stage[i].thread, SIGINT);
+        pthread_join(stage[i].thread, NULL);
     }
 
+    /* context: cleanup */
+    _PIPELINE(VERBOSE, "ZeroMQ destroy context.\n");
+    zmq_ctx_destroy(_pipeline_context);
+    _pipeline_context = NULL;
+
     return 0;
 }
 
@@ -2778,14 +6470,27 @@ _usage(char *arg, char *message, int mode)
     len = (int)strlen(command);
     printf("Usage: %s --mode=MODE\n", command);
 
+    /* pipeline options */
+    if (!mode || mode & ZLMB_PIPELINE) {
+        printf("%*s      [ --pipeline=STAGES ]\n", len, "");
+    }
+
     /* client options */
     if (!mode || mode & ZLMB_CLI_FRONT || mode & ZLMB_CLI_BACK) {
         printf("%*s      [ ", len, "");
-        printf("--client_frontendpoint=ENDPOINT");
+        printf("--client_frontendpoint=ENDPOINTS");
+        printf("\n%*s        --client_syslogendpoints=ENDPOINTS", len, "");
+        printf("\n%*s        --client_syslog_key", len, "");
         if (!mode || mode & ZLMB_CLI_BACK) {
             printf("\n%*s        --client_backendpoints=ENDPOINTS", len, "");
             printf("\n%*s        --client_dumpfile=FILE", len, "");
             printf("\n%*s        --client_dumptype=TYPE", len, "");
+            printf("\n%*s        --client_codec_threads=NUM", len, "");
+            printf("\n%*s        --client_priority_keys=KEYS", len, "");
+            printf("\n%*s        --client_priority_weight=NUM", len, "");
+            printf("\n%*s        --client_priority_backendpoints=ENDPOINTS",
+                   len, "");
+            printf("\n%*s        --client_ttl=RULES", len, "");
         }
         printf(" ]\n");
     }
@@ -2803,6 +6508,28 @@ _usage(char *arg, char *message, int mode)
             printf("--publish_backendpoint=ENDPOINT");
             printf("\n%*s        --publish_key=KEY", len, "");
             printf("\n%*s        --publish_sendkey", len, "");
+            printf("\n%*s        --publish_ratelimit=NUM", len, "");
+            printf("\n%*s        --publish_ratelimit_burst=NUM", len, "");
+            printf("\n%*s        --publish_ratelimit_buckets=NUM", len, "");
+            printf("\n%*s        --publish_sampling=NUM", len, "");
+            printf("\n%*s        --publish_sampling_random", len, "");
+            printf("\n%*s        --publish_sequence", len, "");
+            printf("\n%*s        --publish_replayendpoint=ENDPOINT", len, "");
+            printf("\n%*s        --publish_replay_size=NUM", len, "");
+            printf("\n%*s        --publish_replay_budget=NUM", len, "");
+            printf("\n%*s        --publish_journal=DIR", len, "");
+            printf("\n%*s        --publish_journal_partitions=NUM", len, "");
+            printf("\n%*s        --publish_journal_segment_size=MB", len, "");
+            printf("\n%*s        --publish_journal_retention_size=MB",
+                   len, "");
+            printf("\n%*s        --publish_journal_retention_time=SEC",
+                   len, "");
+            printf("\n%*s        --publish_journal_sync=MSEC", len, "");
+            printf("\n%*s        --publish_journalendpoint=ENDPOINT", len, "");
+            printf("\n%*s        --publish_priority_frontendpoint=ENDPOINT",
+                   len, "");
+            printf("\n%*s        --publish_priority_backendpoint=ENDPOINT",
+                   len, "");
         }
         printf(" ]\n");
     }
@@ -2818,6 +6545,27 @@ _usage(char *arg, char *message, int mode)
         if (!mode || mode & ZLMB_SUB_FRONT) {
             printf("\n%*s        --subscribe_key=KEY", len, "");
             printf("\n%*s        --subscribe_dropkey", len, "");
+            printf("\n%*s        --subscribe_dedup", len, "");
+            printf("\n%*s        --subscribe_dedup_memory=BYTES", len, "");
+            printf("\n%*s        --subscribe_dedup_window=SEC", len, "");
+            printf("\n%*s        --subscribe_sequence", len, "");
+            printf("\n%*s        --subscribe_ttl", len, "");
+            printf("\n%*s        --subscribe_replayendpoints=ENDPOINTS",
+                   len, "");
+            printf("\n%*s        --subscribe_replay_catchup", len, "");
+            printf("\n%*s        --subscribe_priority_frontendpoints=ENDPOINTS",
+                   len, "");
+            printf("\n%*s        --subscribe_journalendpoint=ENDPOINT",
+                   len, "");
+            printf("\n%*s        --subscribe_journal_offsetfile=FILE",
+                   len, "");
+            printf("\n%*s        --subscribe_codec_threads=NUM", len, "");
+            printf("\n%*s        --subscribe_sink=DIR", len, "");
+            printf("\n%*s        --subscribe_sink_rotate_size=MB", len, "");
+            printf("\n%*s        --subscribe_sink_rotate_time=SEC", len, "");
+            printf("\n%*s        --subscribe_sink_compress=COMMAND", len, "");
+            printf("\n%*s        --subscribe_sink_sync=MSEC", len, "");
+            printf("\n%*s        --subscribe_sink_uncompress", len, "");
         }
         printf("\n%*s        --subscribe_dumpfile=FILE", len, "");
         printf("\n%*s        --subscribe_dumptype=TYPE", len, "");
@@ -2825,6 +6573,8 @@ _usage(char *arg, char *message, int mode)
     }
 
     /* other options */
+    printf("%*s      [ --stats_interval=SEC ]\n", len, "");
+    printf("%*s      [ --memory_limit=MB --memory_high=PERCENT ]\n", len, "");
     printf("%*s      [ --config=FILE ]\n", len, "");
     printf("%*s      [ --info ]\n", len, "");
     printf("%*s      [ --syslog ]\n", len, "");
@@ -2835,15 +6585,29 @@ _usage(char *arg, char *message, int mode)
     printf("  --mode                      execute mode\n");
     printf("                               [ %s | %s | %s |\n"
            "                                 %s | %s |\n"
-           "                                 %s | %s ]\n",
+           "                                 %s | %s |\n"
+           "                                 %s ]\n",
            ZLMB_OPTION_MODE_CLIENT, ZLMB_OPTION_MODE_PUBLISH,
            ZLMB_OPTION_MODE_SUBSCRIBE, ZLMB_OPTION_MODE_CLIENT_PUBLISH,
            ZLMB_OPTION_MODE_PUBLISH_SUBSCRIBE,
            ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE,
-           ZLMB_OPTION_MODE_STAND_ALONE);
+           ZLMB_OPTION_MODE_STAND_ALONE,
+           ZLMB_OPTION_MODE_PIPELINE);
+    if (!mode || mode & ZLMB_PIPELINE) {
+        printf("  --pipeline                  pipeline stages in one process\n"
+               "                               (ex: %s,%s,%s)\n",
+               ZLMB_OPTION_MODE_CLIENT, ZLMB_OPTION_MODE_PUBLISH,
+               ZLMB_OPTION_MODE_SUBSCRIBE);
+    }
     if (!mode || mode & ZLMB_CLI_FRONT) {
-        printf("  --client_frontendpoint      client fronend endpoint\n"
-               "                               (ex: tcp://127.0.0.1:5557)\n");
+        printf("  --client_frontendpoint      client fronend endpoints\n"
+               "                              "
+               " (ex: tcp://127.0.0.1:5557,ipc:///tmp/zlmb.ipc,...)\n");
+        printf("  --client_syslogendpoints    client syslog endpoints\n"
+               "                              "
+               " (ex: udp://0.0.0.0:514,unix:///dev/log,...)\n");
+        printf("  --client_syslog_key         enable syslog key frame\n"
+               "                               (facility.severity.app)\n");
     }
     if (!mode || mode & ZLMB_CLI_BACK) {
         printf("  --client_backendpoints      client backend endpoints\n"
@@ -2861,6 +6625,18 @@ _usage(char *arg, char *message, int mode)
                ZLMB_OPTION_DUMPTYPE_PLAIN_TIME,
                ZLMB_OPTION_DUMPTYPE_PLAIN_FLAGS,
                ZLMB_OPTION_DUMPTYPE_PLAIN_TIME_FLAGS);
+        printf("  --client_codec_threads      client compress threads\n"
+               "                               [ 0 (DEFAULT:disable) ]\n");
+        printf("  --client_priority_keys      client priority key patterns\n"
+               "                               (ex: *.err.*,*.crit.*,...)\n");
+        printf("  --client_priority_weight    client priority messages"
+               " per message\n"
+               "                               [ 0 (DEFAULT:strict) ]\n");
+        printf("  --client_priority_backendpoints\n"
+               "                              client priority backend endpoints\n"
+               "                               [ client_backendpoints (DEFAULT) ]\n");
+        printf("  --client_ttl                client message ttl (seconds)\n"
+               "                               (ex: metrics.*=60,*=86400)\n");
     }
     if (!mode || mode & ZLMB_PUB_FRONT) {
         printf("  --publish_frontendpoint     publish frontend point\n"
@@ -2873,6 +6649,53 @@ _usage(char *arg, char *message, int mode)
                "                               [ \"\" (DEFAULT:empty) ]\n");
         printf("  --publish_sendkey           enable sending publish key\n"
                "                               [ disable (DEFAULT) ]\n");
+        printf("  --publish_ratelimit         messages per second per key\n"
+               "                               [ 0 (DEFAULT:unlimited) ]\n");
+        printf("  --publish_ratelimit_burst   token bucket size per key\n"
+               "                               [ 0 (DEFAULT:ratelimit) ]\n");
+        printf("  --publish_ratelimit_buckets rate limit hash table size\n"
+               "                               [ %d (DEFAULT) ]\n",
+               ZLMB_RATELIMIT_DEFAULT_BUCKETS);
+        printf("  --publish_sampling          publish 1 of NUM messages per key\n"
+               "                               [ 0 (DEFAULT:disable) ]\n");
+        printf("  --publish_sampling_random   enable random sampling (1/NUM)\n"
+               "                               [ disable (DEFAULT) ]\n");
+        printf("  --publish_sequence          enable sending sequence number\n"
+               "                               [ disable (DEFAULT) ]\n");
+        printf("  --publish_replayendpoint    publish replay request point\n"
+               "                               (ex: tcp://127.0.0.1:5561)\n");
+        printf("  --publish_replay_size       replay messages in memory\n"
+               "                               [ %d (DEFAULT) ]\n",
+               ZLMB_REPLAY_DEFAULT_SIZE);
+        printf("  --publish_replay_budget     retransmit messages per second\n"
+               "                               [ 0 (DEFAULT:unlimited) ]\n");
+        printf("  --publish_journal           publish journal directory\n"
+               "                               (ex: /var/lib/zlmb/journal)\n");
+        printf("  --publish_journal_partitions\n"
+               "                              journal partitions (key hash)\n"
+               "                               [ %d (DEFAULT) ]\n",
+               ZLMB_JOURNAL_DEFAULT_PARTITIONS);
+        printf("  --publish_journal_segment_size\n"
+               "                              journal segment file size (MB)\n"
+               "                               [ %d (DEFAULT) ]\n",
+               ZLMB_JOURNAL_DEFAULT_SEGMENT >> 20);
+        printf("  --publish_journal_retention_size\n"
+               "                              journal size per partition (MB)\n"
+               "                               [ 0 (DEFAULT:unlimited) ]\n");
+        printf("  --publish_journal_retention_time\n"
+               "                              journal retention seconds\n"
+               "                               [ 0 (DEFAULT:unlimited) ]\n");
+        printf("  --publish_journal_sync      journal sync interval (msec)\n"
+               "                               [ %d (DEFAULT) ]\n",
+               ZLMB_JOURNAL_DEFAULT_SYNC);
+        printf("  --publish_journalendpoint   publish journal fetch point\n"
+               "                               (ex: tcp://127.0.0.1:5562)\n");
+        printf("  --publish_priority_frontendpoint\n"
+               "                              publish priority frontend point\n"
+               "                               (ex: tcp://127.0.0.1:5563)\n");
+        printf("  --publish_priority_backendpoint\n"
+               "                              publish priority backend point\n"
+               "                               [ publish_backendpoint (DEFAULT) ]\n");
     }
     if (!mode || mode & ZLMB_SUB_FRONT) {
         printf("  --subscribe_frontendpoints  subscribe frontend points\n"
@@ -2887,6 +6710,48 @@ _usage(char *arg, char *message, int mode)
                    "                               [ \"\" (DEFAULT:empty)]\n");
             printf("  --subscribe_dropkey         enable dropped subscribe key\n"
                    "                               [ disable (DEFAULT) ]\n");
+            printf("  --subscribe_dedup           enable duplicate suppression\n"
+                   "                               [ disable (DEFAULT) ]\n");
+            printf("  --subscribe_dedup_memory    duplicate filter memory bytes\n"
+                   "                               [ %d (DEFAULT) ]\n",
+                   ZLMB_DEDUP_DEFAULT_MEMORY);
+            printf("  --subscribe_dedup_window    duplicate filter window\n"
+                   "                               [ %d (DEFAULT) ]\n",
+                   ZLMB_DEDUP_DEFAULT_WINDOW);
+            printf("  --subscribe_sequence        enable sequence loss accounting\n"
+                   "                               [ disable (DEFAULT) ]\n");
+            printf("  --subscribe_ttl             enable expired message drop\n"
+                   "                               [ disable (DEFAULT) ]\n");
+            printf("  --subscribe_replayendpoints publish replay request points\n"
+                   "                               (ex: tcp://127.0.0.1:5561,...)\n");
+            printf("  --subscribe_replay_catchup  enable replay request at start\n"
+                   "                               [ disable (DEFAULT) ]\n");
+            printf("  --subscribe_priority_frontendpoints\n"
+                   "                              subscribe priority points\n"
+                   "                               (ex: tcp://127.0.0.1:5564,...)\n");
+            printf("  --subscribe_journalendpoint publish journal fetch point\n"
+                   "                               (ex: tcp://127.0.0.1:5562)\n");
+            printf("  --subscribe_journal_offsetfile\n"
+                   "                              journal offset file\n"
+                   "                               [ %s (DEFAULT) ]\n",
+                   ZLMB_DEFAULT_SUBSCRIBE_OFFSET_FILE);
+            printf("  --subscribe_codec_threads   subscribe uncompress threads\n"
+                   "                               [ 0 (DEFAULT:disable) ]\n");
+            printf("  --subscribe_sink            subscribe sink directory\n"
+                   "                               (ex: /var/log/zlmb)\n");
+            printf("  --subscribe_sink_rotate_size\n"
+                   "                              sink rotate size (MB)\n"
+                   "                               [ 0 (DEFAULT:disable) ]\n");
+            printf("  --subscribe_sink_rotate_time\n"
+                   "                              sink rotate time (sec)\n"
+                   "                               [ 0 (DEFAULT:disable) ]\n");
+            printf("  --subscribe_sink_compress   sink rotated file command\n"
+                   "                               (ex: gzip -f)\n");
+            printf("  --subscribe_sink_sync       sink sync interval (msec)\n"
+                   "                               [ %d (DEFAULT) ]\n",
+                   ZLMB_SINK_DEFAULT_SYNC);
+            printf("  --subscribe_sink_uncompress enable sink uncompressed frames\n"
+                   "                               [ disable (DEFAULT) ]\n");
         }
         printf("  --subscribe_dumpfile        subscribe error file\n"
                "                               [ %s (DEFAULT) ]\n",
@@ -2901,6 +6766,13 @@ _usage(char *arg, char *message, int mode)
                ZLMB_OPTION_DUMPTYPE_PLAIN_FLAGS,
                ZLMB_OPTION_DUMPTYPE_PLAIN_TIME_FLAGS);
     }
+    printf("  --stats_interval            statistics report interval\n"
+           "                               [ 0 (DEFAULT:at exit) ]\n");
+    printf("  --memory_limit              memory budget of messages (MB)\n"
+           "                               [ 0 (DEFAULT:disable) ]\n");
+    printf("  --memory_high               memory high-water mark (%%)\n"
+           "                               [ %d (DEFAULT) ]\n",
+           ZLMB_MEMORY_DEFAULT_HIGH);
     printf("  --config                    config file path\n");
     printf("  --info                      application information\n");
     printf("  --syslog                    log to syslog\n");
@@ -2910,21 +6782,102 @@ _usage(char *arg, char *message, int mode)
         printf("\nEnable mode options:\n");
         printf("  %s: client_frontendpoint,client_backendpoints,\n",
                ZLMB_OPTION_MODE_CLIENT);
-        printf("  %*s: client_dumpfile,client_dumptype\n",
+        printf("  %*s: client_dumpfile,client_dumptype,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT), "");
+        printf("  %*s: client_codec_threads,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT), "");
+        printf("  %*s: client_priority_keys,client_priority_weight,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT), "");
+        printf("  %*s: client_priority_backendpoints,client_ttl,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT), "");
+        printf("  %*s: client_syslogendpoints,client_syslog_key\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT), "");
         printf("  %s: publish_frontendpoint,publish_backendpoint,\n",
                ZLMB_OPTION_MODE_PUBLISH);
-        printf("  %*s: publish_key,publish_sendkey\n",
+        printf("  %*s: publish_key,publish_sendkey,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_ratelimit,publish_ratelimit_burst,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_ratelimit_buckets,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_sampling,publish_sampling_random,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_sequence,publish_replayendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_replay_size,publish_replay_budget,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_journal,publish_journal_partitions,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_journal_segment_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_journal_retention_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_journal_retention_time,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_journal_sync,publish_journalendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_priority_frontendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
+        printf("  %*s: publish_priority_backendpoint\n",
                (int)strlen(ZLMB_OPTION_MODE_PUBLISH), "");
         printf("  %s: subscribe_frontendpoint,subscribe_backendpoint,\n",
                ZLMB_OPTION_MODE_SUBSCRIBE);
         printf("  %*s: subscribe_key,subscribe_dropkey,\n",
                (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_dedup,subscribe_dedup_memory,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_dedup_window,subscribe_sequence,"
+               "subscribe_ttl,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_replayendpoints,subscribe_replay_catchup,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_priority_frontendpoints,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_journalendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_journal_offsetfile,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_codec_threads,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink,subscribe_sink_rotate_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_rotate_time,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_compress,subscribe_sink_sync,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_uncompress,\n",
+               (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
         printf("  %*s: subscribe_dumpfile,subscribe_dumptype\n",
                (int)strlen(ZLMB_OPTION_MODE_SUBSCRIBE), "");
         printf("  %s: client_frontendpoint,publish_backendpoint,\n",
                ZLMB_OPTION_MODE_CLIENT_PUBLISH);
-        printf("  %*s: publish_key,publish_sendkey\n",
+        printf("  %*s: client_syslogendpoints,client_syslog_key,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_key,publish_sendkey,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_ratelimit,publish_ratelimit_burst,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_ratelimit_buckets,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_sampling,publish_sampling_random,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_sequence,publish_replayendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_replay_size,publish_replay_budget,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_journal,publish_journal_partitions,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_journal_segment_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_journal_retention_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_journal_retention_time,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_journal_sync,publish_journalendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_priority_frontendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
+        printf("  %*s: publish_priority_backendpoint\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT_PUBLISH), "");
         printf("  %s: publish_frontendpoint,subscribe_backendpoint,\n",
                ZLMB_OPTION_MODE_PUBLISH_SUBSCRIBE);
@@ -2932,18 +6885,56 @@ _usage(char *arg, char *message, int mode)
                (int)strlen(ZLMB_OPTION_MODE_PUBLISH_SUBSCRIBE), "");
         printf("  %s: client_frontendpoint,client_backendpoints,\n",
                ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE);
-        printf("  %*s: client_dumpfile,client_dumptype\n",
+        printf("  %*s: client_dumpfile,client_dumptype,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: client_codec_threads,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: client_priority_keys,client_priority_weight,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: client_priority_backendpoints,client_ttl,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: client_syslogendpoints,client_syslog_key,\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
         printf("  %*s: subscribe_frontendpoint,subscribe_backendpoint,\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
         printf("  %*s: subscribe_key,subscribe_dropkey,\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_dedup,subscribe_dedup_memory,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_dedup_window,subscribe_sequence,"
+               "subscribe_ttl,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_replayendpoints,subscribe_replay_catchup,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_priority_frontendpoints,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_journalendpoint,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_journal_offsetfile,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_codec_threads,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink,subscribe_sink_rotate_size,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_rotate_time,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_compress,subscribe_sink_sync,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
+        printf("  %*s: subscribe_sink_uncompress,\n",
+               (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
         printf("  %*s: subscribe_dumpfile,subscribe_dumptype\n",
                (int)strlen(ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE), "");
         printf("  %s: client_frontendpoint,subscribe_backendpoint,\n",
                ZLMB_OPTION_MODE_STAND_ALONE);
+        printf("  %*s: client_syslogendpoints,client_syslog_key,\n",
+               (int)strlen(ZLMB_OPTION_MODE_STAND_ALONE), "");
         printf("  %*s: subscribe_dumpfile,subscribe_dumptype\n",
                (int)strlen(ZLMB_OPTION_MODE_STAND_ALONE), "");
+        printf("  %s: pipeline,\n", ZLMB_OPTION_MODE_PIPELINE);
+        printf("  %*s: options of %s, %s and %s\n",
+               (int)strlen(ZLMB_OPTION_MODE_PIPELINE), "",
+               ZLMB_OPTION_MODE_CLIENT, ZLMB_OPTION_MODE_PUBLISH,
+               ZLMB_OPTION_MODE_SUBSCRIBE);
     }
 
     if (message) {
@@ -2969,30 +6960,78 @@ _usage(char *arg, char *message, int mode)
 int
 main (int argc, char **argv)
 {
-    int opt;
+    int opt, pipeline, ret = 0;
     char *config_filename = NULL;
     zlmb_option_t *option = NULL;
+    zlmb_publish_stage_t *publish_stage = NULL;
+    zlmb_subscribe_stage_t *subscribe_stage = NULL;
 
     const struct option long_options[] = {
         { ZLMB_OPTION_KEY_MODE, 1, NULL, 1 },
+        { ZLMB_OPTION_KEY_PIPELINE, 1, NULL, 2 },
         { ZLMB_OPTION_KEY_CLIENT_FRONTENDPOINT, 1, NULL, 11 },
         { ZLMB_OPTION_KEY_CLIENT_BACKENDPOINTS, 1, NULL, 12 },
         { ZLMB_OPTION_KEY_CLIENT_DUMPFILE, 1, NULL, 13 },
         { ZLMB_OPTION_KEY_CLIENT_DUMPTYPE, 1, NULL, 14 },
+        { ZLMB_OPTION_KEY_CLIENT_CODEC_THREADS, 1, NULL, 15 },
+        { ZLMB_OPTION_KEY_CLIENT_SYSLOGENDPOINTS, 1, NULL, 16 },
+        { ZLMB_OPTION_KEY_CLIENT_SYSLOG_KEY, 0, NULL, 17 },
+        { ZLMB_OPTION_KEY_CLIENT_PRIORITY_KEYS, 1, NULL, 18 },
+        { ZLMB_OPTION_KEY_CLIENT_PRIORITY_WEIGHT, 1, NULL, 19 },
+        { ZLMB_OPTION_KEY_CLIENT_TTL, 1, NULL, 20 },
+        { ZLMB_OPTION_KEY_CLIENT_PRIORITY_BACKENDPOINTS, 1, NULL, 82 },
         { ZLMB_OPTION_KEY_PUBLISH_FRONTENDPOINT, 1, NULL, 21 },
         { ZLMB_OPTION_KEY_PUBLISH_BACKENDPOINT, 1, NULL, 22 },
         { ZLMB_OPTION_KEY_PUBLISH_KEY, 1, NULL, 23 },
         { ZLMB_OPTION_KEY_PUBLISH_SENDKEY, 0, NULL, 24 },
+        { ZLMB_OPTION_KEY_PUBLISH_RATELIMIT, 1, NULL, 25 },
+        { ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BURST, 1, NULL, 26 },
+        { ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BUCKETS, 1, NULL, 27 },
+        { ZLMB_OPTION_KEY_PUBLISH_SAMPLING, 1, NULL, 28 },
+        { ZLMB_OPTION_KEY_PUBLISH_SAMPLING_RANDOM, 0, NULL, 29 },
+        { ZLMB_OPTION_KEY_PUBLISH_SEQUENCE, 0, NULL, 30 },
+        { ZLMB_OPTION_KEY_PUBLISH_REPLAYENDPOINT, 1, NULL, 61 },
+        { ZLMB_OPTION_KEY_PUBLISH_REPLAY_SIZE, 1, NULL, 62 },
+        { ZLMB_OPTION_KEY_PUBLISH_REPLAY_BUDGET, 1, NULL, 63 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL, 1, NULL, 64 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL_PARTITIONS, 1, NULL, 65 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SEGMENT_SIZE, 1, NULL, 66 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_SIZE, 1, NULL, 67 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_TIME, 1, NULL, 68 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SYNC, 1, NULL, 69 },
+        { ZLMB_OPTION_KEY_PUBLISH_JOURNALENDPOINT, 1, NULL, 70 },
+        { ZLMB_OPTION_KEY_PUBLISH_PRIORITY_FRONTENDPOINT, 1, NULL, 83 },
+        { ZLMB_OPTION_KEY_PUBLISH_PRIORITY_BACKENDPOINT, 1, NULL, 84 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_FRONTENDPOINTS, 1, NULL, 31 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_BACKENDPOINT, 1, NULL, 32 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_KEY, 1, NULL, 33 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_DROPKEY, 0, NULL, 34 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_DUMPFILE, 1, NULL, 35 },
         { ZLMB_OPTION_KEY_SUBSCRIBE_DUMPTYPE, 1, NULL, 36 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP, 0, NULL, 37 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_MEMORY, 1, NULL, 38 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_WINDOW, 1, NULL, 39 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SEQUENCE, 0, NULL, 40 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_TTL, 0, NULL, 81 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_REPLAYENDPOINTS, 1, NULL, 71 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_REPLAY_CATCHUP, 0, NULL, 72 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_PRIORITY_FRONTENDPOINTS, 1, NULL, 85 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_JOURNALENDPOINT, 1, NULL, 73 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_JOURNAL_OFFSETFILE, 1, NULL, 74 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_CODEC_THREADS, 1, NULL, 75 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK, 1, NULL, 76 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_SIZE, 1, NULL, 77 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_TIME, 1, NULL, 78 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK_COMPRESS, 1, NULL, 79 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK_SYNC, 1, NULL, 80 },
+        { ZLMB_OPTION_KEY_SUBSCRIBE_SINK_UNCOMPRESS, 0, NULL, 86 },
         { "config", 1, NULL, 41 },
         { "info", 0, NULL, 42 },
         { "syslog", 0, NULL, 43 },
         { "verbose", 0, NULL, 44 },
+        { ZLMB_OPTION_KEY_STATS_INTERVAL, 1, NULL, 45 },
+        { ZLMB_OPTION_KEY_MEMORY_LIMIT, 1, NULL, 46 },
+        { ZLMB_OPTION_KEY_MEMORY_HIGH, 1, NULL, 47 },
         { "help", 0, NULL, 100 },
         { NULL, 0, NULL, 0 }
     };
@@ -3008,8 +7047,11 @@ main (int argc, char **argv)
             case 1:
                 _option_set(option, optarg, MODE);
                 break;
+            case 2:
+                _option_sets(option, optarg, PIPELINE);
+                break;
             case 11:
-                _option_set(option, optarg, CLIENT_FRONTENDPOINT);
+                _option_sets(option, optarg, CLIENT_FRONTENDPOINT);
                 break;
             case 12:
                 _option_sets(option, optarg, CLIENT_BACKENDPOINTS);
@@ -3020,6 +7062,27 @@ main (int argc, char **argv)
             case 14:
                 _option_set(option, optarg, CLIENT_DUMPFILE);
                 break;
+            case 15:
+                _option_set(option, optarg, CLIENT_CODEC_THREADS);
+                break;
+            case 16:
+                _option_sets(option, optarg, CLIENT_SYSLOGENDPOINTS);
+                break;
+            case 17:
+                _option_set(option, "true", CLIENT_SYSLOG_KEY);
+                break;
+            case 18:
+                _option_sets(option, optarg, CLIENT_PRIORITY_KEYS);
+                break;
+            case 19:
+                _option_set(option, optarg, CLIENT_PRIORITY_WEIGHT);
+                break;
+            case 20:
+                _option_sets(option, optarg, CLIENT_TTL);
+                break;
+            case 82:
+                _option_sets(option, optarg, CLIENT_PRIORITY_BACKENDPOINTS);
+                break;
             case 21:
                 _option_set(option, optarg, PUBLISH_FRONTENDPOINT);
                 break;
@@ -3032,6 +7095,60 @@ main (int argc, char **argv)
             case 24:
                 _option_set(option, "true", PUBLISH_SENDKEY);
                 break;
+            case 25:
+                _option_set(option, optarg, PUBLISH_RATELIMIT);
+                break;
+            case 26:
+                _option_set(option, optarg, PUBLISH_RATELIMIT_BURST);
+                break;
+            case 27:
+                _option_set(option, optarg, PUBLISH_RATELIMIT_BUCKETS);
+                break;
+            case 28:
+                _option_set(option, optarg, PUBLISH_SAMPLING);
+                break;
+            case 29:
+                _option_set(option, "true", PUBLISH_SAMPLING_RANDOM);
+                break;
+            case 30:
+                _option_set(option, "true", PUBLISH_SEQUENCE);
+                break;
+            case 61:
+                _option_set(option, optarg, PUBLISH_REPLAYENDPOINT);
+                break;
+            case 62:
+                _option_set(option, optarg, PUBLISH_REPLAY_SIZE);
+                break;
+            case 63:
+                _option_set(option, optarg, PUBLISH_REPLAY_BUDGET);
+                break;
+            case 64:
+                _option_set(option, optarg, PUBLISH_JOURNAL);
+                break;
+            case 65:
+                _option_set(option, optarg, PUBLISH_JOURNAL_PARTITIONS);
+                break;
+            case 66:
+                _option_set(option, optarg, PUBLISH_JOURNAL_SEGMENT_SIZE);
+                break;
+            case 67:
+                _option_set(option, optarg, PUBLISH_JOURNAL_RETENTION_SIZE);
+                break;
+            case 68:
+                _option_set(option, optarg, PUBLISH_JOURNAL_RETENTION_TIME);
+                break;
+            case 69:
+                _option_set(option, optarg, PUBLISH_JOURNAL_SYNC);
+                break;
+            case 70:
+                _option_set(option, optarg, PUBLISH_JOURNALENDPOINT);
+                break;
+            case 83:
+                _option_set(option, optarg, PUBLISH_PRIORITY_FRONTENDPOINT);
+                break;
+            case 84:
+                _option_set(option, optarg, PUBLISH_PRIORITY_BACKENDPOINT);
+                break;
             case 31:
                 _option_sets(option, optarg, SUBSCRIBE_FRONTENDPOINTS);
                 break;
@@ -3050,6 +7167,58 @@ main (int argc, char **argv)
             case 36:
                 _option_set(option, optarg, SUBSCRIBE_DUMPTYPE);
                 break;
+            case 37:
+                _option_set(option, "true", SUBSCRIBE_DEDUP);
+                break;
+            case 38:
+                _option_set(option, optarg, SUBSCRIBE_DEDUP_MEMORY);
+                break;
+            case 39:
+                _option_set(option, optarg, SUBSCRIBE_DEDUP_WINDOW);
+                break;
+            case 40:
+                _option_set(option, "true", SUBSCRIBE_SEQUENCE);
+                break;
+            case 81:
+                _option_set(option, "true", SUBSCRIBE_TTL);
+                break;
+            case 71:
+                _option_sets(option, optarg, SUBSCRIBE_REPLAYENDPOINTS);
+                break;
+            case 72:
+                _option_set(option, "true", SUBSCRIBE_REPLAY_CATCHUP);
+                break;
+            case 85:
+                _option_sets(option, optarg,
+                             SUBSCRIBE_PRIORITY_FRONTENDPOINTS);
+                break;
+            case 73:
+                _option_set(option, optarg, SUBSCRIBE_JOURNALENDPOINT);
+                break;
+            case 74:
+                _option_set(option, optarg, SUBSCRIBE_JOURNAL_OFFSETFILE);
+                break;
+            case 75:
+                _option_set(option, optarg, SUBSCRIBE_CODEC_THREADS);
+                break;
+            case 76:
+                _option_set(option, optarg, SUBSCRIBE_SINK);
+                break;
+            case 77:
+                _option_set(option, optarg, SUBSCRIBE_SINK_ROTATE_SIZE);
+                break;
+            case 78:
+                _option_set(option, optarg, SUBSCRIBE_SINK_ROTATE_TIME);
+                break;
+            case 79:
+                _option_set(option, optarg, SUBSCRIBE_SINK_COMPRESS);
+                break;
+            case 80:
+                _option_set(option, optarg, SUBSCRIBE_SINK_SYNC);
+                break;
+            case 86:
+                _option_set(option, "true", SUBSCRIBE_SINK_UNCOMPRESS);
+                break;
             case 41:
                 config_filename = optarg;
                 break;
@@ -3063,6 +7232,15 @@ main (int argc, char **argv)
             case 44:
                 _option_set(option, "true", VERBOSE);
                 break;
+            case 45:
+                _option_set(option, optarg, STATS_INTERVAL);
+                break;
+            case 46:
+                _option_set(option, optarg, MEMORY_LIMIT);
+                break;
+            case 47:
+                _option_set(option, optarg, MEMORY_HIGH);
+                break;
             default:
                 _usage(argv[0], NULL, option->mode);
                 zlmb_option_destroy(&option);
@@ -3081,15 +7259,55 @@ main (int argc, char **argv)
 
     zlmb_option_set_default(option);
 
+    /* sequence: counted per publisher, keys filtered by the SUB socket
+     * would be counted as lost */
+    if ((option->subscribe_sequence > 0 || option->subscribe_replayendpoints)
+        && option->subscribe_key && strlen(option->subscribe_key) > 0) {
+        _usage(argv[0], "subscribe_sequence (subscribe_replayendpoints)"
+               " can not be used with subscribe_key", option->mode);
+        zlmb_option_destroy(&option);
+        return -1;
+    }
+
     if (option->syslog != -1) {
         _syslog = option->syslog;
     }
     if (option->verbose != -1) {
         _verbose = option->verbose;
     }
+    _stats_interval = option->stats_interval;
 
     _LOG_OPEN(ZLMB_SYSLOG_IDENT);
 
+    /* log: write on a background thread (never blocks forwarding) */
+    if (zlmb_log_start() == -1) {
+        _ERR("Log thread start.\n");
+    }
+
+    /* memory: byte budget of queued messages */
+    if (option->memory_limit > 0) {
+        _memory = zlmb_memory_init(option->memory_limit, option->memory_high);
+        if (!_memory) {
+            _ERR("Memory budget initilized.\n");
+        } else {
+            _VERBOSE("Memory budget: %d MB (high-water mark: %d%%)\n",
+                     option->memory_limit, option->memory_high);
+        }
+    }
+
+    /* ttl: stamp messages at the client stage */
+    if (option->client_ttl && strlen(option->client_ttl) > 0) {
+        _ttl = zlmb_ttl_init(option->client_ttl);
+        if (!_ttl) {
+            _ERR("TTL initilized: %s\n", option->client_ttl);
+        } else {
+            _VERBOSE("TTL: %s\n", option->client_ttl);
+        }
+    }
+
+    /* interrupt: wakeup poll loops */
+    _wakeup_init(_wakeup);
+
     switch (option->mode) {
         case ZLMB_MODE_CLIENT:
             _option_require(argv[0], option, client_frontendpoint,
@@ -3098,9 +7316,15 @@ main (int argc, char **argv)
                             "required client_backendpoints");
 
             _server_client(option->client_frontendpoint,
+                           option->client_syslogendpoints,
+                           option->client_syslog_key,
                            option->client_backendpoints,
                            option->client_dumpfile,
-                           option->client_dumptype);
+                           option->client_dumptype,
+                           option->client_codec_threads,
+                           option->client_priority_keys,
+                           option->client_priority_weight,
+                           option->client_priority_backendpoints);
             break;
         case ZLMB_MODE_PUBLISH:
             _option_require(argv[0], option, publish_frontendpoint,
@@ -3108,23 +7332,37 @@ main (int argc, char **argv)
             _option_require(argv[0], option, publish_backendpoint,
                             "required publish_backendpoint");
 
+            if (_publish_stage_init(option, &publish_stage) == -1) {
+                ret = -1;
+                break;
+            }
+
             _server_publish(option->publish_frontendpoint,
                             option->publish_backendpoint,
                             option->publish_key,
-                            option->publish_sendkey);
+                            option->publish_sendkey,
+                            publish_stage);
             break;
         case ZLMB_MODE_SUBSCRIBE:
-            _option_require(argv[0], option, subscribe_frontendpoints,
-                            "required subscribe_frontendpoint");
+            if (!option->subscribe_journalendpoint) {
+                _option_require(argv[0], option, subscribe_frontendpoints,
+                                "required subscribe_frontendpoint");
+            }
             _option_require(argv[0], option, subscribe_backendpoint,
                             "required subscribe_backendpoint");
 
+            if (_subscribe_stage_init(option, &subscribe_stage) == -1) {
+                ret = -1;
+                break;
+            }
+
             _server_subscribe(option->subscribe_frontendpoints,
                               option->subscribe_backendpoint,
                               option->subscribe_key,
                               option->subscribe_dropkey,
                               option->subscribe_dumpfile,
-                              option->subscribe_dumptype);
+                              option->subscribe_dumptype,
+                              subscribe_stage);
             break;
         case ZLMB_MODE_CLIENT_PUBLISH:
             _option_require(argv[0], option, client_frontendpoint,
@@ -3132,10 +7370,18 @@ main (int argc, char **argv)
             _option_require(argv[0], option, publish_backendpoint,
                             "required publish_backendpoint");
 
+            if (_publish_stage_init(option, &publish_stage) == -1) {
+                ret = -1;
+                break;
+            }
+
             _server_client_publish(option->client_frontendpoint,
+                                   option->client_syslogendpoints,
+                                   option->client_syslog_key,
                                    option->publish_backendpoint,
                                    option->publish_key,
-                                   option->publish_sendkey);
+                                   option->publish_sendkey,
+                                   publish_stage);
             break;
         case ZLMB_MODE_PUBLISH_SUBSCRIBE:
             _option_require(argv[0], option, publish_frontendpoint,
@@ -3153,21 +7399,35 @@ main (int argc, char **argv)
                             "required client_frontendpoint");
             _option_require(argv[0], option, client_backendpoints,
                             "required client_backendpoints");
-            _option_require(argv[0], option, subscribe_frontendpoints,
-                            "required subscribe_frontendpoint");
+            if (!option->subscribe_journalendpoint) {
+                _option_require(argv[0], option, subscribe_frontendpoints,
+                                "required subscribe_frontendpoint");
+            }
             _option_require(argv[0], option, subscribe_backendpoint,
                             "required subscribe_backendpoint");
 
+            if (_subscribe_stage_init(option, &subscribe_stage) == -1) {
+                ret = -1;
+                break;
+            }
+
             _server_client_subscribe(option->client_frontendpoint,
+                                     option->client_syslogendpoints,
+                                     option->client_syslog_key,
                                      option->client_backendpoints,
                                      option->client_dumpfile,
                                      option->client_dumptype,
+                                     option->client_codec_threads,
+                                     option->client_priority_keys,
+                                     option->client_priority_weight,
+                                     option->client_priority_backendpoints,
                                      option->subscribe_frontendpoints,
                                      option->subscribe_backendpoint,
                                      option->subscribe_key,
                                      option->subscribe_dropkey,
                                      option->subscribe_dumpfile,
-                                     option->subscribe_dumptype);
+                                     option->subscribe_dumptype,
+                                     subscribe_stage);
             break;
         case ZLMB_MODE_STAND_ALONE:
             _option_require(argv[0], option, client_frontendpoint,
@@ -3176,20 +7436,85 @@ main (int argc, char **argv)
                             "required subscribe_backendpoint");
 
             _server_stand_alone(option->client_frontendpoint,
+                                option->client_syslogendpoints,
+                                option->client_syslog_key,
                                 option->subscribe_backendpoint,
                                 option->subscribe_dumpfile,
                                 option->subscribe_dumptype);
             break;
+        case ZLMB_MODE_PIPELINE:
+            _option_require(argv[0], option, pipeline, "required pipeline");
+
+            pipeline = _pipeline_parse(option->pipeline);
+            if (pipeline == -1) {
+                _usage(argv[0], "invalid pipeline", option->mode);
+                zlmb_option_destroy(&option);
+                _wakeup_destroy(_wakeup);
+                zlmb_memory_destroy(&_memory);
+                zlmb_ttl_destroy(&_ttl);
+                _LOG_CLOSE();
+                return -1;
+            }
+
+            if (pipeline & ZLMB_MODE_CLIENT) {
+                _option_require(argv[0], option, client_frontendpoint,
+                                "required client_frontendpoint");
+                _option_require(argv[0], option, client_backendpoints,
+                                "required client_backendpoints");
+            }
+            if (pipeline & ZLMB_MODE_PUBLISH) {
+                _option_require(argv[0], option, publish_frontendpoint,
+                                "required publish_frontendpoint");
+                _option_require(argv[0], option, publish_backendpoint,
+                                "required publish_backendpoint");
+            }
+            if (pipeline & ZLMB_MODE_SUBSCRIBE) {
+                if (!option->subscribe_journalendpoint) {
+                    _option_require(argv[0], option, subscribe_frontendpoints,
+                                    "required subscribe_frontendpoint");
+                }
+                _option_require(argv[0], option, subscribe_backendpoint,
+                                "required subscribe_backendpoint");
+            }
+
+            if ((pipeline & ZLMB_MODE_PUBLISH) &&
+                _publish_stage_init(option, &publish_stage) == -1) {
+                ret = -1;
+                break;
+            }
+            if ((pipeline & ZLMB_MODE_SUBSCRIBE) &&
+                _subscribe_stage_init(option, &subscribe_stage) == -1) {
+                ret = -1;
+                break;
+            }
+
+            _server_pipeline(option, pipeline, publish_stage, subscribe_stage);
+            break;
         default:
             _usage(argv[0], "invalid mode", option->mode);
             zlmb_option_destroy(&option);
+            _wakeup_destroy(_wakeup);
+            zlmb_memory_destroy(&_memory);
+            zlmb_ttl_destroy(&_ttl);
             _LOG_CLOSE();
             return -1;
     }
 
+    if (publish_stage) {
+        _publish_stage_destroy(&publish_stage);
+    }
+
+    if (subscribe_stage) {
+        _subscribe_stage_destroy(&subscribe_stage);
+    }
+
     zlmb_option_destroy(&option);
 
+    _wakeup_destroy(_wakeup);
+    zlmb_memory_destroy(&_memory);
+    zlmb_ttl_destroy(&_ttl);
+
     _LOG_CLOSE();
 
-    return 0;
+    return ret;
 }
@@ -0,0 +1,360 @@
+/*
+ * zlmb tail
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+#include <getopt.h>
+#include <signal.h>
+#include <poll.h>
+
+#include "zlmb.h"
+#include "tail.h"
+#include "utils.h"
+#include "log.h"
+
+#define ZLMB_SYSLOG_IDENT "zlmb-tail"
+
+/* zeromq 3.2 */
+#ifndef ZMQ_IMMEDIATE
+#define ZMQ_IMMEDIATE ZMQ_DELAY_ATTACH_ON_CONNECT
+#endif
+
+#ifndef ZLMB_CLIENT_SOCKET
+#define ZLMB_CLIENT_SOCKET "tcp://127.0.0.1:5557"
+#endif
+
+typedef struct {
+    void *socket;
+    int key;
+} zlmb_tail_client_t;
+
+static int _syslog = 0;
+static int _verbose = 0;
+static volatile sig_atomic_t _interrupted = 0;
+
+static void
+_signal_handler(int sig)
+{
+    (void)sig;
+    _interrupted = 1;
+}
+
+static void
+_signals(void)
+{
+    struct sigaction sa;
+
+    sa.sa_handler = _signal_handler;
+    sa.sa_flags = 0;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+}
+
+static int
+_send(void *arg, char *path, struct iovec *lines, int count)
+{
+    zlmb_tail_client_t *client = (zlmb_tail_client_t *)arg;
+    int i;
+
+    /* key: file path */
+    if (client->key) {
+        if (zmq_send(client->socket, path, strlen(path), ZMQ_SNDMORE) == -1) {
+            _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
+            return -1;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        _DEBUG("ZeroMQ send(#%d).\n", i + 1);
+        if (zmq_send(client->socket, lines[i].iov_base, lines[i].iov_len,
+                     (i + 1 < count) ? ZMQ_SNDMORE : 0) == -1) {
+            _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+_add_list(zlmb_tail_t *tail, char *filename)
+{
+    FILE *fp;
+    char buf[BUFSIZ];
+    int count = 0;
+
+    fp = fopen(filename, "r");
+    if (!fp) {
+        _ERR("Open read file: %s\n", filename);
+        return -1;
+    }
+
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        char *p;
+
+        if ((p = strrchr(buf, '\n')) != NULL) {
+            *p = '\0';
+        }
+
+        if (buf[0] == '\0' || buf[0] == '#') {
+            continue;
+        }
+
+        if (zlmb_tail_add(tail, buf) == -1) {
+            _ERR("Tail file: %s\n", buf);
+            continue;
+        }
+
+        count++;
+    }
+
+    fclose(fp);
+
+    return count;
+}
+
+static void
+_usage(char *arg, char *message)
+{
+    char *command = basename(arg);
+
+    printf("Usage: %s [-e ENDPOINT] [-o FILE] [-n NUM] [-i MSEC] [-l FILE]"
+           " [-b] [-k] FILE ...\n\n", command);
+
+    printf("  -e, --endpoint=ENDPOINT server endpoint [DEFAULT: %s]\n",
+           ZLMB_CLIENT_SOCKET);
+    printf("  -o, --offsetfile=FILE   offset file [DEFAULT: %s]\n",
+           ZLMB_DEFAULT_TAIL_OFFSET_FILE);
+    printf("  -n, --lines=NUM         lines per message (multi-part)"
+           " [DEFAULT: 1]\n");
+    printf("  -i, --sync=MSEC         offset file sync interval"
+           " [DEFAULT: %d]\n", ZLMB_TAIL_DEFAULT_SYNC);
+    printf("  -l, --list=FILE         file names (one per line)\n");
+    printf("  -b, --beginning         read new files from the beginning\n");
+    printf("  -k, --key               send file name before the lines\n");
+    printf("  -s, --syslog            log to syslog\n");
+    printf("  -v, --verbose           verbosity log\n");
+    printf("  FILE ...                follow files\n");
+
+    if (message) {
+        printf("\nINFO: %s\n", message);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+    int i, opt, lines = 1, sync = ZLMB_TAIL_DEFAULT_SYNC, beginning = 0;
+    int hwm = ZLMB_TAIL_SNDHWM, immediate = 1, linger = ZLMB_TAIL_LINGER;
+    char *endpoint = ZLMB_CLIENT_SOCKET;
+    char *offsetfile = ZLMB_DEFAULT_TAIL_OFFSET_FILE;
+    char *listfile = NULL;
+    void *context;
+    zlmb_tail_t *tail;
+    zlmb_tail_client_t client = { NULL, 0 };
+    struct pollfd pollfd;
+    uint64_t next;
+
+    const struct option long_options[] = {
+        { "endpoint", 1, NULL, 'e' },
+        { "offsetfile", 1, NULL, 'o' },
+        { "lines", 1, NULL, 'n' },
+        { "sync", 1, NULL, 'i' },
+        { "list", 1, NULL, 'l' },
+        { "beginning", 0, NULL, 'b' },
+        { "key", 0, NULL, 'k' },
+        { "syslog", 0, NULL, 's' },
+        { "verbose", 0, NULL, 'v' },
+        { "help", 0, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((opt = getopt_long(argc, argv, "e:o:n:i:l:bksvh",
+                              long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'e':
+                endpoint = optarg;
+                break;
+            case 'o':
+                offsetfile = optarg;
+                break;
+            case 'n':
+                lines = atoi(optarg);
+                if (lines <= 0) {
+                    lines = 1;
+                }
+                break;
+            case 'i':
+                sync = atoi(optarg);
+                if (sync < 0) {
+                    sync = 0;
+                }
+                break;
+            case 'l':
+                listfile = optarg;
+                break;
+            case 'b':
+                beginning = 1;
+                break;
+            case 'k':
+                client.key = 1;
+                break;
+            case 's':
+                _syslog = 1;
+                break;
+            case 'v':
+                _verbose = 1;
+                break;
+            default:
+                _usage(argv[0], NULL);
+                return -1;
+        }
+    }
+
+    if (listfile == NULL && argc <= optind) {
+        _usage(argv[0], "required files to follow.");
+        return -1;
+    }
+
+    _LOG_OPEN(ZLMB_SYSLOG_IDENT);
+
+    if (zlmb_log_start() == -1) {
+        _ERR("Log thread start.\n");
+    }
+
+    _INFO("Connection endpoint: %s\n", endpoint);
+    _INFO("Offset file: %s\n", offsetfile);
+
+    tail = zlmb_tail_init(offsetfile, lines, beginning);
+    if (!tail) {
+        _ERR("Tail initilized: %s\n", strerror(errno));
+        _LOG_CLOSE();
+        return -1;
+    }
+
+    for (i = optind; i < argc; i++) {
+        if (zlmb_tail_add(tail, argv[i]) == -1) {
+            _ERR("Tail file: %s\n", argv[i]);
+        }
+    }
+
+    if (listfile) {
+        _add_list(tail, listfile);
+    }
+
+    if (tail->nfiles == 0) {
+        _ERR("Tail files: not found\n");
+        zlmb_tail_destroy(&tail);
+        _LOG_CLOSE();
+        return -1;
+    }
+
+    _VERBOSE("Tail files: %ld (directories: %ld)\n",
+             (long)tail->nfiles, (long)tail->ndirs);
+
+    context = zmq_ctx_new();
+    if (!context) {
+        _ERR("ZeroMQ context: %s\n", zmq_strerror(errno));
+        zlmb_tail_destroy(&tail);
+        _LOG_CLOSE();
+        return -1;
+    }
+
+    client.socket = zmq_socket(context, ZMQ_PUSH);
+    if (!client.socket) {
+        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
+        zmq_ctx_destroy(context);
+        zlmb_tail_destroy(&tail);
+        _LOG_CLOSE();
+        return -1;
+    }
+
+    /* offset: saved for queued lines, the queue is kept small and only
+     * for a connected server (lost by a crash: at most the queue) */
+    zmq_setsockopt(client.socket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(client.socket, ZMQ_IMMEDIATE, &immediate,
+                   sizeof(immediate));
+    zmq_setsockopt(client.socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+    if (zmq_connect(client.socket, endpoint) == -1) {
+        _ERR("ZeroMQ connect: %s: %s\n", endpoint, zmq_strerror(errno));
+        zmq_close(client.socket);
+        zmq_ctx_destroy(context);
+        zlmb_tail_destroy(&tail);
+        _LOG_CLOSE();
+        return -1;
+    }
+
+    _VERBOSE("ZeroMQ socket connect: %s\n", endpoint);
+
+    _signals();
+
+    /* catch up: lines written while stopped */
+    zlmb_tail_scan(tail, _send, &client);
+
+    pollfd.fd = zlmb_tail_fd(tail);
+    pollfd.events = POLLIN;
+
+    next = zlmb_utils_clock() + (uint64_t)sync * 1000;
+
+    while (!_interrupted) {
+        int timeout = -1;
+        uint64_t now;
+
+        /* offset file: sync at most once per interval */
+        if (tail->dirty) {
+            now = zlmb_utils_clock();
+            timeout = (now >= next) ? 0 : (int)((next - now) / 1000) + 1;
+        }
+
+        if (poll(&pollfd, 1, timeout) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _ERR("Poll: %s\n", strerror(errno));
+            break;
+        }
+
+        if (pollfd.revents & POLLIN) {
+            zlmb_tail_event(tail, _send, &client);
+        }
+
+        now = zlmb_utils_clock();
+        if (tail->dirty && now >= next) {
+            if (zlmb_tail_sync(tail) == -1) {
+                _ERR("Offset file sync: %s: %s\n",
+                     offsetfile, strerror(errno));
+            }
+            next = now + (uint64_t)sync * 1000;
+        }
+    }
+
+    if (zlmb_tail_sync(tail) == -1) {
+        _ERR("Offset file sync: %s: %s\n", offsetfile, strerror(errno));
+    }
+
+    _INFO("Tail messages: %llu (bytes: %llu, rotated: %llu,"
+          " truncated: %llu, syncs: %llu)\n",
+          (unsigned long long)tail->messages,
+          (unsigned long long)tail->bytes,
+          (unsigned long long)tail->rotated,
+          (unsigned long long)tail->truncated,
+          (unsigned long long)tail->syncs);
+
+    _VERBOSE("ZeroMQ socket close.\n");
+    zmq_close(client.socket);
+
+    _VERBOSE("ZeroMQ destroy context.\n");
+    zmq_ctx_destroy(context);
+
+    zlmb_tail_destroy(&tail);
+
+    _LOG_CLOSE();
+
+    return 0;
+}
@@ -5,8 +5,28 @@
  *  ZLMB_FRAME
  *  ZLMB_FRAME_LENGTH
  *  ZLMB_LENGTH
+ *  ZLMB_MEMFD (memfd option: frames in a sealed memfd, not in stdin)
+ *  ZLMB_FRAME_OFFSET
+ *
+ * command stdout (output option):
+ *  records (line or length prefixed) are sent to the output endpoint
+ *
+ * route file (route.h): commands, plugins and sinks per key
+ *
+ * fastcgi option (fastcgi.h): commands are scripts of a FastCGI server
+ *  (php-fpm), environ in params and frames in stdin
+ *
+ * webhook option (http.h): messages are posted in batches (NDJSON, one
+ *  JSON array of frames per line) on a kept and pipelined connection
+ *
+ * plugin (shared object, see plugin.h):
+ *  messages are passed in batches on the worker threads (no copy)
  */
 
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +37,11 @@
 #include <pthread.h>
 #include <stdarg.h>
 #include <spawn.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 
 #include "zlmb.h"
@@ -24,6 +49,11 @@
 #include "dump.h"
 #include "log.h"
 #include "utils.h"
+#include "plugin.h"
+#include "route.h"
+#include "sink.h"
+#include "fastcgi.h"
+#include "http.h"
 
 #define ZLMB_SYSLOG_IDENT "zlmb-worker"
 
@@ -33,9 +63,48 @@
 
 #define ZLMB_WORKER_BACKEND_SOCKET "inproc://zlmb.worker"
 
+/* memfd: descriptor number in the command */
+#define ZLMB_WORKER_MEMFD     3
+#define ZLMB_WORKER_MEMFD_ENV "ZLMB_MEMFD=3"
+
+/* output: stdout framing */
+#define ZLMB_WORKER_OUTPUT_LINE   0
+#define ZLMB_WORKER_OUTPUT_LENGTH 1
+#define ZLMB_WORKER_OUTPUT_LINGER 1000
+
+/* retry: messages waiting per thread, longest backoff (msec) */
+#define ZLMB_WORKER_RETRY_QUEUE 1024
+#define ZLMB_WORKER_BACKOFF_MAX 60000
+#define ZLMB_WORKER_BACKOFF     1000
+
+/* fastcgi: frames in stdin without allocation */
+#define ZLMB_WORKER_FASTCGI_IOV 16
+
+/* fastcgi, webhook: response timeout (msec) */
+#define ZLMB_WORKER_TIMEOUT 30000
+
+/* webhook: batches in flight per connection */
+#define ZLMB_WORKER_HTTP_PIPELINE 4
+#define ZLMB_WORKER_HTTP_TYPE     "application/x-ndjson"
+
+#define ZLMB_WORKER_POST_FREE    0
+#define ZLMB_WORKER_POST_PENDING 1
+#define ZLMB_WORKER_POST_SENT    2
+
+/* plugin: messages per batch */
+#define ZLMB_WORKER_PLUGIN_BATCH 64
+
+/* dispatch: messages waiting for a busy route or shard */
+#define ZLMB_WORKER_DISPATCH_QUEUE 1024
+
+#if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+#    define HAVE_MEMFD 1
+#endif
+
 static int _interrupted = 0;
 static int _syslog = 0;
 static int _verbose = 0;
+static pthread_mutex_t _deadletter_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 typedef struct {
     pthread_t thread;
@@ -45,6 +114,22 @@ typedef struct {
     char **argv;
     int argc;
     int optind;
+    size_t memfd;
+    zlmb_plugin_t *plugin;
+    int retry;
+    int backoff;
+    zlmb_dump_t *deadletter;
+    char *output;
+    int format;
+    char *fastcgi;
+    int timeout;
+    uint64_t messages;
+    uint64_t elapsed;
+    uint64_t retries;
+    uint64_t deadletters;
+    uint64_t outputs;
+    uint64_t outputs_dropped;
+    volatile uint64_t completed;
 } zlmb_worker_t;
 
 typedef struct {
@@ -52,8 +137,80 @@ typedef struct {
     char *frame;
     char *frame_length;
     char *length;
+    size_t size;
+    int memfd;
+    char *frame_offset;
+    char *output;
+    size_t output_size;
+    size_t output_length;
 } zlmb_spawn_t;
 
+/* command: resolved once per thread (PATH search, argv, attributes) */
+typedef struct {
+    char *path;
+    char **argv;
+    posix_spawnattr_t attr;
+    zlmb_fastcgi_t *fastcgi;
+    char *script_filename;
+    char *script_name;
+} zlmb_exec_t;
+
+typedef struct zlmb_retry zlmb_retry_t;
+struct zlmb_retry {
+    zlmb_spawn_t spawn;
+    int attempts;
+    uint64_t due;
+    zlmb_retry_t *next;
+};
+
+/* overflow: sent in order when the socket is writable again */
+typedef struct {
+    zlmb_stack_t *queue;
+    uint64_t dropped;
+} zlmb_overflow_t;
+
+typedef struct {
+    void *socket;
+    char *endpoint;
+    uint64_t dispatched;
+    zlmb_overflow_t overflow;
+} zlmb_shard_t;
+
+typedef struct {
+    void *socket;
+    char *endpoint;
+    zlmb_overflow_t overflow;
+    zlmb_shard_t *shards;
+    int nshards;
+    zlmb_worker_t **worker;
+    int thread;
+    void *handle;
+} zlmb_backend_t;
+
+/* plugin: received frames of a batch (zmsgs are reused) */
+typedef struct {
+    zmq_msg_t **zmsgs;
+    zlmb_plugin_frame_t *frames;
+    size_t size;
+    size_t nframes;
+    zlmb_plugin_message_t messages[ZLMB_WORKER_PLUGIN_BATCH];
+    size_t offsets[ZLMB_WORKER_PLUGIN_BATCH];
+    size_t count;
+} zlmb_batch_t;
+
+/* webhook: request body of a batch (order: sent again in order) */
+typedef struct {
+    zlmb_batch_t batch;
+    char *body;
+    size_t size;
+    size_t length;
+    int attempts;
+    int state;
+    int reused;
+    uint64_t order;
+    uint64_t seq;
+} zlmb_post_t;
+
 static void
 _signal_handler(int sig)
 {
@@ -70,6 +227,10 @@ _signals(void)
     sigemptyset(&sa.sa_mask);
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+
+    /* command: exit before reading stdin */
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
 }
 
 static char *
@@ -143,239 +304,2298 @@ _spawn_generate_environ(zlmb_spawn_t *self)
     }
 
     self->length = _str_printf("ZLMB_LENGTH=%ld", length);
+    self->size = length;
 
     _DEBUG("POSIX spawn Environ: %s; %s; %s\n",
            self->frame, self->frame_length, self->length);
 }
 
+/* memfd: frames in order, sealed before the command maps it */
+static int
+_spawn_memfd(zlmb_spawn_t *self)
+{
+#ifdef HAVE_MEMFD
+    int fd;
+    size_t offset = 0;
+    zlmb_stack_item_t *item;
+
+    fd = memfd_create("zlmb-worker", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        _ERR("Memory file create: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* reserved for the command (dup2 keeps close-on-exec of same fd) */
+    if (fd == ZLMB_WORKER_MEMFD) {
+        int tmp = fcntl(fd, F_DUPFD_CLOEXEC, ZLMB_WORKER_MEMFD + 1);
+        close(fd);
+        if (tmp == -1) {
+            _ERR("Memory file duplicate: %s\n", strerror(errno));
+            return -1;
+        }
+        fd = tmp;
+    }
+
+    if (ftruncate(fd, self->size) == -1) {
+        _ERR("Memory file size: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    item = zlmb_stack_first(self->stack);
+    while (item) {
+        zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+        if (zmsg) {
+            char *data = zmq_msg_data(zmsg);
+            size_t size = zmq_msg_size(zmsg);
+            char *older = self->frame_offset;
+
+            if (!older) {
+                self->frame_offset = _str_printf("ZLMB_FRAME_OFFSET=%ld",
+                                                 (long)offset);
+            } else {
+                self->frame_offset = _str_printf("%s:%ld",
+                                                 older, (long)offset);
+                free(older);
+            }
+
+            while (size > 0) {
+                ssize_t len = pwrite(fd, data, size, offset);
+                if (len <= 0) {
+                    if (len == -1 && errno == EINTR) {
+                        continue;
+                    }
+                    break;
+                }
+                data += len;
+                size -= len;
+                offset += len;
+            }
+
+            if (size > 0) {
+                _ERR("Memory file write: %s\n", strerror(errno));
+                close(fd);
+                return -1;
+            }
+        }
+        item = zlmb_stack_item_next(item);
+    }
+
+    /* read only for the command */
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW
+              | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        _ERR("Memory file seal: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    self->memfd = fd;
+
+    _DEBUG("Memory file: %ld bytes (%s)\n",
+           (long)self->size, self->frame_offset);
+
+    return 0;
+#else
+    (void)self;
+    return -1;
+#endif
+}
+
+static int
+_spawn_output(zlmb_spawn_t *self, const char *buf, size_t len)
+{
+    if (self->output_length + len > self->output_size) {
+        size_t size = self->output_size ? self->output_size : BUFSIZ;
+        void *tmp;
+
+        while (self->output_length + len > size) {
+            size *= 2;
+        }
+
+        tmp = realloc(self->output, size);
+        if (!tmp) {
+            _ERR("Memory allocate output.\n");
+            return -1;
+        }
+        self->output = (char *)tmp;
+        self->output_size = size;
+    }
+
+    memcpy(self->output + self->output_length, buf, len);
+    self->output_length += len;
+
+    return 0;
+}
+
+static void
+_spawn_close(int *in, int *out)
+{
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (in[i] != -1) {
+            close(in[i]);
+        }
+        if (out[i] != -1) {
+            close(out[i]);
+        }
+    }
+}
+
+/* stdin and stdout at once: the command may write before reading all */
+static void
+_spawn_io(zlmb_spawn_t *self, int in, int out)
+{
+    struct pollfd fds[2];
+    zlmb_stack_item_t *item = zlmb_stack_first(self->stack);
+    size_t offset = 0;
+    char buf[BUFSIZ];
+
+    if (in != -1) {
+        fcntl(in, F_SETFL, fcntl(in, F_GETFL) | O_NONBLOCK);
+    }
+
+    while (in != -1 || out != -1) {
+        fds[0].fd = in;
+        fds[0].events = POLLOUT;
+        fds[0].revents = 0;
+        fds[1].fd = out;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _ERR("Poll: %s\n", strerror(errno));
+            break;
+        }
+
+        if (in != -1 && fds[0].revents) {
+            zmq_msg_t *zmsg = NULL;
+
+            while (item) {
+                zmsg = zlmb_stack_item_data(item);
+                if (zmsg && offset < zmq_msg_size(zmsg)) {
+                    break;
+                }
+                item = zlmb_stack_item_next(item);
+                offset = 0;
+            }
+
+            if (!item) {
+                close(in);
+                in = -1;
+            } else {
+                ssize_t len = write(in, (char *)zmq_msg_data(zmsg) + offset,
+                                    zmq_msg_size(zmsg) - offset);
+                if (len > 0) {
+                    offset += len;
+                } else if (errno != EAGAIN && errno != EINTR) {
+                    /* command does not read stdin */
+                    close(in);
+                    in = -1;
+                }
+            }
+        }
+
+        if (out != -1 && fds[1].revents) {
+            ssize_t len = read(out, buf, sizeof(buf));
+            if (len > 0) {
+                _spawn_output(self, buf, len);
+            } else if (len == 0 || (errno != EAGAIN && errno != EINTR)) {
+                close(out);
+                out = -1;
+            }
+        }
+    }
+
+    if (in != -1) {
+        close(in);
+    }
+    if (out != -1) {
+        close(out);
+    }
+}
+
+/* PATH search: executable file (NULL: not found) */
+static char *
+_exec_path(const char *command)
+{
+    char *paths, *dir, *save = NULL;
+    const char *env;
+
+    if (strchr(command, '/')) {
+        return strdup(command);
+    }
+
+    env = getenv("PATH");
+    paths = strdup(env ? env : "/bin:/usr/bin");
+    if (!paths) {
+        return NULL;
+    }
+
+    dir = strtok_r(paths, ":", &save);
+    while (dir) {
+        char *path = _str_printf("%s/%s", dir, command);
+        if (path) {
+            struct stat st;
+            if (stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+                access(path, X_OK) == 0) {
+                free(paths);
+                return path;
+            }
+            free(path);
+        }
+        dir = strtok_r(NULL, ":", &save);
+    }
+
+    free(paths);
+
+    return NULL;
+}
+
+static void
+_exec_destroy(zlmb_exec_t *self)
+{
+    if (self->fastcgi || self->script_filename || self->script_name) {
+        zlmb_fastcgi_destroy(&self->fastcgi);
+        free(self->script_filename);
+        free(self->script_name);
+    } else {
+        posix_spawnattr_destroy(&self->attr);
+    }
+    if (self->path) {
+        free(self->path);
+    }
+    if (self->argv) {
+        free(self->argv);
+    }
+}
+
+static int
+_exec_init(zlmb_exec_t *self, zlmb_worker_t *worker)
+{
+    int i, n = worker->argc - worker->optind;
+    short flags = POSIX_SPAWN_SETSIGDEF;
+    sigset_t sigdefault;
+
+    memset(self, 0, sizeof(zlmb_exec_t));
+
+    if (n < 0) {
+        n = 0;
+    }
+
+    self->argv = (char **)malloc(sizeof(char *) * (n + 2));
+    if (!self->argv) {
+        _ERR("Memory allocate args.\n");
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        self->argv[i+1] = worker->argv[worker->optind+i];
+    }
+    self->argv[0] = worker->command;
+    self->argv[n+1] = NULL;
+
+    /* fastcgi: script path on the server (persistent connection) */
+    if (worker->fastcgi) {
+        self->fastcgi = zlmb_fastcgi_init(worker->fastcgi, worker->timeout);
+        self->script_filename = _str_printf("SCRIPT_FILENAME=%s",
+                                            worker->command);
+        self->script_name = _str_printf("SCRIPT_NAME=%s", worker->command);
+        if (!self->fastcgi || !self->script_filename || !self->script_name) {
+            _ERR("FastCGI initilize: %s\n", worker->fastcgi);
+            _exec_destroy(self);
+            return -1;
+        }
+        return 0;
+    }
+
+    /* not found: searched at each spawn (installed later) */
+    self->path = _exec_path(worker->command);
+    if (self->path) {
+        _DEBUG("Command path: %s\n", self->path);
+    } else {
+        _NOTICE("Command not found in PATH: %s\n", worker->command);
+    }
+
+    if (posix_spawnattr_init(&self->attr) != 0) {
+        _ERR("POSIX spawn attribute initilize.\n");
+        free(self->path);
+        free(self->argv);
+        return -1;
+    }
+
+    /* SIGPIPE: ignored by the worker, default in the command */
+    sigemptyset(&sigdefault);
+    sigaddset(&sigdefault, SIGPIPE);
+    posix_spawnattr_setsigdefault(&self->attr, &sigdefault);
+
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+
+    posix_spawnattr_setflags(&self->attr, flags);
+
+    return 0;
+}
+
 static int
-_spawn_run(zlmb_spawn_t *self, char *command, int argc, char **argv, int opt)
+_spawn_run(zlmb_spawn_t *self, zlmb_exec_t *exec, int capture)
 {
     pid_t pid;
-    int ret, in[2];
-    int i, n = argc - opt;
-    char *env[] = { NULL, NULL, NULL, NULL };
-    char **arg = NULL;
+    int ret, in[2], out[2] = { -1, -1 };
+    char *env[] = { NULL, NULL, NULL, NULL, NULL, NULL };
+    char *command;
     posix_spawn_file_actions_t actions;
 
-    if (!self || !command || strlen(command) <= 0) {
+    if (!self || !exec || !exec->argv) {
         _ERR("Function arguments: %s\n", __FUNCTION__);
         return -1;
     }
 
+    command = exec->argv[0];
+
     env[0] = self->frame;
     env[1] = self->frame_length;
     env[2] = self->length;
+    if (self->memfd != -1) {
+        env[3] = ZLMB_WORKER_MEMFD_ENV;
+        env[4] = self->frame_offset;
+    }
 
-    if (n < 0) {
-        n = 0;
+    /* memfd: read from the beginning (retry) */
+    if (self->memfd != -1) {
+        lseek(self->memfd, 0, SEEK_SET);
     }
 
-    arg = malloc(sizeof(char *) * (n + 2));
-    if (arg == NULL) {
-        _ERR("Memory allocate args.\n");
+    /* close-on-exec: not inherited by commands of the other threads */
+    if (pipe2(in, O_CLOEXEC) == -1) {
+        _ERR("Create STDIN pipe.\n");
+        return -1;
+    }
+
+    if (capture && pipe2(out, O_CLOEXEC) == -1) {
+        _ERR("Create STDOUT pipe.\n");
+        close(in[0]);
+        close(in[1]);
+        return -1;
+    }
+
+    if (posix_spawn_file_actions_init(&actions) != 0) {
+        _ERR("POSIX spawn file action initilize.\n");
+        _spawn_close(in, out);
+        return -1;
+    }
+
+    if (posix_spawn_file_actions_addclose(&actions, in[1]) != 0 ||
+        posix_spawn_file_actions_adddup2(&actions, in[0], 0) != 0 ||
+        (capture &&
+         posix_spawn_file_actions_adddup2(&actions, out[1], 1) != 0) ||
+        (self->memfd != -1 &&
+         posix_spawn_file_actions_adddup2(&actions, self->memfd,
+                                          ZLMB_WORKER_MEMFD) != 0)) {
+        _ERR("POSIX spawn file action add.\n");
+        posix_spawn_file_actions_destroy(&actions);
+        _spawn_close(in, out);
+        return -1;
+    }
+
+    _DEBUG("POSIX spawn run: %s\n", command);
+
+    if (exec->path) {
+        ret = posix_spawn(&pid, exec->path, &actions, &exec->attr,
+                          exec->argv, env);
+    } else {
+        ret = posix_spawnp(&pid, command, &actions, &exec->attr,
+                           exec->argv, env);
+    }
+    if (ret != 0) {
+        _ERR("POSIX spawn: %s: %s\n", command, strerror(ret));
+        posix_spawn_file_actions_destroy(&actions);
+        _spawn_close(in, out);
         return -1;
     }
-    if (n > 0) {
-        for (i = 0; i != n; i++) {
-            arg[i+1] = argv[opt+i];
+
+    close(in[0]);
+
+    if (capture) {
+        close(out[1]);
+
+        /* memfd: stdin is closed */
+        if (self->memfd != -1) {
+            close(in[1]);
+            in[1] = -1;
+        }
+
+        _spawn_io(self, in[1], out[0]);
+    } else if (self->memfd == -1) {
+        /* memfd: stdin is closed (frames are kept for a retry) */
+        zlmb_stack_item_t *item = zlmb_stack_first(self->stack);
+        while (item) {
+            zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+            if (zmsg) {
+                write(in[1], zmq_msg_data(zmsg), zmq_msg_size(zmsg));
+            }
+            item = zlmb_stack_item_next(item);
+        }
+    }
+
+    if (!capture) {
+        close(in[1]);
+    }
+
+    _DEBUG("POSIX spawn wait(#%d).\n", pid);
+    while (waitpid(pid, &ret, 0) == -1) {
+        if (errno != EINTR) {
+            ret = -1;
+            break;
+        }
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    _DEBUG("POSIX spawn finish(#%d).\n", pid);
+
+    /* exit status: 0 only */
+    if (ret != -1 && WIFEXITED(ret) && WEXITSTATUS(ret) == 0) {
+        return 0;
+    }
+
+    if (ret != -1 && WIFSIGNALED(ret)) {
+        _ERR("Command signaled: %s: %d\n", command, WTERMSIG(ret));
+    } else if (ret != -1 && WIFEXITED(ret)) {
+        _ERR("Command exit: %s: %d\n", command, WEXITSTATUS(ret));
+    } else {
+        _ERR("Command wait: %s\n", command);
+    }
+
+    return -1;
+}
+
+static int
+_fastcgi_output(void *arg, int type, const char *buf, size_t len)
+{
+    if (type == ZLMB_FASTCGI_STDERR) {
+        _NOTICE("FastCGI stderr: %.*s\n", (int)len, buf);
+        return 0;
+    }
+
+    return _spawn_output((zlmb_spawn_t *)arg, buf, len);
+}
+
+/* fastcgi: same environ as a command, CGI response in output (body) */
+static int
+_fastcgi_run(zlmb_spawn_t *self, zlmb_exec_t *exec)
+{
+    char length[32], *command = exec->argv[0];
+    char *params[] = { exec->script_filename, exec->script_name,
+                       "REQUEST_METHOD=POST",
+                       "CONTENT_TYPE=application/octet-stream",
+                       "GATEWAY_INTERFACE=CGI/1.1",
+                       "SERVER_SOFTWARE=" ZLMB_SYSLOG_IDENT,
+                       length, self->frame, self->length,
+                       self->frame_length, NULL };
+    struct iovec iovs[ZLMB_WORKER_FASTCGI_IOV], *iov = iovs;
+    size_t count = zlmb_stack_size(self->stack), offset = 0;
+    zlmb_stack_item_t *item;
+    int n = 0, ret, status = 0, code;
+
+    snprintf(length, sizeof(length), "CONTENT_LENGTH=%ld", (long)self->size);
+
+    if (count > ZLMB_WORKER_FASTCGI_IOV) {
+        iov = (struct iovec *)malloc(sizeof(struct iovec) * count);
+        if (!iov) {
+            _ERR("Memory allocate iovec.\n");
+            return -1;
+        }
+    }
+
+    item = zlmb_stack_first(self->stack);
+    while (item && (size_t)n < count) {
+        zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+        if (zmsg) {
+            iov[n].iov_base = zmq_msg_data(zmsg);
+            iov[n].iov_len = zmq_msg_size(zmsg);
+            n++;
+        }
+        item = zlmb_stack_item_next(item);
+    }
+
+    _DEBUG("FastCGI request: %s\n", command);
+
+    ret = zlmb_fastcgi_request(exec->fastcgi, params, iov, n,
+                               _fastcgi_output, self, &status);
+
+    if (iov != iovs) {
+        free(iov);
+    }
+
+    if (ret != 0) {
+        _ERR("FastCGI request: %s: %s: %s\n",
+             exec->fastcgi->endpoint, command, strerror(errno));
+        return -1;
+    }
+
+    /* output: body without the headers */
+    code = zlmb_fastcgi_response(self->output, self->output_length, &offset);
+    if (offset > 0) {
+        memmove(self->output, self->output + offset,
+                self->output_length - offset);
+        self->output_length -= offset;
+    }
+
+    if (status != 0 || code < 200 || code >= 300) {
+        _ERR("FastCGI response: %s: status %d, exit %d\n",
+             command, code, status);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+_stack_destroy(zlmb_stack_t **stack)
+{
+    while (zlmb_stack_size(*stack)) {
+        zmq_msg_t *zmsg = zlmb_stack_shift(*stack);
+        if (zmsg) {
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+    }
+    zlmb_stack_destroy(stack);
+}
+
+static void
+_spawn_destroy(zlmb_spawn_t *self)
+{
+    if (self->stack) {
+        _stack_destroy(&self->stack);
+    }
+    if (self->frame) {
+        free(self->frame);
+    }
+    if (self->frame_length) {
+        free(self->frame_length);
+    }
+    if (self->length) {
+        free(self->length);
+    }
+    if (self->frame_offset) {
+        free(self->frame_offset);
+    }
+    if (self->output) {
+        free(self->output);
+    }
+    if (self->memfd != -1) {
+        close(self->memfd);
+    }
+}
+
+static void *
+_worker_socket(zlmb_worker_t *worker)
+{
+    void *socket;
+
+    socket = zmq_socket(worker->context, ZMQ_PULL);
+    if (!socket) {
+        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
+        return NULL;
+    }
+
+    if (zmq_connect(socket, worker->endpoint) == -1) {
+        _ERR("ZeroMQ socket connect: %s: %s\n",
+             worker->endpoint, zmq_strerror(errno));
+        zmq_close(socket);
+        return NULL;
+    }
+
+    _VERBOSE("ZeroMQ socket connect: %s\n", worker->endpoint);
+
+    return socket;
+}
+
+/* one message: frames in the stack */
+static int
+_worker_recv(void *socket, zlmb_stack_t *stack)
+{
+    int more;
+    size_t moresz = sizeof(more);
+
+    while (!_interrupted) {
+        zmq_msg_t *zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
+        if (!zmsg) {
+            return -1;
+        }
+
+        _DEBUG("ZeroMQ receive message.\n");
+
+        if (zmq_msg_init(zmsg) != 0) {
+            free(zmsg);
+            return -1;
+        }
+
+        if (zmq_recvmsg(socket, zmsg, 0) == -1) {
+            _ERR("ZeroMQ socket receive: %s\n", zmq_strerror(errno));
+            zmq_msg_close(zmsg);
+            free(zmsg);
+            return -1;
+        }
+
+        if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            _ERR("ZeroMQ socket option receive: %s\n", zmq_strerror(errno));
+            more = 0;
+        }
+
+        if (zlmb_stack_push(stack, zmsg) != 0) {
+            _ERR("Message stack push.\n");
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+
+        if (!more) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/* dead letter: failed message to the dump file (shared by the threads) */
+static void
+_worker_deadletter(zlmb_worker_t *worker, zlmb_spawn_t *spawn)
+{
+    zlmb_stack_item_t *item;
+
+    worker->deadletters++;
+    __sync_fetch_and_add(&worker->completed, 1);
+
+    if (!worker->deadletter) {
+        _ERR("Drop message: %s\n", worker->command);
+        return;
+    }
+
+    _NOTICE("Message in dead letter: %s\n", worker->deadletter->filename);
+
+    pthread_mutex_lock(&_deadletter_mutex);
+
+    item = zlmb_stack_first(spawn->stack);
+    while (item) {
+        zlmb_stack_item_t *next = zlmb_stack_item_next(item);
+        zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+        if (zmsg &&
+            zlmb_dump_write(worker->deadletter, zmsg,
+                            next ? ZMQ_SNDMORE : 0) == -1) {
+            zlmb_dump_close(worker->deadletter);
+            _ERR("Output message dead letter: %s\n",
+                 worker->deadletter->filename);
+            break;
+        }
+        item = next;
+    }
+
+    pthread_mutex_unlock(&_deadletter_mutex);
+}
+
+/* backoff: doubled for each attempt (msec) */
+static uint64_t
+_worker_backoff(zlmb_worker_t *worker, int attempts)
+{
+    uint64_t backoff;
+    int shift = attempts - 1;
+
+    if (shift > 16) {
+        shift = 16;
+    }
+    backoff = (uint64_t)worker->backoff << shift;
+    if (backoff > ZLMB_WORKER_BACKOFF_MAX) {
+        backoff = ZLMB_WORKER_BACKOFF_MAX;
+    }
+
+    return backoff;
+}
+
+/* failed: retry queue (ordered by due time) or dead letter */
+static void
+_worker_failure(zlmb_worker_t *worker, zlmb_retry_t **queue, size_t *size,
+                zlmb_spawn_t *spawn, int attempts)
+{
+    zlmb_retry_t *retry, **pos;
+    uint64_t backoff;
+
+    if (attempts > worker->retry || *size >= ZLMB_WORKER_RETRY_QUEUE) {
+        _worker_deadletter(worker, spawn);
+        _spawn_destroy(spawn);
+        return;
+    }
+
+    retry = (zlmb_retry_t *)malloc(sizeof(zlmb_retry_t));
+    if (!retry) {
+        _ERR("Memory allocate retry.\n");
+        _worker_deadletter(worker, spawn);
+        _spawn_destroy(spawn);
+        return;
+    }
+
+    backoff = _worker_backoff(worker, attempts);
+
+    retry->spawn = *spawn;
+    retry->attempts = attempts;
+    retry->due = zlmb_utils_clock() + backoff * 1000;
+
+    pos = queue;
+    while (*pos && (*pos)->due <= retry->due) {
+        pos = &(*pos)->next;
+    }
+    retry->next = *pos;
+    *pos = retry;
+    (*size)++;
+
+    worker->retries++;
+
+    _DEBUG("Retry message: attempts=%d backoff=%llu msec\n",
+           attempts, (unsigned long long)backoff);
+}
+
+/* output: records of the command stdout as new messages (dropped when the
+ * endpoint is down or slow, never blocks the command thread) */
+static void
+_worker_output(zlmb_worker_t *worker, void *socket, zlmb_spawn_t *spawn)
+{
+    char *data = spawn->output;
+    size_t left = spawn->output_length;
+    long dropped = 0;
+
+    while (left > 0) {
+        char *record = data;
+        size_t len;
+
+        if (worker->format == ZLMB_WORKER_OUTPUT_LENGTH) {
+            /* length: 4 bytes, big endian */
+            unsigned char *p = (unsigned char *)data;
+            if (left < 4) {
+                _ERR("Output record: truncated header\n");
+                break;
+            }
+            len = ((size_t)p[0] << 24) | ((size_t)p[1] << 16)
+                | ((size_t)p[2] << 8) | (size_t)p[3];
+            if (left - 4 < len) {
+                _ERR("Output record: truncated (%ld bytes)\n", (long)len);
+                break;
+            }
+            record = data + 4;
+            data += 4 + len;
+            left -= 4 + len;
+        } else {
+            char *eol = memchr(data, '\n', left);
+            len = eol ? (size_t)(eol - data) : left;
+            data += eol ? len + 1 : len;
+            left -= eol ? len + 1 : len;
+            if (len == 0) {
+                continue;
+            }
+        }
+
+        if (zmq_send(socket, record, len, ZMQ_DONTWAIT) == -1) {
+            if (errno == EAGAIN) {
+                dropped++;
+                continue;
+            }
+            _ERR("ZeroMQ output send: %s\n", zmq_strerror(errno));
+            break;
+        }
+
+        worker->outputs++;
+    }
+
+    if (dropped > 0) {
+        worker->outputs_dropped += dropped;
+        _ERR("Drop output records: %s: %ld\n", worker->output, dropped);
+    }
+}
+
+static int
+_worker_run(zlmb_worker_t *worker, zlmb_exec_t *exec, void *output,
+            zlmb_spawn_t *spawn)
+{
+    uint64_t start = zlmb_utils_clock();
+    int ret;
+
+    spawn->output_length = 0;
+
+    if (exec->fastcgi) {
+        ret = _fastcgi_run(spawn, exec);
+    } else {
+        ret = _spawn_run(spawn, exec, output != NULL);
+    }
+
+    /* output: successful command only (no duplicate on retry) */
+    if (ret == 0 && output) {
+        _worker_output(worker, output, spawn);
+    }
+
+    worker->messages++;
+    worker->elapsed += zlmb_utils_clock() - start;
+
+    return ret;
+}
+
+static void *
+_worker_output_socket(zlmb_worker_t *worker)
+{
+    void *socket;
+    int linger = ZLMB_WORKER_OUTPUT_LINGER;
+
+    socket = zmq_socket(worker->context, ZMQ_PUSH);
+    if (!socket) {
+        _ERR("ZeroMQ output socket: %s\n", zmq_strerror(errno));
+        return NULL;
+    }
+
+    /* exit: unsent records are not waited forever */
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+    if (zmq_connect(socket, worker->output) == -1) {
+        _ERR("ZeroMQ output connect: %s: %s\n",
+             worker->output, zmq_strerror(errno));
+        zmq_close(socket);
+        return NULL;
+    }
+
+    _VERBOSE("ZeroMQ output connect: %s\n", worker->output);
+
+    return socket;
+}
+
+static void *
+_worker_command(void *arg)
+{
+    zlmb_worker_t *worker = (zlmb_worker_t *)arg;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_retry_t *queue = NULL;
+    zlmb_exec_t exec;
+    size_t size = 0;
+    void *socket, *output = NULL;
+
+    if (!worker || !worker->context || !worker->command) {
+        _ERR("Function arguments: %s\n", __FUNCTION__);
+        return NULL;
+    }
+
+    if (_exec_init(&exec, worker) != 0) {
+        return NULL;
+    }
+
+    socket = _worker_socket(worker);
+    if (!socket) {
+        _exec_destroy(&exec);
+        return NULL;
+    }
+
+    if (worker->output) {
+        output = _worker_output_socket(worker);
+        if (!output) {
+            zmq_close(socket);
+            _exec_destroy(&exec);
+            return NULL;
+        }
+    }
+
+    _VERBOSE("ZeroMQ start worker command proxy.\n");
+
+    pollitems[0].socket = socket;
+
+    _signals();
+
+    while (!_interrupted) {
+        long timeout = -1;
+
+        /* retry: wake up at the first due time */
+        if (queue) {
+            uint64_t now = zlmb_utils_clock();
+            timeout = 0;
+            if (queue->due > now) {
+                timeout = (long)((queue->due - now) / 1000) + 1;
+            }
+        }
+
+        if (zmq_poll(pollitems, 1, timeout) == -1) {
+            break;
+        }
+
+        /* fresh message first, one retry per turn */
+        if (pollitems[0].revents & ZMQ_POLLIN) {
+            zlmb_spawn_t spawn = { NULL, NULL, NULL, NULL, 0, -1, NULL,
+                                   NULL, 0, 0 };
+
+            _DEBUG("ZeroMQ receive in poll event.\n");
+
+            spawn.stack = zlmb_stack_init();
+            if (!spawn.stack) {
+                _ERR("Message stack initilize.\n");
+                break;
+            }
+
+            _worker_recv(socket, spawn.stack);
+
+            //env
+            _spawn_generate_environ(&spawn);
+
+            //memfd: large message (stdin on error)
+            if (worker->memfd > 0 && spawn.size >= worker->memfd) {
+                _spawn_memfd(&spawn);
+            }
+
+            //spawn
+            if (_worker_run(worker, &exec, output, &spawn) == 0) {
+                _spawn_destroy(&spawn);
+                __sync_fetch_and_add(&worker->completed, 1);
+            } else {
+                _worker_failure(worker, &queue, &size, &spawn, 1);
+            }
+        }
+
+        if (queue && queue->due <= zlmb_utils_clock() && !_interrupted) {
+            zlmb_retry_t *retry = queue;
+
+            queue = retry->next;
+            size--;
+
+            _DEBUG("Retry run: attempts=%d\n", retry->attempts + 1);
+
+            if (_worker_run(worker, &exec, output, &retry->spawn) == 0) {
+                _spawn_destroy(&retry->spawn);
+                __sync_fetch_and_add(&worker->completed, 1);
+            } else {
+                _worker_failure(worker, &queue, &size, &retry->spawn,
+                                retry->attempts + 1);
+            }
+
+            free(retry);
+        }
+    }
+
+    /* retry queue: not lost at exit */
+    if (size > 0) {
+        _NOTICE("Retry queue: %ld messages to dead letter\n", (long)size);
+    }
+    while (queue) {
+        zlmb_retry_t *retry = queue;
+        queue = retry->next;
+        _worker_deadletter(worker, &retry->spawn);
+        _spawn_destroy(&retry->spawn);
+        free(retry);
+    }
+
+    _VERBOSE("ZeroMQ end worker command proxy.\n");
+
+    if (output) {
+        zmq_close(output);
+    }
+
+    zmq_close(socket);
+
+    _exec_destroy(&exec);
+
+    return NULL;
+}
+
+/* sink: messages appended to files per key (route) */
+static void *
+_worker_sink(void *arg)
+{
+    zlmb_worker_t *worker = (zlmb_worker_t *)arg;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_sink_t *sink;
+    void *socket;
+
+    if (!worker || !worker->context || !worker->command) {
+        _ERR("Function arguments: %s\n", __FUNCTION__);
+        return NULL;
+    }
+
+    sink = zlmb_sink_init(worker->command, 0, 0, NULL,
+                          ZLMB_SINK_DEFAULT_SYNC, 0);
+    if (!sink) {
+        _ERR("Sink initilize: %s: %s\n", worker->command, strerror(errno));
+        return NULL;
+    }
+
+    socket = _worker_socket(worker);
+    if (!socket) {
+        zlmb_sink_destroy(&sink);
+        return NULL;
+    }
+
+    _VERBOSE("ZeroMQ start worker sink: %s\n", worker->command);
+
+    pollitems[0].socket = socket;
+
+    _signals();
+
+    while (!_interrupted) {
+        if (zmq_poll(pollitems, 1, zlmb_sink_timeout(sink)) == -1) {
+            break;
+        }
+
+        if (pollitems[0].revents & ZMQ_POLLIN) {
+            zlmb_spawn_t spawn = { NULL, NULL, NULL, NULL, 0, -1, NULL,
+                                   NULL, 0, 0 };
+
+            spawn.stack = zlmb_stack_init();
+            if (!spawn.stack) {
+                _ERR("Message stack initilize.\n");
+                break;
+            }
+
+            if (_worker_recv(socket, spawn.stack) == 0) {
+                if (zlmb_sink_write(sink, spawn.stack) == -1) {
+                    _ERR("Sink write: %s\n", worker->command);
+                }
+                worker->messages++;
+                __sync_fetch_and_add(&worker->completed, 1);
+            }
+
+            /* sink: frames are copied */
+            _spawn_destroy(&spawn);
+        }
+
+        if (zlmb_sink_flush(sink, 0) == -1) {
+            _ERR("Sink write: %s: %s\n", worker->command, strerror(errno));
+        }
+    }
+
+    if (zlmb_sink_flush(sink, 1) == -1) {
+        _ERR("Sink write: %s: %s\n", worker->command, strerror(errno));
+    }
+
+    _VERBOSE("ZeroMQ end worker sink.\n");
+
+    zmq_close(socket);
+
+    zlmb_sink_destroy(&sink);
+
+    return NULL;
+}
+
+static void
+_batch_clear(zlmb_batch_t *self, size_t from)
+{
+    while (self->nframes > from) {
+        self->nframes--;
+        zmq_msg_close(self->zmsgs[self->nframes]);
+    }
+}
+
+static void
+_batch_destroy(zlmb_batch_t *self)
+{
+    size_t i;
+
+    _batch_clear(self, 0);
+
+    for (i = 0; i < self->size; i++) {
+        if (self->zmsgs[i]) {
+            free(self->zmsgs[i]);
+        }
+    }
+    if (self->zmsgs) {
+        free(self->zmsgs);
+    }
+    if (self->frames) {
+        free(self->frames);
+    }
+}
+
+static int
+_batch_reserve(zlmb_batch_t *self)
+{
+    size_t size;
+    void *tmp;
+
+    if (self->nframes < self->size) {
+        return 0;
+    }
+
+    size = self->size ? self->size * 2 : ZLMB_WORKER_PLUGIN_BATCH;
+
+    tmp = realloc(self->zmsgs, sizeof(zmq_msg_t *) * size);
+    if (!tmp) {
+        return -1;
+    }
+    self->zmsgs = (zmq_msg_t **)tmp;
+    memset(self->zmsgs + self->size, 0,
+           sizeof(zmq_msg_t *) * (size - self->size));
+
+    tmp = realloc(self->frames, sizeof(zlmb_plugin_frame_t) * size);
+    if (!tmp) {
+        return -1;
+    }
+    self->frames = (zlmb_plugin_frame_t *)tmp;
+
+    self->size = size;
+
+    return 0;
+}
+
+/* one message: 1 received, 0 none (flags: ZMQ_DONTWAIT), -1 error */
+static int
+_batch_recv(zlmb_batch_t *self, void *socket, int flags)
+{
+    int more = 1;
+    size_t moresz = sizeof(more);
+    size_t start = self->nframes;
+
+    while (more) {
+        zmq_msg_t *zmsg;
+
+        if (_batch_reserve(self) != 0) {
+            _ERR("Memory allocate batch.\n");
+            _batch_clear(self, start);
+            return -1;
+        }
+
+        zmsg = self->zmsgs[self->nframes];
+        if (!zmsg) {
+            zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
+            if (!zmsg) {
+                _ERR("Memory allocate batch.\n");
+                _batch_clear(self, start);
+                return -1;
+            }
+            self->zmsgs[self->nframes] = zmsg;
+        }
+
+        if (zmq_msg_init(zmsg) != 0) {
+            _batch_clear(self, start);
+            return -1;
+        }
+
+        if (zmq_recvmsg(socket, zmsg, flags) == -1) {
+            zmq_msg_close(zmsg);
+            if (errno == EAGAIN && self->nframes == start) {
+                return 0;
+            }
+            if (errno != EINTR) {
+                _ERR("ZeroMQ socket receive: %s\n", zmq_strerror(errno));
+            }
+            _batch_clear(self, start);
+            return -1;
+        }
+
+        self->nframes++;
+
+        if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
+            _ERR("ZeroMQ socket option receive: %s\n", zmq_strerror(errno));
+            more = 0;
+        }
+
+        /* rest of the message: already arrived */
+        flags = 0;
+    }
+
+    self->offsets[self->count] = start;
+    self->messages[self->count].count = self->nframes - start;
+    self->count++;
+
+    return 1;
+}
+
+static int
+_batch_run(zlmb_batch_t *self, zlmb_plugin_t *plugin, void *state)
+{
+    size_t i;
+    int ret;
+
+    /* frames: data of the received messages */
+    for (i = 0; i < self->nframes; i++) {
+        self->frames[i].data = zmq_msg_data(self->zmsgs[i]);
+        self->frames[i].size = zmq_msg_size(self->zmsgs[i]);
+    }
+    for (i = 0; i < self->count; i++) {
+        self->messages[i].frames = self->frames + self->offsets[i];
+    }
+
+    _DEBUG("Plugin batch: %ld messages (%ld frames)\n",
+           (long)self->count, (long)self->nframes);
+
+    ret = plugin->batch(state, self->messages, self->count);
+    if (ret != 0) {
+        _ERR("Plugin batch: %s\n", plugin->name ? plugin->name : "-");
+    }
+
+    _batch_clear(self, 0);
+    self->count = 0;
+
+    return ret;
+}
+
+static void *
+_worker_plugin(void *arg)
+{
+    zlmb_worker_t *worker = (zlmb_worker_t *)arg;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_batch_t batch;
+    zlmb_plugin_t *plugin;
+    void *socket, *state = NULL;
+    char **args;
+    int i, n;
+
+    if (!worker || !worker->context || !worker->plugin) {
+        _ERR("Function arguments: %s\n", __FUNCTION__);
+        return NULL;
+    }
+
+    plugin = worker->plugin;
+
+    /* init: plugin path and ARGS (like a command) */
+    n = worker->argc - worker->optind;
+    if (n < 0) {
+        n = 0;
+    }
+
+    args = (char **)malloc(sizeof(char *) * (n + 2));
+    if (!args) {
+        _ERR("Memory allocate args.\n");
+        return NULL;
+    }
+    args[0] = worker->command;
+    for (i = 0; i < n; i++) {
+        args[i + 1] = worker->argv[worker->optind + i];
+    }
+    args[n + 1] = NULL;
+
+    if (plugin->init) {
+        state = plugin->init(n + 1, args);
+        if (!state) {
+            _ERR("Plugin initilize: %s\n", worker->command);
+            free(args);
+            return NULL;
+        }
+    }
+
+    socket = _worker_socket(worker);
+    if (!socket) {
+        if (plugin->shutdown) {
+            plugin->shutdown(state);
+        }
+        free(args);
+        return NULL;
+    }
+
+    _VERBOSE("ZeroMQ start worker plugin: %s\n",
+             plugin->name ? plugin->name : worker->command);
+
+    memset(&batch, 0, sizeof(batch));
+
+    pollitems[0].socket = socket;
+
+    _signals();
+
+    while (!_interrupted) {
+        uint64_t start;
+        int ret = 1;
+
+        if (zmq_poll(pollitems, 1, -1) == -1) {
+            break;
+        }
+
+        if (!(pollitems[0].revents & ZMQ_POLLIN)) {
+            continue;
+        }
+
+        start = zlmb_utils_clock();
+
+        /* batch: messages that have already arrived */
+        while (batch.count < ZLMB_WORKER_PLUGIN_BATCH && !_interrupted) {
+            ret = _batch_recv(&batch, socket, ZMQ_DONTWAIT);
+            if (ret != 1) {
+                break;
+            }
+        }
+
+        if (batch.count > 0) {
+            size_t count = batch.count;
+            worker->messages += count;
+            _batch_run(&batch, plugin, state);
+            __sync_fetch_and_add(&worker->completed, count);
+        }
+
+        /* idle: nothing left to receive */
+        if (ret != 1 && plugin->flush && plugin->flush(state) != 0) {
+            _ERR("Plugin flush: %s\n", plugin->name ? plugin->name : "-");
+        }
+
+        worker->elapsed += zlmb_utils_clock() - start;
+    }
+
+    if (plugin->flush && plugin->flush(state) != 0) {
+        _ERR("Plugin flush: %s\n", plugin->name ? plugin->name : "-");
+    }
+
+    _VERBOSE("ZeroMQ end worker plugin.\n");
+
+    _batch_destroy(&batch);
+
+    zmq_close(socket);
+
+    if (plugin->shutdown) {
+        plugin->shutdown(state);
+    }
+
+    free(args);
+
+    return NULL;
+}
+
+static int
+_post_append(zlmb_post_t *self, const char *data, size_t len)
+{
+    if (self->length + len > self->size) {
+        size_t size = self->size ? self->size : BUFSIZ;
+        void *tmp;
+
+        while (self->length + len > size) {
+            size *= 2;
+        }
+
+        tmp = realloc(self->body, size);
+        if (!tmp) {
+            _ERR("Memory allocate webhook body.\n");
+            return -1;
+        }
+        self->body = (char *)tmp;
+        self->size = size;
+    }
+
+    memcpy(self->body + self->length, data, len);
+    self->length += len;
+
+    return 0;
+}
+
+/* JSON string: control characters, quote and backslash escaped */
+static int
+_post_json(zlmb_post_t *self, const unsigned char *data, size_t len)
+{
+    size_t i, start = 0;
+    char escape[8];
+
+    if (_post_append(self, "\"", 1) != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < len; i++) {
+        if (data[i] >= 0x20 && data[i] != '"' && data[i] != '\\') {
+            continue;
+        }
+
+        if (data[i] == '"' || data[i] == '\\') {
+            snprintf(escape, sizeof(escape), "\\%c", data[i]);
+        } else if (data[i] == '\n') {
+            snprintf(escape, sizeof(escape), "\\n");
+        } else if (data[i] == '\t') {
+            snprintf(escape, sizeof(escape), "\\t");
+        } else {
+            snprintf(escape, sizeof(escape), "\\u%04x", data[i]);
+        }
+
+        if (_post_append(self, (const char *)data + start, i - start) != 0 ||
+            _post_append(self, escape, strlen(escape)) != 0) {
+            return -1;
+        }
+        start = i + 1;
+    }
+
+    if (_post_append(self, (const char *)data + start, len - start) != 0) {
+        return -1;
+    }
+
+    return _post_append(self, "\"", 1);
+}
+
+/* NDJSON: ["frame", ...] per message */
+static int
+_post_body(zlmb_post_t *self)
+{
+    zlmb_batch_t *batch = &self->batch;
+    size_t i, j;
+
+    self->length = 0;
+
+    for (i = 0; i < batch->count; i++) {
+        size_t offset = batch->offsets[i];
+
+        if (_post_append(self, "[", 1) != 0) {
+            return -1;
+        }
+
+        for (j = 0; j < batch->messages[i].count; j++) {
+            zmq_msg_t *zmsg = batch->zmsgs[offset + j];
+            if ((j > 0 && _post_append(self, ",", 1) != 0) ||
+                _post_json(self, zmq_msg_data(zmsg),
+                           zmq_msg_size(zmsg)) != 0) {
+                return -1;
+            }
+        }
+
+        if (_post_append(self, "]\n", 2) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+_post_clear(zlmb_post_t *self)
+{
+    _batch_clear(&self->batch, 0);
+    self->batch.count = 0;
+    self->length = 0;
+    self->attempts = 0;
+    self->state = ZLMB_WORKER_POST_FREE;
+}
+
+/* dead letter: messages of the batch */
+static void
+_post_deadletter(zlmb_worker_t *worker, zlmb_post_t *post)
+{
+    zlmb_batch_t *batch = &post->batch;
+    size_t i, j;
+    int ret = 0;
+
+    worker->deadletters += batch->count;
+    __sync_fetch_and_add(&worker->completed, batch->count);
+
+    if (!worker->deadletter) {
+        _ERR("Drop messages: %s: %ld\n", worker->command, (long)batch->count);
+        _post_clear(post);
+        return;
+    }
+
+    _NOTICE("Messages in dead letter: %s\n", worker->deadletter->filename);
+
+    pthread_mutex_lock(&_deadletter_mutex);
+
+    for (i = 0; i < batch->count && ret == 0; i++) {
+        size_t count = batch->messages[i].count;
+        for (j = 0; j < count && ret == 0; j++) {
+            ret = zlmb_dump_write(worker->deadletter,
+                                  batch->zmsgs[batch->offsets[i] + j],
+                                  j + 1 < count ? ZMQ_SNDMORE : 0);
+        }
+    }
+
+    if (ret == -1) {
+        zlmb_dump_close(worker->deadletter);
+        _ERR("Output message dead letter: %s\n",
+             worker->deadletter->filename);
+    }
+
+    pthread_mutex_unlock(&_deadletter_mutex);
+
+    _post_clear(post);
+}
+
+/* failed: sent again after the backoff (all batches wait) or dead letter */
+static void
+_post_failure(zlmb_worker_t *worker, zlmb_post_t *post, uint64_t *due)
+{
+    post->attempts++;
+
+    if (post->attempts > worker->retry) {
+        _post_deadletter(worker, post);
+        return;
+    }
+
+    post->state = ZLMB_WORKER_POST_PENDING;
+    worker->retries++;
+
+    *due = zlmb_utils_clock()
+        + _worker_backoff(worker, post->attempts) * 1000;
+}
+
+/* connection closed: sent batches without a response are sent again
+ * (not counted as attempts) */
+static void
+_post_resend(zlmb_post_t *posts)
+{
+    int i;
+
+    for (i = 0; i < ZLMB_WORKER_HTTP_PIPELINE; i++) {
+        if (posts[i].state == ZLMB_WORKER_POST_SENT) {
+            posts[i].state = ZLMB_WORKER_POST_PENDING;
+        }
+    }
+}
+
+/* kept connection closed by the server: not counted as a failure */
+static int
+_post_lost(zlmb_post_t *post, int err)
+{
+    return post->reused &&
+        (err == EPIPE || err == ECONNRESET || err == ENOTCONN);
+}
+
+/* retrying: a failed batch is sent alone (not pipelined) until it succeeds */
+static int
+_post_retrying(zlmb_post_t *posts)
+{
+    int i;
+
+    for (i = 0; i < ZLMB_WORKER_HTTP_PIPELINE; i++) {
+        if (posts[i].state != ZLMB_WORKER_POST_FREE && posts[i].attempts > 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static zlmb_post_t *
+_post_oldest(zlmb_post_t *posts, int state)
+{
+    zlmb_post_t *post = NULL;
+    int i;
+
+    for (i = 0; i < ZLMB_WORKER_HTTP_PIPELINE; i++) {
+        if (posts[i].state != state) {
+            continue;
+        }
+        if (!post ||
+            (state == ZLMB_WORKER_POST_SENT && posts[i].seq < post->seq) ||
+            (state != ZLMB_WORKER_POST_SENT && posts[i].order < post->order)) {
+            post = &posts[i];
+        }
+    }
+
+    return post;
+}
+
+/* webhook: batches posted to the URL (command), responses in order */
+static void *
+_worker_http(void *arg)
+{
+    zlmb_worker_t *worker = (zlmb_worker_t *)arg;
+    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
+    zlmb_post_t posts[ZLMB_WORKER_HTTP_PIPELINE];
+    zlmb_http_t *http;
+    uint64_t order = 0, seq = 0, due = 0;
+    void *socket;
+    int i;
+
+    if (!worker || !worker->context || !worker->command) {
+        _ERR("Function arguments: %s\n", __FUNCTION__);
+        return NULL;
+    }
+
+    http = zlmb_http_init(worker->command, worker->timeout);
+    if (!http) {
+        _ERR("Webhook initilize: %s: %s\n", worker->command, strerror(errno));
+        return NULL;
+    }
+
+    socket = _worker_socket(worker);
+    if (!socket) {
+        zlmb_http_destroy(&http);
+        return NULL;
+    }
+
+    _VERBOSE("ZeroMQ start worker webhook: %s\n", worker->command);
+
+    memset(posts, 0, sizeof(posts));
+
+    pollitems[0].socket = socket;
+
+    _signals();
+
+    while (!_interrupted) {
+        zlmb_post_t *pending, *sent, *empty;
+        uint64_t now = zlmb_utils_clock();
+        int status = 0;
+
+        pending = _post_oldest(posts, ZLMB_WORKER_POST_PENDING);
+        sent = _post_oldest(posts, ZLMB_WORKER_POST_SENT);
+        empty = _post_oldest(posts, ZLMB_WORKER_POST_FREE);
+
+        /* send: pipelined, oldest batch first (after the backoff),
+         * one at a time while retrying */
+        if (pending && due <= now && !(sent && _post_retrying(posts))) {
+            int ret = zlmb_http_send(http, ZLMB_WORKER_HTTP_TYPE,
+                                     pending->body, pending->length);
+            int err = errno;
+
+            pending->reused = http->reused;
+
+            if (ret == 0) {
+                pending->state = ZLMB_WORKER_POST_SENT;
+                pending->seq = ++seq;
+            } else {
+                _ERR("Webhook send: %s: %s\n",
+                     worker->command, strerror(err));
+                _post_resend(posts);
+                if (!_post_lost(pending, err)) {
+                    _post_failure(worker, pending, &due);
+                }
+            }
+            worker->elapsed += zlmb_utils_clock() - now;
+            continue;
+        }
+
+        /* batch: messages that have already arrived (no new batch while
+         * waiting for the backoff) */
+        if (empty && !pending) {
+            if (zmq_poll(pollitems, 1, sent ? 0 : -1) == -1) {
+                break;
+            }
+
+            if (pollitems[0].revents & ZMQ_POLLIN) {
+                while (empty->batch.count < ZLMB_WORKER_PLUGIN_BATCH &&
+                       !_interrupted) {
+                    if (_batch_recv(&empty->batch, socket,
+                                    ZMQ_DONTWAIT) != 1) {
+                        break;
+                    }
+                }
+
+                if (empty->batch.count > 0) {
+                    if (_post_body(empty) == 0) {
+                        empty->state = ZLMB_WORKER_POST_PENDING;
+                        empty->order = ++order;
+                    } else {
+                        _post_deadletter(worker, empty);
+                    }
+                }
+                continue;
+            }
+        }
+
+        if (sent) {
+            if (zlmb_http_recv(http, &status) != 0) {
+                int err = errno;
+                if (_post_lost(sent, err)) {
+                    _VERBOSE("Webhook connection closed: %s: %s\n",
+                             worker->command, strerror(err));
+                } else {
+                    _ERR("Webhook receive: %s: %s\n",
+                         worker->command, strerror(err));
+                    _post_failure(worker, sent, &due);
+                }
+            } else if (status >= 200 && status < 300) {
+                worker->messages += sent->batch.count;
+                __sync_fetch_and_add(&worker->completed, sent->batch.count);
+                _post_clear(sent);
+            } else {
+                _ERR("Webhook status: %s: %d\n", worker->command, status);
+                _post_failure(worker, sent, &due);
+            }
+
+            /* connection closed: the next batches are sent again */
+            if (http->fd == -1) {
+                _post_resend(posts);
+            }
+            worker->elapsed += zlmb_utils_clock() - now;
+            continue;
+        }
+
+        /* backoff: nothing in flight */
+        if (pending) {
+            poll(NULL, 0, (int)((due - now) / 1000) + 1);
+        }
+    }
+
+    /* exit: responses of the sent batches, the rest to dead letter */
+    while (1) {
+        zlmb_post_t *sent = _post_oldest(posts, ZLMB_WORKER_POST_SENT);
+        int status = 0;
+
+        if (!sent || zlmb_http_recv(http, &status) != 0 ||
+            status < 200 || status >= 300) {
+            break;
+        }
+
+        worker->messages += sent->batch.count;
+        __sync_fetch_and_add(&worker->completed, sent->batch.count);
+        _post_clear(sent);
+    }
+
+    for (i = 0; i < ZLMB_WORKER_HTTP_PIPELINE; i++) {
+        if (posts[i].state != ZLMB_WORKER_POST_FREE) {
+            _post_deadletter(worker, &posts[i]);
+        }
+        _batch_destroy(&posts[i].batch);
+        if (posts[i].body) {
+            free(posts[i].body);
+        }
+    }
+
+    _VERBOSE("ZeroMQ end worker webhook: connects=%llu requests=%llu\n",
+             (unsigned long long)http->connects,
+             (unsigned long long)http->requests);
+
+    zlmb_http_destroy(&http);
+
+    zmq_close(socket);
+
+    return NULL;
+}
+
+static void
+_worker_destroy(zlmb_worker_t **self, int count, int wait)
+{
+    int i;
+
+    if (wait > 0) {
+        usleep(wait);
+    }
+
+    for (i = 0; i < count; i++) {
+        if (self[i]) {
+            if (self[i]->thread) {
+                pthread_kill(self[i]->thread, SIGINT);
+                pthread_join(self[i]->thread, NULL);
+            }
+            if (self[i]->messages > 0) {
+                _VERBOSE("Worker thread(#%d): messages=%llu"
+                         " (%.3f usec/msg)\n", i + 1,
+                         (unsigned long long)self[i]->messages,
+                         (double)self[i]->elapsed / self[i]->messages);
+            }
+            if (self[i]->outputs > 0) {
+                _VERBOSE("Worker thread(#%d): outputs=%llu\n", i + 1,
+                         (unsigned long long)self[i]->outputs);
+            }
+            if (self[i]->outputs_dropped > 0) {
+                _INFO("Worker thread(#%d): outputs dropped=%llu\n", i + 1,
+                      (unsigned long long)self[i]->outputs_dropped);
+            }
+            if (self[i]->retries > 0 || self[i]->deadletters > 0) {
+                _INFO("Worker thread(#%d): retries=%llu deadletters=%llu\n",
+                      i + 1, (unsigned long long)self[i]->retries,
+                      (unsigned long long)self[i]->deadletters);
+            }
+            free(self[i]);
+        }
+    }
+
+    free(self);
+}
+
+static zlmb_plugin_t *
+_plugin_load(char *path, void **handle)
+{
+    zlmb_plugin_t *symbol;
+
+    *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!*handle) {
+        _ERR("Plugin load: %s\n", dlerror());
+        return NULL;
+    }
+
+    symbol = (zlmb_plugin_t *)dlsym(*handle, ZLMB_PLUGIN_SYMBOL);
+    if (!symbol || symbol->abi != ZLMB_PLUGIN_ABI || !symbol->batch) {
+        _ERR("Plugin symbol: %s: %s (ABI: %d)\n", path,
+             ZLMB_PLUGIN_SYMBOL, symbol ? symbol->abi : -1);
+        dlclose(*handle);
+        *handle = NULL;
+        return NULL;
+    }
+
+    _VERBOSE("Plugin: %s\n", symbol->name ? symbol->name : path);
+
+    return symbol;
+}
+
+/* backend: inproc socket and its threads (command, plugin or sink) */
+static int
+_backend_bind(void *context, void **socket, char **endpoint,
+              int index, int shard)
+{
+    *socket = zmq_socket(context, ZMQ_PUSH);
+    if (!*socket) {
+        _ERR("ZeroMQ backend socket: %s\n", zmq_strerror(errno));
+        return -1;
+    }
+
+    if (zlmb_utils_asprintf(endpoint, "%s.%d.%d.%d",
+                            ZLMB_WORKER_BACKEND_SOCKET,
+                            getpid(), index, shard) == -1) {
+        _ERR("Allocate string backend point.\n");
+        *endpoint = NULL;
+        return -1;
+    }
+
+    if (zmq_bind(*socket, *endpoint) == -1) {
+        _ERR("ZeroMQ backend bind: %s: %s\n",
+             *endpoint, zmq_strerror(errno));
+        return -1;
+    }
+
+    _VERBOSE("ZeroMQ backend bind: %s\n", *endpoint);
+
+    return 0;
+}
+
+/* shards: a socket per thread (messages of a key on one thread) */
+static int
+_backend_start(zlmb_backend_t *self, void *context, int index,
+               zlmb_worker_t *config, int thread, int keyed,
+               void *(*start)(void *))
+{
+    size_t size;
+    int i;
+
+    if (thread <= 0) {
+        thread = 1;
+    }
+
+    if (keyed && thread > 1) {
+        size = sizeof(zlmb_shard_t) * thread;
+        self->shards = (zlmb_shard_t *)malloc(size);
+        if (!self->shards) {
+            _ERR("Memory allocate shard.\n");
+            return -1;
+        }
+        memset(self->shards, 0, size);
+        self->nshards = thread;
+
+        for (i = 0; i != thread; i++) {
+            if (_backend_bind(context, &self->shards[i].socket,
+                              &self->shards[i].endpoint, index, i) != 0) {
+                return -1;
+            }
+        }
+    } else if (_backend_bind(context, &self->socket, &self->endpoint,
+                             index, 0) != 0) {
+        return -1;
+    }
+
+    size = sizeof(zlmb_worker_t *) * thread;
+    self->worker = (zlmb_worker_t **)malloc(size);
+    if (!self->worker) {
+        _ERR("Memory allocate worker command.\n");
+        return -1;
+    }
+
+    memset(self->worker, 0, size);
+    self->thread = thread;
+
+    for (i = 0; i != thread; i++) {
+        self->worker[i] = (zlmb_worker_t *)malloc(sizeof(zlmb_worker_t));
+        if (!self->worker[i]) {
+            _ERR("Memory allocate worker command.\n");
+            return -1;
+        }
+
+        *self->worker[i] = *config;
+        self->worker[i]->thread = 0;
+        self->worker[i]->context = context;
+        if (self->shards) {
+            self->worker[i]->endpoint = self->shards[i].endpoint;
+        } else {
+            self->worker[i]->endpoint = self->endpoint;
+        }
+
+        if (pthread_create(&(self->worker[i]->thread), NULL,
+                           start, (void *)self->worker[i]) == -1) {
+            _ERR("Create command worker thread(#%d).\n", i+1);
+            self->worker[i]->thread = 0;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static void
+_backend_stop(zlmb_backend_t *self, int wait)
+{
+    int i;
+
+    if (self->worker) {
+        _worker_destroy(self->worker, self->thread, wait);
+        self->worker = NULL;
+    }
+    if (self->shards) {
+        for (i = 0; i < self->nshards; i++) {
+            if (self->shards[i].socket) {
+                zmq_close(self->shards[i].socket);
+            }
+            if (self->shards[i].endpoint) {
+                free(self->shards[i].endpoint);
+            }
+        }
+        free(self->shards);
+        self->shards = NULL;
+    }
+    if (self->socket) {
+        zmq_close(self->socket);
+        self->socket = NULL;
+    }
+    if (self->endpoint) {
+        free(self->endpoint);
+        self->endpoint = NULL;
+    }
+    if (self->handle) {
+        dlclose(self->handle);
+        self->handle = NULL;
+    }
+}
+
+static void
+_backends_destroy(zlmb_backend_t *self, int count, int wait)
+{
+    int i;
+
+    if (!self) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        _backend_stop(&self[i], wait);
+    }
+
+    free(self);
+}
+
+/* depth: dispatched and not completed messages of each shard */
+static void
+_backends_report(zlmb_backend_t *self, int count)
+{
+    int i, j;
+
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < self[i].nshards; j++) {
+            uint64_t completed = self[i].worker[j]->completed;
+            uint64_t dispatched = self[i].shards[j].dispatched;
+            zlmb_overflow_t *overflow = &self[i].shards[j].overflow;
+
+            _INFO("Shard(#%d.%d): depth=%llu dispatched=%llu "
+                  "queued=%lu dropped=%llu\n",
+                  i + 1, j + 1,
+                  (unsigned long long)(dispatched > completed
+                                       ? dispatched - completed : 0),
+                  (unsigned long long)dispatched,
+                  (unsigned long)(overflow->queue
+                                  ? zlmb_stack_size(overflow->queue) : 0),
+                  (unsigned long long)overflow->dropped);
+        }
+        if (!self[i].shards && (self[i].overflow.queue ||
+                                self[i].overflow.dropped > 0)) {
+            _INFO("Backend(#%d): queued=%lu dropped=%llu\n", i + 1,
+                  (unsigned long)(self[i].overflow.queue
+                                  ? zlmb_stack_size(self[i].overflow.queue)
+                                  : 0),
+                  (unsigned long long)self[i].overflow.dropped);
         }
     }
-    arg[0] = command;
-    arg[n+1] = NULL;
+}
 
-    if (pipe(in) == -1) {
-        _ERR("Create STDIN pipe.\n");
-        return -1;
-    }
+/* key: frame (1: first) and field (separated by space or tab) */
+static uint64_t
+_dispatch_hash(zlmb_stack_t *stack, int frame, int field)
+{
+    zlmb_stack_item_t *item = zlmb_stack_first(stack);
+    const char *data = "";
+    size_t len = 0;
+    int i;
 
-    if (posix_spawn_file_actions_init(&actions) != 0) {
-        _ERR("POSIX spawn file action initilize.\n");
-        return -1;
+    for (i = 1; item && i < frame; i++) {
+        item = zlmb_stack_item_next(item);
     }
 
-    if (posix_spawn_file_actions_addclose(&actions, in[1]) != 0 ||
-        posix_spawn_file_actions_adddup2(&actions, in[0], 0) != 0) {
-        _ERR("POSIX spawn file action add.\n");
-        posix_spawn_file_actions_destroy(&actions);
-        return -1;
+    if (item && zlmb_stack_item_data(item)) {
+        zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+        data = zmq_msg_data(zmsg);
+        len = zmq_msg_size(zmsg);
     }
 
-    _DEBUG("POSIX spawn run: %s\n", command);
-
-    if (posix_spawnp(&pid, command, &actions, NULL, arg, env) != 0) {
-        _ERR("POSIX spawn: %s\n", command);
-        posix_spawn_file_actions_destroy(&actions);
-        return -1;
-    }
+    for (i = 1; field > 0 && i <= field; i++) {
+        size_t n = 0;
 
-    close(in[0]);
+        while (len > 0 && (*data == ' ' || *data == '\t')) {
+            data++;
+            len--;
+        }
+        while (n < len && data[n] != ' ' && data[n] != '\t') {
+            n++;
+        }
 
-    while (zlmb_stack_size(self->stack)) {
-        zmq_msg_t *zmsg = zlmb_stack_shift(self->stack);
-        if (zmsg) {
-            write(in[1], zmq_msg_data(zmsg), zmq_msg_size(zmsg));
-            zmq_msg_close(zmsg);
-            free(zmsg);
+        if (i == field) {
+            len = n;
+        } else {
+            data += n;
+            len -= n;
         }
     }
 
-    close(in[1]);
-
-    _DEBUG("POSIX spawn wait(#%d).\n", pid);
-    waitpid(pid, &ret, 0);
+    return zlmb_utils_hash(data, len, 0);
+}
 
-    posix_spawn_file_actions_destroy(&actions);
+/* send: a busy socket refuses the first frame, the others follow it */
+static int
+_dispatch_send(void *socket, zlmb_stack_t *stack)
+{
+    zlmb_stack_item_t *item = zlmb_stack_first(stack);
+    int flags = ZMQ_DONTWAIT;
 
-    _DEBUG("POSIX spawn finish(#%d).\n", pid);
+    while (item) {
+        zlmb_stack_item_t *next = zlmb_stack_item_next(item);
+        zmq_msg_t *zmsg = zlmb_stack_item_data(item);
 
-    if (arg) {
-        free(arg);
+        if (zmsg && zmq_sendmsg(socket, zmsg,
+                                flags | (next ? ZMQ_SNDMORE : 0)) == -1) {
+            if (errno == EAGAIN && flags == ZMQ_DONTWAIT) {
+                return 1;
+            }
+            _ERR("ZeroMQ backend send: %s\n", zmq_strerror(errno));
+            return -1;
+        }
+        flags = 0;
+        item = next;
     }
 
     return 0;
 }
 
+/* drop: queue is full (or at exit), message to the dead letter */
 static void
-_spawn_destroy(zlmb_spawn_t *self)
+_dispatch_drop(zlmb_backend_t *backend, zlmb_overflow_t *overflow,
+               zlmb_stack_t **stack)
 {
-    if (self->stack) {
-        zlmb_stack_destroy(&self->stack);
-    }
-    if (self->frame) {
-        free(self->frame);
-    }
-    if (self->frame_length) {
-        free(self->frame_length);
-    }
-    if (self->length) {
-        free(self->length);
+    zlmb_dump_t *deadletter = backend->worker[0]->deadletter;
+    zlmb_stack_item_t *item;
+
+    overflow->dropped++;
+
+    if (deadletter) {
+        pthread_mutex_lock(&_deadletter_mutex);
+        item = zlmb_stack_first(*stack);
+        while (item) {
+            zlmb_stack_item_t *next = zlmb_stack_item_next(item);
+            zmq_msg_t *zmsg = zlmb_stack_item_data(item);
+            if (zmsg && zlmb_dump_write(deadletter, zmsg,
+                                        next ? ZMQ_SNDMORE : 0) == -1) {
+                zlmb_dump_close(deadletter);
+                _ERR("Output message dead letter: %s\n",
+                     deadletter->filename);
+                break;
+            }
+            item = next;
+        }
+        pthread_mutex_unlock(&_deadletter_mutex);
     }
+
+    _stack_destroy(stack);
 }
 
-static void *
-_worker_command(void *arg)
+/* flush: waiting messages while the socket takes them */
+static void
+_dispatch_flush(void *socket, zlmb_overflow_t *overflow)
 {
-    zlmb_worker_t *worker = (zlmb_worker_t *)arg;
-    zmq_pollitem_t pollitems[] = { { NULL, 0, ZMQ_POLLIN, 0 } };
-    void *socket;
+    while (overflow->queue && zlmb_stack_size(overflow->queue) > 0) {
+        zlmb_stack_t *stack;
 
-    if (!worker || !worker->context || !worker->command) {
-        _ERR("Function arguments: %s\n", __FUNCTION__);
-        return NULL;
-    }
+        stack = zlmb_stack_item_data(zlmb_stack_first(overflow->queue));
+        if (_dispatch_send(socket, stack) == 1) {
+            break;
+        }
 
-    socket = zmq_socket(worker->context, ZMQ_PULL);
-    if (!socket) {
-        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
-        return NULL;
+        zlmb_stack_shift(overflow->queue);
+        _stack_destroy(&stack);
     }
+}
 
-    if (zmq_connect(socket, worker->endpoint) == -1) {
-        _ERR("ZeroMQ socket connect: %s: %s\n",
-             worker->endpoint, zmq_strerror(errno));
-        zmq_close(socket);
-        return NULL;
+/* queue: behind the waiting messages (order of a key) */
+static void
+_dispatch_queue(zlmb_backend_t *backend, void *socket,
+                zlmb_overflow_t *overflow, zlmb_stack_t **stack)
+{
+    if (!overflow->queue || zlmb_stack_size(overflow->queue) == 0) {
+        if (_dispatch_send(socket, *stack) != 1) {
+            _stack_destroy(stack);
+            return;
+        }
     }
 
-    _VERBOSE("ZeroMQ socket connect: %s\n", worker->endpoint);
+    if (!overflow->queue) {
+        overflow->queue = zlmb_stack_init();
+    }
 
-    _VERBOSE("ZeroMQ start worker command proxy.\n");
+    if (!overflow->queue ||
+        zlmb_stack_size(overflow->queue) >= ZLMB_WORKER_DISPATCH_QUEUE ||
+        zlmb_stack_push(overflow->queue, *stack) != 0) {
+        _dispatch_drop(backend, overflow, stack);
+        return;
+    }
 
-    pollitems[0].socket = socket;
+    *stack = NULL;
+}
 
-    _signals();
+/* overflow: each socket (shard or backend) with waiting messages */
+static int
+_dispatch_pollitems(zlmb_backend_t *backends, int nbackends,
+                    zmq_pollitem_t *pollitems, int flush)
+{
+    int i, j, n = 0;
 
-    while (!_interrupted) {
-        if (zmq_poll(pollitems, 1, -1) == -1) {
-            break;
-        }
+    for (i = 0; i < nbackends; i++) {
+        int count = backends[i].shards ? backends[i].nshards : 1;
 
-        if (pollitems[0].revents & ZMQ_POLLIN) {
-            int more;
-            size_t moresz = sizeof(more);
-            zlmb_spawn_t spawn = { NULL, NULL, NULL, NULL };
+        for (j = 0; j < count; j++) {
+            zlmb_overflow_t *overflow;
+            void *socket;
 
-            _DEBUG("ZeroMQ receive in poll event.\n");
+            if (backends[i].shards) {
+                overflow = &backends[i].shards[j].overflow;
+                socket = backends[i].shards[j].socket;
+            } else {
+                overflow = &backends[i].overflow;
+                socket = backends[i].socket;
+            }
 
-            spawn.stack = zlmb_stack_init();
-            if (!spawn.stack) {
-                _ERR("Message stack initilize.\n");
-                break;
+            if (!overflow->queue) {
+                continue;
             }
 
-            while (!_interrupted) {
-                zmq_msg_t *zmsg = (zmq_msg_t *)malloc(sizeof(zmq_msg_t));
-                if (!zmsg) {
-                    break;
+            if (flush == 1) {
+                _dispatch_flush(socket, overflow);
+            } else if (flush == -1) {
+                while (zlmb_stack_size(overflow->queue) > 0) {
+                    zlmb_stack_t *stack = zlmb_stack_shift(overflow->queue);
+                    _dispatch_drop(&backends[i], overflow, &stack);
                 }
+                zlmb_stack_destroy(&overflow->queue);
+                continue;
+            }
 
-                _DEBUG("ZeroMQ receive message.\n");
+            if (pollitems && zlmb_stack_size(overflow->queue) > 0) {
+                pollitems[n].socket = socket;
+                pollitems[n].fd = 0;
+                pollitems[n].events = ZMQ_POLLOUT;
+                pollitems[n].revents = 0;
+                n++;
+            }
+        }
+    }
 
-                if (zmq_msg_init(zmsg) != 0) {
-                    break;
-                }
+    return n;
+}
 
-                if (zmq_recvmsg(socket, zmsg, 0) == -1) {
-                    _ERR("ZeroMQ socket receive: %s\n", zmq_strerror(errno));
-                    zmq_msg_close(zmsg);
-                    free(zmsg);
-                    break;
-                }
+/* dispatch: route (key: first frame) and shard (key: frame, field) */
+static void
+_worker_dispatch(void *frontend, zlmb_backend_t *backends, int nbackends,
+                 zlmb_route_t *route, int frame, int field, int interval)
+{
+    zmq_pollitem_t *pollitems;
+    uint64_t next = 0;
+    int i, count = 1;
 
-                if (zmq_getsockopt(socket, ZMQ_RCVMORE, &more, &moresz) == -1) {
-                    _ERR("ZeroMQ socket option receive: %s\n",
-                         zmq_strerror(errno));
-                    more = 0;
-                }
+    if (interval > 0) {
+        next = zlmb_utils_clock() + (uint64_t)interval * 1000000;
+    }
 
-                if (zlmb_stack_push(spawn.stack, zmsg) != 0) {
-                    _ERR("Message stack push.\n");
-                }
+    /* poll: frontend and the sockets of waiting messages */
+    for (i = 0; i < nbackends; i++) {
+        count += backends[i].shards ? backends[i].nshards : 1;
+    }
 
-                if (!more) {
-                    break;
-                }
+    pollitems = (zmq_pollitem_t *)calloc(count, sizeof(zmq_pollitem_t));
+    if (!pollitems) {
+        _ERR("Memory allocate poll items.\n");
+        return;
+    }
+
+    pollitems[0].socket = frontend;
+    pollitems[0].events = ZMQ_POLLIN;
+
+    while (!_interrupted) {
+        zlmb_stack_t *stack;
+        zlmb_overflow_t *overflow;
+        void *socket;
+        long timeout = -1;
+        int n = 0;
+
+        if (next) {
+            uint64_t now = zlmb_utils_clock();
+            if (now >= next) {
+                _backends_report(backends, nbackends);
+                next = now + (uint64_t)interval * 1000000;
             }
+            timeout = (long)((next - now) / 1000) + 1;
+        }
 
-            //env
-            _spawn_generate_environ(&spawn);
+        count = 1 + _dispatch_pollitems(backends, nbackends,
+                                        &pollitems[1], 0);
 
-            //spawn
-            _spawn_run(&spawn, worker->command,
-                       worker->argc, worker->argv, worker->optind);
+        if (zmq_poll(pollitems, count, timeout) == -1) {
+            break;
+        }
 
-            _spawn_destroy(&spawn);
+        if (count > 1) {
+            _dispatch_pollitems(backends, nbackends, NULL, 1);
         }
-    }
 
-    _VERBOSE("ZeroMQ end worker command proxy.\n");
+        if (!(pollitems[0].revents & ZMQ_POLLIN)) {
+            continue;
+        }
 
-    zmq_close(socket);
+        stack = zlmb_stack_init();
+        if (!stack) {
+            _ERR("Message stack initilize.\n");
+            break;
+        }
 
-    return NULL;
-}
+        if (_worker_recv(frontend, stack) != 0 ||
+            zlmb_stack_size(stack) == 0) {
+            _stack_destroy(&stack);
+            continue;
+        }
 
-static void
-_worker_destroy(zlmb_worker_t **self, int count, int wait)
-{
-    int i;
+        /* route: empty key on a single frame message */
+        if (route) {
+            zmq_msg_t *key = zlmb_stack_item_data(zlmb_stack_first(stack));
 
-    if (wait > 0) {
-        usleep(wait);
-    }
+            if (zlmb_stack_size(stack) > 1) {
+                n = zlmb_route_match(route, zmq_msg_data(key),
+                                     zmq_msg_size(key));
+            } else {
+                n = zlmb_route_match(route, "", 0);
+            }
 
-    for (i = 0; i < count; i++) {
-        if (self[i]) {
-            if (self[i]->thread) {
-                pthread_kill(self[i]->thread, SIGINT);
-                pthread_join(self[i]->thread, NULL);
+            if (n < 0) {
+                route->unmatched++;
+                _NOTICE("Route: no match, drop message.\n");
+                _stack_destroy(&stack);
+                continue;
             }
-            free(self[i]);
+
+            route->routes[n].messages++;
         }
+
+        socket = backends[n].socket;
+        overflow = &backends[n].overflow;
+        if (backends[n].shards) {
+            zlmb_shard_t *shard;
+
+            shard = &backends[n].shards[_dispatch_hash(stack, frame, field)
+                                        % backends[n].nshards];
+            shard->dispatched++;
+            socket = shard->socket;
+            overflow = &shard->overflow;
+        }
+
+        /* busy: not blocking the other routes and shards */
+        _dispatch_queue(&backends[n], socket, overflow, &stack);
     }
 
-    free(self);
+    /* exit: waiting messages to the dead letter */
+    _dispatch_pollitems(backends, nbackends, NULL, 1);
+    _dispatch_pollitems(backends, nbackends, NULL, -1);
+
+    free(pollitems);
 }
 
 static void
@@ -383,16 +2603,41 @@ _usage(char *arg, char *message)
 {
     char *command = basename(arg);
 
-    printf("Usage: %s [-e ENDPOINT] [-c COMMAND] [-t NUM] [ARGS ...]\n\n",
-           command);
+    printf("Usage: %s [-e ENDPOINT]"
+           " [-c COMMAND | -p PLUGIN | -R FILE | -W URL] [-t NUM]"
+           " [-k KEY] [-i SEC] [-m BYTES] [-r NUM] [-b MSEC] [-d FILE]"
+           " [-o ENDPOINT] [-f FORMAT] [-F ENDPOINT] [-T MSEC]"
+           " [ARGS ...]\n\n", command);
 
     printf("  -e, --endpoint=ENDPOINT server endpoint [DEFAULT: %s]\n",
            ZLMB_WORKER_SOCKET);
     printf("  -c, --command=COMMAND   command path\n");
+    printf("  -p, --plugin=PLUGIN     plugin path (shared object)\n");
+    printf("  -R, --route=FILE        route file (commands, plugins and"
+           " sinks per key)\n");
+    printf("  -W, --webhook=URL       post messages to URL (http://,"
+           " NDJSON batches)\n");
     printf("  -t, --thread=NUM        command thread count\n");
+    printf("  -k, --key=FRAME[:FIELD] keep order per key (thread by key"
+           " hash)\n");
+    printf("  -i, --interval=SEC      shard queue depth report interval\n");
+    printf("  -m, --memfd=BYTES       message size to pass in memfd"
+           " (fd %d)\n", ZLMB_WORKER_MEMFD);
+    printf("  -r, --retry=NUM         retry count of a failed command"
+           " [DEFAULT: 0]\n");
+    printf("  -b, --backoff=MSEC      first retry interval (doubled)"
+           " [DEFAULT: %d]\n", ZLMB_WORKER_BACKOFF);
+    printf("  -d, --deadletter=FILE   dump file of failed messages\n");
+    printf("  -o, --output=ENDPOINT   send command stdout to endpoint\n");
+    printf("  -f, --format=FORMAT     stdout record format"
+           " (line or length) [DEFAULT: line]\n");
+    printf("  -F, --fastcgi=ENDPOINT  FastCGI server of the commands"
+           " (tcp://HOST:PORT, unix://PATH)\n");
+    printf("  -T, --timeout=MSEC      fastcgi and webhook response timeout"
+           " [DEFAULT: %d]\n", ZLMB_WORKER_TIMEOUT);
     printf("  -s, --syslog            log to syslog\n");
     printf("  -v, --verbose           verbosity log\n");
-    printf("  ARGS ...                command arguments\n");
+    printf("  ARGS ...                command (plugin) arguments\n");
 
     if (message) {
         printf("\nINFO: %s\n", message);
@@ -402,25 +2647,47 @@ _usage(char *arg, char *message)
 int
 main (int argc, char **argv)
 {
-    int i, opt, thread = 1;
-    char *command = NULL;
-    char *frontendpoint = ZLMB_WORKER_SOCKET, *backendpoint = NULL;
-    void *context, *frontend = NULL, *backend = NULL;
-    zlmb_worker_t **worker = NULL;
+    int i, opt, thread = 1, retry = 0, backoff = ZLMB_WORKER_BACKOFF;
+    long memfd = 0;
+    char *command = NULL, *plugin = NULL, *deadletter = NULL;
+    char *output = NULL, *fastcgi = NULL, *webhook = NULL;
+    int timeout = ZLMB_WORKER_TIMEOUT;
+    int format = ZLMB_WORKER_OUTPUT_LINE;
+    char *routefile = NULL;
+    char *frontendpoint = ZLMB_WORKER_SOCKET;
+    void *context, *frontend = NULL;
+    zlmb_backend_t *backends = NULL;
+    zlmb_route_t *route = NULL;
+    zlmb_dump_t *dump = NULL;
+    int nbackends = 0, ret = 0;
+    int keyframe = 0, keyfield = 0, interval = 0;
     size_t size;
 
     const struct option long_options[] = {
         { "endpoint", 1, NULL, 'e' },
         { "command", 1, NULL, 'c' },
+        { "plugin", 1, NULL, 'p' },
+        { "route", 1, NULL, 'R' },
         { "thread", 1, NULL, 't' },
+        { "key", 1, NULL, 'k' },
+        { "interval", 1, NULL, 'i' },
+        { "memfd", 1, NULL, 'm' },
+        { "retry", 1, NULL, 'r' },
+        { "backoff", 1, NULL, 'b' },
+        { "deadletter", 1, NULL, 'd' },
+        { "output", 1, NULL, 'o' },
+        { "format", 1, NULL, 'f' },
+        { "fastcgi", 1, NULL, 'F' },
+        { "webhook", 1, NULL, 'W' },
+        { "timeout", 1, NULL, 'T' },
         { "syslog", 0, NULL, 's' },
         { "verbose", 0, NULL, 'v' },
         { "help", 0, NULL, 'h' },
         { NULL, 0, NULL, 0 }
     };
 
-    while ((opt = getopt_long(argc, argv,
-                              "e:c:t:svh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "e:c:p:R:t:k:i:m:r:b:d:o:f:F:W:T:svh",
+                              long_options, NULL)) != -1) {
         switch (opt) {
             case 'e':
                 frontendpoint = optarg;
@@ -428,9 +2695,78 @@ main (int argc, char **argv)
             case 'c':
                 command = optarg;
                 break;
+            case 'p':
+                plugin = optarg;
+                break;
+            case 'R':
+                routefile = optarg;
+                break;
             case 't':
                 thread = atoi(optarg);
                 break;
+            case 'k':
+                /* FRAME[:FIELD] */
+                keyframe = atoi(optarg);
+                if (strchr(optarg, ':')) {
+                    keyfield = atoi(strchr(optarg, ':') + 1);
+                }
+                if (keyframe <= 0 || keyfield < 0) {
+                    _usage(argv[0], "key is FRAME[:FIELD] (1 or more).");
+                    return -1;
+                }
+                break;
+            case 'i':
+                interval = atoi(optarg);
+                if (interval < 0) {
+                    interval = 0;
+                }
+                break;
+            case 'm':
+                memfd = atol(optarg);
+                if (memfd < 0) {
+                    memfd = 0;
+                }
+                break;
+            case 'r':
+                retry = atoi(optarg);
+                if (retry < 0) {
+                    retry = 0;
+                }
+                break;
+            case 'b':
+                backoff = atoi(optarg);
+                if (backoff < 0) {
+                    backoff = 0;
+                }
+                break;
+            case 'd':
+                deadletter = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'f':
+                if (strcmp(optarg, "length") == 0) {
+                    format = ZLMB_WORKER_OUTPUT_LENGTH;
+                } else if (strcmp(optarg, "line") == 0) {
+                    format = ZLMB_WORKER_OUTPUT_LINE;
+                } else {
+                    _usage(argv[0], "format is line or length.");
+                    return -1;
+                }
+                break;
+            case 'F':
+                fastcgi = optarg;
+                break;
+            case 'W':
+                webhook = optarg;
+                break;
+            case 'T':
+                timeout = atoi(optarg);
+                if (timeout < 0) {
+                    timeout = 0;
+                }
+                break;
             case 's':
                 _syslog = 1;
                 break;
@@ -443,15 +2779,102 @@ main (int argc, char **argv)
         }
     }
 
+    if ((command && plugin) || (routefile && (command || plugin)) ||
+        (webhook && (command || plugin || routefile))) {
+        _usage(argv[0], "command, plugin, route and webhook are exclusive.");
+        return -1;
+    }
+
+    if (fastcgi && (plugin || webhook || memfd > 0)) {
+        _usage(argv[0], "fastcgi is used for commands (not memfd).");
+        return -1;
+    }
+
     _LOG_OPEN(ZLMB_SYSLOG_IDENT);
 
     _INFO("Connect endpoint: %s\n", frontendpoint);
-    _INFO("Execute command: %s\n", command);
-    _INFO("Thread count: %d\n", thread);
+    if (routefile) {
+        _INFO("Route file: %s\n", routefile);
+    } else if (plugin) {
+        _INFO("Load plugin: %s\n", plugin);
+        _INFO("Thread count: %d\n", thread);
+    } else if (webhook) {
+        _INFO("Webhook: %s (timeout: %d msec)\n", webhook, timeout);
+        _INFO("Thread count: %d\n", thread);
+    } else {
+        _INFO("Execute command: %s\n", command);
+        _INFO("Thread count: %d\n", thread);
+    }
+
+    if (memfd > 0) {
+#ifdef HAVE_MEMFD
+        _INFO("Memory file: %ld bytes or more\n", memfd);
+#else
+        _NOTICE("Memory file: not supported\n");
+        memfd = 0;
+#endif
+    }
+
+    if (keyframe > 0) {
+        _INFO("Key: frame %d, field %d (interval: %d sec)\n",
+              keyframe, keyfield, interval);
+    }
+
+    if ((command || routefile || webhook) && (retry > 0 || deadletter)) {
+        _INFO("Retry: %d (backoff: %d msec), dead letter: %s\n",
+              retry, backoff, deadletter ? deadletter : "-");
+    }
+
+    if ((command || routefile) && fastcgi) {
+        _INFO("FastCGI server: %s\n", fastcgi);
+    }
+
+    if ((command || routefile) && output) {
+        _INFO("Output endpoint: %s (format: %s)\n", output,
+              format == ZLMB_WORKER_OUTPUT_LENGTH ? "length" : "line");
+    }
+
+    /* binary dump: replay with zlmb-dump */
+    if (deadletter) {
+        dump = zlmb_dump_init(deadletter, 0);
+        if (!dump) {
+            _ERR("Dead letter initilize: %s\n", deadletter);
+            _LOG_CLOSE();
+            return -1;
+        }
+    }
+
+    /* route: commands, plugins and sinks per key */
+    if (routefile) {
+        route = zlmb_route_init(routefile);
+        if (!route) {
+            _ERR("Route file: %s: %s\n", routefile, strerror(errno));
+            if (dump) {
+                zlmb_dump_destroy(&dump);
+            }
+            _LOG_CLOSE();
+            return -1;
+        }
+
+        for (i = 0; i < (int)route->count; i++) {
+            zlmb_route_entry_t *entry = &route->routes[i];
+            _INFO("Route(#%d): %s: %s %s (thread: %d)\n", i + 1, entry->key,
+                  zlmb_route_type2string(entry->type), entry->target,
+                  entry->thread);
+        }
+
+        nbackends = (int)route->count;
+    } else if (command || plugin || webhook) {
+        nbackends = 1;
+    }
 
     context = zmq_ctx_new();
     if (!context) {
         _ERR("ZeroMQ context: %s\n", zmq_strerror(errno));
+        zlmb_route_destroy(&route);
+        if (dump) {
+            zlmb_dump_destroy(&dump);
+        }
         _LOG_CLOSE();
         return -1;
     }
@@ -470,94 +2893,93 @@ main (int argc, char **argv)
     }
     */
 
-    /* backend: command */
-    if (command) {
-        backend = zmq_socket(context, ZMQ_PUSH);
-        if (!backend) {
-            _ERR("ZeroMQ backend socket: %s\n", zmq_strerror(errno));
-            zmq_ctx_destroy(context);
-            _LOG_CLOSE();
-            return -1;
-        }
-
-        if (zlmb_utils_asprintf(&backendpoint, "%s.%d",
-                                ZLMB_WORKER_BACKEND_SOCKET, getpid()) == -1) {
-            _ERR("Allocate string backend point.\n");
-            zmq_ctx_destroy(context);
-            _LOG_CLOSE();
-            return -1;
+    /* backend: command, plugin or routes */
+    if (nbackends > 0) {
+        zlmb_worker_t config;
+
+        size = sizeof(zlmb_backend_t) * nbackends;
+        backends = (zlmb_backend_t *)malloc(size);
+        if (!backends) {
+            _ERR("Memory allocate backend.\n");
+            ret = -1;
+        } else {
+            memset(backends, 0, size);
         }
 
-        if (zmq_bind(backend, backendpoint) == -1) {
-            _ERR("ZeroMQ backend bind: %s: %s\n",
-                 backendpoint, zmq_strerror(errno));
-            zmq_close(backend);
-            zmq_ctx_destroy(context);
-            _LOG_CLOSE();
-            return -1;
-        }
+        memset(&config, 0, sizeof(config));
+        config.command = command;
+        config.argv = argv;
+        config.argc = argc;
+        config.optind = optind;
+        config.memfd = (size_t)memfd;
+        config.retry = retry;
+        config.backoff = backoff;
+        config.deadletter = dump;
+        config.output = output;
+        config.format = format;
+        config.fastcgi = fastcgi;
+        config.timeout = timeout;
+
+        for (i = 0; i < nbackends && ret == 0; i++) {
+            void *(*start)(void *) = _worker_command;
+            int count = thread;
+            char *target = plugin;
+
+            if (route) {
+                zlmb_route_entry_t *entry = &route->routes[i];
+
+                config.command = entry->target;
+                config.argv = entry->argv;
+                config.argc = entry->argc;
+                config.optind = 1;
+                count = entry->thread;
+                target = NULL;
+
+                if (entry->type == ZLMB_ROUTE_PLUGIN) {
+                    target = entry->target;
+                } else if (entry->type == ZLMB_ROUTE_SINK) {
+                    start = _worker_sink;
+                }
+            } else if (webhook) {
+                config.command = webhook;
+                start = _worker_http;
+            }
 
-        _VERBOSE("ZeroMQ backend bind: %s\n", backendpoint);
+            /* plugin: resolved before the threads start */
+            config.plugin = NULL;
+            if (target) {
+                config.command = target;
+                config.plugin = _plugin_load(target, &backends[i].handle);
+                if (!config.plugin) {
+                    ret = -1;
+                    break;
+                }
+                start = _worker_plugin;
+            }
 
-        /* backend: command thread */
-        if (thread <= 0) {
-            thread = 1;
+            if (_backend_start(&backends[i], context, i, &config,
+                               count, keyframe > 0, start) != 0) {
+                ret = -1;
+            }
         }
 
-        size = sizeof(zlmb_worker_t *) * thread;
-        worker = (zlmb_worker_t **)malloc(size);
-        if (!worker) {
-            _ERR("Memory allocate worker command.\n");
-            zmq_close(backend);
+        if (ret != 0) {
+            _backends_destroy(backends, nbackends, 500);
             zmq_ctx_destroy(context);
-            free(backendpoint);
+            zlmb_route_destroy(&route);
+            if (dump) {
+                zlmb_dump_destroy(&dump);
+            }
             _LOG_CLOSE();
             return -1;
         }
-
-        memset(worker, 0, size);
-
-        for (i = 0; i != thread; i++) {
-            worker[i] = (zlmb_worker_t *)malloc(sizeof(zlmb_worker_t));
-            if (!worker[i]) {
-                _ERR("Memory allocate worker command.\n");
-                _worker_destroy(worker, thread, 500);
-                zmq_close(backend);
-                zmq_ctx_destroy(context);
-                free(backendpoint);
-                return -1;
-            }
-
-            worker[i]->thread = 0;
-            worker[i]->context = context;
-            worker[i]->command = command;
-            worker[i]->endpoint = backendpoint;
-            worker[i]->argv = argv;
-            worker[i]->argc = argc;
-            worker[i]->optind = optind;
-
-            if (pthread_create(&(worker[i]->thread), NULL,
-                               _worker_command, (void *)worker[i]) == -1) {
-                _ERR("Create command worker thread(#%d).\n", i+1);
-                _worker_destroy(worker, thread, 500);
-                zmq_close(backend);
-                zmq_ctx_destroy(context);
-                free(backendpoint);
-                _LOG_CLOSE();
-                return -1;
-            }
-        }
     }
 
     /* frontend */
     frontend = zmq_socket(context, ZMQ_PULL);
     if (!frontend) {
         _ERR("ZeroMQ frontend socket: %s\n", zmq_strerror(errno));
-        if (worker) {
-            _worker_destroy(worker, thread, 500);
-            zmq_close(backend);
-            free(backendpoint);
-        }
+        _backends_destroy(backends, nbackends, 500);
         zmq_ctx_destroy(context);
         _LOG_CLOSE();
         return -1;
@@ -566,11 +2988,7 @@ main (int argc, char **argv)
     if (zmq_connect(frontend, frontendpoint) == -1) {
         _ERR("ZeroMQ frontend connect: %s: %s\n",
              frontendpoint, zmq_strerror(errno));
-        if (worker) {
-            _worker_destroy(worker, thread, 500);
-            zmq_close(backend);
-            free(backendpoint);
-        }
+        _backends_destroy(backends, nbackends, 500);
         zmq_close(frontend);
         zmq_ctx_destroy(context);
         _LOG_CLOSE();
@@ -583,8 +3001,11 @@ main (int argc, char **argv)
 
     _VERBOSE("ZeroMQ start proxy.\n");
 
-    if (backend) {
-        zmq_proxy(frontend, backend, NULL);
+    if (route || (backends && backends[0].shards)) {
+        _worker_dispatch(frontend, backends, nbackends, route,
+                         keyframe, keyfield, interval);
+    } else if (backends) {
+        zmq_proxy(frontend, backends[0].socket, NULL);
     } else {
         zmq_pollitem_t pollitems[] = { { frontend, 0, ZMQ_POLLIN, 0 } };
 
@@ -644,16 +3065,32 @@ main (int argc, char **argv)
 
     zmq_close(frontend);
 
-    if (worker) {
-        _worker_destroy(worker, thread, 0);
-        zmq_close(backend);
-        free(backendpoint);
-    }
+    _backends_report(backends, nbackends);
+
+    _backends_destroy(backends, nbackends, 0);
 
     _VERBOSE("ZeroMQ destory context.\n");
 
     zmq_ctx_destroy(context);
 
+    if (route) {
+        for (i = 0; i < (int)route->count; i++) {
+            _INFO("Route(#%d): %s: messages=%llu\n", i + 1,
+                  route->routes[i].key,
+                  (unsigned long long)route->routes[i].messages);
+        }
+        if (route->unmatched > 0) {
+            _INFO("Route: unmatched=%llu\n",
+                  (unsigned long long)route->unmatched);
+        }
+        zlmb_route_destroy(&route);
+    }
+
+    if (dump) {
+        zlmb_dump_close(dump);
+        zlmb_dump_destroy(&dump);
+    }
+
     _LOG_CLOSE();
 
     return 0;
@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "config.h"
+#include "codec.h"
+#include "utils.h"
+#include "ttl.h"
+
+#ifdef USE_SNAPPY
+#    include <snappy-c.h>
+#endif
+
+/*
+ * codec pool: compress/uncompress messages on worker threads
+ *   jobs are taken in order of push and popped in the same order
+ *   (ring of size jobs: head <= next <= tail)
+ */
+
+#ifdef USE_SNAPPY
+static void
+_codec_free(void *data, void *hint)
+{
+    (void)hint;
+    free(data);
+}
+#endif
+
+int
+zlmb_codec_message(zmq_msg_t *zmsg, int type)
+{
+#ifdef USE_SNAPPY
+    zmq_msg_t out;
+    size_t out_len;
+    char *buf;
+
+    /* ttl frame: read before uncompress */
+    if (zlmb_ttl_parse(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                       NULL, NULL) == 0) {
+        return 0;
+    }
+
+    if (type == ZLMB_CODEC_COMPRESS) {
+        out_len = snappy_max_compressed_length(zmq_msg_size(zmsg));
+        buf = (char *)malloc(out_len);
+        if (!buf) {
+            return -1;
+        }
+        if (snappy_compress(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                            buf, &out_len) != SNAPPY_OK) {
+            free(buf);
+            return -1;
+        }
+    } else if (type == ZLMB_CODEC_UNCOMPRESS) {
+        if (snappy_uncompressed_length(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                                       &out_len) != SNAPPY_OK) {
+            return -1;
+        }
+        buf = (char *)malloc(out_len > 0 ? out_len : 1);
+        if (!buf) {
+            return -1;
+        }
+        if (snappy_uncompress(zmq_msg_data(zmsg), zmq_msg_size(zmsg),
+                              buf, &out_len) != SNAPPY_OK) {
+            free(buf);
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    /* message owns the output buffer (no copy) */
+    if (zmq_msg_init_data(&out, buf, out_len, _codec_free, NULL) != 0) {
+        free(buf);
+        return -1;
+    }
+
+    zmq_msg_move(zmsg, &out);
+    zmq_msg_close(&out);
+
+    return 0;
+#else
+    (void)zmsg;
+    (void)type;
+    return -1;
+#endif
+}
+
+static void
+_codec_stack_clear(zlmb_stack_t *stack)
+{
+    while (zlmb_stack_size(stack)) {
+        zmq_msg_t *zmsg = zlmb_stack_shift(stack);
+        if (zmsg) {
+            zmq_msg_close(zmsg);
+            free(zmsg);
+        }
+    }
+}
+
+static void
+_codec_wakeup(zlmb_codec_t *self)
+{
+    char c = 0;
+
+    /* mutex locked: one byte until the reader drains */
+    if (!self->wakeup) {
+        if (write(self->fd[1], &c, 1) == 1) {
+            self->wakeup = 1;
+        }
+    }
+}
+
+#ifdef USE_SNAPPY
+static void *
+_codec_worker(void *arg)
+{
+    zlmb_codec_thread_t *thread = (zlmb_codec_thread_t *)arg;
+    zlmb_codec_t *self = thread->codec;
+
+    pthread_mutex_lock(&self->mutex);
+
+    while (1) {
+        zlmb_codec_job_t *job;
+        zlmb_stack_item_t *item;
+        uint64_t seq, start, frames = 0, errors = 0;
+
+        while (!self->stop && self->next == self->tail) {
+            pthread_cond_wait(&self->job, &self->mutex);
+        }
+
+        if (self->stop) {
+            break;
+        }
+
+        seq = self->next++;
+        job = &self->jobs[seq % self->size];
+
+        pthread_mutex_unlock(&self->mutex);
+
+        start = zlmb_utils_clock();
+
+        item = zlmb_stack_first(job->stack);
+        while (item) {
+            if (zlmb_codec_message(zlmb_stack_item_data(item),
+                                   self->type) != 0) {
+                errors++;
+            }
+            frames++;
+            item = zlmb_stack_item_next(item);
+        }
+
+        pthread_mutex_lock(&self->mutex);
+
+        thread->busy += zlmb_utils_clock() - start;
+        thread->jobs++;
+        thread->frames += frames;
+        thread->errors += errors;
+
+        job->done = 1;
+
+        /* sequencer: the oldest job is ready */
+        if (seq == self->head) {
+            _codec_wakeup(self);
+            pthread_cond_signal(&self->done);
+        }
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return NULL;
+}
+#endif
+
+zlmb_codec_t *
+zlmb_codec_init(int type, int threads, size_t size)
+{
+#ifndef USE_SNAPPY
+    return NULL;
+#else
+    zlmb_codec_t *self;
+    int i;
+
+    if (threads <= 0) {
+        return NULL;
+    } else if (threads > ZLMB_CODEC_THREADS_MAX) {
+        threads = ZLMB_CODEC_THREADS_MAX;
+    }
+
+    if (size == 0) {
+        size = ZLMB_CODEC_QUEUE_SIZE;
+    }
+
+    self = (zlmb_codec_t *)malloc(sizeof(zlmb_codec_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_codec_t));
+
+    self->type = type;
+    self->size = size;
+
+    self->jobs = (zlmb_codec_job_t *)calloc(size, sizeof(zlmb_codec_job_t));
+    self->thread = (zlmb_codec_thread_t *)calloc(threads,
+                                                 sizeof(zlmb_codec_thread_t));
+    if (!self->jobs || !self->thread) {
+        free(self->jobs);
+        free(self->thread);
+        free(self);
+        return NULL;
+    }
+
+    if (pipe(self->fd) == -1) {
+        free(self->jobs);
+        free(self->thread);
+        free(self);
+        return NULL;
+    }
+
+    fcntl(self->fd[0], F_SETFL, fcntl(self->fd[0], F_GETFL) | O_NONBLOCK);
+    fcntl(self->fd[1], F_SETFL, fcntl(self->fd[1], F_GETFL) | O_NONBLOCK);
+
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->job, NULL);
+    pthread_cond_init(&self->done, NULL);
+
+    self->stamp = zlmb_utils_clock();
+
+    for (i = 0; i < threads; i++) {
+        self->thread[i].codec = self;
+        if (pthread_create(&self->thread[i].thread, NULL,
+                           _codec_worker, &self->thread[i]) != 0) {
+            break;
+        }
+        self->threads++;
+    }
+
+    if (self->threads == 0) {
+        zlmb_codec_destroy(&self);
+        return NULL;
+    }
+
+    return self;
+#endif
+}
+
+void
+zlmb_codec_destroy(zlmb_codec_t **self)
+{
+    int i;
+
+    if (!*self) {
+        return;
+    }
+
+    pthread_mutex_lock(&(*self)->mutex);
+    (*self)->stop = 1;
+    pthread_cond_broadcast(&(*self)->job);
+    pthread_mutex_unlock(&(*self)->mutex);
+
+    for (i = 0; i < (*self)->threads; i++) {
+        pthread_join((*self)->thread[i].thread, NULL);
+    }
+
+    /* jobs not popped */
+    while ((*self)->head < (*self)->tail) {
+        zlmb_codec_job_t *job = &(*self)->jobs[(*self)->head % (*self)->size];
+        if (job->stack) {
+            _codec_stack_clear(job->stack);
+            zlmb_stack_destroy(&job->stack);
+        }
+        (*self)->head++;
+    }
+
+    close((*self)->fd[0]);
+    close((*self)->fd[1]);
+
+    pthread_cond_destroy(&(*self)->done);
+    pthread_cond_destroy(&(*self)->job);
+    pthread_mutex_destroy(&(*self)->mutex);
+
+    free((*self)->jobs);
+    free((*self)->thread);
+    free(*self);
+    *self = NULL;
+}
+
+int
+zlmb_codec_fd(zlmb_codec_t *self)
+{
+    if (!self) {
+        return -1;
+    }
+
+    return self->fd[0];
+}
+
+int
+zlmb_codec_push(zlmb_codec_t *self, zlmb_stack_t *stack)
+{
+    zlmb_codec_job_t *job;
+    size_t bytes = 0;
+
+    if (!self || !stack) {
+        return -1;
+    }
+
+    if (self->memory) {
+        bytes = zlmb_memory_stack(stack);
+    }
+
+    pthread_mutex_lock(&self->mutex);
+
+    /* full: caller pops the oldest job */
+    if (self->tail - self->head >= self->size) {
+        self->full++;
+        pthread_mutex_unlock(&self->mutex);
+        return -1;
+    }
+
+    job = &self->jobs[self->tail % self->size];
+    job->stack = stack;
+    job->bytes = bytes;
+    job->done = 0;
+
+    self->tail++;
+
+    /* memory: held until popped */
+    zlmb_memory_add(self->memory, bytes);
+
+    pthread_cond_signal(&self->job);
+    pthread_mutex_unlock(&self->mutex);
+
+    return 0;
+}
+
+zlmb_stack_t *
+zlmb_codec_pop(zlmb_codec_t *self, int wait)
+{
+    zlmb_codec_job_t *job;
+    zlmb_stack_t *stack = NULL;
+
+    if (!self) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&self->mutex);
+
+    while (self->head < self->tail) {
+        job = &self->jobs[self->head % self->size];
+
+        if (job->done) {
+            stack = job->stack;
+            job->stack = NULL;
+            job->done = 0;
+            self->head++;
+            zlmb_memory_sub(self->memory, job->bytes);
+            break;
+        }
+
+        if (!wait) {
+            break;
+        }
+
+        pthread_cond_wait(&self->done, &self->mutex);
+    }
+
+    /* next job not ready: drain wakeup */
+    if (!stack || self->head == self->tail ||
+        !self->jobs[self->head % self->size].done) {
+        char buf[64];
+        while (read(self->fd[0], buf, sizeof(buf)) > 0) {
+            ;
+        }
+        self->wakeup = 0;
+        if (self->head < self->tail &&
+            self->jobs[self->head % self->size].done) {
+            _codec_wakeup(self);
+        }
+    }
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return stack;
+}
+
+size_t
+zlmb_codec_pending(zlmb_codec_t *self)
+{
+    size_t pending;
+
+    if (!self) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&self->mutex);
+    pending = (size_t)(self->tail - self->head);
+    pthread_mutex_unlock(&self->mutex);
+
+    return pending;
+}
+
+void
+zlmb_codec_utilization(zlmb_codec_t *self, double *utilization)
+{
+    uint64_t now, elapsed;
+    int i;
+
+    if (!self || !utilization) {
+        return;
+    }
+
+    now = zlmb_utils_clock();
+
+    pthread_mutex_lock(&self->mutex);
+
+    elapsed = now - self->stamp;
+
+    for (i = 0; i < self->threads; i++) {
+        if (elapsed > 0) {
+            utilization[i] = (double)self->thread[i].busy * 100.0 / elapsed;
+        } else {
+            utilization[i] = 0;
+        }
+        self->thread[i].busy = 0;
+    }
+
+    self->stamp = now;
+
+    pthread_mutex_unlock(&self->mutex);
+}
@@ -0,0 +1,66 @@
+#ifndef __ZLMB_CODEC_H__
+#define __ZLMB_CODEC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include <zmq.h>
+
+#include "stack.h"
+#include "memory.h"
+
+#define ZLMB_CODEC_COMPRESS   1
+#define ZLMB_CODEC_UNCOMPRESS 2
+
+#define ZLMB_CODEC_THREADS_MAX 64
+#define ZLMB_CODEC_QUEUE_SIZE  1024
+
+typedef struct zlmb_codec zlmb_codec_t;
+
+typedef struct zlmb_codec_job {
+    zlmb_stack_t *stack;
+    size_t bytes;
+    int done;
+} zlmb_codec_job_t;
+
+typedef struct zlmb_codec_thread {
+    pthread_t thread;
+    zlmb_codec_t *codec;
+    uint64_t jobs;
+    uint64_t frames;
+    uint64_t errors;
+    uint64_t busy;
+} zlmb_codec_thread_t;
+
+struct zlmb_codec {
+    int type;
+    int threads;
+    size_t size;
+    uint64_t head;
+    uint64_t next;
+    uint64_t tail;
+    int stop;
+    int wakeup;
+    int fd[2];
+    zlmb_codec_job_t *jobs;
+    zlmb_codec_thread_t *thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t job;
+    pthread_cond_t done;
+    uint64_t stamp;
+    uint64_t full;
+    zlmb_memory_t *memory;
+};
+
+zlmb_codec_t * zlmb_codec_init(int type, int threads, size_t size);
+void zlmb_codec_destroy(zlmb_codec_t **self);
+int zlmb_codec_fd(zlmb_codec_t *self);
+int zlmb_codec_push(zlmb_codec_t *self, zlmb_stack_t *stack);
+zlmb_stack_t * zlmb_codec_pop(zlmb_codec_t *self, int wait);
+size_t zlmb_codec_pending(zlmb_codec_t *self);
+void zlmb_codec_utilization(zlmb_codec_t *self, double *utilization);
+
+int zlmb_codec_message(zmq_msg_t *zmsg, int type);
+
+#endif
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dedup.h"
+#include "utils.h"
+
+/*
+ * Rotating Bloom filter: two generations (current, previous) share the
+ * memory budget. The current generation is rotated out when it reaches
+ * its capacity or the time window has passed, so an entry is remembered
+ * for at least one and at most two windows.
+ */
+
+zlmb_dedup_t *
+zlmb_dedup_init(size_t memory, int window)
+{
+    zlmb_dedup_t *self;
+    size_t bits = 8;
+
+    if (memory <= 0) {
+        memory = ZLMB_DEDUP_DEFAULT_MEMORY;
+    }
+
+    if (window <= 0) {
+        window = ZLMB_DEDUP_DEFAULT_WINDOW;
+    }
+
+    /* per generation: power of two bits within memory / 2 */
+    while ((bits << 1) / 8 <= memory / 2) {
+        bits <<= 1;
+    }
+
+    self = (zlmb_dedup_t *)malloc(sizeof(zlmb_dedup_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_dedup_t));
+
+    self->current = (unsigned char *)malloc(bits / 8);
+    self->previous = (unsigned char *)malloc(bits / 8);
+    if (!self->current || !self->previous) {
+        zlmb_dedup_destroy(&self);
+        return NULL;
+    }
+
+    memset(self->current, 0, bits / 8);
+    memset(self->previous, 0, bits / 8);
+
+    self->bits = bits;
+    self->mask = bits - 1;
+    self->capacity = bits / ZLMB_DEDUP_BITS_PER_ITEM;
+    self->window = (uint64_t)window * 1000000;
+    self->stamp = zlmb_utils_clock();
+
+    return self;
+}
+
+void
+zlmb_dedup_destroy(zlmb_dedup_t **self)
+{
+    if (*self) {
+        if ((*self)->current) {
+            free((*self)->current);
+        }
+        if ((*self)->previous) {
+            free((*self)->previous);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+static void
+_dedup_rotate(zlmb_dedup_t *self, uint64_t now)
+{
+    unsigned char *tmp = self->previous;
+
+    self->previous = self->current;
+    self->current = tmp;
+    memset(self->current, 0, self->bits / 8);
+
+    self->previous_count = self->count;
+    self->count = 0;
+    self->stamp = now;
+    self->rotations++;
+}
+
+int
+zlmb_dedup_check(zlmb_dedup_t *self, uint64_t hash)
+{
+    int i, current = 1, previous = 1;
+    uint64_t now, h2;
+    size_t pos[ZLMB_DEDUP_HASHES];
+
+    if (!self) {
+        return 0;
+    }
+
+    now = zlmb_utils_clock();
+    if (self->count >= self->capacity || now - self->stamp >= self->window) {
+        _dedup_rotate(self, now);
+    }
+
+    self->checked++;
+
+    /* double hashing: h1 + i * h2 */
+    h2 = ((hash >> 32) | (hash << 32)) * 0x9e3779b97f4a7c15ULL | 1;
+
+    for (i = 0; i < ZLMB_DEDUP_HASHES; i++) {
+        pos[i] = (size_t)(hash + i * h2) & self->mask;
+        if (!(self->current[pos[i] >> 3] & (1 << (pos[i] & 7)))) {
+            current = 0;
+        }
+        if (!(self->previous[pos[i] >> 3] & (1 << (pos[i] & 7)))) {
+            previous = 0;
+        }
+    }
+
+    if (current) {
+        self->duplicates++;
+        return 1;
+    }
+
+    for (i = 0; i < ZLMB_DEDUP_HASHES; i++) {
+        self->current[pos[i] >> 3] |= (1 << (pos[i] & 7));
+    }
+    self->count++;
+
+    if (previous) {
+        self->duplicates++;
+        return 1;
+    }
+
+    return 0;
+}
+
+double
+zlmb_dedup_fpp(zlmb_dedup_t *self)
+{
+    double current, previous;
+
+    if (!self) {
+        return 0;
+    }
+
+    /* (1 - e^(-kn/m))^k for each generation, false if either matches */
+    current = pow(1 - exp(-(double)ZLMB_DEDUP_HASHES * self->count
+                          / self->bits), ZLMB_DEDUP_HASHES);
+    previous = pow(1 - exp(-(double)ZLMB_DEDUP_HASHES * self->previous_count
+                           / self->bits), ZLMB_DEDUP_HASHES);
+
+    return 1 - (1 - current) * (1 - previous);
+}
@@ -0,0 +1,33 @@
+#ifndef __ZLMB_DEDUP_H__
+#define __ZLMB_DEDUP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_DEDUP_HASHES         7
+#define ZLMB_DEDUP_BITS_PER_ITEM 10
+
+#define ZLMB_DEDUP_DEFAULT_MEMORY (1024 * 1024)
+#define ZLMB_DEDUP_DEFAULT_WINDOW 60
+
+typedef struct zlmb_dedup {
+    size_t bits;
+    size_t mask;
+    uint64_t capacity;
+    uint64_t window;
+    uint64_t stamp;
+    uint64_t count;
+    uint64_t previous_count;
+    unsigned char *current;
+    unsigned char *previous;
+    uint64_t checked;
+    uint64_t duplicates;
+    uint64_t rotations;
+} zlmb_dedup_t;
+
+zlmb_dedup_t * zlmb_dedup_init(size_t memory, int window);
+void zlmb_dedup_destroy(zlmb_dedup_t **self);
+int zlmb_dedup_check(zlmb_dedup_t *self, uint64_t hash);
+double zlmb_dedup_fpp(zlmb_dedup_t *self);
+
+#endif
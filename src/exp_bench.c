@@ -0,0 +1,254 @@
+/*
+ * Example benchmark (transport)
+ *
+ * Usage: exp-bench ENDPOINT [COUNT] [SIZE]
+ *
+ * % exp-bench tcp://127.0.0.1:5570
+ * % exp-bench ipc:///tmp/zlmb-bench.ipc 1000000 100
+ * % exp-bench ipc://@zlmb-bench 1000000 100
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <zmq.h>
+
+#define _ERR(...) fprintf(stderr, "ERR: "__VA_ARGS__)
+
+#define EXP_BENCH_COUNT 100000
+#define EXP_BENCH_SIZE  100
+#define EXP_BENCH_ROUNDTRIP 10000
+
+typedef struct {
+    void *context;
+    char *endpoint;
+    int count;
+    int size;
+    int type;
+} exp_bench_t;
+
+static uint64_t
+_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t
+_cpu(void)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void *
+_peer(void *arg)
+{
+    exp_bench_t *self = (exp_bench_t *)arg;
+    void *socket;
+    char *buf;
+    int i;
+
+    buf = (char *)malloc(self->size);
+    if (!buf) {
+        _ERR("Memory allocate.\n");
+        return NULL;
+    }
+
+    memset(buf, 'x', self->size);
+
+    socket = zmq_socket(self->context, self->type);
+    if (!socket) {
+        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
+        free(buf);
+        return NULL;
+    }
+
+    if (zmq_connect(socket, self->endpoint) == -1) {
+        _ERR("ZeroMQ connect: %s: %s\n", self->endpoint, zmq_strerror(errno));
+        zmq_close(socket);
+        free(buf);
+        return NULL;
+    }
+
+    for (i = 0; i < self->count; i++) {
+        if (self->type == ZMQ_REQ) {
+            if (zmq_send(socket, buf, self->size, 0) == -1 ||
+                zmq_recv(socket, buf, self->size, 0) == -1) {
+                _ERR("ZeroMQ request: %s\n", zmq_strerror(errno));
+                break;
+            }
+        } else if (zmq_send(socket, buf, self->size, 0) == -1) {
+            _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
+            break;
+        }
+    }
+
+    zmq_close(socket);
+    free(buf);
+
+    return NULL;
+}
+
+static int
+_bench(void *context, char *endpoint, int count, int size, int type)
+{
+    exp_bench_t peer = { context, endpoint, count, size, 0 };
+    pthread_t thread;
+    void *socket;
+    char *buf;
+    int i, linger = 0;
+
+    buf = (char *)malloc(size);
+    if (!buf) {
+        _ERR("Memory allocate.\n");
+        return -1;
+    }
+
+    /* throughput: PULL <- PUSH, latency: REP <- REQ */
+    if (type == ZMQ_PULL) {
+        peer.type = ZMQ_PUSH;
+    } else {
+        peer.type = ZMQ_REQ;
+    }
+
+    socket = zmq_socket(context, type);
+    if (!socket) {
+        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
+        free(buf);
+        return -1;
+    }
+
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+
+    if (zmq_bind(socket, endpoint) == -1) {
+        _ERR("ZeroMQ bind: %s: %s\n", endpoint, zmq_strerror(errno));
+        zmq_close(socket);
+        free(buf);
+        return -1;
+    }
+
+    if (pthread_create(&thread, NULL, _peer, (void *)&peer) != 0) {
+        _ERR("Thread create.\n");
+        zmq_close(socket);
+        free(buf);
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (zmq_recv(socket, buf, size, 0) == -1) {
+            _ERR("ZeroMQ receive: %s\n", zmq_strerror(errno));
+            break;
+        }
+        if (type == ZMQ_REP && zmq_send(socket, buf, size, 0) == -1) {
+            _ERR("ZeroMQ reply: %s\n", zmq_strerror(errno));
+            break;
+        }
+    }
+
+    pthread_join(thread, NULL);
+
+    zmq_unbind(socket, endpoint);
+    zmq_close(socket);
+    free(buf);
+
+    return i;
+}
+
+static void
+_usage(char *arg)
+{
+    char *command = basename(arg);
+
+    printf("Usage: %s ENDPOINT [COUNT] [SIZE]\n\n", command);
+
+    printf("  ENDPOINT    bind endpoint (tcp://, ipc://, ipc://@)\n");
+    printf("  COUNT       messages [ %d (DEFAULT) ]\n", EXP_BENCH_COUNT);
+    printf("  SIZE        message size [ %d (DEFAULT) ]\n", EXP_BENCH_SIZE);
+}
+
+int
+main (int argc, char **argv)
+{
+    int count = EXP_BENCH_COUNT, size = EXP_BENCH_SIZE, n;
+    char *endpoint = NULL;
+    void *context;
+    uint64_t start, cpu, elapsed;
+
+    if (argc <= 1) {
+        _usage(argv[0]);
+        return -1;
+    }
+
+    endpoint = argv[1];
+
+    if (argc > 2) {
+        count = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        size = atoi(argv[3]);
+    }
+
+    if (count <= 0 || size <= 0) {
+        _usage(argv[0]);
+        return -1;
+    }
+
+    context = zmq_ctx_new();
+    if (!context) {
+        _ERR("ZeroMQ context: %s\n", zmq_strerror(errno));
+        return -1;
+    }
+
+    printf("endpoint: %s\n", endpoint);
+    printf("message: count=%d size=%d\n", count, size);
+
+    /* throughput */
+    start = _clock();
+    cpu = _cpu();
+
+    n = _bench(context, endpoint, count, size, ZMQ_PULL);
+
+    elapsed = _clock() - start;
+    cpu = _cpu() - cpu;
+
+    if (n > 0 && elapsed > 0) {
+        printf("throughput: %.0f msg/sec %.3f MB/sec cpu=%.1f%%\n",
+               (double)n * 1000000 / elapsed,
+               (double)n * size / elapsed,
+               (double)cpu * 100 / elapsed);
+        printf("cpu: %.3f usec/msg\n", (double)cpu / n);
+    }
+
+    /* latency */
+    n = count < EXP_BENCH_ROUNDTRIP ? count : EXP_BENCH_ROUNDTRIP;
+
+    start = _clock();
+
+    n = _bench(context, endpoint, n, size, ZMQ_REP);
+
+    elapsed = _clock() - start;
+
+    if (n > 0) {
+        printf("latency: %.3f usec (round trip: %d)\n",
+               (double)elapsed / n / 2, n);
+    }
+
+    zmq_ctx_destroy(context);
+
+    return 0;
+}
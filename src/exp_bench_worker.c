@@ -0,0 +1,138 @@
+/*
+ * Example benchmark (zlmb-worker: command and plugin)
+ *
+ * Usage: exp-bench-worker ENDPOINT [COUNT] [SIZE]
+ *
+ * % exp-bench-worker tcp://127.0.0.1:5560 10000 100
+ *
+ * % zlmb-worker -v -e tcp://127.0.0.1:5560 -c exp-worker-exec -- -f /dev/null
+ * % zlmb-worker -v -e tcp://127.0.0.1:5560 -p ./exp-worker-plugin.so -- -f /dev/null
+ *
+ * zlmb-worker (-v) reports the handler time per message at exit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <libgen.h>
+#include <time.h>
+
+#include <zmq.h>
+
+#define _ERR(...) fprintf(stderr, "ERR: "__VA_ARGS__)
+
+#define EXP_BENCH_COUNT 10000
+#define EXP_BENCH_SIZE  100
+
+static uint64_t
+_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+_usage(char *arg)
+{
+    char *command = basename(arg);
+
+    printf("Usage: %s ENDPOINT [COUNT] [SIZE]\n\n", command);
+
+    printf("  ENDPOINT    bind endpoint (zlmb-worker -e ENDPOINT)\n");
+    printf("  COUNT       messages [ %d (DEFAULT) ]\n", EXP_BENCH_COUNT);
+    printf("  SIZE        message size [ %d (DEFAULT) ]\n", EXP_BENCH_SIZE);
+}
+
+int
+main (int argc, char **argv)
+{
+    int i, count = EXP_BENCH_COUNT, size = EXP_BENCH_SIZE, hwm = 1;
+    char *endpoint = NULL, *buf;
+    void *context, *socket;
+    uint64_t start = 0, elapsed;
+
+    if (argc <= 1) {
+        _usage(argv[0]);
+        return -1;
+    }
+
+    endpoint = argv[1];
+
+    if (argc > 2) {
+        count = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        size = atoi(argv[3]);
+    }
+
+    if (count <= 0 || size <= 0) {
+        _usage(argv[0]);
+        return -1;
+    }
+
+    buf = (char *)malloc(size);
+    if (!buf) {
+        _ERR("Memory allocate.\n");
+        return -1;
+    }
+
+    memset(buf, 'x', size);
+
+    context = zmq_ctx_new();
+    if (!context) {
+        _ERR("ZeroMQ context: %s\n", zmq_strerror(errno));
+        free(buf);
+        return -1;
+    }
+
+    socket = zmq_socket(context, ZMQ_PUSH);
+    if (!socket) {
+        _ERR("ZeroMQ socket: %s\n", zmq_strerror(errno));
+        zmq_ctx_destroy(context);
+        free(buf);
+        return -1;
+    }
+
+    /* queue: send paced by the worker */
+    zmq_setsockopt(socket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+
+    if (zmq_bind(socket, endpoint) == -1) {
+        _ERR("ZeroMQ bind: %s: %s\n", endpoint, zmq_strerror(errno));
+        zmq_close(socket);
+        zmq_ctx_destroy(context);
+        free(buf);
+        return -1;
+    }
+
+    printf("endpoint: %s\n", endpoint);
+    printf("message: count=%d size=%d\n", count, size);
+
+    for (i = 0; i < count; i++) {
+        /* start: worker connected (first send blocks until then) */
+        if (zmq_send(socket, buf, size, 0) == -1) {
+            _ERR("ZeroMQ send: %s\n", zmq_strerror(errno));
+            break;
+        }
+        if (i == 0) {
+            start = _clock();
+        }
+    }
+
+    elapsed = _clock() - start;
+
+    if (i > 1 && elapsed > 0) {
+        printf("throughput: %.0f msg/sec %.3f usec/msg\n",
+               (double)(i - 1) * 1000000 / elapsed,
+               (double)elapsed / (i - 1));
+    }
+
+    zmq_close(socket);
+    zmq_ctx_destroy(context);
+    free(buf);
+
+    return 0;
+}
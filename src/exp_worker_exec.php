@@ -6,6 +6,7 @@
  * Usage: exp_worker_exec.php
  *
  * zlmb-worker -e tcp://127.0.0.1:5560 -c exp_worker_exec.php
+ * zlmb-worker -e tcp://127.0.0.1:5560 -F tcp://127.0.0.1:9000 -c /path/to/exp_worker_exec.php
  */
 
 //Init zlmb
@@ -14,8 +15,8 @@ $zlmb_frame_length = 0;
 $zlmb_length = 0;
 $zlmb_buffer = '';
 
-//Read STDIN (Get zlmb buffer)
-$fp = fopen('php://stdin', 'r');
+//Read STDIN (Get zlmb buffer, php-fpm: request body)
+$fp = fopen(PHP_SAPI === 'fpm-fcgi' ? 'php://input' : 'php://stdin', 'r');
 if ($fp) {
     stream_set_blocking($fp, false);
     while (!feof($fp)) {
@@ -0,0 +1,242 @@
+/*
+ * Example worker plugin (exp-worker-exec in the worker thread)
+ *
+ * Usage: exp-worker-plugin.so [-f FILE]
+ *
+ * zlmb-worker -e tcp://127.0.0.1:5560 -p ./exp-worker-plugin.so [-- -f /path/to/output]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/file.h>
+
+#include "plugin.h"
+
+#define _ERR(...) fprintf(stderr, "ERR: "__VA_ARGS__)
+
+/* output: written at flush (or when the buffer is large) */
+#define EXP_PLUGIN_BUFFER 65536
+
+typedef struct {
+    const char *command;
+    char *filename;
+    int fd;
+    FILE *stream;
+    char *buf;
+    size_t len;
+} exp_plugin_t;
+
+/* threads of a worker: one output at a time (flock: other processes) */
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+_open(exp_plugin_t *self)
+{
+    self->buf = NULL;
+    self->len = 0;
+
+    self->stream = open_memstream(&self->buf, &self->len);
+    if (!self->stream) {
+        _ERR("Memory stream open.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+_write(exp_plugin_t *self)
+{
+    int ret = 0;
+
+    if (!self->stream) {
+        return 0;
+    }
+
+    fclose(self->stream);
+    self->stream = NULL;
+
+    if (self->len > 0) {
+        char *data = self->buf;
+        size_t size = self->len;
+
+        pthread_mutex_lock(&_mutex);
+
+        if (flock(self->fd, LOCK_EX) == 0) {
+            while (size > 0) {
+                ssize_t len = write(self->fd, data, size);
+                if (len <= 0) {
+                    _ERR("Write log file: %s\n",
+                         self->filename ? self->filename : "stdout");
+                    ret = -1;
+                    break;
+                }
+                data += len;
+                size -= len;
+            }
+            flock(self->fd, LOCK_UN);
+        } else {
+            _ERR("Lock log file: %s\n",
+                 self->filename ? self->filename : "stdout");
+            ret = -1;
+        }
+
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    free(self->buf);
+    self->buf = NULL;
+    self->len = 0;
+
+    return ret;
+}
+
+static void *
+_init(int argc, char **argv)
+{
+    exp_plugin_t *self;
+    const char *command;
+    int i;
+
+    self = (exp_plugin_t *)malloc(sizeof(exp_plugin_t));
+    if (!self) {
+        _ERR("Memory allocate.\n");
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(exp_plugin_t));
+
+    command = strrchr(argv[0], '/');
+    self->command = command ? command + 1 : argv[0];
+
+    /* getopt: not per thread */
+    for (i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-f") == 0 ||
+             strcmp(argv[i], "--file") == 0) && i + 1 < argc) {
+            self->filename = argv[++i];
+        } else if (strncmp(argv[i], "--file=", 7) == 0) {
+            self->filename = argv[i] + 7;
+        }
+    }
+
+    if (self->filename) {
+        self->fd = open(self->filename, O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (self->fd == -1) {
+            _ERR("Open log file: %s\n", self->filename);
+            free(self);
+            return NULL;
+        }
+    } else {
+        self->fd = STDOUT_FILENO;
+    }
+
+    if (_open(self) != 0) {
+        if (self->filename) {
+            close(self->fd);
+        }
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static int
+_flush(void *state)
+{
+    exp_plugin_t *self = (exp_plugin_t *)state;
+    int ret;
+
+    ret = _write(self);
+
+    if (_open(self) != 0) {
+        return -1;
+    }
+
+    return ret;
+}
+
+static int
+_batch(void *state, const zlmb_plugin_message_t *messages, size_t count)
+{
+    exp_plugin_t *self = (exp_plugin_t *)state;
+    char date[20];
+    struct tm tm;
+    time_t now;
+    size_t i, j;
+
+    if (!self->stream && _open(self) != 0) {
+        return -1;
+    }
+
+    time(&now);
+    localtime_r(&now, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+
+    for (i = 0; i < count; i++) {
+        const zlmb_plugin_message_t *message = &messages[i];
+        size_t length = 0;
+
+        fprintf(self->stream, "%s: %s\n", self->command, date);
+        fprintf(self->stream, "ZLMB_FRAME:%ld\n", (long)message->count);
+
+        fprintf(self->stream, "ZLMB_FRAME_LENGTH:");
+        for (j = 0; j < message->count; j++) {
+            fprintf(self->stream, j ? ":%ld" : "%ld",
+                    (long)message->frames[j].size);
+            length += message->frames[j].size;
+        }
+        fprintf(self->stream, "\n");
+
+        fprintf(self->stream, "ZLMB_LENGTH:%ld\n", (long)length);
+
+        fprintf(self->stream, "ZLMB_BUFFER:");
+        for (j = 0; j < message->count; j++) {
+            fwrite(message->frames[j].data, 1, message->frames[j].size,
+                   self->stream);
+        }
+        fprintf(self->stream, "\n");
+
+        fprintf(self->stream, "----------\n");
+    }
+
+    /* len: updated by fflush */
+    fflush(self->stream);
+    if (self->len >= EXP_PLUGIN_BUFFER) {
+        return _flush(self);
+    }
+
+    return 0;
+}
+
+static void
+_shutdown(void *state)
+{
+    exp_plugin_t *self = (exp_plugin_t *)state;
+
+    if (!self) {
+        return;
+    }
+
+    _write(self);
+
+    if (self->filename) {
+        close(self->fd);
+    }
+
+    free(self);
+}
+
+zlmb_plugin_t zlmb_plugin = {
+    ZLMB_PLUGIN_ABI,
+    "exp-worker-plugin",
+    _init,
+    _batch,
+    _flush,
+    _shutdown
+};
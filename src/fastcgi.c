@@ -0,0 +1,626 @@
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "fastcgi.h"
+
+/*
+ * fastcgi: responder client (FastCGI 1.0, php-fpm)
+ *   one request at a time on a kept connection (FCGI_KEEP_CONN),
+ *   connected again when the server closed it (pm.max_requests)
+ *
+ *   params: "NAME=VALUE" strings (like environ)
+ *   stdin:  iovec (frames)
+ *   request: records in one buffer (one send per message)
+ */
+
+#define ZLMB_FASTCGI_VERSION          1
+#define ZLMB_FASTCGI_BEGIN_REQUEST    1
+#define ZLMB_FASTCGI_END_REQUEST      3
+#define ZLMB_FASTCGI_PARAMS           4
+#define ZLMB_FASTCGI_STDIN            5
+#define ZLMB_FASTCGI_RESPONDER        1
+#define ZLMB_FASTCGI_KEEP_CONN        1
+#define ZLMB_FASTCGI_REQUEST_COMPLETE 0
+#define ZLMB_FASTCGI_REQUEST_ID       1
+#define ZLMB_FASTCGI_HEADER_SIZE      8
+
+static int
+_fastcgi_grow(char **buf, size_t *size, size_t need)
+{
+    size_t len = *size ? *size : BUFSIZ;
+    void *tmp;
+
+    if (need <= *size) {
+        return 0;
+    }
+
+    while (len < need) {
+        len *= 2;
+    }
+
+    tmp = realloc(*buf, len);
+    if (!tmp) {
+        return -1;
+    }
+
+    *buf = (char *)tmp;
+    *size = len;
+
+    return 0;
+}
+
+static int
+_fastcgi_append(zlmb_fastcgi_t *self, const void *data, size_t len)
+{
+    if (_fastcgi_grow(&self->request, &self->request_size,
+                      self->request_length + len) != 0) {
+        return -1;
+    }
+
+    memcpy(self->request + self->request_length, data, len);
+    self->request_length += len;
+
+    return 0;
+}
+
+static void
+_fastcgi_header(unsigned char *buf, int type, size_t len, size_t padding)
+{
+    buf[0] = ZLMB_FASTCGI_VERSION;
+    buf[1] = (unsigned char)type;
+    buf[2] = (ZLMB_FASTCGI_REQUEST_ID >> 8) & 0xff;
+    buf[3] = ZLMB_FASTCGI_REQUEST_ID & 0xff;
+    buf[4] = (len >> 8) & 0xff;
+    buf[5] = len & 0xff;
+    buf[6] = (unsigned char)padding;
+    buf[7] = 0;
+}
+
+/* stream: content split into records (padded to 8 bytes), empty record */
+static int
+_fastcgi_record(zlmb_fastcgi_t *self, int type,
+                const struct iovec *iov, int iovcnt)
+{
+    unsigned char header[ZLMB_FASTCGI_HEADER_SIZE], padding[8];
+    size_t total = 0, offset = 0;
+    int i;
+
+    memset(padding, 0, sizeof(padding));
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+
+    i = 0;
+    while (total > 0) {
+        size_t len = total, pad, left;
+
+        if (len > ZLMB_FASTCGI_RECORD_SIZE) {
+            len = ZLMB_FASTCGI_RECORD_SIZE;
+        }
+        pad = (8 - (len % 8)) % 8;
+
+        _fastcgi_header(header, type, len, pad);
+        if (_fastcgi_append(self, header, sizeof(header)) != 0) {
+            return -1;
+        }
+
+        left = len;
+        while (left > 0) {
+            size_t n = iov[i].iov_len - offset;
+            if (n > left) {
+                n = left;
+            }
+            if (n > 0 &&
+                _fastcgi_append(self, (char *)iov[i].iov_base + offset,
+                                n) != 0) {
+                return -1;
+            }
+            offset += n;
+            left -= n;
+            if (offset == iov[i].iov_len) {
+                i++;
+                offset = 0;
+            }
+        }
+
+        if (pad > 0 && _fastcgi_append(self, padding, pad) != 0) {
+            return -1;
+        }
+
+        total -= len;
+    }
+
+    _fastcgi_header(header, type, 0, 0);
+
+    return _fastcgi_append(self, header, sizeof(header));
+}
+
+static size_t
+_fastcgi_length(unsigned char *buf, size_t len)
+{
+    if (len < 128) {
+        buf[0] = (unsigned char)len;
+        return 1;
+    }
+
+    buf[0] = ((len >> 24) & 0x7f) | 0x80;
+    buf[1] = (len >> 16) & 0xff;
+    buf[2] = (len >> 8) & 0xff;
+    buf[3] = len & 0xff;
+
+    return 4;
+}
+
+/* name-value pair: "NAME=VALUE" */
+static int
+_fastcgi_pair(zlmb_fastcgi_t *self, const char *param)
+{
+    const char *value = strchr(param, '=');
+    size_t nlen, vlen;
+    unsigned char *buf;
+
+    if (!value || value == param) {
+        return 0;
+    }
+
+    nlen = value - param;
+    value++;
+    vlen = strlen(value);
+
+    if (_fastcgi_grow(&self->params, &self->params_size,
+                      self->params_length + 8 + nlen + vlen) != 0) {
+        return -1;
+    }
+
+    buf = (unsigned char *)self->params + self->params_length;
+    buf += _fastcgi_length(buf, nlen);
+    buf += _fastcgi_length(buf, vlen);
+    memcpy(buf, param, nlen);
+    memcpy(buf + nlen, value, vlen);
+
+    self->params_length = (char *)buf + nlen + vlen - self->params;
+
+    return 0;
+}
+
+static int
+_fastcgi_tcp(const char *address)
+{
+    struct addrinfo hints, *res = NULL, *ai;
+    char *str, *host, *port, *end;
+    int fd = -1, nodelay = 1;
+
+    str = strdup(address);
+    if (!str) {
+        return -1;
+    }
+
+    /* [host]:port, host:port */
+    host = str;
+    if (*host == '[') {
+        host++;
+        end = strchr(host, ']');
+        if (!end || *(end + 1) != ':') {
+            free(str);
+            errno = EINVAL;
+            return -1;
+        }
+        *end = '\0';
+        port = end + 2;
+    } else {
+        port = strrchr(host, ':');
+        if (!port) {
+            free(str);
+            errno = EINVAL;
+            return -1;
+        }
+        *port++ = '\0';
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(*host ? host : NULL, port, &hints, &res) != 0) {
+        free(str);
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                    ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+                       &nodelay, sizeof(nodelay));
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+    free(str);
+
+    return fd;
+}
+
+static int
+_fastcgi_unix(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int
+_fastcgi_connect(zlmb_fastcgi_t *self)
+{
+    struct timeval tv;
+    size_t len;
+    int fd;
+
+    len = strlen(ZLMB_FASTCGI_ENDPOINT_UNIX);
+    if (strncmp(self->endpoint, ZLMB_FASTCGI_ENDPOINT_UNIX, len) == 0) {
+        fd = _fastcgi_unix(self->endpoint + len);
+    } else {
+        len = strlen(ZLMB_FASTCGI_ENDPOINT_TCP);
+        if (strncmp(self->endpoint, ZLMB_FASTCGI_ENDPOINT_TCP, len) != 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        fd = _fastcgi_tcp(self->endpoint + len);
+    }
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    /* timeout: a hung script does not block the thread forever */
+    if (self->timeout > 0) {
+        tv.tv_sec = self->timeout / 1000;
+        tv.tv_usec = (self->timeout % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    self->fd = fd;
+    self->connects++;
+
+    return 0;
+}
+
+static void
+_fastcgi_close(zlmb_fastcgi_t *self)
+{
+    int err = errno;
+
+    if (self->fd != -1) {
+        close(self->fd);
+        self->fd = -1;
+    }
+
+    errno = err;
+}
+
+static int
+_fastcgi_send(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                errno = ETIMEDOUT;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int
+_fastcgi_read(int fd, void *data, size_t len)
+{
+    char *buf = (char *)data;
+
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n == 0) {
+            errno = ECONNRESET;
+            return -1;
+        } else if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                errno = ETIMEDOUT;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int
+_fastcgi_receive(zlmb_fastcgi_t *self, zlmb_fastcgi_output_t output,
+                 void *arg, int *status, int *received)
+{
+    unsigned char header[ZLMB_FASTCGI_HEADER_SIZE];
+
+    while (1) {
+        unsigned char *body = (unsigned char *)self->buffer;
+        size_t len, padding;
+        int type, id;
+
+        if (_fastcgi_read(self->fd, header, sizeof(header)) != 0) {
+            return -1;
+        }
+
+        *received = 1;
+
+        if (header[0] != ZLMB_FASTCGI_VERSION) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        type = header[1];
+        id = (header[2] << 8) | header[3];
+        len = (header[4] << 8) | header[5];
+        padding = header[6];
+
+        if (len + padding > 0 &&
+            _fastcgi_read(self->fd, self->buffer, len + padding) != 0) {
+            return -1;
+        }
+
+        /* management records (id 0) */
+        if (id != ZLMB_FASTCGI_REQUEST_ID) {
+            continue;
+        }
+
+        if (type == ZLMB_FASTCGI_END_REQUEST) {
+            if (len < 8) {
+                errno = EPROTO;
+                return -1;
+            }
+            if (status) {
+                *status = (int)(((uint32_t)body[0] << 24) |
+                                ((uint32_t)body[1] << 16) |
+                                ((uint32_t)body[2] << 8) | body[3]);
+            }
+            /* overloaded, unknown role, no multiplexing */
+            if (body[4] != ZLMB_FASTCGI_REQUEST_COMPLETE) {
+                errno = EPROTO;
+                return -1;
+            }
+            return 0;
+        }
+
+        if ((type == ZLMB_FASTCGI_STDOUT || type == ZLMB_FASTCGI_STDERR) &&
+            len > 0 && output && output(arg, type, self->buffer, len) != 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+}
+
+zlmb_fastcgi_t *
+zlmb_fastcgi_init(const char *endpoint, int timeout)
+{
+    zlmb_fastcgi_t *self;
+
+    if (!endpoint || strlen(endpoint) == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = (zlmb_fastcgi_t *)malloc(sizeof(zlmb_fastcgi_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_fastcgi_t));
+
+    self->fd = -1;
+    self->timeout = timeout;
+
+    self->endpoint = strdup(endpoint);
+    if (!self->endpoint) {
+        free(self);
+        return NULL;
+    }
+
+    /* record content and padding */
+    self->buffer = (char *)malloc(ZLMB_FASTCGI_RECORD_SIZE + 256);
+    if (!self->buffer) {
+        free(self->endpoint);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+zlmb_fastcgi_destroy(zlmb_fastcgi_t **self)
+{
+    if (*self) {
+        _fastcgi_close(*self);
+        if ((*self)->endpoint) {
+            free((*self)->endpoint);
+        }
+        if ((*self)->buffer) {
+            free((*self)->buffer);
+        }
+        if ((*self)->params) {
+            free((*self)->params);
+        }
+        if ((*self)->request) {
+            free((*self)->request);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+/* status: application status of FCGI_END_REQUEST */
+int
+zlmb_fastcgi_request(zlmb_fastcgi_t *self, char **params,
+                     const struct iovec *iov, int iovcnt,
+                     zlmb_fastcgi_output_t output, void *arg, int *status)
+{
+    unsigned char begin[ZLMB_FASTCGI_HEADER_SIZE + 8];
+    struct iovec pairs;
+    int i, attempts;
+
+    if (!self || !params) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->params_length = 0;
+    self->request_length = 0;
+
+    for (i = 0; params[i]; i++) {
+        if (_fastcgi_pair(self, params[i]) != 0) {
+            return -1;
+        }
+    }
+
+    _fastcgi_header(begin, ZLMB_FASTCGI_BEGIN_REQUEST, 8, 0);
+    memset(begin + ZLMB_FASTCGI_HEADER_SIZE, 0, 8);
+    begin[ZLMB_FASTCGI_HEADER_SIZE + 1] = ZLMB_FASTCGI_RESPONDER;
+    begin[ZLMB_FASTCGI_HEADER_SIZE + 2] = ZLMB_FASTCGI_KEEP_CONN;
+
+    pairs.iov_base = self->params;
+    pairs.iov_len = self->params_length;
+
+    if (_fastcgi_append(self, begin, sizeof(begin)) != 0 ||
+        _fastcgi_record(self, ZLMB_FASTCGI_PARAMS, &pairs, 1) != 0 ||
+        _fastcgi_record(self, ZLMB_FASTCGI_STDIN, iov, iovcnt) != 0) {
+        return -1;
+    }
+
+    /* kept connection: closed by the server before the request */
+    for (attempts = 0; attempts < 2; attempts++) {
+        int fresh = 0, received = 0;
+
+        if (self->fd == -1) {
+            if (_fastcgi_connect(self) != 0) {
+                return -1;
+            }
+            fresh = 1;
+        }
+
+        if (_fastcgi_send(self->fd, self->request,
+                          self->request_length) == 0 &&
+            _fastcgi_receive(self, output, arg, status, &received) == 0) {
+            self->requests++;
+            return 0;
+        }
+
+        _fastcgi_close(self);
+
+        if (fresh || received || (errno != EPIPE && errno != ECONNRESET)) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+/* CGI response: "Status:" header (DEFAULT: 200), offset of the body */
+int
+zlmb_fastcgi_response(const char *buf, size_t len, size_t *offset)
+{
+    const char *p = buf, *end = buf + len;
+    int status = 200;
+
+    if (offset) {
+        *offset = 0;
+    }
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t n;
+
+        if (!eol) {
+            break;
+        }
+
+        n = eol - p;
+        if (n > 0 && p[n-1] == '\r') {
+            n--;
+        }
+
+        if (n == 0) {
+            if (offset) {
+                *offset = eol + 1 - buf;
+            }
+            return status;
+        }
+
+        /* not a header: body only */
+        if (!memchr(p, ':', n)) {
+            break;
+        }
+
+        if (n > 7 && strncasecmp(p, "Status:", 7) == 0) {
+            status = atoi(p + 7);
+        }
+
+        p = eol + 1;
+    }
+
+    return 200;
+}
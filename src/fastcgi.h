@@ -0,0 +1,45 @@
+#ifndef __ZLMB_FASTCGI_H__
+#define __ZLMB_FASTCGI_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#define ZLMB_FASTCGI_ENDPOINT_TCP  "tcp://"
+#define ZLMB_FASTCGI_ENDPOINT_UNIX "unix://"
+
+#define ZLMB_FASTCGI_TIMEOUT     30000
+#define ZLMB_FASTCGI_RECORD_SIZE 65535
+
+/* record types passed to the output callback */
+#define ZLMB_FASTCGI_STDOUT 6
+#define ZLMB_FASTCGI_STDERR 7
+
+typedef int (*zlmb_fastcgi_output_t)(void *arg, int type,
+                                     const char *buf, size_t len);
+
+typedef struct zlmb_fastcgi {
+    char *endpoint;
+    int fd;
+    int timeout;
+    char *buffer;
+    char *params;
+    size_t params_size;
+    size_t params_length;
+    char *request;
+    size_t request_size;
+    size_t request_length;
+    uint64_t requests;
+    uint64_t connects;
+} zlmb_fastcgi_t;
+
+zlmb_fastcgi_t * zlmb_fastcgi_init(const char *endpoint, int timeout);
+void zlmb_fastcgi_destroy(zlmb_fastcgi_t **self);
+int zlmb_fastcgi_request(zlmb_fastcgi_t *self, char **params,
+                         const struct iovec *iov, int iovcnt,
+                         zlmb_fastcgi_output_t output, void *arg,
+                         int *status);
+
+int zlmb_fastcgi_response(const char *buf, size_t len, size_t *offset);
+
+#endif
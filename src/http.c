@@ -0,0 +1,560 @@
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "http.h"
+
+/*
+ * http: HTTP/1.1 POST client (webhook)
+ *   kept connection (keep-alive), requests pipelined by the caller:
+ *   zlmb_http_send() N times, then zlmb_http_recv() N times (in order)
+ *
+ *   closed connection: requests without a response are lost
+ *   (sent again by the caller)
+ *
+ *   reused: the last request was sent on a kept connection, which the
+ *   server may have closed before reading it
+ */
+
+static int
+_http_connect(zlmb_http_t *self)
+{
+    struct addrinfo hints, *res = NULL, *ai;
+    struct timeval tv;
+    int fd = -1, nodelay = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(self->host, self->port, &hints, &res) != 0) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                    ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    if (self->timeout > 0) {
+        tv.tv_sec = self->timeout / 1000;
+        tv.tv_usec = (self->timeout % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    }
+
+    self->fd = fd;
+    self->close = 0;
+    self->sent = 0;
+    self->pending = 0;
+    self->buffer_offset = 0;
+    self->buffer_length = 0;
+    self->connects++;
+
+    return 0;
+}
+
+static int
+_http_sendv(int fd, struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg;
+
+    while (iovcnt > 0) {
+        ssize_t n;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                errno = ETIMEDOUT;
+            }
+            return -1;
+        }
+
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 0;
+}
+
+/* kept connection without a request: closed by the server (or data) */
+static int
+_http_idle(zlmb_http_t *self)
+{
+    int err = errno;
+    char c;
+    ssize_t n;
+
+    n = recv(self->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+                    errno == EINTR)) {
+        errno = err;
+        return 0;
+    }
+
+    errno = err;
+
+    return -1;
+}
+
+/* bytes read, 0: closed by the server, -1: error */
+static ssize_t
+_http_fill(zlmb_http_t *self)
+{
+    ssize_t n;
+
+    if (self->buffer_offset > 0) {
+        memmove(self->buffer, self->buffer + self->buffer_offset,
+                self->buffer_length - self->buffer_offset);
+        self->buffer_length -= self->buffer_offset;
+        self->buffer_offset = 0;
+    }
+
+    while (1) {
+        n = recv(self->fd, self->buffer + self->buffer_length,
+                 self->buffer_size - self->buffer_length, 0);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        break;
+    }
+
+    if (n == -1 && errno == EAGAIN) {
+        errno = ETIMEDOUT;
+    } else if (n > 0) {
+        self->buffer_length += n;
+    }
+
+    return n;
+}
+
+/* line without CRLF (NUL terminated, valid until the next read) */
+static char *
+_http_line(zlmb_http_t *self, size_t *len)
+{
+    while (1) {
+        char *line = self->buffer + self->buffer_offset;
+        size_t left = self->buffer_length - self->buffer_offset;
+        char *eol = memchr(line, '\n', left);
+        ssize_t n;
+
+        if (eol) {
+            *len = eol - line;
+            if (*len > 0 && line[*len - 1] == '\r') {
+                (*len)--;
+            }
+            line[*len] = '\0';
+            self->buffer_offset = eol + 1 - self->buffer;
+            return line;
+        }
+
+        if (left >= ZLMB_HTTP_LINE_SIZE) {
+            errno = EPROTO;
+            return NULL;
+        }
+
+        n = _http_fill(self);
+        if (n <= 0) {
+            if (n == 0) {
+                errno = ECONNRESET;
+            }
+            return NULL;
+        }
+    }
+}
+
+/* body: read and discarded */
+static int
+_http_skip(zlmb_http_t *self, size_t len)
+{
+    while (len > 0) {
+        size_t left = self->buffer_length - self->buffer_offset;
+        ssize_t n;
+
+        if (left > 0) {
+            if (left > len) {
+                left = len;
+            }
+            self->buffer_offset += left;
+            len -= left;
+            continue;
+        }
+
+        n = _http_fill(self);
+        if (n <= 0) {
+            if (n == 0) {
+                errno = ECONNRESET;
+            }
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+_http_chunked(zlmb_http_t *self)
+{
+    char *line;
+    size_t len;
+
+    while (1) {
+        unsigned long long size;
+
+        line = _http_line(self, &len);
+        if (!line) {
+            return -1;
+        }
+
+        size = strtoull(line, NULL, 16);
+        if (size == 0) {
+            break;
+        }
+
+        if (_http_skip(self, (size_t)size) != 0 ||
+            !_http_line(self, &len)) {
+            return -1;
+        }
+    }
+
+    /* trailer */
+    do {
+        line = _http_line(self, &len);
+        if (!line) {
+            return -1;
+        }
+    } while (len > 0);
+
+    return 0;
+}
+
+static int
+_http_response(zlmb_http_t *self, int *status)
+{
+    unsigned long long length = 0;
+    int code, chunked, has_length;
+    char *line;
+    size_t len;
+
+    /* interim responses (1xx): skipped */
+    do {
+        line = _http_line(self, &len);
+        if (!line) {
+            return -1;
+        }
+
+        if (len < 12 || strncmp(line, "HTTP/1.", 7) != 0) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        code = atoi(line + 9);
+        self->close = (line[7] == '0');
+        chunked = 0;
+        has_length = 0;
+
+        while (1) {
+            line = _http_line(self, &len);
+            if (!line) {
+                return -1;
+            }
+            if (len == 0) {
+                break;
+            }
+
+            if (strncasecmp(line, "Content-Length:", 15) == 0) {
+                length = strtoull(line + 15, NULL, 10);
+                has_length = 1;
+            } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+                chunked = (strcasestr(line + 18, "chunked") != NULL);
+            } else if (strncasecmp(line, "Connection:", 11) == 0) {
+                if (strcasestr(line + 11, "close")) {
+                    self->close = 1;
+                } else if (strcasestr(line + 11, "keep-alive")) {
+                    self->close = 0;
+                }
+            }
+        }
+    } while (code >= 100 && code < 200);
+
+    if (chunked) {
+        if (_http_chunked(self) != 0) {
+            return -1;
+        }
+    } else if (has_length) {
+        if (_http_skip(self, (size_t)length) != 0) {
+            return -1;
+        }
+    } else if (code != 204 && code != 304) {
+        /* body until the server closes */
+        ssize_t n;
+        while ((n = _http_fill(self)) > 0) {
+            self->buffer_offset = self->buffer_length;
+        }
+        if (n == -1) {
+            return -1;
+        }
+        self->close = 1;
+    }
+
+    if (status) {
+        *status = code;
+    }
+
+    return 0;
+}
+
+zlmb_http_t *
+zlmb_http_init(const char *url, int timeout)
+{
+    zlmb_http_t *self;
+    const char *authority, *path;
+    char *colon;
+    size_t len;
+
+    len = strlen(ZLMB_HTTP_SCHEME);
+    if (!url || strncmp(url, ZLMB_HTTP_SCHEME, len) != 0) {
+        /* https: not supported (no TLS library) */
+        errno = (url && strncmp(url, "https://", 8) == 0)
+            ? EPROTONOSUPPORT : EINVAL;
+        return NULL;
+    }
+
+    self = (zlmb_http_t *)malloc(sizeof(zlmb_http_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_http_t));
+
+    self->fd = -1;
+    self->timeout = timeout;
+
+    /* http://host[:port][/path], http://[v6]:port/path */
+    authority = url + len;
+    path = strchr(authority, '/');
+    len = path ? (size_t)(path - authority) : strlen(authority);
+    if (!path) {
+        path = "/";
+    }
+
+    if (*authority == '[') {
+        const char *end = memchr(authority, ']', len);
+        if (end) {
+            self->host = strndup(authority + 1, end - authority - 1);
+            if (end + 1 < authority + len && *(end + 1) == ':') {
+                self->port = strndup(end + 2, authority + len - end - 2);
+            }
+        }
+    } else {
+        self->host = strndup(authority, len);
+        if (self->host) {
+            colon = strrchr(self->host, ':');
+            if (colon) {
+                *colon = '\0';
+                self->port = strdup(colon + 1);
+            }
+        }
+    }
+
+    if (!self->port) {
+        self->port = strdup("80");
+    }
+
+    self->path = strdup(path);
+
+    if (asprintf(&self->header, "POST %s HTTP/1.1\r\nHost: %.*s\r\n",
+                 path, (int)len, authority) == -1) {
+        self->header = NULL;
+    }
+
+    self->buffer_size = BUFSIZ * 2;
+    self->buffer = (char *)malloc(self->buffer_size);
+
+    if (!self->host || !self->port || !self->path ||
+        !self->header || !self->buffer) {
+        zlmb_http_destroy(&self);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (*self->host == '\0' || *self->port == '\0') {
+        zlmb_http_destroy(&self);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+zlmb_http_destroy(zlmb_http_t **self)
+{
+    if (*self) {
+        zlmb_http_close(*self);
+        if ((*self)->host) {
+            free((*self)->host);
+        }
+        if ((*self)->port) {
+            free((*self)->port);
+        }
+        if ((*self)->path) {
+            free((*self)->path);
+        }
+        if ((*self)->header) {
+            free((*self)->header);
+        }
+        if ((*self)->buffer) {
+            free((*self)->buffer);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+void
+zlmb_http_close(zlmb_http_t *self)
+{
+    int err = errno;
+
+    if (self && self->fd != -1) {
+        close(self->fd);
+        self->fd = -1;
+        self->pending = 0;
+    }
+
+    errno = err;
+}
+
+int
+zlmb_http_send(zlmb_http_t *self, const char *type,
+               const char *body, size_t len)
+{
+    char fields[256];
+    struct iovec iov[3];
+    int n, attempts;
+
+    if (!self) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (self->fd != -1 && self->pending == 0 && _http_idle(self) != 0) {
+        zlmb_http_close(self);
+    }
+
+    n = snprintf(fields, sizeof(fields),
+                 "Content-Type: %s\r\nContent-Length: %lu\r\n\r\n",
+                 type ? type : "application/octet-stream",
+                 (unsigned long)len);
+
+    /* kept connection: closed by the server before the request */
+    for (attempts = 0; attempts < 2; attempts++) {
+        size_t pending;
+
+        if (self->fd == -1 && _http_connect(self) != 0) {
+            self->reused = 0;
+            return -1;
+        }
+
+        self->reused = (self->sent > 0);
+
+        iov[0].iov_base = self->header;
+        iov[0].iov_len = strlen(self->header);
+        iov[1].iov_base = fields;
+        iov[1].iov_len = n;
+        iov[2].iov_base = (void *)body;
+        iov[2].iov_len = len;
+
+        if (_http_sendv(self->fd, iov, 3) == 0) {
+            self->sent++;
+            self->pending++;
+            self->requests++;
+            return 0;
+        }
+
+        pending = self->pending;
+
+        zlmb_http_close(self);
+
+        if (!self->reused || pending > 0 ||
+            (errno != EPIPE && errno != ECONNRESET)) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+/* response of the oldest request: status code (body discarded) */
+int
+zlmb_http_recv(zlmb_http_t *self, int *status)
+{
+    if (!self || self->fd == -1) {
+        errno = ENOTCONN;
+        return -1;
+    }
+
+    if (_http_response(self, status) != 0) {
+        zlmb_http_close(self);
+        return -1;
+    }
+
+    if (self->pending > 0) {
+        self->pending--;
+    }
+
+    /* Connection: close (next requests are sent again) */
+    if (self->close) {
+        zlmb_http_close(self);
+    }
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef __ZLMB_HTTP_H__
+#define __ZLMB_HTTP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_HTTP_SCHEME    "http://"
+#define ZLMB_HTTP_TIMEOUT   30000
+#define ZLMB_HTTP_LINE_SIZE 8192
+
+typedef struct zlmb_http {
+    char *host;
+    char *port;
+    char *path;
+    char *header;
+    int fd;
+    int timeout;
+    int close;
+    int reused;
+    size_t sent;
+    size_t pending;
+    char *buffer;
+    size_t buffer_size;
+    size_t buffer_offset;
+    size_t buffer_length;
+    uint64_t requests;
+    uint64_t connects;
+} zlmb_http_t;
+
+zlmb_http_t * zlmb_http_init(const char *url, int timeout);
+void zlmb_http_destroy(zlmb_http_t **self);
+int zlmb_http_send(zlmb_http_t *self, const char *type,
+                   const char *body, size_t len);
+int zlmb_http_recv(zlmb_http_t *self, int *status);
+void zlmb_http_close(zlmb_http_t *self);
+
+#endif
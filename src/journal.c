@@ -0,0 +1,978 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "journal.h"
+#include "utils.h"
+
+/*
+ * journal: <dir>/<partition>/<base offset>.log
+ *
+ * record (host byte order):
+ *   magic(4) | frames(4) | offset(8) | timestamp(8) | { length(8) | data }...
+ *
+ * fetch request / replies (big endian):
+ *   fetch:   magic(4) | partition(4) | offset(8) | count(4)
+ *   message: magic(4) | partition(4) | offset(8)  (+ message frames)
+ *   end:     magic(4) | partition(4) | next(8) | first(8) | partitions(4)
+ *            | count(4)
+ */
+
+#define ZLMB_JOURNAL_BUFSIZ 65536
+
+static const unsigned char zlmb_journal_magic[4] = { 0x00, 0x7a, 0x6a, 0x72 };
+static const unsigned char zlmb_journal_fetch_magic[4] = {
+    0x00, 0x7a, 0x6a, 0x66
+};
+static const unsigned char zlmb_journal_message_magic[4] = {
+    0x00, 0x7a, 0x6a, 0x6d
+};
+static const unsigned char zlmb_journal_end_magic[4] = {
+    0x00, 0x7a, 0x6a, 0x65
+};
+
+static void
+_journal_put(unsigned char *buf, uint64_t val, int size)
+{
+    int i;
+
+    for (i = size - 1; i >= 0; i--) {
+        buf[i] = (unsigned char)(val & 0xff);
+        val >>= 8;
+    }
+}
+
+static uint64_t
+_journal_get(const unsigned char *buf, int size)
+{
+    int i;
+    uint64_t val = 0;
+
+    for (i = 0; i < size; i++) {
+        val = (val << 8) | buf[i];
+    }
+
+    return val;
+}
+
+static uint64_t
+_journal_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int
+_journal_mkdir(const char *path)
+{
+    char *dir, *p;
+
+    dir = strdup(path);
+    if (!dir) {
+        return -1;
+    }
+
+    for (p = dir + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+                free(dir);
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        free(dir);
+        return -1;
+    }
+
+    free(dir);
+
+    return 0;
+}
+
+void
+zlmb_journal_map_ref(zlmb_journal_map_t *map)
+{
+    if (map) {
+        __sync_fetch_and_add(&map->refs, 1);
+    }
+}
+
+void
+zlmb_journal_map_release(void *data, void *hint)
+{
+    zlmb_journal_map_t *map = (zlmb_journal_map_t *)hint;
+
+    (void)data;
+
+    if (map && __sync_sub_and_fetch(&map->refs, 1) == 0) {
+        munmap(map->addr, map->len);
+        free(map);
+    }
+}
+
+static zlmb_journal_map_t *
+_journal_map(zlmb_journal_segment_t *segment)
+{
+    zlmb_journal_map_t *map;
+
+    if (segment->map && segment->map->len >= segment->size) {
+        return segment->map;
+    }
+
+    if (segment->size == 0) {
+        return NULL;
+    }
+
+    map = (zlmb_journal_map_t *)malloc(sizeof(zlmb_journal_map_t));
+    if (!map) {
+        return NULL;
+    }
+
+    map->addr = mmap(NULL, segment->size, PROT_READ, MAP_SHARED,
+                     segment->fd, 0);
+    if (map->addr == MAP_FAILED) {
+        free(map);
+        return NULL;
+    }
+
+    map->len = segment->size;
+    map->refs = 1;
+
+    /* previous mapping: released when no message refers it */
+    if (segment->map) {
+        zlmb_journal_map_release(NULL, segment->map);
+    }
+
+    segment->map = map;
+
+    return map;
+}
+
+static int
+_journal_segment_index(zlmb_journal_segment_t *segment, uint64_t pos)
+{
+    if (segment->count == segment->alloc) {
+        size_t alloc = segment->alloc ? segment->alloc * 2 : 1024;
+        uint64_t *index;
+
+        index = (uint64_t *)realloc(segment->index, sizeof(uint64_t) * alloc);
+        if (!index) {
+            return -1;
+        }
+
+        segment->index = index;
+        segment->alloc = alloc;
+    }
+
+    segment->index[segment->count++] = pos;
+
+    return 0;
+}
+
+static void
+_journal_segment_destroy(zlmb_journal_segment_t **segment)
+{
+    if (*segment) {
+        if ((*segment)->map) {
+            zlmb_journal_map_release(NULL, (*segment)->map);
+        }
+        if ((*segment)->fd != -1) {
+            close((*segment)->fd);
+        }
+        if ((*segment)->index) {
+            free((*segment)->index);
+        }
+        if ((*segment)->path) {
+            free((*segment)->path);
+        }
+        free(*segment);
+        *segment = NULL;
+    }
+}
+
+static zlmb_journal_segment_t *
+_journal_segment_open(zlmb_journal_partition_t *partition, uint64_t base)
+{
+    zlmb_journal_segment_t *segment;
+    struct stat st;
+
+    segment = (zlmb_journal_segment_t *)malloc(sizeof(zlmb_journal_segment_t));
+    if (!segment) {
+        return NULL;
+    }
+
+    memset(segment, 0, sizeof(zlmb_journal_segment_t));
+
+    segment->base = base;
+    segment->fd = -1;
+
+    if (zlmb_utils_asprintf(&segment->path, "%s/%020llu.log", partition->dir,
+                            (unsigned long long)base) == -1) {
+        free(segment);
+        return NULL;
+    }
+
+    segment->fd = open(segment->path, O_RDWR | O_CREAT, 0644);
+    if (segment->fd == -1 || fstat(segment->fd, &st) == -1) {
+        _journal_segment_destroy(&segment);
+        return NULL;
+    }
+
+    segment->size = st.st_size;
+    segment->mtime = st.st_mtime;
+
+    return segment;
+}
+
+static void
+_journal_segment_scan(zlmb_journal_segment_t *segment, int last)
+{
+    char *addr;
+    uint64_t pos = 0;
+
+    if (segment->size == 0) {
+        return;
+    }
+
+    addr = mmap(NULL, segment->size, PROT_READ, MAP_SHARED, segment->fd, 0);
+    if (addr == MAP_FAILED) {
+        segment->size = 0;
+        return;
+    }
+
+    while (pos + ZLMB_JOURNAL_HEADER_SIZE <= segment->size) {
+        uint32_t i, frames;
+        uint64_t end = pos + ZLMB_JOURNAL_HEADER_SIZE, offset;
+
+        if (memcmp(addr + pos, zlmb_journal_magic,
+                   sizeof(zlmb_journal_magic)) != 0) {
+            break;
+        }
+
+        memcpy(&frames, addr + pos + 4, sizeof(frames));
+        memcpy(&offset, addr + pos + 8, sizeof(offset));
+
+        if (offset != segment->base + segment->count) {
+            break;
+        }
+
+        for (i = 0; i < frames; i++) {
+            uint64_t len;
+            if (end + sizeof(len) > segment->size) {
+                break;
+            }
+            memcpy(&len, addr + end, sizeof(len));
+            end += sizeof(len);
+            if (len > segment->size - end) {
+                break;
+            }
+            end += len;
+        }
+
+        if (i != frames || _journal_segment_index(segment, pos) != 0) {
+            break;
+        }
+
+        pos = end;
+    }
+
+    munmap(addr, segment->size);
+
+    /* partial record: last segment is truncated */
+    if (pos != segment->size) {
+        if (last && ftruncate(segment->fd, pos) == -1) {
+            return;
+        }
+        segment->size = pos;
+    }
+}
+
+static int
+_journal_base_compare(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int
+_journal_partition_open(zlmb_journal_t *self, zlmb_journal_partition_t *part)
+{
+    DIR *dir;
+    struct dirent *entry;
+    uint64_t *bases = NULL;
+    size_t i, count = 0, alloc = 0;
+
+    if (_journal_mkdir(part->dir) != 0) {
+        return -1;
+    }
+
+    dir = opendir(part->dir);
+    if (!dir) {
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned long long base;
+        char suffix[8];
+
+        if (strlen(entry->d_name) != 24 ||
+            sscanf(entry->d_name, "%20llu%7s", &base, suffix) != 2 ||
+            strcmp(suffix, ".log") != 0) {
+            continue;
+        }
+
+        if (count == alloc) {
+            uint64_t *tmp;
+            alloc = alloc ? alloc * 2 : 16;
+            tmp = (uint64_t *)realloc(bases, sizeof(uint64_t) * alloc);
+            if (!tmp) {
+                break;
+            }
+            bases = tmp;
+        }
+
+        bases[count++] = base;
+    }
+
+    closedir(dir);
+
+    if (count > 0) {
+        qsort(bases, count, sizeof(uint64_t), _journal_base_compare);
+    }
+
+    for (i = 0; i < count; i++) {
+        zlmb_journal_segment_t *segment;
+
+        segment = _journal_segment_open(part, bases[i]);
+        if (!segment) {
+            continue;
+        }
+
+        _journal_segment_scan(segment, i + 1 == count);
+
+        if (part->tail) {
+            part->tail->next = segment;
+        } else {
+            part->head = segment;
+        }
+        part->tail = segment;
+
+        part->next = segment->base + segment->count;
+        part->bytes += segment->size;
+    }
+
+    if (bases) {
+        free(bases);
+    }
+
+    if (!part->tail) {
+        part->head = part->tail = _journal_segment_open(part, 0);
+        if (!part->tail) {
+            return -1;
+        }
+    }
+
+    (void)self;
+
+    return 0;
+}
+
+static int
+_journal_partition_flush(zlmb_journal_partition_t *part)
+{
+    size_t len = part->buf_len, done = 0;
+
+    /* pending record is written on commit */
+    if (part->frames != (uint32_t)-1) {
+        len = part->record;
+    }
+
+    while (done < len) {
+        ssize_t n = pwrite(part->tail->fd, part->buf + done, len - done,
+                           part->tail->size + done);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        done += n;
+    }
+
+    part->tail->size += done;
+    part->bytes += done;
+
+    if (done > 0) {
+        memmove(part->buf, part->buf + done, part->buf_len - done);
+        part->buf_len -= done;
+        if (part->frames != (uint32_t)-1) {
+            part->record -= done;
+        }
+        part->dirty = 1;
+    }
+
+    return done == len ? 0 : -1;
+}
+
+static int
+_journal_partition_reserve(zlmb_journal_partition_t *part, size_t len)
+{
+    if (part->buf_len + len > part->buf_size) {
+        size_t size = part->buf_size ? part->buf_size : ZLMB_JOURNAL_BUFSIZ;
+        char *buf;
+
+        while (size < part->buf_len + len) {
+            size *= 2;
+        }
+
+        buf = (char *)realloc(part->buf, size);
+        if (!buf) {
+            return -1;
+        }
+
+        part->buf = buf;
+        part->buf_size = size;
+    }
+
+    return 0;
+}
+
+zlmb_journal_t *
+zlmb_journal_init(const char *dir, int partitions, uint64_t segment_size,
+                  uint64_t retention_size, int retention_time, int sync)
+{
+    zlmb_journal_t *self;
+    int i;
+
+    if (!dir || strlen(dir) == 0) {
+        return NULL;
+    }
+
+    if (partitions <= 0) {
+        partitions = ZLMB_JOURNAL_DEFAULT_PARTITIONS;
+    } else if (partitions > ZLMB_JOURNAL_PARTITIONS_MAX) {
+        partitions = ZLMB_JOURNAL_PARTITIONS_MAX;
+    }
+
+    self = (zlmb_journal_t *)malloc(sizeof(zlmb_journal_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_journal_t));
+
+    self->dir = strdup(dir);
+    self->partitions = partitions;
+    self->segment_size = segment_size > 0 ? segment_size
+                                          : ZLMB_JOURNAL_DEFAULT_SEGMENT;
+    self->retention_size = retention_size;
+    self->retention_time = retention_time > 0 ? retention_time : 0;
+    self->sync = sync > 0 ? sync : ZLMB_JOURNAL_DEFAULT_SYNC;
+    self->sync_next = zlmb_utils_clock() + (uint64_t)self->sync * 1000;
+
+    self->partition = (zlmb_journal_partition_t *)calloc(
+        partitions, sizeof(zlmb_journal_partition_t));
+    if (!self->dir || !self->partition) {
+        zlmb_journal_destroy(&self);
+        return NULL;
+    }
+
+    for (i = 0; i < partitions; i++) {
+        zlmb_journal_partition_t *part = &self->partition[i];
+
+        part->id = i;
+        part->frames = (uint32_t)-1;
+
+        if (zlmb_utils_asprintf(&part->dir, "%s/%03d", dir, i) == -1 ||
+            _journal_partition_open(self, part) != 0) {
+            zlmb_journal_destroy(&self);
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+void
+zlmb_journal_destroy(zlmb_journal_t **self)
+{
+    if (*self) {
+        if ((*self)->partition) {
+            int i;
+
+            (*self)->current = NULL;
+            zlmb_journal_sync(*self);
+
+            for (i = 0; i < (*self)->partitions; i++) {
+                zlmb_journal_partition_t *part = &(*self)->partition[i];
+                zlmb_journal_segment_t *segment = part->head;
+
+                while (segment) {
+                    zlmb_journal_segment_t *next = segment->next;
+                    _journal_segment_destroy(&segment);
+                    segment = next;
+                }
+                if (part->buf) {
+                    free(part->buf);
+                }
+                if (part->dir) {
+                    free(part->dir);
+                }
+            }
+            free((*self)->partition);
+        }
+        if ((*self)->dir) {
+            free((*self)->dir);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+int
+zlmb_journal_begin(zlmb_journal_t *self, const void *key, size_t len)
+{
+    zlmb_journal_partition_t *part;
+
+    if (!self) {
+        return -1;
+    }
+
+    /* discard the unfinished record */
+    if (self->current) {
+        self->current->buf_len = self->current->record;
+        self->current->frames = (uint32_t)-1;
+        self->current = NULL;
+    }
+
+    /* partition: hash of the key frame */
+    if (self->partitions > 1) {
+        part = &self->partition[zlmb_utils_hash(key, len, 0)
+                                % self->partitions];
+    } else {
+        part = &self->partition[0];
+    }
+
+    if (_journal_partition_reserve(part, ZLMB_JOURNAL_HEADER_SIZE) != 0) {
+        return -1;
+    }
+
+    part->record = part->buf_len;
+    part->frames = 0;
+    part->buf_len += ZLMB_JOURNAL_HEADER_SIZE;
+
+    self->current = part;
+
+    return part->id;
+}
+
+int
+zlmb_journal_frame(zlmb_journal_t *self, const void *data, size_t len)
+{
+    zlmb_journal_partition_t *part;
+    uint64_t size = len;
+
+    if (!self || !self->current) {
+        return -1;
+    }
+
+    part = self->current;
+
+    if (_journal_partition_reserve(part, sizeof(size) + len) != 0) {
+        return -1;
+    }
+
+    memcpy(part->buf + part->buf_len, &size, sizeof(size));
+    part->buf_len += sizeof(size);
+    if (len > 0) {
+        memcpy(part->buf + part->buf_len, data, len);
+        part->buf_len += len;
+    }
+
+    part->frames++;
+
+    return 0;
+}
+
+int
+zlmb_journal_commit(zlmb_journal_t *self, uint64_t *offset)
+{
+    zlmb_journal_partition_t *part;
+    zlmb_journal_segment_t *segment;
+    uint64_t timestamp;
+    char *header;
+
+    if (!self || !self->current) {
+        return -1;
+    }
+
+    part = self->current;
+    segment = part->tail;
+
+    if (_journal_segment_index(segment, segment->size + part->record) != 0) {
+        part->buf_len = part->record;
+        part->frames = (uint32_t)-1;
+        self->current = NULL;
+        return -1;
+    }
+
+    timestamp = _journal_now();
+
+    header = part->buf + part->record;
+    memcpy(header, zlmb_journal_magic, sizeof(zlmb_journal_magic));
+    memcpy(header + 4, &part->frames, sizeof(part->frames));
+    memcpy(header + 8, &part->next, sizeof(part->next));
+    memcpy(header + 16, &timestamp, sizeof(timestamp));
+
+    if (offset) {
+        *offset = part->next;
+    }
+
+    part->next++;
+    part->frames = (uint32_t)-1;
+    segment->mtime = timestamp / 1000000;
+
+    self->current = NULL;
+    self->appended++;
+
+    if (part->buf_len >= ZLMB_JOURNAL_BUFSIZ) {
+        _journal_partition_flush(part);
+    }
+
+    /* segment: roll */
+    if (segment->size + part->buf_len >= self->segment_size) {
+        zlmb_journal_segment_t *next;
+
+        if (_journal_partition_flush(part) == 0) {
+            next = _journal_segment_open(part, part->next);
+            if (next) {
+                fdatasync(segment->fd);
+                segment->next = next;
+                part->tail = next;
+                self->syncs++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int
+zlmb_journal_flush(zlmb_journal_t *self)
+{
+    int i, ret = 0;
+
+    if (!self) {
+        return -1;
+    }
+
+    for (i = 0; i < self->partitions; i++) {
+        zlmb_journal_partition_t *part = &self->partition[i];
+        if (part->buf_len > 0 && _journal_partition_flush(part) != 0) {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+int
+zlmb_journal_sync(zlmb_journal_t *self)
+{
+    int i, ret;
+    uint64_t now;
+
+    if (!self) {
+        return -1;
+    }
+
+    ret = zlmb_journal_flush(self);
+
+    now = time(NULL);
+
+    for (i = 0; i < self->partitions; i++) {
+        zlmb_journal_partition_t *part = &self->partition[i];
+
+        if (part->dirty) {
+            if (fdatasync(part->tail->fd) == -1) {
+                ret = -1;
+            }
+            part->dirty = 0;
+            self->syncs++;
+        }
+
+        /* retention: remove old segments (except the active segment) */
+        while (part->head != part->tail &&
+               ((self->retention_size > 0 &&
+                 part->bytes > self->retention_size) ||
+                (self->retention_time > 0 &&
+                 part->head->mtime + self->retention_time < now))) {
+            zlmb_journal_segment_t *segment = part->head;
+
+            part->head = segment->next;
+            part->bytes -= segment->size;
+
+            unlink(segment->path);
+            _journal_segment_destroy(&segment);
+
+            self->removed++;
+        }
+    }
+
+    return ret;
+}
+
+long
+zlmb_journal_timeout(zlmb_journal_t *self, long timeout)
+{
+    uint64_t now;
+    long remain;
+
+    if (!self) {
+        return timeout;
+    }
+
+    now = zlmb_utils_clock();
+    if (now >= self->sync_next) {
+        return 0;
+    }
+
+    remain = (long)((self->sync_next - now + 999) / 1000);
+    if (timeout < 0 || remain < timeout) {
+        return remain;
+    }
+
+    return timeout;
+}
+
+int
+zlmb_journal_expired(zlmb_journal_t *self)
+{
+    uint64_t now;
+
+    if (!self) {
+        return 0;
+    }
+
+    now = zlmb_utils_clock();
+    if (now < self->sync_next) {
+        return 0;
+    }
+
+    self->sync_next = now + (uint64_t)self->sync * 1000;
+
+    return 1;
+}
+
+int
+zlmb_journal_read(zlmb_journal_t *self, int partition, uint64_t offset,
+                  zlmb_journal_record_t *record)
+{
+    zlmb_journal_partition_t *part;
+    zlmb_journal_segment_t *segment;
+    zlmb_journal_map_t *map;
+    uint64_t pos, end, i;
+    const char *addr;
+
+    if (!self || !record || partition < 0 || partition >= self->partitions) {
+        return -1;
+    }
+
+    part = &self->partition[partition];
+
+    /* removed by retention: first available */
+    if (offset < part->head->base) {
+        offset = part->head->base;
+    }
+
+    if (offset >= part->next) {
+        return -1;
+    }
+
+    segment = part->head;
+    while (segment && offset >= segment->base + segment->count) {
+        segment = segment->next;
+    }
+
+    if (!segment) {
+        return -1;
+    }
+
+    /* gap: segment cut short by a corrupt record, next available */
+    if (offset < segment->base) {
+        offset = segment->base;
+    }
+
+    if (offset >= segment->base + segment->count) {
+        return -1;
+    }
+
+    i = offset - segment->base;
+    pos = segment->index[i];
+    if (i + 1 < segment->count) {
+        end = segment->index[i + 1];
+    } else {
+        end = segment->size;
+    }
+
+    /* not flushed */
+    if (end > segment->size || end < pos + ZLMB_JOURNAL_HEADER_SIZE) {
+        return -1;
+    }
+
+    map = _journal_map(segment);
+    if (!map || end > map->len) {
+        return -1;
+    }
+
+    addr = (const char *)map->addr;
+
+    record->offset = offset;
+    memcpy(&record->frames, addr + pos + 4, sizeof(record->frames));
+    memcpy(&record->timestamp, addr + pos + 16, sizeof(record->timestamp));
+    record->data = addr + pos + ZLMB_JOURNAL_HEADER_SIZE;
+    record->end = addr + end;
+    record->map = map;
+
+    self->fetched++;
+
+    return 0;
+}
+
+const char *
+zlmb_journal_record_frame(zlmb_journal_record_t *record, size_t *len)
+{
+    uint64_t size;
+    const char *data;
+
+    if (!record || record->data + sizeof(size) > record->end) {
+        return NULL;
+    }
+
+    memcpy(&size, record->data, sizeof(size));
+
+    data = record->data + sizeof(size);
+    if (size > (uint64_t)(record->end - data)) {
+        return NULL;
+    }
+
+    record->data = data + size;
+
+    if (len) {
+        *len = size;
+    }
+
+    return data;
+}
+
+size_t
+zlmb_journal_fetch(unsigned char *buf, int partition, uint64_t offset,
+                   int count)
+{
+    memcpy(buf, zlmb_journal_fetch_magic, sizeof(zlmb_journal_fetch_magic));
+    _journal_put(buf + 4, partition, 4);
+    _journal_put(buf + 8, offset, 8);
+    _journal_put(buf + 16, count, 4);
+
+    return ZLMB_JOURNAL_FETCH_SIZE;
+}
+
+int
+zlmb_journal_parse_fetch(const void *data, size_t len, int *partition,
+                         uint64_t *offset, int *count)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_JOURNAL_FETCH_SIZE ||
+        memcmp(buf, zlmb_journal_fetch_magic,
+               sizeof(zlmb_journal_fetch_magic)) != 0) {
+        return -1;
+    }
+
+    *partition = (int)_journal_get(buf + 4, 4);
+    *offset = _journal_get(buf + 8, 8);
+    *count = (int)_journal_get(buf + 16, 4);
+
+    return 0;
+}
+
+size_t
+zlmb_journal_message(unsigned char *buf, int partition, uint64_t offset)
+{
+    memcpy(buf, zlmb_journal_message_magic,
+           sizeof(zlmb_journal_message_magic));
+    _journal_put(buf + 4, partition, 4);
+    _journal_put(buf + 8, offset, 8);
+
+    return ZLMB_JOURNAL_MESSAGE_SIZE;
+}
+
+int
+zlmb_journal_parse_message(const void *data, size_t len, int *partition,
+                           uint64_t *offset)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_JOURNAL_MESSAGE_SIZE ||
+        memcmp(buf, zlmb_journal_message_magic,
+               sizeof(zlmb_journal_message_magic)) != 0) {
+        return -1;
+    }
+
+    *partition = (int)_journal_get(buf + 4, 4);
+    *offset = _journal_get(buf + 8, 8);
+
+    return 0;
+}
+
+size_t
+zlmb_journal_end(unsigned char *buf, int partition, uint64_t next,
+                 uint64_t first, int partitions, int count)
+{
+    memcpy(buf, zlmb_journal_end_magic, sizeof(zlmb_journal_end_magic));
+    _journal_put(buf + 4, partition, 4);
+    _journal_put(buf + 8, next, 8);
+    _journal_put(buf + 16, first, 8);
+    _journal_put(buf + 24, partitions, 4);
+    _journal_put(buf + 28, count, 4);
+
+    return ZLMB_JOURNAL_END_SIZE;
+}
+
+int
+zlmb_journal_parse_end(const void *data, size_t len, int *partition,
+                       uint64_t *next, uint64_t *first, int *partitions,
+                       int *count)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_JOURNAL_END_SIZE ||
+        memcmp(buf, zlmb_journal_end_magic,
+               sizeof(zlmb_journal_end_magic)) != 0) {
+        return -1;
+    }
+
+    *partition = (int)_journal_get(buf + 4, 4);
+    *next = _journal_get(buf + 8, 8);
+    *first = _journal_get(buf + 16, 8);
+    *partitions = (int)_journal_get(buf + 24, 4);
+    *count = (int)_journal_get(buf + 28, 4);
+
+    return 0;
+}
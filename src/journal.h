@@ -0,0 +1,101 @@
+#ifndef __ZLMB_JOURNAL_H__
+#define __ZLMB_JOURNAL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_JOURNAL_PARTITIONS_MAX      64
+#define ZLMB_JOURNAL_DEFAULT_PARTITIONS  1
+#define ZLMB_JOURNAL_DEFAULT_SEGMENT     67108864
+#define ZLMB_JOURNAL_DEFAULT_SYNC        1000
+#define ZLMB_JOURNAL_FETCH_MAX           256
+
+#define ZLMB_JOURNAL_HEADER_SIZE  24
+#define ZLMB_JOURNAL_FETCH_SIZE   20
+#define ZLMB_JOURNAL_MESSAGE_SIZE 16
+#define ZLMB_JOURNAL_END_SIZE     32
+
+typedef struct zlmb_journal_map {
+    void *addr;
+    size_t len;
+    int refs;
+} zlmb_journal_map_t;
+
+typedef struct zlmb_journal_segment zlmb_journal_segment_t;
+struct zlmb_journal_segment {
+    uint64_t base;
+    uint64_t count;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t *index;
+    size_t alloc;
+    char *path;
+    int fd;
+    zlmb_journal_map_t *map;
+    zlmb_journal_segment_t *next;
+};
+
+typedef struct zlmb_journal_partition {
+    int id;
+    char *dir;
+    uint64_t next;
+    uint64_t bytes;
+    int dirty;
+    zlmb_journal_segment_t *head;
+    zlmb_journal_segment_t *tail;
+    char *buf;
+    size_t buf_len;
+    size_t buf_size;
+    size_t record;
+    uint32_t frames;
+} zlmb_journal_partition_t;
+
+typedef struct zlmb_journal {
+    char *dir;
+    int partitions;
+    uint64_t segment_size;
+    uint64_t retention_size;
+    uint64_t retention_time;
+    int sync;
+    uint64_t sync_next;
+    zlmb_journal_partition_t *current;
+    zlmb_journal_partition_t *partition;
+    uint64_t appended;
+    uint64_t syncs;
+    uint64_t fetched;
+    uint64_t removed;
+} zlmb_journal_t;
+
+typedef struct zlmb_journal_record {
+    uint64_t offset;
+    uint64_t timestamp;
+    uint32_t frames;
+    const char *data;
+    const char *end;
+    zlmb_journal_map_t *map;
+} zlmb_journal_record_t;
+
+zlmb_journal_t * zlmb_journal_init(const char *dir, int partitions, uint64_t segment_size, uint64_t retention_size, int retention_time, int sync);
+void zlmb_journal_destroy(zlmb_journal_t **self);
+
+int zlmb_journal_begin(zlmb_journal_t *self, const void *key, size_t len);
+int zlmb_journal_frame(zlmb_journal_t *self, const void *data, size_t len);
+int zlmb_journal_commit(zlmb_journal_t *self, uint64_t *offset);
+int zlmb_journal_flush(zlmb_journal_t *self);
+int zlmb_journal_sync(zlmb_journal_t *self);
+long zlmb_journal_timeout(zlmb_journal_t *self, long timeout);
+int zlmb_journal_expired(zlmb_journal_t *self);
+
+int zlmb_journal_read(zlmb_journal_t *self, int partition, uint64_t offset, zlmb_journal_record_t *record);
+const char * zlmb_journal_record_frame(zlmb_journal_record_t *record, size_t *len);
+void zlmb_journal_map_ref(zlmb_journal_map_t *map);
+void zlmb_journal_map_release(void *data, void *hint);
+
+size_t zlmb_journal_fetch(unsigned char *buf, int partition, uint64_t offset, int count);
+int zlmb_journal_parse_fetch(const void *data, size_t len, int *partition, uint64_t *offset, int *count);
+size_t zlmb_journal_message(unsigned char *buf, int partition, uint64_t offset);
+int zlmb_journal_parse_message(const void *data, size_t len, int *partition, uint64_t *offset);
+size_t zlmb_journal_end(unsigned char *buf, int partition, uint64_t next, uint64_t first, int partitions, int count);
+int zlmb_journal_parse_end(const void *data, size_t len, int *partition, uint64_t *next, uint64_t *first, int *partitions, int *count);
+
+#endif
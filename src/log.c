@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "log.h"
+
+#define ZLMB_LOG_RING_MASK (ZLMB_LOG_RING_SIZE - 1)
+
+/* ring slot: sequence == position + 1 when filled (bounded MPSC queue) */
+typedef struct zlmb_log_entry {
+    volatile uint64_t sequence;
+    int syslog;
+    int level;
+    char line[ZLMB_LOG_LINE_SIZE];
+} zlmb_log_entry_t;
+
+static zlmb_log_entry_t *_ring = NULL;
+static volatile uint64_t _head = 0;
+static uint64_t _tail = 0;
+static volatile int _running = 0;
+static volatile int _waiting = 0;
+static volatile int _writers = 0;
+static volatile uint64_t _dropped = 0;
+static volatile int _syslog_mode = 0;
+static zlmb_log_site_t * volatile _sites = NULL;
+static pthread_t _thread;
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _cond = PTHREAD_COND_INITIALIZER;
+
+static void
+_log_output(int syslog_, int level, const char *line)
+{
+    if (syslog_) {
+        syslog(level, "%s", line);
+        return;
+    }
+
+    switch (level) {
+        case LOG_ERR:
+            fprintf(stderr, "ERR: %s", line);
+            break;
+        case LOG_NOTICE:
+            fprintf(stderr, "NOTICE: %s", line);
+            break;
+        case LOG_INFO:
+            fprintf(stderr, "INFO: %s", line);
+            break;
+        case LOG_DEBUG:
+            fprintf(stderr, "DEBUG: %s", line);
+            break;
+        default:
+            fputs(line, stderr);
+            break;
+    }
+}
+
+static int
+_log_push(int syslog_, int level, const char *line)
+{
+    zlmb_log_entry_t *entry;
+    uint64_t pos;
+
+    pos = _head;
+    while (1) {
+        int64_t diff;
+
+        entry = &_ring[pos & ZLMB_LOG_RING_MASK];
+        diff = (int64_t)entry->sequence - (int64_t)pos;
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&_head, pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* full: never block the caller */
+            __sync_fetch_and_add(&_dropped, 1);
+            return -1;
+        }
+        pos = _head;
+    }
+
+    entry->syslog = syslog_;
+    entry->level = level;
+    strcpy(entry->line, line);
+
+    __sync_synchronize();
+    entry->sequence = pos + 1;
+    __sync_synchronize();
+
+    if (_waiting) {
+        pthread_mutex_lock(&_mutex);
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    return 0;
+}
+
+/* writers: counted while pushing, the ring is freed only when none left */
+static void
+_log_write(int syslog_, int level, const char *line)
+{
+    __sync_fetch_and_add(&_writers, 1);
+
+    if (!_running) {
+        __sync_fetch_and_sub(&_writers, 1);
+        _log_output(syslog_, level, line);
+        return;
+    }
+
+    _syslog_mode = syslog_;
+
+    _log_push(syslog_, level, line);
+
+    __sync_fetch_and_sub(&_writers, 1);
+}
+
+static void
+_log_summary(zlmb_log_site_t *site, uint32_t suppressed, int direct)
+{
+    char line[ZLMB_LOG_LINE_SIZE];
+    size_t len;
+
+    len = strcspn(site->format, "\n");
+    if (len > ZLMB_LOG_LINE_SIZE / 2) {
+        len = ZLMB_LOG_LINE_SIZE / 2;
+    }
+
+    snprintf(line, sizeof(line), "Log: suppressed %u similar messages: %.*s\n",
+             suppressed, (int)len, site->format);
+
+    if (direct) {
+        _log_output(site->syslog, site->level, line);
+    } else {
+        _log_write(site->syslog, site->level, line);
+    }
+}
+
+/* summaries of call sites that have been quiet since their window ended */
+static void
+_log_sweep(uint64_t now, int direct)
+{
+    zlmb_log_site_t *site;
+
+    for (site = _sites; site; site = site->next) {
+        uint32_t suppressed;
+
+        if (site->window == now || site->suppressed == 0) {
+            continue;
+        }
+
+        suppressed = __sync_lock_test_and_set(&site->suppressed, 0);
+        if (suppressed > 0) {
+            _log_summary(site, suppressed, direct);
+        }
+    }
+}
+
+static int
+_log_pop(void)
+{
+    zlmb_log_entry_t *entry;
+
+    entry = &_ring[_tail & ZLMB_LOG_RING_MASK];
+    if (entry->sequence != _tail + 1) {
+        return 0;
+    }
+
+    __sync_synchronize();
+
+    _log_output(entry->syslog, entry->level, entry->line);
+
+    __sync_synchronize();
+    entry->sequence = _tail + ZLMB_LOG_RING_SIZE;
+    _tail++;
+
+    return 1;
+}
+
+static void *
+_log_thread(void *arg)
+{
+    uint64_t sweep = 0;
+
+    (void)arg;
+
+    while (1) {
+        uint64_t now, dropped;
+        int count = 0;
+
+        while (_log_pop()) {
+            count++;
+        }
+
+        dropped = __sync_lock_test_and_set(&_dropped, 0);
+        if (dropped > 0) {
+            char line[ZLMB_LOG_LINE_SIZE];
+            snprintf(line, sizeof(line),
+                     "Log: dropped %llu messages (ring full)\n",
+                     (unsigned long long)dropped);
+            _log_output(_syslog_mode, LOG_NOTICE, line);
+        }
+
+        now = (uint64_t)time(NULL) / ZLMB_LOG_RATE_INTERVAL;
+        if (now != sweep) {
+            _log_sweep(now, 1);
+            sweep = now;
+        }
+
+        if (count > 0) {
+            continue;
+        }
+
+        if (!_running) {
+            break;
+        }
+
+        pthread_mutex_lock(&_mutex);
+        _waiting = 1;
+        __sync_synchronize();
+        if (_ring[_tail & ZLMB_LOG_RING_MASK].sequence != _tail + 1 &&
+            _running) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += ZLMB_LOG_RATE_INTERVAL;
+            pthread_cond_timedwait(&_cond, &_mutex, &ts);
+        }
+        _waiting = 0;
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    return NULL;
+}
+
+int
+zlmb_log_start(void)
+{
+    uint64_t i;
+
+    if (_running) {
+        return 0;
+    }
+
+    if (!_ring) {
+        _ring = (zlmb_log_entry_t *)malloc(sizeof(zlmb_log_entry_t)
+                                           * ZLMB_LOG_RING_SIZE);
+        if (!_ring) {
+            return -1;
+        }
+    }
+
+    for (i = 0; i < ZLMB_LOG_RING_SIZE; i++) {
+        _ring[i].sequence = i;
+    }
+    _head = 0;
+    _tail = 0;
+
+    _running = 1;
+    __sync_synchronize();
+
+    if (pthread_create(&_thread, NULL, _log_thread, NULL) != 0) {
+        _running = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+zlmb_log_stop(void)
+{
+    if (_running) {
+        pthread_mutex_lock(&_mutex);
+        _running = 0;
+        pthread_cond_signal(&_cond);
+        pthread_mutex_unlock(&_mutex);
+
+        pthread_join(_thread, NULL);
+
+        /* writers still pushing (threads not joined yet) */
+        __sync_synchronize();
+        while (_writers > 0) {
+            sched_yield();
+        }
+
+        /* late writers between the last pop and stop */
+        while (_log_pop());
+    }
+
+    if (_ring) {
+        free(_ring);
+        _ring = NULL;
+    }
+
+    _log_sweep((uint64_t)-1, 1);
+}
+
+void
+zlmb_log_printf(zlmb_log_site_t *site, int syslog_, int level,
+                const char *format, ...)
+{
+    char line[ZLMB_LOG_LINE_SIZE];
+    va_list args;
+    int len;
+
+    /* rate limit: errors and notices per call site and interval */
+    if (site && level <= LOG_NOTICE) {
+        uint64_t now = (uint64_t)time(NULL) / ZLMB_LOG_RATE_INTERVAL;
+        uint64_t window = site->window;
+        uint32_t suppressed;
+
+        if (window != now &&
+            __sync_bool_compare_and_swap(&site->window, window, now)) {
+            __sync_lock_test_and_set(&site->count, 0);
+        }
+
+        if (__sync_fetch_and_add(&site->count, 1) >= ZLMB_LOG_RATE_BURST) {
+            site->syslog = syslog_;
+            site->level = level;
+            site->format = format;
+            if (__sync_bool_compare_and_swap(&site->listed, 0, 1)) {
+                do {
+                    site->next = _sites;
+                } while (!__sync_bool_compare_and_swap(&_sites, site->next,
+                                                       site));
+            }
+            __sync_fetch_and_add(&site->suppressed, 1);
+            return;
+        }
+
+        if (site->suppressed > 0) {
+            suppressed = __sync_lock_test_and_set(&site->suppressed, 0);
+            if (suppressed > 0) {
+                _log_summary(site, suppressed, 0);
+            }
+        }
+    }
+
+    va_start(args, format);
+    len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+
+    if (len >= (int)sizeof(line)) {
+        line[sizeof(line) - 2] = '\n';
+    }
+
+    _log_write(syslog_, level, line);
+}
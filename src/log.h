@@ -1,34 +1,41 @@
 #ifndef __ZLMB_LOG_H__
 #define __ZLMB_LOG_H__
 
+#include <stdint.h>
 #include <syslog.h>
 
+#define ZLMB_LOG_RING_SIZE     1024
+#define ZLMB_LOG_LINE_SIZE     512
+#define ZLMB_LOG_RATE_BURST    10
+#define ZLMB_LOG_RATE_INTERVAL 1
+
+/* call site: rate limit state (static, zero initialized) */
+typedef struct zlmb_log_site {
+    uint64_t window;
+    uint32_t count;
+    uint32_t suppressed;
+    int syslog;
+    int level;
+    const char *format;
+    int listed;
+    struct zlmb_log_site *next;
+} zlmb_log_site_t;
+
+int zlmb_log_start(void);
+void zlmb_log_stop(void);
+void zlmb_log_printf(zlmb_log_site_t *site, int syslog, int level,
+                     const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
 #define _LOG_OPEN(_ident) if (_syslog) openlog(_ident, LOG_PID, LOG_USER)
 //openlog(_ident, LOG_CONS | LOG_PID, LOG_DAEMON)
-#define _LOG_CLOSE() if (_syslog) closelog()
+#define _LOG_CLOSE() zlmb_log_stop(); if (_syslog) closelog()
 #define _LOG_LEVEL(_ident) if (_syslog) setlogmask(LOG_UPTO(_ident))
 
-#define _LOG(_level, ...)                               \
-    if (_syslog) {                                      \
-        syslog(_level, __VA_ARGS__);                    \
-    } else {                                            \
-        switch (_level) {                               \
-            case LOG_ERR:                               \
-                fprintf(stderr, "ERR: "__VA_ARGS__);    \
-                break;                                  \
-            case LOG_NOTICE:                            \
-                fprintf(stderr, "NOTICE: "__VA_ARGS__); \
-                break;                                  \
-            case LOG_INFO:                              \
-                fprintf(stderr, "INFO: "__VA_ARGS__);   \
-                break;                                  \
-            case LOG_DEBUG:                             \
-                fprintf(stderr, "DEBUG: "__VA_ARGS__);  \
-                break;                                  \
-            default:                                    \
-                fprintf(stderr, __VA_ARGS__);           \
-                break;                                  \
-        }                                               \
+#define _LOG(_level, ...)                                           \
+    {                                                               \
+        static zlmb_log_site_t _log_site;                           \
+        zlmb_log_printf(&_log_site, _syslog, _level, __VA_ARGS__);  \
     }
 
 #ifndef NDEBUG
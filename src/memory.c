@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+
+/*
+ * memory budget
+ *   message data is copied (or compressed) to a buffer released by ZeroMQ
+ *   (free function), so bytes still queued in sockets are counted until
+ *   they are written
+ */
+
+typedef struct zlmb_memory_block {
+    zlmb_memory_t *memory;
+    size_t size;
+} zlmb_memory_block_t;
+
+zlmb_memory_t *
+zlmb_memory_init(int limit, int high)
+{
+    zlmb_memory_t *self;
+
+    if (limit <= 0) {
+        return NULL;
+    }
+
+    if (high <= 0 || high > 100) {
+        high = ZLMB_MEMORY_DEFAULT_HIGH;
+    }
+
+    self = (zlmb_memory_t *)malloc(sizeof(zlmb_memory_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_memory_t));
+
+    self->limit = (uint64_t)limit << 20;
+    self->high = self->limit / 100 * high;
+    if (high > ZLMB_MEMORY_RESUME) {
+        self->low = self->limit / 100 * (high - ZLMB_MEMORY_RESUME);
+    }
+
+    return self;
+}
+
+void
+zlmb_memory_destroy(zlmb_memory_t **self)
+{
+    if (*self) {
+        free(*self);
+        *self = NULL;
+    }
+}
+
+void
+zlmb_memory_add(zlmb_memory_t *self, size_t size)
+{
+    uint64_t used, peak;
+
+    if (!self) {
+        return;
+    }
+
+    used = __sync_add_and_fetch(&self->used, size);
+
+    peak = self->peak;
+    while (used > peak &&
+           !__sync_bool_compare_and_swap(&self->peak, peak, used)) {
+        peak = self->peak;
+    }
+}
+
+void
+zlmb_memory_sub(zlmb_memory_t *self, size_t size)
+{
+    if (!self) {
+        return;
+    }
+
+    __sync_sub_and_fetch(&self->used, size);
+}
+
+int
+zlmb_memory_over(zlmb_memory_t *self)
+{
+    uint64_t used;
+
+    if (!self) {
+        return 0;
+    }
+
+    /* hysteresis: divert from high until usage falls below low */
+    used = self->used;
+    if (self->over) {
+        if (used < self->low) {
+            self->over = 0;
+        }
+    } else if (used >= self->high) {
+        self->over = 1;
+        __sync_fetch_and_add(&self->crossed, 1);
+    }
+
+    return self->over;
+}
+
+int
+zlmb_memory_divert(zlmb_memory_t *self)
+{
+    if (!zlmb_memory_over(self)) {
+        return 0;
+    }
+
+    __sync_fetch_and_add(&self->diverted, 1);
+
+    return 1;
+}
+
+static void
+_memory_free(void *data, void *hint)
+{
+    zlmb_memory_block_t *block = (zlmb_memory_block_t *)data - 1;
+
+    (void)hint;
+
+    if (block->memory) {
+        zlmb_memory_sub(block->memory, block->size);
+    }
+
+    free(block);
+}
+
+/* buffer: block header followed by data (passed to ZeroMQ without copy) */
+void *
+zlmb_memory_alloc(size_t size)
+{
+    zlmb_memory_block_t *block;
+
+    block = (zlmb_memory_block_t *)malloc(sizeof(zlmb_memory_block_t) + size);
+    if (!block) {
+        return NULL;
+    }
+
+    block->memory = NULL;
+    block->size = 0;
+
+    return block + 1;
+}
+
+void
+zlmb_memory_free(void *data)
+{
+    if (data) {
+        free((zlmb_memory_block_t *)data - 1);
+    }
+}
+
+/* message: owns the buffer of zlmb_memory_alloc, counted until released */
+int
+zlmb_memory_data(zlmb_memory_t *self, zmq_msg_t *zmsg, void *data, size_t size)
+{
+    zlmb_memory_block_t *block = (zlmb_memory_block_t *)data - 1;
+
+    block->memory = self;
+    block->size = size;
+
+    if (zmq_msg_init_data(zmsg, data, size, _memory_free, NULL) != 0) {
+        return -1;
+    }
+
+    if (self) {
+        zlmb_memory_add(self, size);
+        __sync_fetch_and_add(&self->tracked, 1);
+    }
+
+    return 0;
+}
+
+int
+zlmb_memory_copy(zlmb_memory_t *self, zmq_msg_t *zmsg,
+                 const void *data, size_t size)
+{
+    char *buf;
+
+    if (!self || size < ZLMB_MEMORY_MESSAGE_MIN) {
+        if (zmq_msg_init_size(zmsg, size) != 0) {
+            return -1;
+        }
+        if (size > 0) {
+            memcpy(zmq_msg_data(zmsg), data, size);
+        }
+        return 0;
+    }
+
+    /* one allocation: block header followed by data */
+    buf = (char *)zlmb_memory_alloc(size);
+    if (!buf) {
+        return -1;
+    }
+
+    memcpy(buf, data, size);
+
+    if (zlmb_memory_data(self, zmsg, buf, size) != 0) {
+        zlmb_memory_free(buf);
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+zlmb_memory_message(zlmb_memory_t *self, zmq_msg_t *zmsg)
+{
+    zmq_msg_t copy;
+
+    if (!self || zmq_msg_size(zmsg) < ZLMB_MEMORY_MESSAGE_MIN) {
+        return 0;
+    }
+
+    if (zlmb_memory_copy(self, &copy, zmq_msg_data(zmsg),
+                         zmq_msg_size(zmsg)) != 0) {
+        return -1;
+    }
+
+    zmq_msg_move(zmsg, &copy);
+    zmq_msg_close(&copy);
+
+    return 0;
+}
+
+size_t
+zlmb_memory_stack(zlmb_stack_t *stack)
+{
+    zlmb_stack_item_t *item;
+    size_t size = 0;
+
+    if (!stack) {
+        return 0;
+    }
+
+    item = zlmb_stack_first(stack);
+    while (item) {
+        zmq_msg_t *zmsg = (zmq_msg_t *)zlmb_stack_item_data(item);
+        if (zmsg) {
+            size += zmq_msg_size(zmsg);
+        }
+        item = zlmb_stack_item_next(item);
+    }
+
+    return size;
+}
@@ -0,0 +1,43 @@
+#ifndef __ZLMB_MEMORY_H__
+#define __ZLMB_MEMORY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zmq.h>
+
+#include "stack.h"
+
+#define ZLMB_MEMORY_DEFAULT_HIGH 90
+#define ZLMB_MEMORY_RESUME       10
+#define ZLMB_MEMORY_MESSAGE_MIN  64
+
+/* byte budget: messages queued in ZeroMQ and held in codec buffers */
+typedef struct zlmb_memory {
+    uint64_t limit;
+    uint64_t high;
+    uint64_t low;
+    int over;
+    volatile uint64_t used;
+    volatile uint64_t peak;
+    volatile uint64_t tracked;
+    volatile uint64_t diverted;
+    volatile uint64_t crossed;
+} zlmb_memory_t;
+
+zlmb_memory_t * zlmb_memory_init(int limit, int high);
+void zlmb_memory_destroy(zlmb_memory_t **self);
+void zlmb_memory_add(zlmb_memory_t *self, size_t size);
+void zlmb_memory_sub(zlmb_memory_t *self, size_t size);
+int zlmb_memory_over(zlmb_memory_t *self);
+int zlmb_memory_divert(zlmb_memory_t *self);
+int zlmb_memory_message(zlmb_memory_t *self, zmq_msg_t *zmsg);
+int zlmb_memory_copy(zlmb_memory_t *self, zmq_msg_t *zmsg,
+                     const void *data, size_t size);
+void * zlmb_memory_alloc(size_t size);
+void zlmb_memory_free(void *data);
+int zlmb_memory_data(zlmb_memory_t *self, zmq_msg_t *zmsg,
+                     void *data, size_t size);
+size_t zlmb_memory_stack(zlmb_stack_t *stack);
+
+#endif
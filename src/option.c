@@ -7,6 +7,11 @@
 #include "zlmb.h"
 #include "option.h"
 #include "dump.h"
+#include "dedup.h"
+#include "replay.h"
+#include "journal.h"
+#include "sink.h"
+#include "memory.h"
 
 #define _option_boolean(_self, _key, _data)                                \
     if (strcasecmp("yes", _data) == 0 || strcasecmp("true", _data) == 0 || \
@@ -35,6 +40,21 @@
         _self->_key = strdup(_data);                                     \
     }
 
+#define _option_integer(_self, _key, _data) \
+    if (_self->_key == -1) {                \
+        _self->_key = atoi(_data);          \
+    }
+
+#define _option_double(_self, _key, _data) \
+    if (_self->_key < 0) {                 \
+        _self->_key = atof(_data);         \
+    }
+
+#define _option_default(_self, _key, _value) \
+    if (_self->_key < 0) {                   \
+        _self->_key = _value;                \
+    }
+
 #define _option_dumptype(_self, _key, _data)                                \
     if (strcmp(_data, ZLMB_OPTION_DUMPTYPE_BINARY) == 0) {                  \
         _self->_key = ZLMB_DUMP_TYPE_BINARY;                                \
@@ -67,16 +87,62 @@ zlmb_option_init(void)
     self->client_backendpoints = NULL;
     self->client_dumpfile = NULL;
     self->client_dumptype = 0;
+    self->client_codec_threads = -1;
+    self->client_syslogendpoints = NULL;
+    self->client_syslog_key = 0;
+    self->client_priority_keys = NULL;
+    self->client_priority_weight = -1;
+    self->client_priority_backendpoints = NULL;
+    self->client_ttl = NULL;
     self->publish_frontendpoint = NULL;
     self->publish_backendpoint = NULL;
     self->publish_key = NULL;
     self->publish_sendkey = 0;
+    self->publish_ratelimit = -1;
+    self->publish_ratelimit_burst = -1;
+    self->publish_ratelimit_buckets = -1;
+    self->publish_sampling = -1;
+    self->publish_sampling_random = 0;
+    self->publish_sequence = 0;
+    self->publish_replayendpoint = NULL;
+    self->publish_replay_size = -1;
+    self->publish_replay_budget = -1;
+    self->publish_journal = NULL;
+    self->publish_journal_partitions = -1;
+    self->publish_journal_segment_size = -1;
+    self->publish_journal_retention_size = -1;
+    self->publish_journal_retention_time = -1;
+    self->publish_journal_sync = -1;
+    self->publish_journalendpoint = NULL;
+    self->publish_priority_frontendpoint = NULL;
+    self->publish_priority_backendpoint = NULL;
     self->subscribe_frontendpoints = NULL;
     self->subscribe_backendpoint = NULL;
     self->subscribe_key = NULL;
     self->subscribe_dropkey = 0;
     self->subscribe_dumpfile = NULL;
     self->subscribe_dumptype = 0;
+    self->subscribe_dedup = 0;
+    self->subscribe_dedup_memory = -1;
+    self->subscribe_dedup_window = -1;
+    self->subscribe_sequence = 0;
+    self->subscribe_replayendpoints = NULL;
+    self->subscribe_replay_catchup = 0;
+    self->subscribe_journalendpoint = NULL;
+    self->subscribe_journal_offsetfile = NULL;
+    self->pipeline = NULL;
+    self->subscribe_codec_threads = -1;
+    self->subscribe_sink = NULL;
+    self->subscribe_sink_rotate_size = -1;
+    self->subscribe_sink_rotate_time = -1;
+    self->subscribe_sink_compress = NULL;
+    self->subscribe_sink_sync = -1;
+    self->subscribe_sink_uncompress = 0;
+    self->subscribe_ttl = 0;
+    self->subscribe_priority_frontendpoints = NULL;
+    self->stats_interval = -1;
+    self->memory_limit = -1;
+    self->memory_high = -1;
     self->syslog = -1;
     self->verbose = -1;
 
@@ -99,6 +165,22 @@ zlmb_option_destroy(zlmb_option_t **self)
             free((*self)->client_dumpfile);
             (*self)->client_dumpfile = NULL;
         }
+        if ((*self)->client_syslogendpoints) {
+            free((*self)->client_syslogendpoints);
+            (*self)->client_syslogendpoints = NULL;
+        }
+        if ((*self)->client_priority_keys) {
+            free((*self)->client_priority_keys);
+            (*self)->client_priority_keys = NULL;
+        }
+        if ((*self)->client_priority_backendpoints) {
+            free((*self)->client_priority_backendpoints);
+            (*self)->client_priority_backendpoints = NULL;
+        }
+        if ((*self)->client_ttl) {
+            free((*self)->client_ttl);
+            (*self)->client_ttl = NULL;
+        }
         if ((*self)->publish_frontendpoint) {
             free((*self)->publish_frontendpoint);
             (*self)->publish_frontendpoint = NULL;
@@ -111,6 +193,26 @@ zlmb_option_destroy(zlmb_option_t **self)
             free((*self)->publish_key);
             (*self)->publish_key = NULL;
         }
+        if ((*self)->publish_replayendpoint) {
+            free((*self)->publish_replayendpoint);
+            (*self)->publish_replayendpoint = NULL;
+        }
+        if ((*self)->publish_journal) {
+            free((*self)->publish_journal);
+            (*self)->publish_journal = NULL;
+        }
+        if ((*self)->publish_journalendpoint) {
+            free((*self)->publish_journalendpoint);
+            (*self)->publish_journalendpoint = NULL;
+        }
+        if ((*self)->publish_priority_frontendpoint) {
+            free((*self)->publish_priority_frontendpoint);
+            (*self)->publish_priority_frontendpoint = NULL;
+        }
+        if ((*self)->publish_priority_backendpoint) {
+            free((*self)->publish_priority_backendpoint);
+            (*self)->publish_priority_backendpoint = NULL;
+        }
         if ((*self)->subscribe_frontendpoints) {
             free((*self)->subscribe_frontendpoints);
             (*self)->subscribe_frontendpoints = NULL;
@@ -127,6 +229,34 @@ zlmb_option_destroy(zlmb_option_t **self)
             free((*self)->subscribe_dumpfile);
             (*self)->subscribe_dumpfile = NULL;
         }
+        if ((*self)->subscribe_replayendpoints) {
+            free((*self)->subscribe_replayendpoints);
+            (*self)->subscribe_replayendpoints = NULL;
+        }
+        if ((*self)->subscribe_journalendpoint) {
+            free((*self)->subscribe_journalendpoint);
+            (*self)->subscribe_journalendpoint = NULL;
+        }
+        if ((*self)->subscribe_priority_frontendpoints) {
+            free((*self)->subscribe_priority_frontendpoints);
+            (*self)->subscribe_priority_frontendpoints = NULL;
+        }
+        if ((*self)->subscribe_journal_offsetfile) {
+            free((*self)->subscribe_journal_offsetfile);
+            (*self)->subscribe_journal_offsetfile = NULL;
+        }
+        if ((*self)->subscribe_sink) {
+            free((*self)->subscribe_sink);
+            (*self)->subscribe_sink = NULL;
+        }
+        if ((*self)->subscribe_sink_compress) {
+            free((*self)->subscribe_sink_compress);
+            (*self)->subscribe_sink_compress = NULL;
+        }
+        if ((*self)->pipeline) {
+            free((*self)->pipeline);
+            (*self)->pipeline = NULL;
+        }
 
         free(*self);
         *self = NULL;
@@ -142,11 +272,29 @@ zlmb_option_set(zlmb_option_t *self, char *key, void *data,
     }
 
     if (key == NULL) {
-        if ((strcmp(data, ZLMB_OPTION_KEY_CLIENT_BACKENDPOINTS) == 0
+        if ((strcmp(data, ZLMB_OPTION_KEY_CLIENT_FRONTENDPOINT) == 0
+             && self->client_frontendpoint) ||
+            (strcmp(data, ZLMB_OPTION_KEY_CLIENT_BACKENDPOINTS) == 0
              && self->client_backendpoints) ||
+            (strcmp(data, ZLMB_OPTION_KEY_CLIENT_SYSLOGENDPOINTS) == 0
+             && self->client_syslogendpoints) ||
+            (strcmp(data, ZLMB_OPTION_KEY_CLIENT_PRIORITY_KEYS) == 0
+             && self->client_priority_keys) ||
+            (strcmp(data, ZLMB_OPTION_KEY_CLIENT_PRIORITY_BACKENDPOINTS) == 0
+             && self->client_priority_backendpoints) ||
+            (strcmp(data, ZLMB_OPTION_KEY_CLIENT_TTL) == 0
+             && self->client_ttl) ||
             (strcmp(data, ZLMB_OPTION_KEY_SUBSCRIBE_FRONTENDPOINTS) == 0
-             && self->subscribe_frontendpoints)) {
-            return NULL;
+             && self->subscribe_frontendpoints) ||
+            (strcmp(data, ZLMB_OPTION_KEY_SUBSCRIBE_REPLAYENDPOINTS) == 0
+             && self->subscribe_replayendpoints) ||
+            (strcmp(data,
+                    ZLMB_OPTION_KEY_SUBSCRIBE_PRIORITY_FRONTENDPOINTS) == 0
+             && self->subscribe_priority_frontendpoints) ||
+            (strcmp(data, ZLMB_OPTION_KEY_PIPELINE) == 0
+             && self->pipeline)) {
+            /* already set: skip the values */
+            return strdup("");
         }
         return strdup(data);
     }
@@ -175,11 +323,16 @@ zlmb_option_set(zlmb_option_t *self, char *key, void *data,
             self->mode = ZLMB_MODE_CLIENT_SUBSCRIBE;
         } else if (strcmp(data, ZLMB_OPTION_MODE_STAND_ALONE) == 0) {
             self->mode = ZLMB_MODE_STAND_ALONE;
+        } else if (strcmp(data, ZLMB_OPTION_MODE_PIPELINE) == 0) {
+            self->mode = ZLMB_MODE_PIPELINE;
         } else {
             self->mode = -1;
         }
-    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_FRONTENDPOINT) == 0) {
-        _option_strdup(self, client_frontendpoint, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PIPELINE) == 0 && depth == 1) {
+        _option_append(self, pipeline, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_FRONTENDPOINT) == 0
+               && depth == 1) {
+        _option_append(self, client_frontendpoint, data);
     } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_BACKENDPOINTS) == 0
                && depth == 1) {
         _option_append(self, client_backendpoints, data);
@@ -193,6 +346,25 @@ zlmb_option_set(zlmb_option_t *self, char *key, void *data,
             return NULL;
         }
         _option_dumptype(self, client_dumptype, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_CODEC_THREADS) == 0) {
+        _option_integer(self, client_codec_threads, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_SYSLOGENDPOINTS) == 0
+               && depth == 1) {
+        _option_append(self, client_syslogendpoints, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_SYSLOG_KEY) == 0) {
+        if (self->client_syslog_key != 1) {
+            _option_boolean(self, client_syslog_key, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_PRIORITY_KEYS) == 0
+               && depth == 1) {
+        _option_append(self, client_priority_keys, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_PRIORITY_WEIGHT) == 0) {
+        _option_integer(self, client_priority_weight, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_PRIORITY_BACKENDPOINTS) == 0
+               && depth == 1) {
+        _option_append(self, client_priority_backendpoints, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_CLIENT_TTL) == 0 && depth == 1) {
+        _option_append(self, client_ttl, data);
     } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_FRONTENDPOINT) == 0) {
         _option_strdup(self, publish_frontendpoint, data);
     } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_BACKENDPOINT) == 0) {
@@ -203,6 +375,50 @@ zlmb_option_set(zlmb_option_t *self, char *key, void *data,
         if (self->publish_sendkey != 1) {
             _option_boolean(self, publish_sendkey, data);
         }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_RATELIMIT) == 0) {
+        _option_double(self, publish_ratelimit, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BURST) == 0) {
+        _option_integer(self, publish_ratelimit_burst, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BUCKETS) == 0) {
+        _option_integer(self, publish_ratelimit_buckets, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_SAMPLING) == 0) {
+        _option_integer(self, publish_sampling, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_SAMPLING_RANDOM) == 0) {
+        if (self->publish_sampling_random != 1) {
+            _option_boolean(self, publish_sampling_random, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_SEQUENCE) == 0) {
+        if (self->publish_sequence != 1) {
+            _option_boolean(self, publish_sequence, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_REPLAYENDPOINT) == 0) {
+        _option_strdup(self, publish_replayendpoint, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_REPLAY_SIZE) == 0) {
+        _option_integer(self, publish_replay_size, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_REPLAY_BUDGET) == 0) {
+        _option_integer(self, publish_replay_budget, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_JOURNAL) == 0) {
+        _option_strdup(self, publish_journal, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_JOURNAL_PARTITIONS) == 0) {
+        _option_integer(self, publish_journal_partitions, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SEGMENT_SIZE) == 0) {
+        _option_integer(self, publish_journal_segment_size, data);
+    } else if (strcmp(key,
+                      ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_SIZE) == 0) {
+        _option_integer(self, publish_journal_retention_size, data);
+    } else if (strcmp(key,
+                      ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_TIME) == 0) {
+        _option_integer(self, publish_journal_retention_time, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SYNC) == 0) {
+        _option_integer(self, publish_journal_sync, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_PUBLISH_JOURNALENDPOINT) == 0) {
+        _option_strdup(self, publish_journalendpoint, data);
+    } else if (strcmp(key,
+                      ZLMB_OPTION_KEY_PUBLISH_PRIORITY_FRONTENDPOINT) == 0) {
+        _option_strdup(self, publish_priority_frontendpoint, data);
+    } else if (strcmp(key,
+                      ZLMB_OPTION_KEY_PUBLISH_PRIORITY_BACKENDPOINT) == 0) {
+        _option_strdup(self, publish_priority_backendpoint, data);
     } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_FRONTENDPOINTS) == 0
                && depth == 1) {
         _option_append(self, subscribe_frontendpoints, data);
@@ -224,6 +440,59 @@ zlmb_option_set(zlmb_option_t *self, char *key, void *data,
             return NULL;
         }
         _option_dumptype(self, subscribe_dumptype, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP) == 0) {
+        if (self->subscribe_dedup != 1) {
+            _option_boolean(self, subscribe_dedup, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_MEMORY) == 0) {
+        _option_integer(self, subscribe_dedup_memory, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_WINDOW) == 0) {
+        _option_integer(self, subscribe_dedup_window, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SEQUENCE) == 0) {
+        if (self->subscribe_sequence != 1) {
+            _option_boolean(self, subscribe_sequence, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_TTL) == 0) {
+        if (self->subscribe_ttl != 1) {
+            _option_boolean(self, subscribe_ttl, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_REPLAYENDPOINTS) == 0
+               && depth == 1) {
+        _option_append(self, subscribe_replayendpoints, data);
+    } else if (strcmp(key,
+                      ZLMB_OPTION_KEY_SUBSCRIBE_PRIORITY_FRONTENDPOINTS) == 0
+               && depth == 1) {
+        _option_append(self, subscribe_priority_frontendpoints, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_REPLAY_CATCHUP) == 0) {
+        if (self->subscribe_replay_catchup != 1) {
+            _option_boolean(self, subscribe_replay_catchup, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_JOURNALENDPOINT) == 0) {
+        _option_strdup(self, subscribe_journalendpoint, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_JOURNAL_OFFSETFILE) == 0) {
+        _option_strdup(self, subscribe_journal_offsetfile, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_CODEC_THREADS) == 0) {
+        _option_integer(self, subscribe_codec_threads, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK) == 0) {
+        _option_strdup(self, subscribe_sink, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_SIZE) == 0) {
+        _option_integer(self, subscribe_sink_rotate_size, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_TIME) == 0) {
+        _option_integer(self, subscribe_sink_rotate_time, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK_COMPRESS) == 0) {
+        _option_strdup(self, subscribe_sink_compress, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK_SYNC) == 0) {
+        _option_integer(self, subscribe_sink_sync, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_SUBSCRIBE_SINK_UNCOMPRESS) == 0) {
+        if (self->subscribe_sink_uncompress != 1) {
+            _option_boolean(self, subscribe_sink_uncompress, data);
+        }
+    } else if (strcmp(key, ZLMB_OPTION_KEY_STATS_INTERVAL) == 0) {
+        _option_integer(self, stats_interval, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_MEMORY_LIMIT) == 0) {
+        _option_integer(self, memory_limit, data);
+    } else if (strcmp(key, ZLMB_OPTION_KEY_MEMORY_HIGH) == 0) {
+        _option_integer(self, memory_high, data);
     } else if (strcmp(key,ZLMB_OPTION_KEY_SYSLOG) == 0) {
         if (self->syslog != 1) {
             _option_boolean(self, syslog, data);
@@ -255,6 +524,33 @@ zlmb_option_set_default(zlmb_option_t *self)
                    ZLMB_DEFAULT_CLIENT_DUMP_FILE);
     _option_strdup(self, subscribe_dumpfile,
                    ZLMB_DEFAULT_SUBSCRIBE_DUMP_FILE);
+    _option_strdup(self, subscribe_journal_offsetfile,
+                   ZLMB_DEFAULT_SUBSCRIBE_OFFSET_FILE);
+
+    _option_default(self, client_codec_threads, 0);
+    _option_default(self, client_priority_weight, 0);
+    _option_default(self, publish_ratelimit, 0);
+    _option_default(self, publish_ratelimit_burst, 0);
+    _option_default(self, publish_ratelimit_buckets, 0);
+    _option_default(self, publish_sampling, 0);
+    _option_default(self, publish_replay_size, ZLMB_REPLAY_DEFAULT_SIZE);
+    _option_default(self, publish_replay_budget, 0);
+    _option_default(self, publish_journal_partitions,
+                    ZLMB_JOURNAL_DEFAULT_PARTITIONS);
+    _option_default(self, publish_journal_segment_size,
+                    ZLMB_JOURNAL_DEFAULT_SEGMENT >> 20);
+    _option_default(self, publish_journal_retention_size, 0);
+    _option_default(self, publish_journal_retention_time, 0);
+    _option_default(self, publish_journal_sync, ZLMB_JOURNAL_DEFAULT_SYNC);
+    _option_default(self, subscribe_dedup_memory, ZLMB_DEDUP_DEFAULT_MEMORY);
+    _option_default(self, subscribe_dedup_window, ZLMB_DEDUP_DEFAULT_WINDOW);
+    _option_default(self, subscribe_codec_threads, 0);
+    _option_default(self, subscribe_sink_rotate_size, 0);
+    _option_default(self, subscribe_sink_rotate_time, 0);
+    _option_default(self, subscribe_sink_sync, ZLMB_SINK_DEFAULT_SYNC);
+    _option_default(self, stats_interval, 0);
+    _option_default(self, memory_limit, 0);
+    _option_default(self, memory_high, ZLMB_MEMORY_DEFAULT_HIGH);
 
     return 0;
 }
@@ -2,21 +2,67 @@
 #define __ZLMB_OPTION_H__
 
 #define ZLMB_OPTION_KEY_MODE                     "mode"
+#define ZLMB_OPTION_KEY_PIPELINE                 "pipeline"
 #define ZLMB_OPTION_KEY_CLIENT_FRONTENDPOINT     "client_frontendpoint"
 #define ZLMB_OPTION_KEY_CLIENT_BACKENDPOINTS     "client_backendpoints"
 #define ZLMB_OPTION_KEY_CLIENT_DUMPFILE          "client_dumpfile"
 #define ZLMB_OPTION_KEY_CLIENT_DUMPTYPE          "client_dumptype"
+#define ZLMB_OPTION_KEY_CLIENT_CODEC_THREADS     "client_codec_threads"
+#define ZLMB_OPTION_KEY_CLIENT_SYSLOGENDPOINTS   "client_syslogendpoints"
+#define ZLMB_OPTION_KEY_CLIENT_SYSLOG_KEY        "client_syslog_key"
+#define ZLMB_OPTION_KEY_CLIENT_PRIORITY_KEYS     "client_priority_keys"
+#define ZLMB_OPTION_KEY_CLIENT_PRIORITY_WEIGHT   "client_priority_weight"
+#define ZLMB_OPTION_KEY_CLIENT_PRIORITY_BACKENDPOINTS "client_priority_backendpoints"
+#define ZLMB_OPTION_KEY_CLIENT_TTL               "client_ttl"
 #define ZLMB_OPTION_KEY_PUBLISH_FRONTENDPOINT    "publish_frontendpoint"
 #define ZLMB_OPTION_KEY_PUBLISH_BACKENDPOINT     "publish_backendpoint"
 #define ZLMB_OPTION_KEY_PUBLISH_KEY              "publish_key"
 #define ZLMB_OPTION_KEY_PUBLISH_SENDKEY          "publish_sendkey"
+#define ZLMB_OPTION_KEY_PUBLISH_RATELIMIT        "publish_ratelimit"
+#define ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BURST  "publish_ratelimit_burst"
+#define ZLMB_OPTION_KEY_PUBLISH_RATELIMIT_BUCKETS "publish_ratelimit_buckets"
+#define ZLMB_OPTION_KEY_PUBLISH_SAMPLING         "publish_sampling"
+#define ZLMB_OPTION_KEY_PUBLISH_SAMPLING_RANDOM  "publish_sampling_random"
+#define ZLMB_OPTION_KEY_PUBLISH_SEQUENCE         "publish_sequence"
+#define ZLMB_OPTION_KEY_PUBLISH_REPLAYENDPOINT   "publish_replayendpoint"
+#define ZLMB_OPTION_KEY_PUBLISH_REPLAY_SIZE      "publish_replay_size"
+#define ZLMB_OPTION_KEY_PUBLISH_REPLAY_BUDGET    "publish_replay_budget"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL          "publish_journal"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL_PARTITIONS "publish_journal_partitions"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SEGMENT_SIZE "publish_journal_segment_size"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_SIZE "publish_journal_retention_size"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL_RETENTION_TIME "publish_journal_retention_time"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNAL_SYNC     "publish_journal_sync"
+#define ZLMB_OPTION_KEY_PUBLISH_JOURNALENDPOINT  "publish_journalendpoint"
+#define ZLMB_OPTION_KEY_PUBLISH_PRIORITY_FRONTENDPOINT "publish_priority_frontendpoint"
+#define ZLMB_OPTION_KEY_PUBLISH_PRIORITY_BACKENDPOINT "publish_priority_backendpoint"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_FRONTENDPOINTS "subscribe_frontendpoints"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_BACKENDPOINT   "subscribe_backendpoint"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_KEY            "subscribe_key"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_DROPKEY        "subscribe_dropkey"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_DUMPFILE       "subscribe_dumpfile"
 #define ZLMB_OPTION_KEY_SUBSCRIBE_DUMPTYPE       "subscribe_dumptype"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP          "subscribe_dedup"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_MEMORY   "subscribe_dedup_memory"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_DEDUP_WINDOW   "subscribe_dedup_window"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SEQUENCE       "subscribe_sequence"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_REPLAYENDPOINTS "subscribe_replayendpoints"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_REPLAY_CATCHUP "subscribe_replay_catchup"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_JOURNALENDPOINT "subscribe_journalendpoint"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_JOURNAL_OFFSETFILE "subscribe_journal_offsetfile"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_CODEC_THREADS  "subscribe_codec_threads"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK           "subscribe_sink"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_SIZE "subscribe_sink_rotate_size"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK_ROTATE_TIME "subscribe_sink_rotate_time"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK_COMPRESS  "subscribe_sink_compress"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK_SYNC      "subscribe_sink_sync"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_SINK_UNCOMPRESS "subscribe_sink_uncompress"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_TTL            "subscribe_ttl"
+#define ZLMB_OPTION_KEY_SUBSCRIBE_PRIORITY_FRONTENDPOINTS "subscribe_priority_frontendpoints"
 
+#define ZLMB_OPTION_KEY_STATS_INTERVAL           "stats_interval"
+#define ZLMB_OPTION_KEY_MEMORY_LIMIT             "memory_limit"
+#define ZLMB_OPTION_KEY_MEMORY_HIGH              "memory_high"
 #define ZLMB_OPTION_KEY_SYSLOG                   "syslog"
 #define ZLMB_OPTION_KEY_VERBOSE                  "verbose"
 
@@ -30,6 +76,7 @@
 #define ZLMB_OPTION_MODE_CLIENT_SUBSCRIBE  "client-subscribe"
 #define ZLMB_OPTION_MODE_SUBSCRIBE_CLIENT  "subscribe-client"
 #define ZLMB_OPTION_MODE_STAND_ALONE       "stand-alone"
+#define ZLMB_OPTION_MODE_PIPELINE          "pipeline"
 
 #define ZLMB_OPTION_DUMPTYPE_BINARY           "binary"
 #define ZLMB_OPTION_DUMPTYPE_PLAIN            "plain-text"
@@ -40,20 +87,66 @@
 
 typedef struct zlmb_option {
     int mode;
+    char *pipeline;
     char *client_frontendpoint;
     char *client_backendpoints;
     char *client_dumpfile;
     int client_dumptype;
+    int client_codec_threads;
+    char *client_syslogendpoints;
+    int client_syslog_key;
+    char *client_priority_keys;
+    int client_priority_weight;
+    char *client_priority_backendpoints;
+    char *client_ttl;
     char *publish_frontendpoint;
     char *publish_backendpoint;
     char *publish_key;
     int publish_sendkey;
+    double publish_ratelimit;
+    int publish_ratelimit_burst;
+    int publish_ratelimit_buckets;
+    int publish_sampling;
+    int publish_sampling_random;
+    int publish_sequence;
+    char *publish_replayendpoint;
+    int publish_replay_size;
+    int publish_replay_budget;
+    char *publish_journal;
+    int publish_journal_partitions;
+    int publish_journal_segment_size;
+    int publish_journal_retention_size;
+    int publish_journal_retention_time;
+    int publish_journal_sync;
+    char *publish_journalendpoint;
+    char *publish_priority_frontendpoint;
+    char *publish_priority_backendpoint;
     char *subscribe_frontendpoints;
     char *subscribe_backendpoint;
     char *subscribe_key;
     int subscribe_dropkey;
     char *subscribe_dumpfile;
     int subscribe_dumptype;
+    int subscribe_dedup;
+    int subscribe_dedup_memory;
+    int subscribe_dedup_window;
+    int subscribe_sequence;
+    char *subscribe_replayendpoints;
+    int subscribe_replay_catchup;
+    char *subscribe_journalendpoint;
+    char *subscribe_journal_offsetfile;
+    int subscribe_codec_threads;
+    char *subscribe_sink;
+    int subscribe_sink_rotate_size;
+    int subscribe_sink_rotate_time;
+    char *subscribe_sink_compress;
+    int subscribe_sink_sync;
+    int subscribe_sink_uncompress;
+    int subscribe_ttl;
+    char *subscribe_priority_frontendpoints;
+    int stats_interval;
+    int memory_limit;
+    int memory_high;
     int syslog;
     int verbose;
 } zlmb_option_t;
@@ -0,0 +1,45 @@
+#ifndef __ZLMB_PLUGIN_H__
+#define __ZLMB_PLUGIN_H__
+
+/*
+ * zlmb-worker plugin (shared object, loaded with -p)
+ *
+ * export: zlmb_plugin_t zlmb_plugin = { ZLMB_PLUGIN_ABI, ... };
+ *
+ * init:     called once per worker thread (argv[0]: plugin path,
+ *           argv[1..]: worker ARGS), returns thread state (NULL: error)
+ *           (optional)
+ * batch:    received messages, frames point into the ZeroMQ buffers
+ *           (valid only during the call), returns 0 or -1 (error)
+ * flush:    no more messages to receive (optional)
+ * shutdown: worker thread end (optional)
+ *
+ * callbacks of one state are called from one thread only.
+ */
+
+#include <stddef.h>
+
+#define ZLMB_PLUGIN_ABI    1
+#define ZLMB_PLUGIN_SYMBOL "zlmb_plugin"
+
+typedef struct zlmb_plugin_frame {
+    const void *data;
+    size_t size;
+} zlmb_plugin_frame_t;
+
+typedef struct zlmb_plugin_message {
+    const zlmb_plugin_frame_t *frames;
+    size_t count;
+} zlmb_plugin_message_t;
+
+typedef struct zlmb_plugin {
+    int abi;
+    const char *name;
+    void * (*init)(int argc, char **argv);
+    int (*batch)(void *state, const zlmb_plugin_message_t *messages,
+                 size_t count);
+    int (*flush)(void *state);
+    void (*shutdown)(void *state);
+} zlmb_plugin_t;
+
+#endif
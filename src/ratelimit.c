@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "ratelimit.h"
+#include "utils.h"
+
+#ifdef USE_SNAPPY
+#    include <snappy-c.h>
+#endif
+
+#define _ratelimit_count(_bucket, _key) \
+    __sync_fetch_and_add(&(_bucket)->_key, 1)
+
+zlmb_ratelimit_t *
+zlmb_ratelimit_init(double rate, int burst, int sampling, int random,
+                    int buckets)
+{
+    zlmb_ratelimit_t *self;
+    size_t size = 1;
+
+    if (rate <= 0 && sampling <= 1) {
+        return NULL;
+    }
+
+    if (buckets <= 0) {
+        buckets = ZLMB_RATELIMIT_DEFAULT_BUCKETS;
+    }
+
+    while (size < (size_t)buckets) {
+        size <<= 1;
+    }
+
+    self = (zlmb_ratelimit_t *)malloc(sizeof(zlmb_ratelimit_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_ratelimit_t));
+
+    if (posix_memalign((void **)&self->buckets, 64,
+                       sizeof(zlmb_ratelimit_bucket_t) * size) != 0) {
+        free(self);
+        return NULL;
+    }
+
+    memset(self->buckets, 0, sizeof(zlmb_ratelimit_bucket_t) * size);
+
+    self->rate = rate;
+    if (burst > 0) {
+        self->burst = burst;
+    } else if (rate > 1) {
+        self->burst = rate;
+    } else {
+        self->burst = 1;
+    }
+    self->sampling = sampling;
+    self->random = random;
+    self->seed = (unsigned int)(time(NULL) ^ getpid());
+    self->size = size;
+    self->mask = size - 1;
+
+    self->overflow.key_len = 1;
+    self->overflow.key[0] = '*';
+    self->overflow.tokens = self->burst;
+
+    return self;
+}
+
+void
+zlmb_ratelimit_destroy(zlmb_ratelimit_t **self)
+{
+    if (*self) {
+        if ((*self)->buckets) {
+            free((*self)->buckets);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+/* key copy: uncompressed, then truncated (report only) */
+static void
+_ratelimit_key(zlmb_ratelimit_bucket_t *bucket, const void *key, size_t len)
+{
+    char *ubuf = NULL;
+#ifdef USE_SNAPPY
+    size_t ubuf_len;
+
+    if (len > 0 &&
+        snappy_uncompressed_length(key, len, &ubuf_len) == SNAPPY_OK) {
+        ubuf = (char *)malloc(ubuf_len);
+        if (ubuf) {
+            if (snappy_uncompress(key, len, ubuf, &ubuf_len) == SNAPPY_OK) {
+                key = ubuf;
+                len = ubuf_len;
+            } else {
+                free(ubuf);
+                ubuf = NULL;
+            }
+        }
+    }
+#endif
+
+    if (len > ZLMB_RATELIMIT_KEY_SIZE) {
+        bucket->key_len = ZLMB_RATELIMIT_KEY_SIZE;
+    } else {
+        bucket->key_len = len;
+    }
+    if (bucket->key_len > 0) {
+        memcpy(bucket->key, key, bucket->key_len);
+    }
+
+    if (ubuf) {
+        free(ubuf);
+    }
+}
+
+static zlmb_ratelimit_bucket_t *
+_ratelimit_bucket(zlmb_ratelimit_t *self, const void *key, size_t len,
+                  uint64_t now)
+{
+    uint64_t hash;
+    size_t i, pos;
+
+    hash = zlmb_utils_hash(key, len, 0);
+    if (hash == 0) {
+        hash = 1;
+    }
+
+    /* open addressing, bounded linear probe; full window -> overflow */
+    pos = (size_t)hash & self->mask;
+    for (i = 0; i < ZLMB_RATELIMIT_PROBE; i++) {
+        zlmb_ratelimit_bucket_t *bucket = &self->buckets[(pos + i) & self->mask];
+        if (bucket->hash == hash) {
+            return bucket;
+        }
+        if (bucket->hash == 0) {
+            bucket->hash = hash;
+            bucket->stamp = now;
+            bucket->tokens = self->burst;
+            _ratelimit_key(bucket, key, len);
+            return bucket;
+        }
+    }
+
+    return &self->overflow;
+}
+
+int
+zlmb_ratelimit_check(zlmb_ratelimit_t *self, const void *key, size_t len)
+{
+    uint64_t now;
+    zlmb_ratelimit_bucket_t *bucket;
+
+    if (!self) {
+        return ZLMB_RATELIMIT_PASS;
+    }
+
+    now = zlmb_utils_clock();
+
+    bucket = _ratelimit_bucket(self, key, len, now);
+
+    /* sampling: keep 1 of every N (deterministic) or with p=1/N (random) */
+    if (self->sampling > 1) {
+        uint64_t seen = _ratelimit_count(bucket, seen);
+        if (self->random) {
+            if ((rand_r(&self->seed) % self->sampling) != 0) {
+                _ratelimit_count(bucket, sampled);
+                return ZLMB_RATELIMIT_SAMPLE;
+            }
+        } else if ((seen % self->sampling) != 0) {
+            _ratelimit_count(bucket, sampled);
+            return ZLMB_RATELIMIT_SAMPLE;
+        }
+    }
+
+    /* token bucket */
+    if (self->rate > 0) {
+        if (now > bucket->stamp) {
+            bucket->tokens += self->rate * (now - bucket->stamp) / 1000000.0;
+            if (bucket->tokens > self->burst) {
+                bucket->tokens = self->burst;
+            }
+        }
+        bucket->stamp = now;
+
+        if (bucket->tokens < 1.0) {
+            _ratelimit_count(bucket, dropped);
+            return ZLMB_RATELIMIT_DROP;
+        }
+        bucket->tokens -= 1.0;
+    }
+
+    _ratelimit_count(bucket, passed);
+
+    return ZLMB_RATELIMIT_PASS;
+}
+
+zlmb_ratelimit_bucket_t *
+zlmb_ratelimit_next(zlmb_ratelimit_t *self, size_t *pos)
+{
+    if (!self || !pos) {
+        return NULL;
+    }
+
+    while (*pos < self->size) {
+        zlmb_ratelimit_bucket_t *bucket = &self->buckets[(*pos)++];
+        if (bucket->hash != 0) {
+            return bucket;
+        }
+    }
+
+    if (*pos == self->size) {
+        (*pos)++;
+        if (self->overflow.seen || self->overflow.passed
+            || self->overflow.dropped || self->overflow.sampled) {
+            return &self->overflow;
+        }
+    }
+
+    return NULL;
+}
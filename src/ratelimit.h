@@ -0,0 +1,48 @@
+#ifndef __ZLMB_RATELIMIT_H__
+#define __ZLMB_RATELIMIT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_RATELIMIT_PASS   0
+#define ZLMB_RATELIMIT_DROP   1
+#define ZLMB_RATELIMIT_SAMPLE 2
+
+#define ZLMB_RATELIMIT_KEY_SIZE 56
+#define ZLMB_RATELIMIT_PROBE    8
+
+#define ZLMB_RATELIMIT_DEFAULT_BUCKETS 1024
+
+/* hot fields in the first cache line, key copy (report only, uncompressed)
+ * in the second */
+typedef struct zlmb_ratelimit_bucket {
+    uint64_t hash;
+    uint64_t stamp;
+    double tokens;
+    uint64_t seen;
+    uint64_t passed;
+    uint64_t dropped;
+    uint64_t sampled;
+    uint64_t reserved;
+    size_t key_len;
+    char key[ZLMB_RATELIMIT_KEY_SIZE];
+} __attribute__((aligned(64))) zlmb_ratelimit_bucket_t;
+
+typedef struct zlmb_ratelimit {
+    double rate;
+    double burst;
+    int sampling;
+    int random;
+    unsigned int seed;
+    size_t size;
+    size_t mask;
+    zlmb_ratelimit_bucket_t overflow;
+    zlmb_ratelimit_bucket_t *buckets;
+} zlmb_ratelimit_t;
+
+zlmb_ratelimit_t * zlmb_ratelimit_init(double rate, int burst, int sampling, int random, int buckets);
+void zlmb_ratelimit_destroy(zlmb_ratelimit_t **self);
+int zlmb_ratelimit_check(zlmb_ratelimit_t *self, const void *key, size_t len);
+zlmb_ratelimit_bucket_t * zlmb_ratelimit_next(zlmb_ratelimit_t *self, size_t *pos);
+
+#endif
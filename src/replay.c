@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+#include "utils.h"
+
+/*
+ * replay ring: recently published messages indexed by sequence number
+ *   (slot = sequence % size, frames are zmq_msg_copy of the sent frames)
+ */
+
+static void
+_replay_entry_clear(zlmb_replay_entry_t *entry)
+{
+    size_t i;
+
+    for (i = 0; i < entry->count; i++) {
+        zmq_msg_close(&entry->frames[i].msg);
+    }
+
+    entry->count = 0;
+    entry->seq = 0;
+}
+
+static zlmb_replay_frame_t *
+_replay_entry_frame(zlmb_replay_entry_t *entry)
+{
+    if (entry->count == entry->alloc) {
+        size_t alloc = entry->alloc ? entry->alloc * 2 : 4;
+        zlmb_replay_frame_t *frames;
+
+        frames = (zlmb_replay_frame_t *)realloc(entry->frames,
+                                                sizeof(*frames) * alloc);
+        if (!frames) {
+            return NULL;
+        }
+
+        entry->frames = frames;
+        entry->alloc = alloc;
+    }
+
+    return &entry->frames[entry->count];
+}
+
+zlmb_replay_t *
+zlmb_replay_init(int size, int budget)
+{
+    zlmb_replay_t *self;
+
+    if (size <= 0) {
+        size = ZLMB_REPLAY_DEFAULT_SIZE;
+    }
+
+    self = (zlmb_replay_t *)malloc(sizeof(zlmb_replay_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_replay_t));
+
+    self->entries = (zlmb_replay_entry_t *)calloc(size,
+                                                  sizeof(zlmb_replay_entry_t));
+    if (!self->entries) {
+        free(self);
+        return NULL;
+    }
+
+    self->size = size;
+    self->budget = budget > 0 ? budget : 0;
+    self->tokens = self->budget;
+    self->stamp = zlmb_utils_clock();
+
+    return self;
+}
+
+void
+zlmb_replay_destroy(zlmb_replay_t **self)
+{
+    if (*self) {
+        size_t i;
+
+        for (i = 0; i < (*self)->size; i++) {
+            _replay_entry_clear(&(*self)->entries[i]);
+            if ((*self)->entries[i].frames) {
+                free((*self)->entries[i].frames);
+            }
+        }
+        free((*self)->entries);
+
+        _replay_entry_clear(&(*self)->pending);
+        if ((*self)->pending.frames) {
+            free((*self)->pending.frames);
+        }
+
+        free(*self);
+        *self = NULL;
+    }
+}
+
+void
+zlmb_replay_begin(zlmb_replay_t *self)
+{
+    if (self) {
+        _replay_entry_clear(&self->pending);
+    }
+}
+
+int
+zlmb_replay_add(zlmb_replay_t *self, zmq_msg_t *zmsg, int type)
+{
+    zlmb_replay_frame_t *frame;
+
+    if (!self || !zmsg) {
+        return -1;
+    }
+
+    frame = _replay_entry_frame(&self->pending);
+    if (!frame) {
+        return -1;
+    }
+
+    if (zmq_msg_init(&frame->msg) != 0) {
+        return -1;
+    }
+
+    if (zmq_msg_copy(&frame->msg, zmsg) != 0) {
+        zmq_msg_close(&frame->msg);
+        return -1;
+    }
+
+    frame->type = type;
+    self->pending.count++;
+
+    return 0;
+}
+
+int
+zlmb_replay_add_data(zlmb_replay_t *self, const void *data, size_t len,
+                     int type)
+{
+    zlmb_replay_frame_t *frame;
+
+    if (!self) {
+        return -1;
+    }
+
+    frame = _replay_entry_frame(&self->pending);
+    if (!frame) {
+        return -1;
+    }
+
+    if (zmq_msg_init_size(&frame->msg, len) != 0) {
+        return -1;
+    }
+
+    if (len > 0) {
+        memcpy(zmq_msg_data(&frame->msg), data, len);
+    }
+
+    frame->type = type;
+    self->pending.count++;
+
+    return 0;
+}
+
+int
+zlmb_replay_commit(zlmb_replay_t *self, uint64_t seq)
+{
+    zlmb_replay_entry_t *entry, tmp;
+    size_t i;
+
+    if (!self || self->pending.count == 0) {
+        return -1;
+    }
+
+    entry = &self->entries[seq % self->size];
+
+    for (i = 0; i < entry->count; i++) {
+        self->bytes -= zmq_msg_size(&entry->frames[i].msg);
+    }
+    _replay_entry_clear(entry);
+
+    /* swap frame buffers: pending reuses the released slot */
+    tmp = *entry;
+    *entry = self->pending;
+    self->pending = tmp;
+
+    entry->seq = seq;
+    for (i = 0; i < entry->count; i++) {
+        self->bytes += zmq_msg_size(&entry->frames[i].msg);
+    }
+
+    if (self->first == 0 || seq - self->first >= self->size) {
+        self->first = seq >= self->size ? seq - self->size + 1 : 1;
+    }
+    self->last = seq;
+
+    return 0;
+}
+
+zlmb_replay_entry_t *
+zlmb_replay_get(zlmb_replay_t *self, uint64_t seq)
+{
+    zlmb_replay_entry_t *entry;
+
+    if (!self || seq == 0) {
+        return NULL;
+    }
+
+    entry = &self->entries[seq % self->size];
+    if (entry->count == 0 || entry->seq != seq) {
+        return NULL;
+    }
+
+    return entry;
+}
+
+uint64_t
+zlmb_replay_budget(zlmb_replay_t *self, uint64_t count)
+{
+    uint64_t now;
+
+    if (!self) {
+        return 0;
+    }
+
+    if (self->budget == 0) {
+        return count;
+    }
+
+    /* token bucket: budget messages per second */
+    now = zlmb_utils_clock();
+    self->tokens += (double)(now - self->stamp) * self->budget / 1000000.0;
+    if (self->tokens > self->budget) {
+        self->tokens = self->budget;
+    }
+    self->stamp = now;
+
+    if ((double)count > self->tokens) {
+        count = (uint64_t)self->tokens;
+    }
+    self->tokens -= count;
+
+    return count;
+}
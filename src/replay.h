@@ -0,0 +1,48 @@
+#ifndef __ZLMB_REPLAY_H__
+#define __ZLMB_REPLAY_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <zmq.h>
+
+#define ZLMB_REPLAY_DEFAULT_SIZE 4096
+
+typedef struct zlmb_replay_frame {
+    zmq_msg_t msg;
+    int type;
+} zlmb_replay_frame_t;
+
+typedef struct zlmb_replay_entry {
+    uint64_t seq;
+    size_t count;
+    size_t alloc;
+    zlmb_replay_frame_t *frames;
+} zlmb_replay_entry_t;
+
+typedef struct zlmb_replay {
+    size_t size;
+    uint64_t first;
+    uint64_t last;
+    size_t bytes;
+    int budget;
+    double tokens;
+    uint64_t stamp;
+    uint64_t requests;
+    uint64_t retransmitted;
+    uint64_t unavailable;
+    uint64_t throttled;
+    zlmb_replay_entry_t pending;
+    zlmb_replay_entry_t *entries;
+} zlmb_replay_t;
+
+zlmb_replay_t * zlmb_replay_init(int size, int budget);
+void zlmb_replay_destroy(zlmb_replay_t **self);
+void zlmb_replay_begin(zlmb_replay_t *self);
+int zlmb_replay_add(zlmb_replay_t *self, zmq_msg_t *zmsg, int type);
+int zlmb_replay_add_data(zlmb_replay_t *self, const void *data, size_t len, int type);
+int zlmb_replay_commit(zlmb_replay_t *self, uint64_t seq);
+zlmb_replay_entry_t * zlmb_replay_get(zlmb_replay_t *self, uint64_t seq);
+uint64_t zlmb_replay_budget(zlmb_replay_t *self, uint64_t count);
+
+#endif
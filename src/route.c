@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fnmatch.h>
+
+#include <yaml.h>
+
+#include "route.h"
+
+/*
+ * route file (yaml): first match of the key (first frame) pattern
+ *
+ * routes:
+ *   - key: "access.*"
+ *     command: /path/to/exec
+ *     args: [ -f, /tmp/access.log ]
+ *     thread: 2
+ *   - key: "debug.*"
+ *     plugin: /path/to/plugin.so
+ *   - key: "*"
+ *     sink: /path/to/directory
+ */
+
+static int
+_route_arg(zlmb_route_entry_t *entry, const char *value)
+{
+    /* argv[0]: target (set at the end of the entry) */
+    if (entry->argc >= ZLMB_ROUTE_ARGS_MAX) {
+        return -1;
+    }
+
+    entry->argv[entry->argc + 1] = strdup(value);
+    if (!entry->argv[entry->argc + 1]) {
+        return -1;
+    }
+    entry->argc++;
+
+    return 0;
+}
+
+static int
+_route_args(zlmb_route_entry_t *entry, const char *value)
+{
+    char *buf, *token, *save = NULL;
+    int ret = 0;
+
+    buf = strdup(value);
+    if (!buf) {
+        return -1;
+    }
+
+    token = strtok_r(buf, " \t", &save);
+    while (token && ret == 0) {
+        ret = _route_arg(entry, token);
+        token = strtok_r(NULL, " \t", &save);
+    }
+
+    free(buf);
+
+    return ret;
+}
+
+static int
+_route_set(zlmb_route_entry_t *entry, const char *name, const char *value)
+{
+    int type = 0;
+
+    if (strcmp(name, "key") == 0) {
+        if (entry->key) {
+            return -1;
+        }
+        entry->key = strdup(value);
+        return entry->key ? 0 : -1;
+    } else if (strcmp(name, "thread") == 0) {
+        entry->thread = atoi(value);
+        return entry->thread > 0 ? 0 : -1;
+    } else if (strcmp(name, "args") == 0) {
+        return _route_args(entry, value);
+    } else if (strcmp(name, "command") == 0) {
+        type = ZLMB_ROUTE_COMMAND;
+    } else if (strcmp(name, "plugin") == 0) {
+        type = ZLMB_ROUTE_PLUGIN;
+    } else if (strcmp(name, "sink") == 0) {
+        type = ZLMB_ROUTE_SINK;
+    } else {
+        return -1;
+    }
+
+    /* one of command, plugin or sink */
+    if (entry->target || strlen(value) == 0) {
+        return -1;
+    }
+
+    entry->type = type;
+    entry->target = strdup(value);
+
+    return entry->target ? 0 : -1;
+}
+
+static int
+_route_end(zlmb_route_entry_t *entry)
+{
+    if (!entry->key || !entry->target) {
+        return -1;
+    }
+
+    if (entry->thread <= 0) {
+        entry->thread = 1;
+    }
+
+    /* sink: files of one thread */
+    if (entry->type == ZLMB_ROUTE_SINK) {
+        entry->thread = 1;
+    }
+
+    entry->argv[0] = entry->target;
+    entry->argv[entry->argc + 1] = NULL;
+    entry->argc++;
+
+    return 0;
+}
+
+zlmb_route_t *
+zlmb_route_init(const char *filename)
+{
+    zlmb_route_t *self;
+    zlmb_route_entry_t *entry = NULL;
+    FILE *file;
+    yaml_parser_t parser;
+    yaml_event_t event;
+    char name[32] = { 0 };
+    int end = 0, error = 0, depth = 0, seq = 0, routes = 0;
+
+    if (!filename) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    file = fopen(filename, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    self = (zlmb_route_t *)malloc(sizeof(zlmb_route_t));
+    if (!self) {
+        fclose(file);
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_route_t));
+
+    yaml_parser_initialize(&parser);
+    yaml_parser_set_input_file(&parser, file);
+
+    while (!end && !error) {
+        if (!yaml_parser_parse(&parser, &event)) {
+            error = 1;
+            break;
+        }
+
+        switch (event.type) {
+            case YAML_MAPPING_START_EVENT:
+                depth++;
+                if (routes && seq == 1 && depth == 2) {
+                    if (self->count >= ZLMB_ROUTE_MAX) {
+                        error = 1;
+                        break;
+                    }
+                    entry = &self->routes[self->count++];
+                    name[0] = '\0';
+                }
+                break;
+            case YAML_MAPPING_END_EVENT:
+                if (entry && depth == 2) {
+                    if (_route_end(entry) != 0) {
+                        error = 1;
+                    }
+                    entry = NULL;
+                }
+                depth--;
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                seq++;
+                break;
+            case YAML_SEQUENCE_END_EVENT:
+                /* args: list end */
+                if (entry && seq == 2) {
+                    name[0] = '\0';
+                }
+                seq--;
+                if (seq == 0) {
+                    routes = 0;
+                }
+                break;
+            case YAML_STREAM_END_EVENT:
+                end = 1;
+                break;
+            case YAML_SCALAR_EVENT: {
+                char *value = (char *)event.data.scalar.value;
+                if (depth == 1 && seq == 0) {
+                    routes = (strcmp(value, "routes") == 0);
+                } else if (entry && seq == 2 && strcmp(name, "args") == 0) {
+                    error = (_route_arg(entry, value) != 0);
+                } else if (entry && seq == 1 && depth == 2) {
+                    if (name[0] == '\0') {
+                        snprintf(name, sizeof(name), "%s", value);
+                    } else {
+                        error = (_route_set(entry, name, value) != 0);
+                        name[0] = '\0';
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        yaml_event_delete(&event);
+    }
+
+    yaml_parser_delete(&parser);
+
+    fclose(file);
+
+    if (error || entry || self->count == 0) {
+        zlmb_route_destroy(&self);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+zlmb_route_destroy(zlmb_route_t **self)
+{
+    if (*self) {
+        size_t i;
+        int j;
+        for (i = 0; i < (*self)->count; i++) {
+            zlmb_route_entry_t *entry = &(*self)->routes[i];
+            free(entry->key);
+            free(entry->target);
+            /* argv[0]: target */
+            for (j = 1; j <= ZLMB_ROUTE_ARGS_MAX; j++) {
+                free(entry->argv[j]);
+            }
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+/* index of the route, -1: no match */
+int
+zlmb_route_match(zlmb_route_t *self, const void *key, size_t len)
+{
+    char buf[ZLMB_ROUTE_KEY_SIZE];
+    size_t i;
+
+    if (!self) {
+        return -1;
+    }
+
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    if (len > 0) {
+        memcpy(buf, key, len);
+    }
+    buf[len] = '\0';
+
+    for (i = 0; i < self->count; i++) {
+        if (fnmatch(self->routes[i].key, buf, 0) == 0) {
+            return (int)i;
+        }
+    }
+
+    return -1;
+}
+
+char *
+zlmb_route_type2string(int type)
+{
+    switch (type) {
+        case ZLMB_ROUTE_COMMAND:
+            return "command";
+        case ZLMB_ROUTE_PLUGIN:
+            return "plugin";
+        case ZLMB_ROUTE_SINK:
+            return "sink";
+        default:
+            return "-";
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef __ZLMB_ROUTE_H__
+#define __ZLMB_ROUTE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_ROUTE_MAX      64
+#define ZLMB_ROUTE_ARGS_MAX 32
+#define ZLMB_ROUTE_KEY_SIZE 256
+
+#define ZLMB_ROUTE_COMMAND 1
+#define ZLMB_ROUTE_PLUGIN  2
+#define ZLMB_ROUTE_SINK    3
+
+typedef struct zlmb_route_entry {
+    char *key;
+    int type;
+    char *target;
+    char *argv[ZLMB_ROUTE_ARGS_MAX + 2];
+    int argc;
+    int thread;
+    uint64_t messages;
+} zlmb_route_entry_t;
+
+typedef struct zlmb_route {
+    size_t count;
+    zlmb_route_entry_t routes[ZLMB_ROUTE_MAX];
+    uint64_t unmatched;
+} zlmb_route_t;
+
+zlmb_route_t * zlmb_route_init(const char *filename);
+void zlmb_route_destroy(zlmb_route_t **self);
+int zlmb_route_match(zlmb_route_t *self, const void *key, size_t len);
+char * zlmb_route_type2string(int type);
+
+#endif
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "sequence.h"
+#include "utils.h"
+
+/*
+ * sequence frame (trailer of a published message):
+ *   magic(4) | publisher id(8, big endian) | sequence(8, big endian)
+ *
+ * retransmission request:
+ *   magic(4) | publisher id(8) | from sequence(8) | to sequence(8)
+ */
+static const unsigned char zlmb_sequence_magic[4] = { 0x00, 0x7a, 0x73, 0x71 };
+static const unsigned char zlmb_sequence_request_magic[4] = {
+    0x00, 0x7a, 0x72, 0x71
+};
+
+static void
+_sequence_put(unsigned char *buf, uint64_t val)
+{
+    int i;
+
+    for (i = 7; i >= 0; i--) {
+        buf[i] = (unsigned char)(val & 0xff);
+        val >>= 8;
+    }
+}
+
+static uint64_t
+_sequence_get(const unsigned char *buf)
+{
+    int i;
+    uint64_t val = 0;
+
+    for (i = 0; i < 8; i++) {
+        val = (val << 8) | buf[i];
+    }
+
+    return val;
+}
+
+zlmb_sequence_t *
+zlmb_sequence_init(void)
+{
+    zlmb_sequence_t *self;
+    int fd;
+
+    self = (zlmb_sequence_t *)malloc(sizeof(zlmb_sequence_t));
+    if (!self) {
+        return NULL;
+    }
+
+    self->id = 0;
+    self->next = 1;
+
+    /* new publisher id for every start (epoch) */
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd != -1) {
+        if (read(fd, &self->id, sizeof(self->id)) != sizeof(self->id)) {
+            self->id = 0;
+        }
+        close(fd);
+    }
+
+    if (self->id == 0) {
+        uint64_t seed = zlmb_utils_clock() ^ time(NULL) ^ getpid();
+        self->id = zlmb_utils_hash(&seed, sizeof(seed), getpid());
+    }
+
+    return self;
+}
+
+void
+zlmb_sequence_destroy(zlmb_sequence_t **self)
+{
+    if (*self) {
+        free(*self);
+        *self = NULL;
+    }
+}
+
+size_t
+zlmb_sequence_frame(zlmb_sequence_t *self, unsigned char *buf, uint64_t *seq)
+{
+    if (!self || !buf) {
+        return 0;
+    }
+
+    memcpy(buf, zlmb_sequence_magic, sizeof(zlmb_sequence_magic));
+    _sequence_put(buf + 4, self->id);
+    _sequence_put(buf + 12, self->next);
+
+    if (seq) {
+        *seq = self->next;
+    }
+
+    self->next++;
+
+    return ZLMB_SEQUENCE_FRAME_SIZE;
+}
+
+int
+zlmb_sequence_parse(const void *data, size_t len, uint64_t *id, uint64_t *seq)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_SEQUENCE_FRAME_SIZE ||
+        memcmp(buf, zlmb_sequence_magic, sizeof(zlmb_sequence_magic)) != 0) {
+        return -1;
+    }
+
+    if (id) {
+        *id = _sequence_get(buf + 4);
+    }
+    if (seq) {
+        *seq = _sequence_get(buf + 12);
+    }
+
+    return 0;
+}
+
+size_t
+zlmb_sequence_request(unsigned char *buf, uint64_t id,
+                      uint64_t from, uint64_t to)
+{
+    if (!buf) {
+        return 0;
+    }
+
+    memcpy(buf, zlmb_sequence_request_magic,
+           sizeof(zlmb_sequence_request_magic));
+    _sequence_put(buf + 4, id);
+    _sequence_put(buf + 12, from);
+    _sequence_put(buf + 20, to);
+
+    return ZLMB_SEQUENCE_REQUEST_SIZE;
+}
+
+int
+zlmb_sequence_parse_request(const void *data, size_t len, uint64_t *id,
+                            uint64_t *from, uint64_t *to)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_SEQUENCE_REQUEST_SIZE ||
+        memcmp(buf, zlmb_sequence_request_magic,
+               sizeof(zlmb_sequence_request_magic)) != 0) {
+        return -1;
+    }
+
+    if (id) {
+        *id = _sequence_get(buf + 4);
+    }
+    if (from) {
+        *from = _sequence_get(buf + 12);
+    }
+    if (to) {
+        *to = _sequence_get(buf + 20);
+    }
+
+    return 0;
+}
+
+zlmb_sequence_tracker_t *
+zlmb_sequence_tracker_init(void)
+{
+    zlmb_sequence_tracker_t *self;
+
+    self = (zlmb_sequence_tracker_t *)malloc(sizeof(zlmb_sequence_tracker_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_sequence_tracker_t));
+
+    return self;
+}
+
+void
+zlmb_sequence_tracker_destroy(zlmb_sequence_tracker_t **self)
+{
+    if (*self) {
+        free(*self);
+        *self = NULL;
+    }
+}
+
+static zlmb_sequence_publisher_t *
+_sequence_publisher(zlmb_sequence_tracker_t *self, uint64_t id, int *created)
+{
+    size_t i;
+    zlmb_sequence_publisher_t *oldest = NULL;
+
+    *created = 0;
+
+    for (i = 0; i < self->count; i++) {
+        if (self->publishers[i].id == id) {
+            return &self->publishers[i];
+        }
+        if (!oldest || self->publishers[i].stamp < oldest->stamp) {
+            oldest = &self->publishers[i];
+        }
+    }
+
+    /* new publisher: free slot or replace least recently seen */
+    if (self->count < ZLMB_SEQUENCE_PUBLISHERS) {
+        oldest = &self->publishers[self->count++];
+    }
+
+    memset(oldest, 0, sizeof(zlmb_sequence_publisher_t));
+    oldest->id = id;
+
+    *created = 1;
+
+    return oldest;
+}
+
+void
+zlmb_sequence_missing(zlmb_sequence_publisher_t *publisher,
+                      uint64_t from, uint64_t to)
+{
+    if (!publisher || from > to) {
+        return;
+    }
+
+    /* full: forget the oldest range */
+    if (publisher->ranges == ZLMB_SEQUENCE_RANGES) {
+        memmove(&publisher->range[0], &publisher->range[1],
+                sizeof(publisher->range[0]) * (ZLMB_SEQUENCE_RANGES - 1));
+        publisher->ranges--;
+    }
+
+    publisher->range[publisher->ranges].from = from;
+    publisher->range[publisher->ranges].to = to;
+    publisher->ranges++;
+}
+
+static int
+_sequence_recover(zlmb_sequence_publisher_t *publisher, uint64_t seq)
+{
+    size_t i;
+
+    for (i = 0; i < publisher->ranges; i++) {
+        uint64_t from = publisher->range[i].from;
+        uint64_t to = publisher->range[i].to;
+
+        if (seq < from || seq > to) {
+            continue;
+        }
+
+        if (from == to) {
+            publisher->ranges--;
+            memmove(&publisher->range[i], &publisher->range[i + 1],
+                    sizeof(publisher->range[0]) * (publisher->ranges - i));
+        } else if (seq == from) {
+            publisher->range[i].from++;
+        } else if (seq == to) {
+            publisher->range[i].to--;
+        } else if (i == 0 && publisher->ranges == ZLMB_SEQUENCE_RANGES) {
+            /* full: forget the oldest part */
+            publisher->range[0].from = seq + 1;
+        } else {
+            /* full: forget the oldest range */
+            if (publisher->ranges == ZLMB_SEQUENCE_RANGES) {
+                memmove(&publisher->range[0], &publisher->range[1],
+                        sizeof(publisher->range[0])
+                        * (ZLMB_SEQUENCE_RANGES - 1));
+                publisher->ranges--;
+                i--;
+            }
+            memmove(&publisher->range[i + 1], &publisher->range[i],
+                    sizeof(publisher->range[0]) * (publisher->ranges - i));
+            publisher->range[i].to = seq - 1;
+            publisher->range[i + 1].from = seq + 1;
+            publisher->ranges++;
+        }
+
+        return 0;
+    }
+
+    return -1;
+}
+
+int
+zlmb_sequence_track(zlmb_sequence_tracker_t *self, uint64_t id, uint64_t seq,
+                    zlmb_sequence_publisher_t **publisher)
+{
+    int created, ret = ZLMB_SEQUENCE_OK;
+    uint64_t now;
+    zlmb_sequence_publisher_t *pub;
+
+    if (!self) {
+        return ZLMB_SEQUENCE_OK;
+    }
+
+    now = zlmb_utils_clock();
+
+    pub = _sequence_publisher(self, id, &created);
+    pub->stamp = now;
+
+    if (publisher) {
+        *publisher = pub;
+    }
+
+    if (created) {
+        ret = ZLMB_SEQUENCE_NEW;
+    } else if (seq < pub->next) {
+        if (_sequence_recover(pub, seq) == 0) {
+            pub->recovered++;
+            return ZLMB_SEQUENCE_RECOVERED;
+        }
+        pub->duplicates++;
+        return ZLMB_SEQUENCE_DUPLICATE;
+    } else if (seq > pub->next) {
+        pub->gap_from = pub->next;
+        pub->gap_to = seq - 1;
+        pub->lost += seq - pub->next;
+        pub->gaps++;
+        zlmb_sequence_missing(pub, pub->gap_from, pub->gap_to);
+        ret = ZLMB_SEQUENCE_GAP;
+    }
+
+    pub->received++;
+    pub->next = seq + 1;
+
+    return ret;
+}
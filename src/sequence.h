@@ -0,0 +1,58 @@
+#ifndef __ZLMB_SEQUENCE_H__
+#define __ZLMB_SEQUENCE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_SEQUENCE_FRAME_SIZE 20
+#define ZLMB_SEQUENCE_REQUEST_SIZE 28
+#define ZLMB_SEQUENCE_PUBLISHERS 64
+#define ZLMB_SEQUENCE_RANGES 16
+
+#define ZLMB_SEQUENCE_OK        0
+#define ZLMB_SEQUENCE_NEW       1
+#define ZLMB_SEQUENCE_GAP       2
+#define ZLMB_SEQUENCE_DUPLICATE 3
+#define ZLMB_SEQUENCE_RECOVERED 4
+
+typedef struct zlmb_sequence {
+    uint64_t id;
+    uint64_t next;
+} zlmb_sequence_t;
+
+typedef struct zlmb_sequence_publisher {
+    uint64_t id;
+    uint64_t next;
+    uint64_t stamp;
+    uint64_t received;
+    uint64_t lost;
+    uint64_t gaps;
+    uint64_t duplicates;
+    uint64_t recovered;
+    uint64_t gap_from;
+    uint64_t gap_to;
+    size_t ranges;
+    struct {
+        uint64_t from;
+        uint64_t to;
+    } range[ZLMB_SEQUENCE_RANGES];
+} zlmb_sequence_publisher_t;
+
+typedef struct zlmb_sequence_tracker {
+    size_t count;
+    zlmb_sequence_publisher_t publishers[ZLMB_SEQUENCE_PUBLISHERS];
+} zlmb_sequence_tracker_t;
+
+zlmb_sequence_t * zlmb_sequence_init(void);
+void zlmb_sequence_destroy(zlmb_sequence_t **self);
+size_t zlmb_sequence_frame(zlmb_sequence_t *self, unsigned char *buf, uint64_t *seq);
+int zlmb_sequence_parse(const void *data, size_t len, uint64_t *id, uint64_t *seq);
+size_t zlmb_sequence_request(unsigned char *buf, uint64_t id, uint64_t from, uint64_t to);
+int zlmb_sequence_parse_request(const void *data, size_t len, uint64_t *id, uint64_t *from, uint64_t *to);
+
+zlmb_sequence_tracker_t * zlmb_sequence_tracker_init(void);
+void zlmb_sequence_tracker_destroy(zlmb_sequence_tracker_t **self);
+int zlmb_sequence_track(zlmb_sequence_tracker_t *self, uint64_t id, uint64_t seq, zlmb_sequence_publisher_t **publisher);
+void zlmb_sequence_missing(zlmb_sequence_publisher_t *publisher, uint64_t from, uint64_t to);
+
+#endif
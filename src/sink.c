@@ -0,0 +1,617 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "sink.h"
+#include "codec.h"
+#include "ttl.h"
+#include "utils.h"
+
+#ifndef IOV_MAX
+#    define IOV_MAX 1024
+#endif
+
+/*
+ * sink: append messages to files per key
+ *   DIRECTORY/KEY.log (key: first frame of a multi-part message)
+ *   record: frames separated by TAB, terminated by LF
+ *   frames are batched per file and written by writev()
+ *   (ttl frame of the client stage is not written, as the key frame)
+ *   rotated: DIRECTORY/KEY.YYYYmmdd-HHMMSS[.N].log (+ compress command)
+ */
+
+extern char **environ;
+
+static void
+_sink_key(char *key, size_t size, const char *data, size_t len)
+{
+    size_t i, n = 0;
+
+    /* file name: [A-Za-z0-9._-], others to '_' */
+    for (i = 0; i < len && n + 1 < size; i++) {
+        char c = data[i];
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == '-' || c == '_' ||
+            (c == '.' && n > 0)) {
+            key[n++] = c;
+        } else {
+            key[n++] = '_';
+        }
+    }
+
+    if (n == 0) {
+        snprintf(key, size, "%s", ZLMB_SINK_DEFAULT_KEY);
+    } else {
+        key[n] = '\0';
+    }
+}
+
+static char **
+_sink_command(char *command)
+{
+    char **argv, *str, *token, *saveptr = NULL;
+    size_t n = 0;
+
+    if (!command) {
+        return NULL;
+    }
+
+    while (*command == ' ') {
+        command++;
+    }
+
+    if (strlen(command) == 0) {
+        return NULL;
+    }
+
+    /* command [ARGS ...] FILE */
+    argv = (char **)calloc(strlen(command) / 2 + 3, sizeof(char *));
+    str = strdup(command);
+    if (!argv || !str) {
+        free(argv);
+        free(str);
+        return NULL;
+    }
+
+    token = strtok_r(str, " ", &saveptr);
+    while (token) {
+        argv[n++] = token;
+        token = strtok_r(NULL, " ", &saveptr);
+    }
+
+    if (n == 0) {
+        free(argv);
+        free(str);
+        return NULL;
+    }
+
+    return argv;
+}
+
+static void
+_sink_reap(zlmb_sink_t *self, int wait)
+{
+    int i = 0;
+
+    while (i < self->nchildren) {
+        int status;
+        pid_t pid = waitpid(self->children[i], &status, wait ? 0 : WNOHANG);
+        if (pid == 0) {
+            i++;
+            continue;
+        }
+        if (pid == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            self->errors++;
+        }
+        self->children[i] = self->children[--self->nchildren];
+    }
+}
+
+static void
+_sink_compress(zlmb_sink_t *self, char *path)
+{
+    pid_t pid;
+    int n;
+
+    if (!self->compress) {
+        return;
+    }
+
+    if (self->nchildren >= ZLMB_SINK_COMPRESS_MAX) {
+        _sink_reap(self, 1);
+    }
+
+    for (n = 0; self->compress[n]; n++) {
+        ;
+    }
+
+    self->compress[n] = path;
+    if (posix_spawnp(&pid, self->compress[0], NULL, NULL,
+                     self->compress, environ) == 0) {
+        self->children[self->nchildren++] = pid;
+    } else {
+        self->errors++;
+    }
+    self->compress[n] = NULL;
+}
+
+static int
+_sink_open(zlmb_sink_t *self, zlmb_sink_file_t *file)
+{
+    struct stat st;
+
+    file->fd = open(file->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                    0644);
+    if (file->fd == -1) {
+        /* reopened on the next write */
+        file->size = 0;
+        self->errors++;
+        return -1;
+    }
+
+    if (fstat(file->fd, &st) == 0) {
+        file->size = st.st_size;
+    } else {
+        file->size = 0;
+    }
+
+    file->opened = zlmb_utils_clock();
+    file->dirty = 0;
+
+    return 0;
+}
+
+zlmb_sink_t *
+zlmb_sink_init(char *directory, int rotate_size, int rotate_time,
+               char *compress, int sync, int uncompress)
+{
+    zlmb_sink_t *self;
+    struct stat st;
+
+    if (!directory || strlen(directory) == 0) {
+        return NULL;
+    }
+
+    if (stat(directory, &st) == -1) {
+        if (mkdir(directory, 0755) == -1) {
+            return NULL;
+        }
+    } else if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return NULL;
+    }
+
+    self = (zlmb_sink_t *)malloc(sizeof(zlmb_sink_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_sink_t));
+
+    self->directory = strdup(directory);
+    self->files = (zlmb_sink_file_t **)calloc(ZLMB_SINK_FILES_MAX,
+                                              sizeof(zlmb_sink_file_t *));
+    if (!self->directory || !self->files) {
+        zlmb_sink_destroy(&self);
+        return NULL;
+    }
+
+    if (rotate_size > 0) {
+        self->rotate_size = (off_t)rotate_size << 20;
+    }
+    if (rotate_time > 0) {
+        self->rotate_time = (uint64_t)rotate_time * 1000000;
+    }
+    if (sync < 0) {
+        sync = ZLMB_SINK_DEFAULT_SYNC;
+    }
+    self->sync = (uint64_t)sync * 1000;
+
+    self->compress = _sink_command(compress);
+    self->uncompress = uncompress;
+
+    return self;
+}
+
+static zlmb_sink_file_t *
+_sink_file(zlmb_sink_t *self, const char *data, size_t len)
+{
+    zlmb_sink_file_t *file;
+    char key[ZLMB_SINK_KEY_SIZE];
+    uint64_t hash;
+    size_t i;
+
+    _sink_key(key, sizeof(key), data, len);
+    hash = zlmb_utils_hash(key, strlen(key), 0);
+
+    for (i = 0; i < self->nfiles; i++) {
+        if (self->files[i]->hash == hash &&
+            strcmp(self->files[i]->key, key) == 0) {
+            return self->files[i];
+        }
+    }
+
+    /* too many keys: default file */
+    if (self->nfiles >= ZLMB_SINK_FILES_MAX) {
+        self->errors++;
+        if (strcmp(key, ZLMB_SINK_DEFAULT_KEY) == 0) {
+            return NULL;
+        }
+        return _sink_file(self, NULL, 0);
+    }
+
+    file = (zlmb_sink_file_t *)malloc(sizeof(zlmb_sink_file_t));
+    if (!file) {
+        return NULL;
+    }
+
+    memset(file, 0, sizeof(zlmb_sink_file_t));
+
+    file->hash = hash;
+    file->key = strdup(key);
+    if (!file->key ||
+        zlmb_utils_asprintf(&file->path, "%s/%s%s", self->directory, key,
+                            ZLMB_SINK_SUFFIX) == -1) {
+        free(file->key);
+        free(file);
+        return NULL;
+    }
+
+    /* open: failed file is kept (reopened on the next write) */
+    _sink_open(self, file);
+
+    self->files[self->nfiles++] = file;
+
+    return file;
+}
+
+static int
+_sink_write(zlmb_sink_t *self, zlmb_sink_file_t *file)
+{
+    static char tab = '\t', lf = '\n';
+    struct iovec iov[ZLMB_SINK_BATCH * 2];
+    size_t i, n = 0;
+    ssize_t len;
+    struct iovec *p;
+    int ret = 0;
+
+    if (file->count == 0) {
+        return 0;
+    }
+
+    /* closed (open or rotate failed): frames are discarded as errors */
+    if (file->fd == -1 && _sink_open(self, file) == -1) {
+        ret = -1;
+    }
+
+    for (i = 0; i < file->count; i++) {
+        iov[n].iov_base = zmq_msg_data(&file->frames[i]);
+        iov[n].iov_len = zmq_msg_size(&file->frames[i]);
+        n++;
+        iov[n].iov_base = file->ends[i] ? &lf : &tab;
+        iov[n].iov_len = 1;
+        n++;
+    }
+
+    /* writev: IOV_MAX per call, continue after a partial write */
+    p = iov;
+    while (n > 0 && file->fd != -1) {
+        int count = (n > IOV_MAX) ? IOV_MAX : (int)n;
+
+        len = writev(file->fd, p, count);
+        if (len == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            self->errors++;
+            ret = -1;
+            break;
+        }
+
+        self->writes++;
+        file->size += len;
+        self->bytes += len;
+
+        while (len > 0 && n > 0) {
+            if ((size_t)len >= p->iov_len) {
+                len -= p->iov_len;
+                p++;
+                n--;
+            } else {
+                p->iov_base = (char *)p->iov_base + len;
+                p->iov_len -= len;
+                len = 0;
+            }
+        }
+    }
+
+    for (i = 0; i < file->count; i++) {
+        zmq_msg_close(&file->frames[i]);
+    }
+    file->count = 0;
+    file->bytes = 0;
+    file->dirty = 1;
+
+    if (self->sync_next == 0) {
+        self->sync_next = zlmb_utils_clock() + self->sync;
+    }
+
+    return ret;
+}
+
+static void
+_sink_rotate(zlmb_sink_t *self, zlmb_sink_file_t *file)
+{
+    char stamp[32], *path = NULL;
+    struct tm tm;
+    time_t now = time(NULL);
+    struct stat st;
+    int i;
+
+    _sink_write(self, file);
+
+    if (file->fd != -1) {
+        fdatasync(file->fd);
+        close(file->fd);
+        file->fd = -1;
+    }
+
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+    for (i = 0; i < 100; i++) {
+        if (path) {
+            free(path);
+            path = NULL;
+        }
+        if (i == 0) {
+            zlmb_utils_asprintf(&path, "%s/%s.%s%s", self->directory,
+                                file->key, stamp, ZLMB_SINK_SUFFIX);
+        } else {
+            zlmb_utils_asprintf(&path, "%s/%s.%s.%d%s", self->directory,
+                                file->key, stamp, i, ZLMB_SINK_SUFFIX);
+        }
+        if (!path || stat(path, &st) == -1) {
+            break;
+        }
+    }
+
+    if (path && rename(file->path, path) == 0) {
+        self->rotations++;
+        _sink_compress(self, path);
+    } else {
+        self->errors++;
+    }
+
+    if (path) {
+        free(path);
+    }
+
+    _sink_open(self, file);
+}
+
+void
+zlmb_sink_destroy(zlmb_sink_t **self)
+{
+    size_t i;
+
+    if (!*self) {
+        return;
+    }
+
+    for (i = 0; i < (*self)->nfiles; i++) {
+        zlmb_sink_file_t *file = (*self)->files[i];
+        _sink_write(*self, file);
+        if (file->fd != -1) {
+            if (file->dirty) {
+                fdatasync(file->fd);
+            }
+            close(file->fd);
+        }
+        free(file->key);
+        free(file->path);
+        free(file);
+    }
+
+    _sink_reap(*self, 1);
+
+    if ((*self)->compress) {
+        free((*self)->compress[0]);
+        free((*self)->compress);
+    }
+
+    free((*self)->files);
+    free((*self)->directory);
+    free(*self);
+    *self = NULL;
+}
+
+int
+zlmb_sink_write(zlmb_sink_t *self, zlmb_stack_t *stack)
+{
+    zlmb_sink_file_t *file;
+    zlmb_stack_item_t *item;
+    zmq_msg_t key;
+    size_t frames;
+
+    if (!self || !stack || zlmb_stack_size(stack) == 0) {
+        return -1;
+    }
+
+    item = zlmb_stack_first(stack);
+    frames = zlmb_stack_size(stack);
+
+    /* ttl: last frame (kept without subscribe_ttl) */
+    if (frames > 1) {
+        zmq_msg_t *last = zlmb_stack_item_data(zlmb_stack_last(stack));
+        if (zlmb_ttl_parse(zmq_msg_data(last), zmq_msg_size(last),
+                           NULL, NULL) == 0) {
+            frames--;
+        }
+    }
+
+    /* key: first frame of a multi-part message (file name uncompressed) */
+    zmq_msg_init(&key);
+    if (frames > 1) {
+        zmq_msg_copy(&key, zlmb_stack_item_data(item));
+#ifdef USE_SNAPPY
+        zlmb_codec_message(&key, ZLMB_CODEC_UNCOMPRESS);
+#endif
+        item = zlmb_stack_item_next(item);
+        frames--;
+    }
+
+    file = _sink_file(self, zmq_msg_data(&key), zmq_msg_size(&key));
+    zmq_msg_close(&key);
+    if (!file) {
+        return -1;
+    }
+
+    /* closed: not archived (the caller keeps the message) */
+    if (file->fd == -1 && _sink_open(self, file) == -1) {
+        return -1;
+    }
+
+    if (frames > ZLMB_SINK_BATCH) {
+        self->errors++;
+        return -1;
+    }
+
+    if (file->count + frames > ZLMB_SINK_BATCH) {
+        _sink_write(self, file);
+    }
+
+    while (item && frames > 0) {
+        zmq_msg_t *zmsg = &file->frames[file->count];
+
+        /* copy: reference counted (frames are also sent to the backend) */
+        zmq_msg_init(zmsg);
+        zmq_msg_copy(zmsg, zlmb_stack_item_data(item));
+#ifdef USE_SNAPPY
+        if (self->uncompress) {
+            zlmb_codec_message(zmsg, ZLMB_CODEC_UNCOMPRESS);
+        }
+#endif
+        file->bytes += zmq_msg_size(zmsg) + 1;
+
+        item = zlmb_stack_item_next(item);
+        file->ends[file->count] = (--frames > 0) ? 0 : 1;
+        file->count++;
+    }
+
+    self->messages++;
+
+    if (self->flush_next == 0) {
+        self->flush_next = zlmb_utils_clock() + ZLMB_SINK_FLUSH * 1000;
+    }
+
+    if (file->count >= ZLMB_SINK_BATCH || file->bytes >= ZLMB_SINK_BATCH_SIZE) {
+        _sink_write(self, file);
+        if (self->rotate_size > 0 && file->size >= self->rotate_size) {
+            _sink_rotate(self, file);
+        }
+    }
+
+    return 0;
+}
+
+int
+zlmb_sink_flush(zlmb_sink_t *self, int force)
+{
+    uint64_t now;
+    size_t i;
+    int ret = 0;
+
+    if (!self) {
+        return -1;
+    }
+
+    now = zlmb_utils_clock();
+
+    if (force || (self->flush_next && now >= self->flush_next)) {
+        for (i = 0; i < self->nfiles; i++) {
+            if (_sink_write(self, self->files[i]) == -1) {
+                ret = -1;
+            }
+        }
+        self->flush_next = 0;
+    }
+
+    for (i = 0; i < self->nfiles; i++) {
+        zlmb_sink_file_t *file = self->files[i];
+        if (file->size == 0) {
+            continue;
+        }
+        if ((self->rotate_size > 0 && file->size >= self->rotate_size) ||
+            (self->rotate_time > 0 &&
+             now >= file->opened + self->rotate_time)) {
+            _sink_rotate(self, file);
+        }
+    }
+
+    if (force || (self->sync_next && now >= self->sync_next)) {
+        for (i = 0; i < self->nfiles; i++) {
+            zlmb_sink_file_t *file = self->files[i];
+            if (file->dirty && file->fd != -1) {
+                if (fdatasync(file->fd) == -1) {
+                    self->errors++;
+                    ret = -1;
+                }
+                file->dirty = 0;
+            }
+        }
+        self->sync_next = 0;
+        self->syncs++;
+    }
+
+    _sink_reap(self, 0);
+
+    return ret;
+}
+
+long
+zlmb_sink_timeout(zlmb_sink_t *self)
+{
+    uint64_t now, next = 0;
+    size_t i;
+
+    if (!self) {
+        return -1;
+    }
+
+    if (self->flush_next) {
+        next = self->flush_next;
+    }
+    if (self->sync_next && (next == 0 || self->sync_next < next)) {
+        next = self->sync_next;
+    }
+    if (self->rotate_time > 0) {
+        for (i = 0; i < self->nfiles; i++) {
+            uint64_t rotate = self->files[i]->opened + self->rotate_time;
+            if (self->files[i]->size > 0 && (next == 0 || rotate < next)) {
+                next = rotate;
+            }
+        }
+    }
+
+    if (next == 0) {
+        return -1;
+    }
+
+    now = zlmb_utils_clock();
+    if (next <= now) {
+        return 0;
+    }
+
+    return (long)((next - now) / 1000) + 1;
+}
@@ -0,0 +1,66 @@
+#ifndef __ZLMB_SINK_H__
+#define __ZLMB_SINK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <zmq.h>
+
+#include "stack.h"
+
+#define ZLMB_SINK_FILES_MAX    1024
+#define ZLMB_SINK_BATCH        512
+#define ZLMB_SINK_BATCH_SIZE   (1024 * 1024)
+#define ZLMB_SINK_FLUSH        100
+#define ZLMB_SINK_COMPRESS_MAX 16
+#define ZLMB_SINK_KEY_SIZE     128
+
+#define ZLMB_SINK_DEFAULT_KEY  "zlmb"
+#define ZLMB_SINK_DEFAULT_SYNC 1000
+#define ZLMB_SINK_SUFFIX       ".log"
+
+typedef struct zlmb_sink_file {
+    uint64_t hash;
+    char *key;
+    char *path;
+    int fd;
+    off_t size;
+    uint64_t opened;
+    int dirty;
+    size_t count;
+    size_t bytes;
+    zmq_msg_t frames[ZLMB_SINK_BATCH];
+    char ends[ZLMB_SINK_BATCH];
+} zlmb_sink_file_t;
+
+typedef struct zlmb_sink {
+    char *directory;
+    off_t rotate_size;
+    uint64_t rotate_time;
+    uint64_t sync;
+    char **compress;
+    int uncompress;
+    zlmb_sink_file_t **files;
+    size_t nfiles;
+    pid_t children[ZLMB_SINK_COMPRESS_MAX];
+    int nchildren;
+    uint64_t flush_next;
+    uint64_t sync_next;
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t writes;
+    uint64_t rotations;
+    uint64_t syncs;
+    uint64_t errors;
+} zlmb_sink_t;
+
+zlmb_sink_t * zlmb_sink_init(char *directory, int rotate_size,
+                             int rotate_time, char *compress, int sync,
+                             int uncompress);
+void zlmb_sink_destroy(zlmb_sink_t **self);
+int zlmb_sink_write(zlmb_sink_t *self, zlmb_stack_t *stack);
+int zlmb_sink_flush(zlmb_sink_t *self, int force);
+long zlmb_sink_timeout(zlmb_sink_t *self);
+
+#endif
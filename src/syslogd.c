@@ -0,0 +1,452 @@
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "syslogd.h"
+
+/*
+ * syslogd: RFC3164/RFC5424 datagrams on UDP and Unix sockets
+ *   one recvmmsg() call reads up to ZLMB_SYSLOGD_BATCH messages
+ *   key: "facility.severity.app" (parse enabled)
+ */
+
+static const char *_syslogd_facility[] = {
+    "kern", "user", "mail", "daemon", "auth", "syslog", "lpr", "news",
+    "uucp", "cron", "authpriv", "ftp", "ntp", "security", "console", "cron2",
+    "local0", "local1", "local2", "local3",
+    "local4", "local5", "local6", "local7"
+};
+
+static const char *_syslogd_severity[] = {
+    "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+};
+
+static void
+_syslogd_nonblock(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+static int
+_syslogd_udp(char *endpoint)
+{
+    struct addrinfo hints, *res = NULL, *ai;
+    char *host, *port, *end;
+    int fd = -1, rcvbuf = ZLMB_SYSLOGD_RCVBUF, reuse = 1;
+
+    /* [host]:port, host:port, *:port */
+    host = endpoint;
+    if (*host == '[') {
+        host++;
+        end = strchr(host, ']');
+        if (!end || *(end + 1) != ':') {
+            return -1;
+        }
+        *end = '\0';
+        port = end + 2;
+    } else {
+        port = strrchr(host, ':');
+        if (!port) {
+            return -1;
+        }
+        *port++ = '\0';
+    }
+
+    if (*host == '\0' || strcmp(host, "*") == 0) {
+        host = NULL;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        return -1;
+    }
+
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+
+        close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(res);
+
+    return fd;
+}
+
+static int
+_syslogd_unix(char *path)
+{
+    struct sockaddr_un addr;
+    int fd, rcvbuf = ZLMB_SYSLOGD_RCVBUF;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* stale socket file */
+    unlink(path);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int
+_syslogd_open(zlmb_syslogd_t *self, char *endpoint)
+{
+    zlmb_syslogd_socket_t *sock;
+    char *str;
+    size_t len;
+
+    if (self->count >= ZLMB_SYSLOGD_SOCKET_MAX) {
+        return -1;
+    }
+
+    sock = &self->sockets[self->count];
+
+    len = strlen(ZLMB_SYSLOGD_ENDPOINT_UDP);
+    if (strncmp(endpoint, ZLMB_SYSLOGD_ENDPOINT_UDP, len) == 0) {
+        str = strdup(endpoint + len);
+        if (!str) {
+            return -1;
+        }
+        sock->fd = _syslogd_udp(str);
+        free(str);
+    } else {
+        len = strlen(ZLMB_SYSLOGD_ENDPOINT_UNIX);
+        if (strncmp(endpoint, ZLMB_SYSLOGD_ENDPOINT_UNIX, len) != 0) {
+            return -1;
+        }
+        sock->path = strdup(endpoint + len);
+        if (!sock->path) {
+            return -1;
+        }
+        sock->fd = _syslogd_unix(sock->path);
+        if (sock->fd == -1) {
+            free(sock->path);
+            sock->path = NULL;
+        }
+    }
+
+    if (sock->fd == -1) {
+        return -1;
+    }
+
+    _syslogd_nonblock(sock->fd);
+
+    self->count++;
+
+    return 0;
+}
+
+zlmb_syslogd_t *
+zlmb_syslogd_init(char *endpoints, int parse)
+{
+    zlmb_syslogd_t *self;
+    char *str, *token, *saveptr = NULL;
+    int i;
+
+    if (!endpoints || strlen(endpoints) == 0) {
+        return NULL;
+    }
+
+    self = (zlmb_syslogd_t *)malloc(sizeof(zlmb_syslogd_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_syslogd_t));
+
+    self->parse = parse;
+
+    self->buffer = (char *)malloc(ZLMB_SYSLOGD_BATCH *
+                                  ZLMB_SYSLOGD_MESSAGE_SIZE);
+    self->iovecs = (struct iovec *)calloc(ZLMB_SYSLOGD_BATCH,
+                                          sizeof(struct iovec));
+    self->headers = (struct mmsghdr *)calloc(ZLMB_SYSLOGD_BATCH,
+                                             sizeof(struct mmsghdr));
+    if (!self->buffer || !self->iovecs || !self->headers) {
+        zlmb_syslogd_destroy(&self);
+        return NULL;
+    }
+
+    for (i = 0; i < ZLMB_SYSLOGD_BATCH; i++) {
+        self->iovecs[i].iov_base = self->buffer + i * ZLMB_SYSLOGD_MESSAGE_SIZE;
+        self->iovecs[i].iov_len = ZLMB_SYSLOGD_MESSAGE_SIZE;
+        self->headers[i].msg_hdr.msg_iov = &self->iovecs[i];
+        self->headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    str = strdup(endpoints);
+    if (!str) {
+        zlmb_syslogd_destroy(&self);
+        return NULL;
+    }
+
+    token = strtok_r(str, ",", &saveptr);
+    while (token) {
+        if (_syslogd_open(self, token) == -1) {
+            free(str);
+            zlmb_syslogd_destroy(&self);
+            return NULL;
+        }
+        token = strtok_r(NULL, ",", &saveptr);
+    }
+
+    free(str);
+
+    if (self->count == 0) {
+        zlmb_syslogd_destroy(&self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+zlmb_syslogd_destroy(zlmb_syslogd_t **self)
+{
+    int i;
+
+    if (!*self) {
+        return;
+    }
+
+    for (i = 0; i < (*self)->count; i++) {
+        close((*self)->sockets[i].fd);
+        if ((*self)->sockets[i].path) {
+            unlink((*self)->sockets[i].path);
+            free((*self)->sockets[i].path);
+        }
+    }
+
+    if ((*self)->buffer) {
+        free((*self)->buffer);
+    }
+    if ((*self)->iovecs) {
+        free((*self)->iovecs);
+    }
+    if ((*self)->headers) {
+        free((*self)->headers);
+    }
+
+    free(*self);
+    *self = NULL;
+}
+
+int
+zlmb_syslogd_fd(zlmb_syslogd_t *self, int index)
+{
+    if (!self || index < 0 || index >= self->count) {
+        return -1;
+    }
+
+    return self->sockets[index].fd;
+}
+
+int
+zlmb_syslogd_recv(zlmb_syslogd_t *self, int index)
+{
+    int i, n;
+
+    if (!self || index < 0 || index >= self->count) {
+        return -1;
+    }
+
+    for (i = 0; i < ZLMB_SYSLOGD_BATCH; i++) {
+        self->headers[i].msg_hdr.msg_flags = 0;
+        self->headers[i].msg_len = 0;
+    }
+
+    n = recvmmsg(self->sockets[index].fd, self->headers,
+                 ZLMB_SYSLOGD_BATCH, MSG_DONTWAIT, NULL);
+    if (n <= 0) {
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        }
+        return n;
+    }
+
+    self->batches++;
+
+    for (i = 0; i < n; i++) {
+        zlmb_syslogd_message_t *message = &self->messages[i];
+        size_t len = self->headers[i].msg_len;
+
+        message->data = (char *)self->iovecs[i].iov_base;
+
+        if (self->headers[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            self->truncated++;
+            len = ZLMB_SYSLOGD_MESSAGE_SIZE;
+        }
+
+        /* trailing newline and nul (local senders) */
+        while (len > 0 && (message->data[len - 1] == '\n' ||
+                           message->data[len - 1] == '\0')) {
+            len--;
+        }
+
+        message->len = len;
+
+        if (self->parse) {
+            message->key_len = zlmb_syslogd_parse(message->data, len,
+                                                  message->key,
+                                                  sizeof(message->key));
+        } else {
+            message->key_len = 0;
+        }
+    }
+
+    self->received += n;
+
+    return n;
+}
+
+zlmb_syslogd_message_t *
+zlmb_syslogd_message(zlmb_syslogd_t *self, int n)
+{
+    if (!self || n < 0 || n >= ZLMB_SYSLOGD_BATCH) {
+        return NULL;
+    }
+
+    return &self->messages[n];
+}
+
+static size_t
+_syslogd_token(char *data, size_t len, size_t *pos, char **token)
+{
+    size_t start, end;
+
+    start = *pos;
+    while (start < len && data[start] == ' ') {
+        start++;
+    }
+
+    end = start;
+    while (end < len && data[end] != ' ') {
+        end++;
+    }
+
+    *token = data + start;
+    *pos = end;
+
+    return end - start;
+}
+
+int
+zlmb_syslogd_parse(char *data, size_t len, char *key, size_t size)
+{
+    int pri = 13, n;
+    size_t pos = 0, app_len = 0, tag;
+    char *app = NULL;
+
+    if (!data || !key || size == 0) {
+        return 0;
+    }
+
+    /* <PRI>: default user.notice (RFC3164 4.3.3) */
+    if (len > 2 && data[0] == '<') {
+        int value = 0;
+        size_t i = 1;
+        while (i < len && i <= 4 && data[i] >= '0' && data[i] <= '9') {
+            value = value * 10 + (data[i] - '0');
+            i++;
+        }
+        if (i > 1 && i < len && data[i] == '>' && value <= 191) {
+            pri = value;
+            pos = i + 1;
+        }
+    }
+
+    if (pos + 2 <= len && data[pos] == '1' && data[pos + 1] == ' ') {
+        /* RFC5424: VERSION TIMESTAMP HOSTNAME APP-NAME ... */
+        char *token;
+        pos += 2;
+        _syslogd_token(data, len, &pos, &token);
+        _syslogd_token(data, len, &pos, &token);
+        app_len = _syslogd_token(data, len, &pos, &app);
+        if (app_len == 1 && *app == '-') {
+            app_len = 0;
+        }
+    } else {
+        /* RFC3164: [TIMESTAMP] [HOSTNAME] TAG[PID]: MSG */
+        if (pos + 16 <= len && data[pos + 3] == ' ' && data[pos + 6] == ' ' &&
+            data[pos + 9] == ':' && data[pos + 12] == ':' &&
+            data[pos + 15] == ' ') {
+            pos += 16;
+        }
+
+        app_len = _syslogd_token(data, len, &pos, &app);
+
+        /* hostname: local senders omit it */
+        if (app_len > 0 && !memchr(app, ':', app_len) &&
+            !memchr(app, '[', app_len)) {
+            char *next;
+            size_t next_len, next_pos = pos;
+            next_len = _syslogd_token(data, len, &next_pos, &next);
+            if (next_len > 0 &&
+                (memchr(next, ':', next_len) || memchr(next, '[', next_len))) {
+                app = next;
+                app_len = next_len;
+            }
+        }
+
+        for (tag = 0; tag < app_len; tag++) {
+            if (app[tag] == '[' || app[tag] == ':') {
+                break;
+            }
+        }
+        app_len = tag;
+    }
+
+    n = snprintf(key, size, "%s.%s.%.*s",
+                 _syslogd_facility[pri >> 3], _syslogd_severity[pri & 7],
+                 (int)app_len, app ? app : "");
+    if (n < 0) {
+        return 0;
+    } else if ((size_t)n >= size) {
+        return (int)size - 1;
+    }
+
+    return n;
+}
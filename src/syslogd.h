@@ -0,0 +1,50 @@
+#ifndef __ZLMB_SYSLOGD_H__
+#define __ZLMB_SYSLOGD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#define ZLMB_SYSLOGD_SOCKET_MAX   16
+#define ZLMB_SYSLOGD_BATCH        64
+#define ZLMB_SYSLOGD_MESSAGE_SIZE 8192
+#define ZLMB_SYSLOGD_KEY_SIZE     64
+#define ZLMB_SYSLOGD_RCVBUF       (4 * 1024 * 1024)
+
+#define ZLMB_SYSLOGD_ENDPOINT_UDP  "udp://"
+#define ZLMB_SYSLOGD_ENDPOINT_UNIX "unix://"
+
+typedef struct zlmb_syslogd_message {
+    char *data;
+    size_t len;
+    char key[ZLMB_SYSLOGD_KEY_SIZE];
+    size_t key_len;
+} zlmb_syslogd_message_t;
+
+typedef struct zlmb_syslogd_socket {
+    int fd;
+    char *path;
+} zlmb_syslogd_socket_t;
+
+typedef struct zlmb_syslogd {
+    int parse;
+    int count;
+    zlmb_syslogd_socket_t sockets[ZLMB_SYSLOGD_SOCKET_MAX];
+    char *buffer;
+    struct iovec *iovecs;
+    struct mmsghdr *headers;
+    zlmb_syslogd_message_t messages[ZLMB_SYSLOGD_BATCH];
+    uint64_t received;
+    uint64_t truncated;
+    uint64_t batches;
+} zlmb_syslogd_t;
+
+zlmb_syslogd_t * zlmb_syslogd_init(char *endpoints, int parse);
+void zlmb_syslogd_destroy(zlmb_syslogd_t **self);
+int zlmb_syslogd_fd(zlmb_syslogd_t *self, int index);
+int zlmb_syslogd_recv(zlmb_syslogd_t *self, int index);
+zlmb_syslogd_message_t * zlmb_syslogd_message(zlmb_syslogd_t *self, int n);
+
+int zlmb_syslogd_parse(char *data, size_t len, char *key, size_t size);
+
+#endif
@@ -0,0 +1,678 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "tail.h"
+
+/*
+ * tail: follow files with one inotify descriptor
+ *   file: IN_MODIFY (append/truncate), IN_MOVE_SELF/IN_DELETE_SELF (rotate)
+ *   directory: IN_CREATE/IN_MOVED_TO (rotated file is created again)
+ *   offset: advanced after the lines are queued to the socket (no
+ *           acknowledgement), saved by zlmb_tail_sync()
+ *           ("dev ino offset path" per line, written to a temporary file,
+ *            fsync and rename)
+ */
+
+#define ZLMB_TAIL_FILE_EVENTS (IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)
+#define ZLMB_TAIL_DIR_EVENTS  (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)
+
+static int
+_tail_watch(zlmb_tail_t *self, int wd, long value)
+{
+    if (wd < 0) {
+        return -1;
+    }
+
+    if ((size_t)wd >= self->nwatches) {
+        size_t size = self->nwatches ? self->nwatches : 64;
+        long *watches;
+
+        while (size <= (size_t)wd) {
+            size *= 2;
+        }
+
+        watches = (long *)realloc(self->watches, size * sizeof(long));
+        if (!watches) {
+            return -1;
+        }
+
+        memset(watches + self->nwatches, 0,
+               (size - self->nwatches) * sizeof(long));
+
+        self->watches = watches;
+        self->nwatches = size;
+    }
+
+    self->watches[wd] = value;
+
+    return 0;
+}
+
+static void
+_tail_offset_load(zlmb_tail_t *self)
+{
+    FILE *fp;
+    char line[BUFSIZ];
+
+    fp = fopen(self->offsetfile, "r");
+    if (!fp) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        zlmb_tail_offset_t *offsets;
+        unsigned long dev, ino;
+        long long offset;
+        char *p;
+        int n = 0;
+
+        if ((p = strrchr(line, '\n')) != NULL) {
+            *p = '\0';
+        }
+
+        if (sscanf(line, "%lu %lu %lld %n", &dev, &ino, &offset, &n) != 3 ||
+            n == 0 || line[n] == '\0') {
+            continue;
+        }
+
+        offsets = (zlmb_tail_offset_t *)realloc(self->offsets,
+                                                (self->noffsets + 1) *
+                                                sizeof(zlmb_tail_offset_t));
+        if (!offsets) {
+            break;
+        }
+        self->offsets = offsets;
+
+        offsets[self->noffsets].path = strdup(line + n);
+        if (!offsets[self->noffsets].path) {
+            break;
+        }
+        offsets[self->noffsets].dev = (dev_t)dev;
+        offsets[self->noffsets].ino = (ino_t)ino;
+        offsets[self->noffsets].offset = (off_t)offset;
+        self->noffsets++;
+    }
+
+    fclose(fp);
+}
+
+static zlmb_tail_offset_t *
+_tail_offset_find(zlmb_tail_t *self, char *path)
+{
+    size_t i;
+
+    for (i = 0; i < self->noffsets; i++) {
+        if (strcmp(self->offsets[i].path, path) == 0) {
+            return &self->offsets[i];
+        }
+    }
+
+    return NULL;
+}
+
+zlmb_tail_t *
+zlmb_tail_init(char *offsetfile, int lines, int beginning)
+{
+    zlmb_tail_t *self;
+
+    if (!offsetfile || strlen(offsetfile) == 0) {
+        return NULL;
+    }
+
+    if (lines <= 0) {
+        lines = 1;
+    } else if (lines > ZLMB_TAIL_LINES_MAX) {
+        lines = ZLMB_TAIL_LINES_MAX;
+    }
+
+    self = (zlmb_tail_t *)malloc(sizeof(zlmb_tail_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_tail_t));
+
+    self->lines = lines;
+    self->beginning = beginning;
+
+    self->offsetfile = strdup(offsetfile);
+    self->buffer = (char *)malloc(ZLMB_TAIL_BUFFER_SIZE);
+    self->iovecs = (struct iovec *)calloc(lines, sizeof(struct iovec));
+    if (!self->offsetfile || !self->buffer || !self->iovecs) {
+        self->fd = -1;
+        zlmb_tail_destroy(&self);
+        return NULL;
+    }
+
+    self->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (self->fd == -1) {
+        zlmb_tail_destroy(&self);
+        return NULL;
+    }
+
+    _tail_offset_load(self);
+
+    return self;
+}
+
+void
+zlmb_tail_destroy(zlmb_tail_t **self)
+{
+    size_t i;
+
+    if (!*self) {
+        return;
+    }
+
+    for (i = 0; i < (*self)->nfiles; i++) {
+        if ((*self)->files[i].fd != -1) {
+            close((*self)->files[i].fd);
+        }
+        free((*self)->files[i].path);
+        free((*self)->files[i].name);
+    }
+    for (i = 0; i < (*self)->ndirs; i++) {
+        free((*self)->dirs[i].path);
+    }
+    for (i = 0; i < (*self)->noffsets; i++) {
+        free((*self)->offsets[i].path);
+    }
+
+    if ((*self)->fd != -1) {
+        close((*self)->fd);
+    }
+
+    free((*self)->files);
+    free((*self)->dirs);
+    free((*self)->offsets);
+    free((*self)->watches);
+    free((*self)->buffer);
+    free((*self)->iovecs);
+    free((*self)->offsetfile);
+    free(*self);
+    *self = NULL;
+}
+
+int
+zlmb_tail_fd(zlmb_tail_t *self)
+{
+    if (!self) {
+        return -1;
+    }
+
+    return self->fd;
+}
+
+static long
+_tail_dir(zlmb_tail_t *self, char *path)
+{
+    zlmb_tail_dir_t *dirs;
+    size_t i;
+    int wd;
+
+    for (i = 0; i < self->ndirs; i++) {
+        if (strcmp(self->dirs[i].path, path) == 0) {
+            return (long)i;
+        }
+    }
+
+    wd = inotify_add_watch(self->fd, path, ZLMB_TAIL_DIR_EVENTS);
+    if (wd == -1) {
+        return -1;
+    }
+
+    dirs = (zlmb_tail_dir_t *)realloc(self->dirs, (self->ndirs + 1) *
+                                      sizeof(zlmb_tail_dir_t));
+    if (!dirs) {
+        return -1;
+    }
+    self->dirs = dirs;
+
+    dirs[self->ndirs].path = strdup(path);
+    if (!dirs[self->ndirs].path) {
+        return -1;
+    }
+    dirs[self->ndirs].wd = wd;
+
+    if (_tail_watch(self, wd, -(long)(self->ndirs + 1)) == -1) {
+        free(dirs[self->ndirs].path);
+        return -1;
+    }
+
+    return (long)(self->ndirs++);
+}
+
+static void
+_tail_close(zlmb_tail_t *self, size_t index)
+{
+    zlmb_tail_file_t *file = &self->files[index];
+
+    if (file->wd != -1) {
+        if ((size_t)file->wd < self->nwatches &&
+            self->watches[file->wd] == (long)(index + 1)) {
+            self->watches[file->wd] = 0;
+        }
+        inotify_rm_watch(self->fd, file->wd);
+        file->wd = -1;
+    }
+
+    if (file->fd != -1) {
+        close(file->fd);
+        file->fd = -1;
+    }
+
+    file->state = 0;
+}
+
+static int
+_tail_open(zlmb_tail_t *self, size_t index, int start)
+{
+    zlmb_tail_file_t *file = &self->files[index];
+    zlmb_tail_offset_t *offset;
+    struct stat st;
+    int fd, wd;
+
+    fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    wd = inotify_add_watch(self->fd, file->path, ZLMB_TAIL_FILE_EVENTS);
+    if (wd == -1 || _tail_watch(self, wd, (long)(index + 1)) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    file->fd = fd;
+    file->wd = wd;
+    file->dev = st.st_dev;
+    file->ino = st.st_ino;
+    file->state = ZLMB_TAIL_FILE_OPEN;
+
+    if (start) {
+        /* first open: saved offset of the same file, or end of file */
+        offset = _tail_offset_find(self, file->path);
+        if (offset && offset->dev == st.st_dev && offset->ino == st.st_ino &&
+            offset->offset <= st.st_size) {
+            file->offset = offset->offset;
+        } else if (offset || self->beginning) {
+            file->offset = 0;
+        } else {
+            file->offset = st.st_size;
+        }
+    } else {
+        /* created (rotated): from the beginning */
+        file->offset = 0;
+    }
+
+    self->dirty = 1;
+
+    return 0;
+}
+
+int
+zlmb_tail_add(zlmb_tail_t *self, char *path)
+{
+    zlmb_tail_file_t *files, *file;
+    char *str;
+    long dir;
+
+    if (!self || !path || strlen(path) == 0) {
+        return -1;
+    }
+
+    str = strdup(path);
+    if (!str) {
+        return -1;
+    }
+
+    dir = _tail_dir(self, dirname(str));
+    free(str);
+    if (dir == -1) {
+        return -1;
+    }
+
+    files = (zlmb_tail_file_t *)realloc(self->files, (self->nfiles + 1) *
+                                        sizeof(zlmb_tail_file_t));
+    if (!files) {
+        return -1;
+    }
+    self->files = files;
+
+    file = &files[self->nfiles];
+    memset(file, 0, sizeof(zlmb_tail_file_t));
+
+    file->fd = -1;
+    file->wd = -1;
+    file->dir = (size_t)dir;
+    file->path = strdup(path);
+    str = strdup(path);
+    if (!file->path || !str) {
+        free(file->path);
+        free(str);
+        return -1;
+    }
+    file->name = strdup(basename(str));
+    free(str);
+    if (!file->name) {
+        free(file->path);
+        return -1;
+    }
+
+    self->nfiles++;
+
+    /* not exists: wait for the directory event */
+    _tail_open(self, self->nfiles - 1, 1);
+
+    return 0;
+}
+
+static int
+_tail_send(zlmb_tail_t *self, zlmb_tail_file_t *file, int count,
+           zlmb_tail_send_t send, void *arg)
+{
+    int i;
+
+    if (send(arg, file->path, self->iovecs, count) == -1) {
+        return -1;
+    }
+
+    self->messages++;
+    for (i = 0; i < count; i++) {
+        self->bytes += self->iovecs[i].iov_len;
+    }
+
+    return 0;
+}
+
+static int
+_tail_read(zlmb_tail_t *self, size_t index, int final,
+           zlmb_tail_send_t send, void *arg)
+{
+    zlmb_tail_file_t *file = &self->files[index];
+    struct stat st;
+
+    if (file->fd == -1) {
+        return 0;
+    }
+
+    /* truncated (copytruncate) */
+    if (fstat(file->fd, &st) == 0 && st.st_size < file->offset) {
+        file->offset = 0;
+        self->truncated++;
+        self->dirty = 1;
+    }
+
+    while (1) {
+        ssize_t n, i, start = 0, sent = 0;
+        int count = 0;
+
+        n = pread(file->fd, self->buffer, ZLMB_TAIL_BUFFER_SIZE, file->offset);
+        if (n <= 0) {
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (self->buffer[i] != '\n') {
+                continue;
+            }
+
+            self->iovecs[count].iov_base = self->buffer + start;
+            self->iovecs[count].iov_len = i - start;
+            count++;
+            start = i + 1;
+
+            if (count == self->lines) {
+                if (_tail_send(self, file, count, send, arg) == -1) {
+                    return -1;
+                }
+                file->offset += start - sent;
+                sent = start;
+                count = 0;
+                self->dirty = 1;
+            }
+        }
+
+        if (count > 0) {
+            if (_tail_send(self, file, count, send, arg) == -1) {
+                return -1;
+            }
+            file->offset += start - sent;
+            sent = start;
+            self->dirty = 1;
+        }
+
+        /* line longer than the buffer, or the last line of a rotated file */
+        if (start < n && ((start == 0 && n == ZLMB_TAIL_BUFFER_SIZE) ||
+                          (final && n < ZLMB_TAIL_BUFFER_SIZE))) {
+            self->iovecs[0].iov_base = self->buffer + start;
+            self->iovecs[0].iov_len = n - start;
+            if (_tail_send(self, file, 1, send, arg) == -1) {
+                return -1;
+            }
+            file->offset += n - start;
+            self->dirty = 1;
+        } else if (start == 0) {
+            /* incomplete line: wait for the newline */
+            break;
+        }
+
+        if (n < ZLMB_TAIL_BUFFER_SIZE) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+int
+zlmb_tail_scan(zlmb_tail_t *self, zlmb_tail_send_t send, void *arg)
+{
+    size_t i;
+
+    if (!self || !send) {
+        return -1;
+    }
+
+    for (i = 0; i < self->nfiles; i++) {
+        if (self->files[i].fd == -1) {
+            if (_tail_open(self, i, 0) == -1) {
+                continue;
+            }
+        }
+        if (_tail_read(self, i, 0, send, arg) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+_tail_created(zlmb_tail_t *self, size_t dir, char *name,
+              zlmb_tail_send_t send, void *arg)
+{
+    size_t i;
+
+    for (i = 0; i < self->nfiles; i++) {
+        zlmb_tail_file_t *file = &self->files[i];
+        struct stat st;
+
+        if (file->dir != dir || strcmp(file->name, name) != 0) {
+            continue;
+        }
+
+        if (stat(file->path, &st) == -1) {
+            continue;
+        }
+
+        if (file->fd != -1) {
+            if (file->dev == st.st_dev && file->ino == st.st_ino) {
+                continue;
+            }
+
+            /* rotated: rest of the old file */
+            if (_tail_read(self, i, 1, send, arg) == -1) {
+                return -1;
+            }
+            _tail_close(self, i);
+            self->rotated++;
+        }
+
+        if (_tail_open(self, i, 0) == 0 &&
+            _tail_read(self, i, 0, send, arg) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+zlmb_tail_event(zlmb_tail_t *self, zlmb_tail_send_t send, void *arg)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int overflow = 0;
+
+    if (!self || !send) {
+        return -1;
+    }
+
+    while (1) {
+        ssize_t n, pos;
+
+        n = read(self->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+
+        for (pos = 0; pos < n;
+             pos += sizeof(struct inotify_event) +
+                 ((struct inotify_event *)(buf + pos))->len) {
+            struct inotify_event *event = (struct inotify_event *)(buf + pos);
+            long value = 0;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = 1;
+                continue;
+            }
+
+            if (event->wd >= 0 && (size_t)event->wd < self->nwatches) {
+                value = self->watches[event->wd];
+            }
+
+            if (event->mask & IN_IGNORED) {
+                if (value > 0) {
+                    self->files[value - 1].wd = -1;
+                }
+                if (value != 0) {
+                    self->watches[event->wd] = 0;
+                }
+                continue;
+            }
+
+            if (value > 0) {
+                size_t index = (size_t)(value - 1);
+
+                if (_tail_read(self, index,
+                               (event->mask & IN_DELETE_SELF) ? 1 : 0,
+                               send, arg) == -1) {
+                    return -1;
+                }
+
+                if (event->mask & IN_DELETE_SELF) {
+                    _tail_close(self, index);
+                } else if (event->mask & IN_MOVE_SELF) {
+                    /* keep reading until the file is created again */
+                    self->files[index].state = ZLMB_TAIL_FILE_ROTATED;
+                }
+            } else if (value < 0 && event->len > 0 &&
+                       (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                if (_tail_created(self, (size_t)(-value - 1), event->name,
+                                  send, arg) == -1) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    /* events lost: read all files */
+    if (overflow) {
+        return zlmb_tail_scan(self, send, arg);
+    }
+
+    return 0;
+}
+
+int
+zlmb_tail_sync(zlmb_tail_t *self)
+{
+    FILE *fp;
+    char *tmp;
+    size_t i, size;
+
+    if (!self) {
+        return -1;
+    }
+
+    if (!self->dirty) {
+        return 0;
+    }
+
+    size = strlen(self->offsetfile) + 5;
+    tmp = (char *)malloc(size);
+    if (!tmp) {
+        return -1;
+    }
+    snprintf(tmp, size, "%s.tmp", self->offsetfile);
+
+    fp = fopen(tmp, "w");
+    if (!fp) {
+        free(tmp);
+        return -1;
+    }
+
+    for (i = 0; i < self->nfiles; i++) {
+        zlmb_tail_file_t *file = &self->files[i];
+        if (file->ino == 0) {
+            continue;
+        }
+        fprintf(fp, "%lu %lu %lld %s\n",
+                (unsigned long)file->dev, (unsigned long)file->ino,
+                (long long)file->offset, file->path);
+    }
+
+    if (fflush(fp) != 0 || fsync(fileno(fp)) == -1) {
+        fclose(fp);
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    if (rename(tmp, self->offsetfile) == -1) {
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+
+    free(tmp);
+
+    self->dirty = 0;
+    self->syncs++;
+
+    return 0;
+}
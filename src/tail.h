@@ -0,0 +1,77 @@
+#ifndef __ZLMB_TAIL_H__
+#define __ZLMB_TAIL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define ZLMB_TAIL_BUFFER_SIZE  65536
+#define ZLMB_TAIL_LINES_MAX    1024
+#define ZLMB_TAIL_DEFAULT_SYNC 1000
+#define ZLMB_TAIL_SNDHWM       100
+#define ZLMB_TAIL_LINGER       1000
+
+#define ZLMB_TAIL_FILE_OPEN    1
+#define ZLMB_TAIL_FILE_ROTATED 2
+
+/* send lines (iovec without newline), -1: retry from the same offset */
+typedef int (*zlmb_tail_send_t)(void *arg, char *path,
+                                struct iovec *lines, int count);
+
+typedef struct zlmb_tail_file {
+    char *path;
+    char *name;
+    size_t dir;
+    int wd;
+    int fd;
+    int state;
+    dev_t dev;
+    ino_t ino;
+    off_t offset;
+} zlmb_tail_file_t;
+
+typedef struct zlmb_tail_dir {
+    char *path;
+    int wd;
+} zlmb_tail_dir_t;
+
+typedef struct zlmb_tail_offset {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t offset;
+} zlmb_tail_offset_t;
+
+typedef struct zlmb_tail {
+    int fd;
+    int beginning;
+    int lines;
+    int dirty;
+    char *offsetfile;
+    zlmb_tail_file_t *files;
+    size_t nfiles;
+    zlmb_tail_dir_t *dirs;
+    size_t ndirs;
+    long *watches;
+    size_t nwatches;
+    zlmb_tail_offset_t *offsets;
+    size_t noffsets;
+    char *buffer;
+    struct iovec *iovecs;
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t rotated;
+    uint64_t truncated;
+    uint64_t syncs;
+} zlmb_tail_t;
+
+zlmb_tail_t * zlmb_tail_init(char *offsetfile, int lines, int beginning);
+void zlmb_tail_destroy(zlmb_tail_t **self);
+int zlmb_tail_add(zlmb_tail_t *self, char *path);
+int zlmb_tail_fd(zlmb_tail_t *self);
+int zlmb_tail_scan(zlmb_tail_t *self, zlmb_tail_send_t send, void *arg);
+int zlmb_tail_event(zlmb_tail_t *self, zlmb_tail_send_t send, void *arg);
+int zlmb_tail_sync(zlmb_tail_t *self);
+
+#endif
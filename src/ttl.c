@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fnmatch.h>
+
+#include "ttl.h"
+
+#define ZLMB_TTL_KEY_SIZE 256
+
+/*
+ * ttl frame (trailer of a message, added at the client stage):
+ *   magic(4) | ingress time(8, milliseconds, big endian) |
+ *   ttl(4, seconds, big endian)
+ *
+ * ttl is carried in the frame: any stage (and zlmb-dump) can drop an
+ * expired message without the rules.
+ */
+static const unsigned char zlmb_ttl_magic[4] = { 0x00, 0x7a, 0x74, 0x6c };
+
+static void
+_ttl_put(unsigned char *buf, uint64_t val, int len)
+{
+    int i;
+
+    for (i = len - 1; i >= 0; i--) {
+        buf[i] = (unsigned char)(val & 0xff);
+        val >>= 8;
+    }
+}
+
+static uint64_t
+_ttl_get(const unsigned char *buf, int len)
+{
+    int i;
+    uint64_t val = 0;
+
+    for (i = 0; i < len; i++) {
+        val = (val << 8) | buf[i];
+    }
+
+    return val;
+}
+
+/* rules: pattern=seconds[,pattern=seconds ...] (first match) */
+zlmb_ttl_t *
+zlmb_ttl_init(char *rules)
+{
+    zlmb_ttl_t *self;
+    char *buf, *token, *save = NULL;
+
+    if (!rules || strlen(rules) == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = (zlmb_ttl_t *)malloc(sizeof(zlmb_ttl_t));
+    if (!self) {
+        return NULL;
+    }
+
+    memset(self, 0, sizeof(zlmb_ttl_t));
+
+    buf = strdup(rules);
+    if (!buf) {
+        free(self);
+        return NULL;
+    }
+
+    token = strtok_r(buf, ",", &save);
+    while (token) {
+        char *value = strrchr(token, '=');
+        long ttl;
+
+        if (!value || value == token || self->count >= ZLMB_TTL_RULES) {
+            break;
+        }
+
+        *value++ = '\0';
+        ttl = strtol(value, NULL, 10);
+        if (ttl <= 0) {
+            break;
+        }
+
+        self->rules[self->count].pattern = strdup(token);
+        if (!self->rules[self->count].pattern) {
+            break;
+        }
+        self->rules[self->count].ttl = (uint32_t)ttl;
+        self->count++;
+
+        token = strtok_r(NULL, ",", &save);
+    }
+
+    free(buf);
+
+    if (token || self->count == 0) {
+        zlmb_ttl_destroy(&self);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return self;
+}
+
+void
+zlmb_ttl_destroy(zlmb_ttl_t **self)
+{
+    if (*self) {
+        size_t i;
+        for (i = 0; i < (*self)->count; i++) {
+            free((*self)->rules[i].pattern);
+        }
+        free(*self);
+        *self = NULL;
+    }
+}
+
+uint32_t
+zlmb_ttl_lookup(zlmb_ttl_t *self, const void *key, size_t len)
+{
+    char buf[ZLMB_TTL_KEY_SIZE];
+    size_t i;
+
+    if (!self) {
+        return 0;
+    }
+
+    if (len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    if (len > 0) {
+        memcpy(buf, key, len);
+    }
+    buf[len] = '\0';
+
+    for (i = 0; i < self->count; i++) {
+        if (fnmatch(self->rules[i].pattern, buf, 0) == 0) {
+            return self->rules[i].ttl;
+        }
+    }
+
+    return 0;
+}
+
+/* wall clock: compared between hosts */
+uint64_t
+zlmb_ttl_now(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return 0;
+    }
+
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+size_t
+zlmb_ttl_frame(unsigned char *buf, uint64_t stamp, uint32_t ttl)
+{
+    if (!buf) {
+        return 0;
+    }
+
+    memcpy(buf, zlmb_ttl_magic, sizeof(zlmb_ttl_magic));
+    _ttl_put(buf + 4, stamp, 8);
+    _ttl_put(buf + 12, ttl, 4);
+
+    return ZLMB_TTL_FRAME_SIZE;
+}
+
+int
+zlmb_ttl_parse(const void *data, size_t len, uint64_t *stamp, uint32_t *ttl)
+{
+    const unsigned char *buf = (const unsigned char *)data;
+
+    if (!buf || len != ZLMB_TTL_FRAME_SIZE ||
+        memcmp(buf, zlmb_ttl_magic, sizeof(zlmb_ttl_magic)) != 0) {
+        return -1;
+    }
+
+    if (stamp) {
+        *stamp = _ttl_get(buf + 4, 8);
+    }
+    if (ttl) {
+        *ttl = (uint32_t)_ttl_get(buf + 12, 4);
+    }
+
+    return 0;
+}
+
+int
+zlmb_ttl_check(const void *data, size_t len, uint64_t now)
+{
+    uint64_t stamp;
+    uint32_t ttl;
+
+    if (zlmb_ttl_parse(data, len, &stamp, &ttl) != 0) {
+        return ZLMB_TTL_NONE;
+    }
+
+    if (ttl > 0 && now > stamp + (uint64_t)ttl * 1000) {
+        return ZLMB_TTL_EXPIRED;
+    }
+
+    return ZLMB_TTL_LIVE;
+}
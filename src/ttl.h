@@ -0,0 +1,35 @@
+#ifndef __ZLMB_TTL_H__
+#define __ZLMB_TTL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ZLMB_TTL_FRAME_SIZE 16
+#define ZLMB_TTL_RULES      32
+
+#define ZLMB_TTL_LIVE     0
+#define ZLMB_TTL_EXPIRED  1
+#define ZLMB_TTL_NONE    -1
+
+typedef struct zlmb_ttl_rule {
+    char *pattern;
+    uint32_t ttl;
+} zlmb_ttl_rule_t;
+
+typedef struct zlmb_ttl {
+    size_t count;
+    zlmb_ttl_rule_t rules[ZLMB_TTL_RULES];
+    uint64_t stamped;
+    uint64_t expired;
+    uint64_t expired_bytes;
+} zlmb_ttl_t;
+
+zlmb_ttl_t * zlmb_ttl_init(char *rules);
+void zlmb_ttl_destroy(zlmb_ttl_t **self);
+uint32_t zlmb_ttl_lookup(zlmb_ttl_t *self, const void *key, size_t len);
+uint64_t zlmb_ttl_now(void);
+size_t zlmb_ttl_frame(unsigned char *buf, uint64_t stamp, uint32_t ttl);
+int zlmb_ttl_parse(const void *data, size_t len, uint64_t *stamp, uint32_t *ttl);
+int zlmb_ttl_check(const void *data, size_t len, uint64_t now);
+
+#endif
@@ -1,6 +1,11 @@
 #ifndef __ZLMB_UTILS_H__
 #define __ZLMB_UTILS_H__
 
+#include <stdint.h>
+#include <stddef.h>
+
 int zlmb_utils_asprintf(char **str, const char *format, ...);
+uint64_t zlmb_utils_hash(const void *data, size_t len, uint64_t seed);
+uint64_t zlmb_utils_clock(void);
 
 #endif
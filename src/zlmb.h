@@ -18,6 +18,7 @@
 #define ZLMB_PUB_BACK  (1<<3)
 #define ZLMB_SUB_FRONT (1<<4)
 #define ZLMB_SUB_BACK  (1<<5)
+#define ZLMB_PIPELINE  (1<<6)
 
 #define ZLMB_MODE_CLIENT            (ZLMB_CLI_FRONT|ZLMB_CLI_BACK)
 #define ZLMB_MODE_PUBLISH           (ZLMB_PUB_FRONT|ZLMB_PUB_BACK)
@@ -26,8 +27,11 @@
 #define ZLMB_MODE_CLIENT_SUBSCRIBE  (ZLMB_CLI_FRONT|ZLMB_CLI_BACK|ZLMB_SUB_FRONT|ZLMB_SUB_BACK)
 #define ZLMB_MODE_PUBLISH_SUBSCRIBE (ZLMB_PUB_FRONT|ZLMB_SUB_BACK)
 #define ZLMB_MODE_STAND_ALONE       (ZLMB_CLI_FRONT|ZLMB_SUB_BACK)
+#define ZLMB_MODE_PIPELINE          (ZLMB_MODE_CLIENT|ZLMB_MODE_PUBLISH|ZLMB_MODE_SUBSCRIBE|ZLMB_PIPELINE)
 
 #define ZLMB_DEFAULT_CLIENT_DUMP_FILE    "/tmp/zlmb-client-dump.dat"
 #define ZLMB_DEFAULT_SUBSCRIBE_DUMP_FILE "/tmp/zlmb-subscribe-dump.dat"
+#define ZLMB_DEFAULT_SUBSCRIBE_OFFSET_FILE "/tmp/zlmb-subscribe-offset.dat"
+#define ZLMB_DEFAULT_TAIL_OFFSET_FILE    "/tmp/zlmb-tail-offset.dat"
 
 #endif